@@ -28,6 +28,7 @@
 #ifndef __RIJNDAEL_H
 #define __RIJNDAEL_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 #define AES_MAXKEYBITS	(256)
@@ -42,12 +43,29 @@ typedef uint8_t		aes_u8;
 typedef uint16_t	aes_u16;
 typedef uint32_t	aes_u32;
 
+/* AES-NI is available as alternative encryption backend on x86 when
+ * building with gcc or clang. Define RIJNDAEL_NO_AESNI to disable it. */
+#if !defined(RIJNDAEL_NO_AESNI) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define RIJNDAEL_AESNI 1
+#endif
+
+/* AES implementations that can be selected with rijndael_set_impl() */
+typedef enum {
+	RIJNDAEL_IMPL_AUTO = 0,		/* AES-NI if the CPU supports it */
+	RIJNDAEL_IMPL_TABLES,		/* portable T-table implementation */
+	RIJNDAEL_IMPL_AESNI		/* AES-NI instructions */
+} rijndael_impl_t;
+
 /*  The structure for key information */
 typedef struct {
 #ifdef WITH_AES_DECRYPT
 	int	enc_only;		/* context contains only encrypt schedule */
 #endif
 	int	Nr;			/* key-length-dependent number of rounds */
+#ifdef RIJNDAEL_AESNI
+	int	aesni;			/* ek is an AES-NI round key schedule */
+#endif
 	aes_u32	ek[4*(AES_MAXROUNDS + 1)];	/* encrypt key schedule */
 #ifdef WITH_AES_DECRYPT
 	aes_u32	dk[4*(AES_MAXROUNDS + 1)];	/* decrypt key schedule */
@@ -58,6 +76,45 @@ int	 rijndael_set_key(rijndael_ctx *, const u_char *, int);
 int	 rijndael_set_key_enc_only(rijndael_ctx *, const u_char *, int);
 void	 rijndael_decrypt(rijndael_ctx *, const u_char *, u_char *);
 void	 rijndael_encrypt(rijndael_ctx *, const u_char *, u_char *);
+/*
+ * Encrypts (or decrypts) nblocks 16-byte blocks of msg in place for
+ * CCM, using the keystream of the counter blocks in ctr, and continues
+ * the CBC-MAC in mac over the cleartext blocks.
+ */
+void	 rijndael_ccm_blocks(rijndael_ctx *, const u_char *ctr, u_char *msg,
+	    size_t nblocks, u_char mac[16], int decrypt);
+/*
+ * Encrypts nblocks independent 16-byte blocks from in to out, block i
+ * with the key schedule ctx[i]. The blocks may use different keys.
+ */
+void	 rijndael_encrypt_multi(rijndael_ctx *ctx[], const u_char *in,
+	    u_char *out, size_t nblocks);
+/*
+ * Encrypts nblocks 16-byte blocks of each of the n messages msg[i] in
+ * place for CCM with the key schedule ctx[i], and continues the CBC-MAC
+ * of message i in mac[16*i..]. The counter block ctr[16*i..] is
+ * incremented before each block and holds the last counter used on
+ * return.
+ */
+void	 rijndael_ccm_multi(rijndael_ctx *ctx[], u_char *ctr, u_char *msg[],
+	    size_t nblocks, u_char *mac, size_t n);
+
+/*
+ * Encrypts (or decrypts) len bytes of msg in place in CTR mode as used
+ * by GCM. The last 32 bits of the counter block ctr are incremented
+ * after each block, ctr holds the next counter block on return.
+ */
+void	 rijndael_ctr32(rijndael_ctx *, u_char ctr[16], u_char *msg,
+	    size_t len);
+
+/*
+ * Selects the implementation used for key schedules set up after this
+ * call. Returns 0 on success, or -1 if impl is not available on this
+ * CPU or build.
+ */
+int	 rijndael_set_impl(rijndael_impl_t impl);
+/* Returns the implementation used for new key schedules. */
+rijndael_impl_t rijndael_get_impl(void);
 
 int	rijndaelKeySetupEnc(aes_u32 rk[/*4*(Nr + 1)*/], const aes_u8 cipherKey[], int keyBits);
 int	rijndaelKeySetupDec(aes_u32 rk[/*4*(Nr + 1)*/], const aes_u8 cipherKey[], int keyBits);
@@ -66,4 +123,15 @@ void	rijndaelEncrypt(const aes_u32 rk[/*4*(Nr + 1)*/], int Nr, const aes_u8 pt[1
 void	rijndaelDecrypt(const aes_u32 rk[/*4*(Nr + 1)*/], int Nr, const aes_u8 ct[16], aes_u8 pt[16]);
 #endif
 
+/* AES-NI backend, see rijndael_aesni.c */
+int	rijndaelAESNIAvailable(void);
+#ifdef RIJNDAEL_AESNI
+int	rijndaelKeySetupEncAESNI(aes_u32 rk[/*4*(Nr + 1)*/], const aes_u8 cipherKey[], int keyBits);
+void	rijndaelEncryptAESNI(const aes_u32 rk[/*4*(Nr + 1)*/], int Nr, const aes_u8 pt[16], aes_u8 ct[16]);
+void	rijndaelCCMBlocksAESNI(const aes_u32 rk[/*4*(Nr + 1)*/], int Nr, const aes_u8 *ctr, aes_u8 *msg, size_t nblocks, aes_u8 mac[16], int decrypt);
+void	rijndaelEncryptMultiAESNI(const aes_u32 *rk[], int Nr, const aes_u8 *in, aes_u8 *out, size_t nblocks);
+void	rijndaelCTR32AESNI(const aes_u32 rk[/*4*(Nr + 1)*/], int Nr, aes_u8 ctr[16], aes_u8 *msg, size_t nblocks);
+void	rijndaelCCMMultiAESNI(const aes_u32 *rk[], int Nr, aes_u8 *ctr, aes_u8 *msg[], size_t nblocks, aes_u8 *mac, size_t n);
+#endif
+
 #endif /* __RIJNDAEL_H */
@@ -0,0 +1,285 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2011-2023 Olaf Bergmann (TZI) and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *******************************************************************************/
+
+/*
+ * AES encryption using the x86 AES-NI instructions. The functions are
+ * compiled for the "aes" target only, so the library itself can still
+ * be built for and run on CPUs without AES-NI. rijndaelAESNIAvailable()
+ * checks the CPU via cpuid before this code is used.
+ */
+
+#include "rijndael.h"
+
+#ifdef RIJNDAEL_AESNI
+
+#include <cpuid.h>
+#include <wmmintrin.h>
+#include <tmmintrin.h>
+
+#ifndef bit_AES
+#define bit_AES (1 << 25)
+#endif
+#ifndef bit_SSSE3
+#define bit_SSSE3 (1 << 9)
+#endif
+
+int
+rijndaelAESNIAvailable(void)
+{
+	static int available = -1;
+	unsigned int eax, ebx, ecx, edx;
+
+	if (available < 0) {
+		available = __get_cpuid(1, &eax, &ebx, &ecx, &edx) &&
+		    (ecx & bit_AES) != 0 && (ecx & bit_SSSE3) != 0;
+	}
+	return available;
+}
+
+/*
+ * Expands the key like rijndaelKeySetupEnc() but stores each round key
+ * in memory byte order as expected by aesenc.
+ */
+int
+rijndaelKeySetupEncAESNI(aes_u32 rk[/*4*(Nr + 1)*/], const aes_u8 cipherKey[], int keyBits)
+{
+	int Nr, i;
+	aes_u32 w;
+	aes_u8 *p;
+
+	Nr = rijndaelKeySetupEnc(rk, cipherKey, keyBits);
+	for (i = 0; i < 4 * (Nr + 1); i++) {
+		w = rk[i];
+		p = (aes_u8 *)&rk[i];
+		p[0] = (aes_u8)(w >> 24);
+		p[1] = (aes_u8)(w >> 16);
+		p[2] = (aes_u8)(w >> 8);
+		p[3] = (aes_u8)w;
+	}
+	return Nr;
+}
+
+__attribute__((target("aes,sse2"))) void
+rijndaelEncryptAESNI(const aes_u32 rk[/*4*(Nr + 1)*/], int Nr, const aes_u8 pt[16],
+    aes_u8 ct[16])
+{
+	const __m128i *k = (const __m128i *)rk;
+	__m128i s;
+	int r;
+
+	s = _mm_xor_si128(_mm_loadu_si128((const __m128i *)pt),
+	    _mm_loadu_si128(k));
+	for (r = 1; r < Nr; r++)
+		s = _mm_aesenc_si128(s, _mm_loadu_si128(k + r));
+	s = _mm_aesenclast_si128(s, _mm_loadu_si128(k + Nr));
+	_mm_storeu_si128((__m128i *)ct, s);
+}
+
+/*
+ * CTR encryption and CBC-MAC of full blocks for CCM, see
+ * rijndael_ccm_blocks(). The keystream of up to eight blocks is
+ * computed in one round loop. When encrypting, the first CBC-MAC step
+ * of the batch runs in the same loop, the others follow one by one as
+ * each depends on the previous one.
+ */
+__attribute__((target("aes,sse2"))) void
+rijndaelCCMBlocksAESNI(const aes_u32 rk[/*4*(Nr + 1)*/], int Nr,
+    const aes_u8 *ctr, aes_u8 *msg, size_t nblocks, aes_u8 mac[16],
+    int decrypt)
+{
+	__m128i k[AES_MAXROUNDS + 1], s[8], x, m;
+	size_t i, n;
+	int r;
+
+	for (r = 0; r <= Nr; r++)
+		k[r] = _mm_loadu_si128((const __m128i *)rk + r);
+	x = _mm_loadu_si128((const __m128i *)mac);
+
+	while (nblocks) {
+		n = nblocks < 8 ? nblocks : 8;
+
+		for (i = 0; i < n; i++)
+			s[i] = _mm_xor_si128(
+			    _mm_loadu_si128((const __m128i *)ctr + i), k[0]);
+		if (!decrypt)
+			x = _mm_xor_si128(x, _mm_xor_si128(
+			    _mm_loadu_si128((const __m128i *)msg), k[0]));
+		for (r = 1; r < Nr; r++) {
+			for (i = 0; i < n; i++)
+				s[i] = _mm_aesenc_si128(s[i], k[r]);
+			if (!decrypt)
+				x = _mm_aesenc_si128(x, k[r]);
+		}
+		for (i = 0; i < n; i++)
+			s[i] = _mm_aesenclast_si128(s[i], k[Nr]);
+		if (!decrypt)
+			x = _mm_aesenclast_si128(x, k[Nr]);
+
+		for (i = 0; i < n; i++) {
+			m = _mm_loadu_si128((const __m128i *)msg + i);
+			_mm_storeu_si128((__m128i *)msg + i,
+			    _mm_xor_si128(m, s[i]));
+			if (decrypt)
+				m = _mm_xor_si128(m, s[i]);
+			else if (i == 0)
+				continue;
+			x = _mm_xor_si128(x, _mm_xor_si128(m, k[0]));
+			for (r = 1; r < Nr; r++)
+				x = _mm_aesenc_si128(x, k[r]);
+			x = _mm_aesenclast_si128(x, k[Nr]);
+		}
+
+		ctr += 16 * n;
+		msg += 16 * n;
+		nblocks -= n;
+	}
+
+	_mm_storeu_si128((__m128i *)mac, x);
+}
+
+/*
+ * Encrypts up to eight independent blocks, block i with the round keys
+ * rk[i]. The rounds of all blocks are interleaved so that the latency
+ * of aesenc is hidden even if every block uses a different key.
+ */
+__attribute__((target("aes,sse2"))) void
+rijndaelEncryptMultiAESNI(const aes_u32 *rk[], int Nr, const aes_u8 *in,
+    aes_u8 *out, size_t nblocks)
+{
+	__m128i s[8];
+	size_t i;
+	int r;
+
+	for (i = 0; i < nblocks; i++)
+		s[i] = _mm_xor_si128(_mm_loadu_si128((const __m128i *)in + i),
+		    _mm_loadu_si128((const __m128i *)rk[i]));
+	for (r = 1; r < Nr; r++)
+		for (i = 0; i < nblocks; i++)
+			s[i] = _mm_aesenc_si128(s[i],
+			    _mm_loadu_si128((const __m128i *)rk[i] + r));
+	for (i = 0; i < nblocks; i++)
+		_mm_storeu_si128((__m128i *)out + i,
+		    _mm_aesenclast_si128(s[i],
+			_mm_loadu_si128((const __m128i *)rk[i] + Nr)));
+}
+
+/*
+ * CTR encryption of nblocks full blocks with a 32-bit counter, see
+ * rijndael_ctr32(). Eight counter blocks are encrypted per round loop.
+ */
+__attribute__((target("aes,ssse3"))) void
+rijndaelCTR32AESNI(const aes_u32 rk[/*4*(Nr + 1)*/], int Nr, aes_u8 ctr[16],
+    aes_u8 *msg, size_t nblocks)
+{
+	const __m128i bswap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7,
+	    8, 9, 10, 11, 12, 13, 14, 15);
+	const __m128i one = _mm_set_epi32(0, 0, 0, 1);
+	__m128i k[AES_MAXROUNDS + 1], s[8], c;
+	size_t i, n;
+	int r;
+
+	for (r = 0; r <= Nr; r++)
+		k[r] = _mm_loadu_si128((const __m128i *)rk + r);
+	/* byte-swapped, so that the counter is the lowest 32-bit lane */
+	c = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)ctr), bswap);
+
+	while (nblocks) {
+		n = nblocks < 8 ? nblocks : 8;
+
+		for (i = 0; i < n; i++) {
+			s[i] = _mm_xor_si128(_mm_shuffle_epi8(c, bswap), k[0]);
+			c = _mm_add_epi32(c, one);
+		}
+		for (r = 1; r < Nr; r++)
+			for (i = 0; i < n; i++)
+				s[i] = _mm_aesenc_si128(s[i], k[r]);
+		for (i = 0; i < n; i++) {
+			s[i] = _mm_aesenclast_si128(s[i], k[Nr]);
+			_mm_storeu_si128((__m128i *)msg + i, _mm_xor_si128(
+			    _mm_loadu_si128((const __m128i *)msg + i), s[i]));
+		}
+
+		msg += 16 * n;
+		nblocks -= n;
+	}
+
+	_mm_storeu_si128((__m128i *)ctr, _mm_shuffle_epi8(c, bswap));
+}
+
+/*
+ * CTR encryption and CBC-MAC of nblocks full blocks of up to eight
+ * messages for CCM, see rijndael_ccm_multi(). Every message uses its own
+ * round keys. The keystream and CBC-MAC blocks of all messages go
+ * through one round loop, so the serial CBC-MAC chains of the messages
+ * overlap each other.
+ */
+__attribute__((target("aes,ssse3"))) void
+rijndaelCCMMultiAESNI(const aes_u32 *rk[], int Nr, aes_u8 *ctr,
+    aes_u8 *msg[], size_t nblocks, aes_u8 *mac, size_t n)
+{
+	const __m128i bswap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7,
+	    8, 9, 10, 11, 12, 13, 14, 15);
+	const __m128i one = _mm_set_epi64x(0, 1);
+	__m128i c[8], x[8], s[8], k, m;
+	size_t i, b;
+	int r;
+
+	/* The counter is kept byte-swapped so that it can be incremented
+	 * with a 64-bit addition. L is at most 8 in CCM. */
+	for (i = 0; i < n; i++) {
+		c[i] = _mm_shuffle_epi8(
+		    _mm_loadu_si128((const __m128i *)ctr + i), bswap);
+		x[i] = _mm_loadu_si128((const __m128i *)mac + i);
+	}
+
+	for (b = 0; b < nblocks; b++) {
+		for (i = 0; i < n; i++) {
+			k = _mm_loadu_si128((const __m128i *)rk[i]);
+			c[i] = _mm_add_epi64(c[i], one);
+			s[i] = _mm_xor_si128(_mm_shuffle_epi8(c[i], bswap), k);
+			m = _mm_loadu_si128((const __m128i *)msg[i] + b);
+			x[i] = _mm_xor_si128(x[i], _mm_xor_si128(m, k));
+		}
+		for (r = 1; r < Nr; r++) {
+			for (i = 0; i < n; i++) {
+				k = _mm_loadu_si128((const __m128i *)rk[i] + r);
+				s[i] = _mm_aesenc_si128(s[i], k);
+				x[i] = _mm_aesenc_si128(x[i], k);
+			}
+		}
+		for (i = 0; i < n; i++) {
+			k = _mm_loadu_si128((const __m128i *)rk[i] + Nr);
+			s[i] = _mm_aesenclast_si128(s[i], k);
+			x[i] = _mm_aesenclast_si128(x[i], k);
+			m = _mm_loadu_si128((const __m128i *)msg[i] + b);
+			_mm_storeu_si128((__m128i *)msg[i] + b,
+			    _mm_xor_si128(m, s[i]));
+		}
+	}
+
+	for (i = 0; i < n; i++) {
+		_mm_storeu_si128((__m128i *)ctr + i,
+		    _mm_shuffle_epi8(c[i], bswap));
+		_mm_storeu_si128((__m128i *)mac + i, x[i]);
+	}
+}
+
+#else /* RIJNDAEL_AESNI */
+
+int
+rijndaelAESNIAvailable(void)
+{
+	return 0;
+}
+
+#endif /* RIJNDAEL_AESNI */
@@ -18,12 +18,56 @@
 
 #include "rijndael.h"
 
+#ifdef RIJNDAEL_AESNI
+/* implementation used for new key schedules, resolved on first use */
+static rijndael_impl_t rijndael_impl = RIJNDAEL_IMPL_AUTO;
+#endif
+
+int
+rijndael_set_impl(rijndael_impl_t impl)
+{
+	switch (impl) {
+	case RIJNDAEL_IMPL_AUTO:
+	case RIJNDAEL_IMPL_TABLES:
+		break;
+	case RIJNDAEL_IMPL_AESNI:
+		if (!rijndaelAESNIAvailable())
+			return -1;
+		break;
+	default:
+		return -1;
+	}
+#ifdef RIJNDAEL_AESNI
+	rijndael_impl = impl;
+#endif
+	return 0;
+}
+
+rijndael_impl_t
+rijndael_get_impl(void)
+{
+#ifdef RIJNDAEL_AESNI
+	if (rijndael_impl == RIJNDAEL_IMPL_AUTO)
+		rijndael_impl = rijndaelAESNIAvailable()
+		    ? RIJNDAEL_IMPL_AESNI : RIJNDAEL_IMPL_TABLES;
+	return rijndael_impl;
+#else
+	return RIJNDAEL_IMPL_TABLES;
+#endif
+}
+
 /* setup key context for encryption only */
 int
 rijndael_set_key_enc_only(rijndael_ctx *ctx, const u_char *key, int bits)
 {
 	int rounds;
 
+#ifdef RIJNDAEL_AESNI
+	ctx->aesni = rijndael_get_impl() == RIJNDAEL_IMPL_AESNI;
+	if (ctx->aesni)
+		rounds = rijndaelKeySetupEncAESNI(ctx->ek, key, bits);
+	else
+#endif
 	rounds = rijndaelKeySetupEnc(ctx->ek, key, bits);
 	if (rounds == 0)
 		return -1;
@@ -48,6 +92,10 @@ rijndael_set_key(rijndael_ctx *ctx, const u_char *key, int bits)
 		return -1;
 	if (rijndaelKeySetupDec(ctx->dk, key, bits) != rounds)
 		return -1;
+#ifdef RIJNDAEL_AESNI
+	/* the decrypt schedule is only available for the T-tables */
+	ctx->aesni = 0;
+#endif
 
 	ctx->Nr = rounds;
 	ctx->enc_only = 0;
@@ -65,5 +113,153 @@ rijndael_decrypt(rijndael_ctx *ctx, const u_char *src, u_char *dst)
 void
 rijndael_encrypt(rijndael_ctx *ctx, const u_char *src, u_char *dst)
 {
+#ifdef RIJNDAEL_AESNI
+	if (ctx->aesni) {
+		rijndaelEncryptAESNI(ctx->ek, ctx->Nr, src, dst);
+		return;
+	}
+#endif
 	rijndaelEncrypt(ctx->ek, ctx->Nr, src, dst);
 }
+
+void
+rijndael_ccm_blocks(rijndael_ctx *ctx, const u_char *ctr, u_char *msg,
+    size_t nblocks, u_char mac[16], int decrypt)
+{
+	u_char S[16], B[16];
+	int i;
+
+#ifdef RIJNDAEL_AESNI
+	if (ctx->aesni) {
+		rijndaelCCMBlocksAESNI(ctx->ek, ctx->Nr, ctr, msg, nblocks,
+		    mac, decrypt);
+		return;
+	}
+#endif
+	/* When encrypting, both AES operations of a block are independent
+	 * and can overlap in the CPU pipeline. */
+	while (nblocks--) {
+		rijndaelEncrypt(ctx->ek, ctx->Nr, ctr, S);
+		if (decrypt)
+			for (i = 0; i < 16; i++)
+				msg[i] ^= S[i];
+		for (i = 0; i < 16; i++)
+			B[i] = mac[i] ^ msg[i];
+		rijndaelEncrypt(ctx->ek, ctx->Nr, B, mac);
+		if (!decrypt)
+			for (i = 0; i < 16; i++)
+				msg[i] ^= S[i];
+		ctr += 16;
+		msg += 16;
+	}
+}
+
+void
+rijndael_encrypt_multi(rijndael_ctx *ctx[], const u_char *in, u_char *out,
+    size_t nblocks)
+{
+#ifdef RIJNDAEL_AESNI
+	const aes_u32 *rk[8];
+	size_t n;
+
+	/* Blocks are handed to the AES-NI backend in groups of eight
+	 * that use AES-NI key schedules with the same number of rounds. */
+	while (nblocks) {
+		for (n = 0; n < nblocks && n < 8; n++) {
+			if (!ctx[n]->aesni || ctx[n]->Nr != ctx[0]->Nr)
+				break;
+			rk[n] = ctx[n]->ek;
+		}
+		if (n) {
+			rijndaelEncryptMultiAESNI(rk, ctx[0]->Nr, in, out, n);
+		} else {
+			rijndael_encrypt(ctx[0], in, out);
+			n = 1;
+		}
+		ctx += n;
+		in += 16 * n;
+		out += 16 * n;
+		nblocks -= n;
+	}
+#else
+	while (nblocks--) {
+		rijndael_encrypt(*ctx++, in, out);
+		in += 16;
+		out += 16;
+	}
+#endif
+}
+
+/* Increments the big-endian counter block ctr. */
+static void
+inc_ctr(u_char ctr[16])
+{
+	int i;
+
+	for (i = 15; i >= 0; i--)
+		if (++ctr[i])
+			break;
+}
+
+void
+rijndael_ccm_multi(rijndael_ctx *ctx[], u_char *ctr, u_char *msg[],
+    size_t nblocks, u_char *mac, size_t n)
+{
+	size_t i, b;
+#ifdef RIJNDAEL_AESNI
+	const aes_u32 *rk[8];
+	size_t k;
+
+	/* Messages are handed to the AES-NI backend in groups of eight
+	 * that use AES-NI key schedules with the same number of rounds. */
+	while (n) {
+		for (k = 0; k < n && k < 8; k++) {
+			if (!ctx[k]->aesni || ctx[k]->Nr != ctx[0]->Nr)
+				break;
+			rk[k] = ctx[k]->ek;
+		}
+		if (!k)
+			break;
+		rijndaelCCMMultiAESNI(rk, ctx[0]->Nr, ctr, msg, nblocks, mac,
+		    k);
+		ctx += k;
+		ctr += 16 * k;
+		msg += k;
+		mac += 16 * k;
+		n -= k;
+	}
+#endif
+	for (i = 0; i < n; i++) {
+		for (b = 0; b < nblocks; b++) {
+			inc_ctr(ctr + 16 * i);
+			rijndael_ccm_blocks(ctx[i], ctr + 16 * i,
+			    msg[i] + 16 * b, 1, mac + 16 * i, 0);
+		}
+	}
+}
+
+void
+rijndael_ctr32(rijndael_ctx *ctx, u_char ctr[16], u_char *msg, size_t len)
+{
+	u_char S[16];
+	size_t i;
+	int j;
+
+#ifdef RIJNDAEL_AESNI
+	if (ctx->aesni && len >= 16) {
+		rijndaelCTR32AESNI(ctx->ek, ctx->Nr, ctr, msg, len / 16);
+		msg += len & ~(size_t)15;
+		len &= 15;
+	}
+#endif
+	while (len) {
+		rijndael_encrypt(ctx, ctr, S);
+		for (j = 15; j >= 12; j--)
+			if (++ctr[j])
+				break;
+		for (i = 0; i < 16 && i < len; i++)
+			msg[i] ^= S[i];
+		msg += i;
+		len -= i;
+	}
+}
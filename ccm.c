@@ -30,6 +30,16 @@
 
 #define MASK_L(_L) ((1 << 8 * _L) - 1)
 
+/* maximum number of CTR blocks encrypted in one batch */
+#ifndef DTLS_CCM_BATCH
+#define DTLS_CCM_BATCH 8
+#endif
+
+/* maximum number of messages encrypted side by side */
+#ifndef DTLS_CCM_LANES
+#define DTLS_CCM_LANES 8
+#endif
+
 #define SET_COUNTER(A,L,cnt,C) {					\
     unsigned int i_;                                                    \
     memset((A) + DTLS_CCM_BLOCKSIZE - (L), 0, (L));			\
@@ -38,6 +48,16 @@
       (A)[i_] |= (C) & 0xFF;						\
   }
 
+/* Increments the counter in the last L bytes of the counter block A. */
+static inline void
+inc_counter(unsigned char A[DTLS_CCM_BLOCKSIZE], size_t L) {
+  size_t i;
+
+  for (i = DTLS_CCM_BLOCKSIZE - 1; i >= DTLS_CCM_BLOCKSIZE - L; i--)
+    if (++A[i])
+      break;
+}
+
 static inline void 
 block0(size_t M,       /* number of auth bytes */
        size_t L,       /* number of bytes to encode message length */
@@ -137,31 +157,75 @@ add_auth_data(rijndael_ctx *ctx, const unsigned char *msg, uint64_t la,
   } 
 }
 
-static inline void
-encrypt(rijndael_ctx *ctx, size_t L, unsigned long counter,
-	unsigned char *msg, size_t len,
-	unsigned char A[DTLS_CCM_BLOCKSIZE],
-	unsigned char S[DTLS_CCM_BLOCKSIZE]) {
+/**
+ * Encrypts or decrypts \p msg in CTR mode and continues the CBC-MAC
+ * in \p X over the cleartext. The counter blocks for up to
+ * DTLS_CCM_BATCH full blocks are prepared at once and handed to
+ * rijndael_ccm_blocks(), which lets the AES backend compute the
+ * keystream of the whole batch alongside the serial CBC-MAC chain.
+ * A trailing partial block is handled here.
+ *
+ * \param ctx     The crypto context for the AES encryption.
+ * \param L       The number of bytes used to encode the message length.
+ * \param msg     The message to encrypt or decrypt in place.
+ * \param lm      The length of \p msg.
+ * \param A       The counter block template with flags and nonce set.
+ * \param X       The CBC-MAC state after add_auth_data(). On return,
+ *                \p X holds the final CBC-MAC.
+ * \param S0      Output buffer for the encrypted counter block A_0.
+ * \param decrypt Non-zero if \p msg is ciphertext.
+ */
+static void
+ccm_crypt(rijndael_ctx *ctx, size_t L, unsigned char *msg, size_t lm,
+	  unsigned char A[DTLS_CCM_BLOCKSIZE],
+	  unsigned char X[DTLS_CCM_BLOCKSIZE],
+	  unsigned char S0[DTLS_CCM_BLOCKSIZE],
+	  int decrypt) {
+  unsigned char ctr[DTLS_CCM_BATCH * DTLS_CCM_BLOCKSIZE];
+  unsigned char B[DTLS_CCM_BLOCKSIZE]; /* B_i blocks for CBC-MAC input */
+  unsigned char S[DTLS_CCM_BLOCKSIZE]; /* S_i = encrypted A_i blocks */
+  unsigned long counter_tmp;
+  size_t i, k;
 
-  static unsigned long counter_tmp;
+  /* MASK_L() overflows for L > 3, so start from A_0 and increment */
+  SET_COUNTER(A, L, 0, counter_tmp);
+  inc_counter(A, L);
+  while (lm >= DTLS_CCM_BLOCKSIZE) {
+    k = min(DTLS_CCM_BATCH, lm / DTLS_CCM_BLOCKSIZE);
+    for (i = 0; i < k; i++) {
+      memcpy(ctr + i * DTLS_CCM_BLOCKSIZE, A, DTLS_CCM_BLOCKSIZE);
+      inc_counter(A, L);
+    }
 
-  SET_COUNTER(A, L, counter, counter_tmp);    
-  rijndael_encrypt(ctx, A, S);
-  memxor(msg, S, len);
-}
+    rijndael_ccm_blocks(ctx, ctr, msg, k, X, decrypt);
 
-static inline void
-mac(rijndael_ctx *ctx, 
-    unsigned char *msg, size_t len,
-    unsigned char B[DTLS_CCM_BLOCKSIZE],
-    unsigned char X[DTLS_CCM_BLOCKSIZE]) {
-  size_t i;
+    /* update local pointers */
+    lm -= k * DTLS_CCM_BLOCKSIZE;
+    msg += k * DTLS_CCM_BLOCKSIZE;
+  }
 
-  for (i = 0; i < len; ++i)
-    B[i] = X[i] ^ msg[i];
+  if (lm) {
+    rijndael_encrypt(ctx, A, S);
 
-  rijndael_encrypt(ctx, B, X);
+    if (decrypt)
+      memxor(msg, S, lm);
+
+    /* Calculate MAC. The remainder of B must be padded with zeroes, so
+     * B is constructed to contain X ^ msg for the first lm bytes and
+     * X ^ 0 for the remaining DTLS_CCM_BLOCKSIZE - lm bytes.
+     */
+    memcpy(B + lm, X + lm, DTLS_CCM_BLOCKSIZE - lm);
+    for (i = 0; i < lm; ++i)
+      B[i] = X[i] ^ msg[i];
+    rijndael_encrypt(ctx, B, X);
+
+    if (!decrypt)
+      memxor(msg, S, lm);
+  }
 
+  /* calculate S_0 */
+  SET_COUNTER(A, L, 0, counter_tmp);
+  rijndael_encrypt(ctx, A, S0);
 }
 
 long int
@@ -169,16 +233,12 @@ dtls_ccm_encrypt_message(rijndael_ctx *ctx, size_t M, size_t L,
 			 const unsigned char nonce[DTLS_CCM_BLOCKSIZE],
 			 unsigned char *msg, size_t lm, 
 			 const unsigned char *aad, size_t la) {
-  size_t i, len;
-  unsigned long counter_tmp;
-  unsigned long counter = 1; /* \bug does not work correctly on ia32 when
-			             lm >= 2^16 */
+  size_t i;
   unsigned char A[DTLS_CCM_BLOCKSIZE]; /* A_i blocks for encryption input */
   unsigned char B[DTLS_CCM_BLOCKSIZE]; /* B_i blocks for CBC-MAC input */
-  unsigned char S[DTLS_CCM_BLOCKSIZE]; /* S_i = encrypted A_i blocks */
+  unsigned char S[DTLS_CCM_BLOCKSIZE]; /* S_0 = encrypted A_0 block */
   unsigned char X[DTLS_CCM_BLOCKSIZE]; /* X_i = encrypted B_i blocks */
 
-  len = lm;			/* save original length */
   /* create the initial authentication block B0 */
   block0(M, L, la, lm, nonce, B);
   add_auth_data(ctx, aad, la, B, X);
@@ -188,44 +248,14 @@ dtls_ccm_encrypt_message(rijndael_ctx *ctx, size_t M, size_t L,
 
   /* copy the nonce */
   memcpy(A + 1, nonce, DTLS_CCM_BLOCKSIZE - L - 1);
-  
-  while (lm >= DTLS_CCM_BLOCKSIZE) {
-    /* calculate MAC */
-    mac(ctx, msg, DTLS_CCM_BLOCKSIZE, B, X);
-
-    /* encrypt */
-    encrypt(ctx, L, counter, msg, DTLS_CCM_BLOCKSIZE, A, S);
-
-    /* update local pointers */
-    lm -= DTLS_CCM_BLOCKSIZE;
-    msg += DTLS_CCM_BLOCKSIZE;
-    counter++;
-  }
-
-  if (lm) {
-    /* Calculate MAC. The remainder of B must be padded with zeroes, so
-     * B is constructed to contain X ^ msg for the first lm bytes (done in
-     * mac() and X ^ 0 for the remaining DTLS_CCM_BLOCKSIZE - lm bytes
-     * (i.e., we can use memcpy() here).
-     */
-    memcpy(B + lm, X + lm, DTLS_CCM_BLOCKSIZE - lm);
-    mac(ctx, msg, lm, B, X);
-
-    /* encrypt */
-    encrypt(ctx, L, counter, msg, lm, A, S);
 
-    /* update local pointers */
-    msg += lm;
-  }
-  
-  /* calculate S_0 */  
-  SET_COUNTER(A, L, 0, counter_tmp);
-  rijndael_encrypt(ctx, A, S);
+  ccm_crypt(ctx, L, msg, lm, A, X, S, 0);
+  msg += lm;
 
   for (i = 0; i < M; ++i)
     *msg++ = X[i] ^ S[i];
 
-  return len + M;
+  return lm + M;
 }
 
 long int
@@ -234,19 +264,14 @@ dtls_ccm_decrypt_message(rijndael_ctx *ctx, size_t M, size_t L,
 			 unsigned char *msg, size_t lm, 
 			 const unsigned char *aad, size_t la) {
   
-  size_t len;
-  unsigned long counter_tmp;
-  unsigned long counter = 1; /* \bug does not work correctly on ia32 when
-			             lm >= 2^16 */
   unsigned char A[DTLS_CCM_BLOCKSIZE]; /* A_i blocks for encryption input */
   unsigned char B[DTLS_CCM_BLOCKSIZE]; /* B_i blocks for CBC-MAC input */
-  unsigned char S[DTLS_CCM_BLOCKSIZE]; /* S_i = encrypted A_i blocks */
+  unsigned char S[DTLS_CCM_BLOCKSIZE]; /* S_0 = encrypted A_0 block */
   unsigned char X[DTLS_CCM_BLOCKSIZE]; /* X_i = encrypted B_i blocks */
 
   if (lm < M)
     goto error;
 
-  len = lm;	      /* save original length */
   lm -= M;	      /* detract MAC size*/
 
   /* create the initial authentication block B0 */
@@ -258,46 +283,117 @@ dtls_ccm_decrypt_message(rijndael_ctx *ctx, size_t M, size_t L,
 
   /* copy the nonce */
   memcpy(A + 1, nonce, DTLS_CCM_BLOCKSIZE - L - 1);
-  
-  while (lm >= DTLS_CCM_BLOCKSIZE) {
-    /* decrypt */
-    encrypt(ctx, L, counter, msg, DTLS_CCM_BLOCKSIZE, A, S);
-    
-    /* calculate MAC */
-    mac(ctx, msg, DTLS_CCM_BLOCKSIZE, B, X);
-
-    /* update local pointers */
-    lm -= DTLS_CCM_BLOCKSIZE;
-    msg += DTLS_CCM_BLOCKSIZE;
-    counter++;
-  }
-
-  if (lm) {
-    /* decrypt */
-    encrypt(ctx, L, counter, msg, lm, A, S);
-
-    /* Calculate MAC. Note that msg ends in the MAC so we must
-     * construct B to contain X ^ msg for the first lm bytes (done in
-     * mac() and X ^ 0 for the remaining DTLS_CCM_BLOCKSIZE - lm bytes
-     * (i.e., we can use memcpy() here).
-     */
-    memcpy(B + lm, X + lm, DTLS_CCM_BLOCKSIZE - lm);
-    mac(ctx, msg, lm, B, X); 
 
-    /* update local pointers */
-    msg += lm;
-  }
-  
-  /* calculate S_0 */  
-  SET_COUNTER(A, L, 0, counter_tmp);
-  rijndael_encrypt(ctx, A, S);
+  ccm_crypt(ctx, L, msg, lm, A, X, S, 1);
+  msg += lm;
 
   memxor(msg, S, M);
 
   /* return length if MAC is valid, otherwise continue with error handling */
   if (equals(X, msg, M))
-    return len - M;
+    return lm;
   
  error:
   return -1;
 }
+
+/**
+ * Returns block \p j of the CBC-MAC input that follows B_0, i.e. the
+ * encoded length \p la, the additional authentication data \p aad
+ * and zero padding. Only \p la < 0xFF00 is supported.
+ */
+static void
+aad_block(const unsigned char *aad, size_t la, size_t j,
+	  unsigned char B[DTLS_CCM_BLOCKSIZE]) {
+  size_t i, p;
+
+  for (i = 0; i < DTLS_CCM_BLOCKSIZE; i++) {
+    p = j * DTLS_CCM_BLOCKSIZE + i;
+    if (p < 2)
+      B[i] = (la >> (8 * (1 - p))) & 0xff;
+    else if (p - 2 < la)
+      B[i] = aad[p - 2];
+    else
+      B[i] = 0;
+  }
+}
+
+long int
+dtls_ccm_encrypt_multi(rijndael_ctx *ctx[], size_t M, size_t L,
+		       const unsigned char *nonce[],
+		       unsigned char *msg[], size_t lm,
+		       const unsigned char *aad[], size_t la, size_t n) {
+  rijndael_ctx *key[2 * DTLS_CCM_LANES];
+  unsigned char in[2 * DTLS_CCM_LANES][DTLS_CCM_BLOCKSIZE];
+  unsigned char out[2 * DTLS_CCM_LANES][DTLS_CCM_BLOCKSIZE];
+  unsigned char A[DTLS_CCM_LANES][DTLS_CCM_BLOCKSIZE]; /* A_i blocks */
+  unsigned char X[DTLS_CCM_LANES][DTLS_CCM_BLOCKSIZE]; /* CBC-MAC */
+  unsigned char S[DTLS_CCM_LANES][DTLS_CCM_BLOCKSIZE]; /* S_0 */
+  unsigned long counter_tmp;
+  size_t i, j, k, ha, off, len;
+
+  if (la >= 0xFF00) {
+    for (i = 0; i < n; i++)
+      dtls_ccm_encrypt_message(ctx[i], M, L, nonce[i], msg[i], lm,
+			       aad[i], la);
+    return lm + M;
+  }
+
+  /* number of CBC-MAC blocks for the additional authentication data */
+  ha = la ? (la + 2 + DTLS_CCM_BLOCKSIZE - 1) / DTLS_CCM_BLOCKSIZE : 0;
+
+  for (; n; n -= k, ctx += k, nonce += k, msg += k, aad += k) {
+    k = min(n, DTLS_CCM_LANES);
+
+    /* B_0 and A_0 of all messages, every message uses its own key */
+    for (i = 0; i < k; i++) {
+      A[i][0] = L - 1;
+      memcpy(A[i] + 1, nonce[i], DTLS_CCM_BLOCKSIZE - L - 1);
+      SET_COUNTER(A[i], L, 0, counter_tmp);
+
+      block0(M, L, la, lm, nonce[i], in[2 * i]);
+      memcpy(in[2 * i + 1], A[i], DTLS_CCM_BLOCKSIZE);
+      key[2 * i] = key[2 * i + 1] = ctx[i];
+    }
+    rijndael_encrypt_multi(key, in[0], out[0], 2 * k);
+    for (i = 0; i < k; i++) {
+      memcpy(X[i], out[2 * i], DTLS_CCM_BLOCKSIZE);
+      memcpy(S[i], out[2 * i + 1], DTLS_CCM_BLOCKSIZE);
+    }
+
+    for (j = 0; j < ha; j++) {
+      for (i = 0; i < k; i++) {
+	aad_block(aad[i], la, j, in[i]);
+	memxor(in[i], X[i], DTLS_CCM_BLOCKSIZE);
+      }
+      rijndael_encrypt_multi(ctx, in[0], X[0], k);
+    }
+
+    /* full blocks */
+    rijndael_ccm_multi(ctx, A[0], msg, lm / DTLS_CCM_BLOCKSIZE, X[0], k);
+
+    /* The CBC-MAC input of the trailing partial block is padded with
+     * zeroes. */
+    off = lm - lm % DTLS_CCM_BLOCKSIZE;
+    len = lm % DTLS_CCM_BLOCKSIZE;
+    if (len) {
+      for (i = 0; i < k; i++) {
+	inc_counter(A[i], L);
+	memcpy(in[2 * i], X[i], DTLS_CCM_BLOCKSIZE);
+	memxor(in[2 * i], msg[i] + off, len);
+	memcpy(in[2 * i + 1], A[i], DTLS_CCM_BLOCKSIZE);
+      }
+      rijndael_encrypt_multi(key, in[0], out[0], 2 * k);
+      for (i = 0; i < k; i++) {
+	memcpy(X[i], out[2 * i], DTLS_CCM_BLOCKSIZE);
+	memxor(msg[i] + off, out[2 * i + 1], len);
+      }
+    }
+
+    for (i = 0; i < k; i++)
+      for (j = 0; j < M; j++)
+	msg[i][lm + j] = X[i][j] ^ S[i][j];
+  }
+
+  return lm + M;
+}
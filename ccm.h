@@ -58,4 +58,32 @@ dtls_ccm_decrypt_message(rijndael_ctx *ctx, size_t M, size_t L,
 			 unsigned char *msg, size_t lm, 
 			 const unsigned char *aad, size_t la);
 
+/**
+ * Authenticates and encrypts \p n messages of the same length \p lm
+ * with AES in CCM mode. Message \p msg[i] is encrypted in place with
+ * key \p ctx[i], nonce \p nonce[i] and additional authentication data
+ * \p aad[i]. The result is the same as calling
+ * dtls_ccm_encrypt_message() for each message, but the AES operations
+ * of up to eight messages are interleaved, which keeps the pipeline of
+ * the AES backend busy despite the serial CBC-MAC of each message.
+ *
+ * \param ctx   The initialized rijndael_ctx objects, one per message.
+ * \param M     The number of authentication octets.
+ * \param L     The number of bytes used to encode the message length.
+ * \param nonce The nonces, one per message.
+ * \param msg   The messages to encrypt. Each buffer must be at least
+ *              \p lm + \p M bytes large.
+ * \param lm    The length of each message.
+ * \param aad   The additional authentication data, one per message.
+ * \param la    The number of additional authentication octets of each
+ *              message.
+ * \param n     The number of messages.
+ * \return The length of each encrypted message including the MAC.
+ */
+long int
+dtls_ccm_encrypt_multi(rijndael_ctx *ctx[], size_t M, size_t L,
+		       const unsigned char *nonce[],
+		       unsigned char *msg[], size_t lm,
+		       const unsigned char *aad[], size_t la, size_t n);
+
 #endif /* _DTLS_CCM_H_ */
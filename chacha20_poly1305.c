@@ -0,0 +1,808 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2011-2023 Olaf Bergmann (TZI) and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *******************************************************************************/
+
+#include <string.h>
+
+#include "tinydtls.h"
+#include "global.h"
+#include "numeric.h"
+#include "chacha20_poly1305.h"
+
+#ifdef DTLS_CHACHA20_SIMD
+#include <cpuid.h>
+#include <emmintrin.h>
+#include <immintrin.h>
+
+#ifndef bit_SSE2
+#define bit_SSE2 (1 << 26)
+#endif
+#ifndef bit_OSXSAVE
+#define bit_OSXSAVE (1 << 27)
+#endif
+#ifndef bit_AVX
+#define bit_AVX (1 << 28)
+#endif
+#ifndef bit_AVX2
+#define bit_AVX2 (1 << 5)
+#endif
+#endif /* DTLS_CHACHA20_SIMD */
+
+static inline uint32_t
+load32_le(const unsigned char *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+    ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void
+store32_le(unsigned char *p, uint32_t v) {
+  p[0] = (unsigned char)v;
+  p[1] = (unsigned char)(v >> 8);
+  p[2] = (unsigned char)(v >> 16);
+  p[3] = (unsigned char)(v >> 24);
+}
+
+/* implementation in use, resolved on first use */
+static dtls_chacha20_impl_t chacha20_impl = DTLS_CHACHA20_IMPL_AUTO;
+
+#ifdef DTLS_CHACHA20_SIMD
+static int
+chacha20_sse2_available(void) {
+#ifdef __x86_64__
+  return 1;
+#else
+  static int available = -1;
+  unsigned int eax, ebx, ecx, edx;
+
+  if (available < 0) {
+    available = __get_cpuid(1, &eax, &ebx, &ecx, &edx) &&
+      (edx & bit_SSE2) != 0;
+  }
+  return available;
+#endif
+}
+
+static int
+chacha20_avx2_available(void) {
+  static int available = -1;
+  unsigned int eax, ebx, ecx, edx, xcr0;
+
+  if (available < 0) {
+    available = 0;
+    /* the OS must save the YMM registers as well */
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) &&
+	(ecx & bit_OSXSAVE) != 0 && (ecx & bit_AVX) != 0) {
+      __asm__ ("xgetbv" : "=a"(xcr0), "=d"(edx) : "c"(0));
+      if ((xcr0 & 6) == 6 && __get_cpuid_max(0, NULL) >= 7) {
+	__cpuid_count(7, 0, eax, ebx, ecx, edx);
+	available = (ebx & bit_AVX2) != 0;
+      }
+    }
+  }
+  return available;
+}
+#endif /* DTLS_CHACHA20_SIMD */
+
+int
+dtls_chacha20_set_impl(dtls_chacha20_impl_t impl) {
+  switch (impl) {
+  case DTLS_CHACHA20_IMPL_AUTO:
+  case DTLS_CHACHA20_IMPL_PORTABLE:
+    break;
+#ifdef DTLS_CHACHA20_SIMD
+  case DTLS_CHACHA20_IMPL_SSE2:
+    if (!chacha20_sse2_available())
+      return -1;
+    break;
+  case DTLS_CHACHA20_IMPL_AVX2:
+    if (!chacha20_avx2_available())
+      return -1;
+    break;
+#else /* DTLS_CHACHA20_SIMD */
+  case DTLS_CHACHA20_IMPL_SSE2:
+  case DTLS_CHACHA20_IMPL_AVX2:
+#endif /* DTLS_CHACHA20_SIMD */
+  default:
+    return -1;
+  }
+  chacha20_impl = impl;
+  return 0;
+}
+
+dtls_chacha20_impl_t
+dtls_chacha20_get_impl(void) {
+  if (chacha20_impl == DTLS_CHACHA20_IMPL_AUTO) {
+    chacha20_impl = DTLS_CHACHA20_IMPL_PORTABLE;
+#ifdef DTLS_CHACHA20_SIMD
+    if (chacha20_avx2_available())
+      chacha20_impl = DTLS_CHACHA20_IMPL_AVX2;
+    else if (chacha20_sse2_available())
+      chacha20_impl = DTLS_CHACHA20_IMPL_SSE2;
+#endif /* DTLS_CHACHA20_SIMD */
+  }
+  return chacha20_impl;
+}
+
+/*
+ * ChaCha20. The state is kept as 16 words: the constants, the key,
+ * the block counter and the nonce. All kernels encrypt nblocks full
+ * blocks of msg in place and advance the block counter in state[12].
+ */
+
+#define ROTL32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+
+#define QUARTERROUND(a, b, c, d)				\
+  a += b; d ^= a; d = ROTL32(d, 16);				\
+  c += d; b ^= c; b = ROTL32(b, 12);				\
+  a += b; d ^= a; d = ROTL32(d, 8);				\
+  c += d; b ^= c; b = ROTL32(b, 7)
+
+static void
+chacha20_init(uint32_t state[16],
+	      const unsigned char key[DTLS_CHACHA20_KEY_SIZE],
+	      uint32_t counter,
+	      const unsigned char nonce[DTLS_CHACHA20_NONCE_SIZE]) {
+  int i;
+
+  /* "expand 32-byte k" */
+  state[0] = 0x61707865;
+  state[1] = 0x3320646e;
+  state[2] = 0x79622d32;
+  state[3] = 0x6b206574;
+  for (i = 0; i < 8; i++)
+    state[4 + i] = load32_le(key + 4 * i);
+  state[12] = counter;
+  for (i = 0; i < 3; i++)
+    state[13 + i] = load32_le(nonce + 4 * i);
+}
+
+static void
+chacha20_blocks(uint32_t state[16], unsigned char *msg, size_t nblocks) {
+  uint32_t x[16];
+  int i;
+
+  while (nblocks--) {
+    memcpy(x, state, sizeof(x));
+    for (i = 0; i < 10; i++) {
+      QUARTERROUND(x[0], x[4], x[8], x[12]);
+      QUARTERROUND(x[1], x[5], x[9], x[13]);
+      QUARTERROUND(x[2], x[6], x[10], x[14]);
+      QUARTERROUND(x[3], x[7], x[11], x[15]);
+      QUARTERROUND(x[0], x[5], x[10], x[15]);
+      QUARTERROUND(x[1], x[6], x[11], x[12]);
+      QUARTERROUND(x[2], x[7], x[8], x[13]);
+      QUARTERROUND(x[3], x[4], x[9], x[14]);
+    }
+    for (i = 0; i < 16; i++)
+      store32_le(msg + 4 * i, load32_le(msg + 4 * i) ^ (x[i] + state[i]));
+    state[12]++;
+    msg += 64;
+  }
+}
+
+#ifdef DTLS_CHACHA20_SIMD
+/*
+ * SSE2 kernels. A single block is computed with one row of the state
+ * per register, the rows are rotated between the column and the
+ * diagonal rounds. Four blocks are computed side by side with one
+ * state word of all blocks per register and transposed at the end.
+ */
+
+#define ROTL128(v, n) \
+  _mm_or_si128(_mm_slli_epi32(v, n), _mm_srli_epi32(v, 32 - (n)))
+
+#define QUARTERROUND128(a, b, c, d)					\
+  a = _mm_add_epi32(a, b); d = _mm_xor_si128(d, a); d = ROTL128(d, 16); \
+  c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c); b = ROTL128(b, 12); \
+  a = _mm_add_epi32(a, b); d = _mm_xor_si128(d, a); d = ROTL128(d, 8);	\
+  c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c); b = ROTL128(b, 7)
+
+/* (a, b, c, d) = columns of the 4x4 matrix (a, b, c, d) */
+#define TRANSPOSE128(a, b, c, d) do {					\
+    __m128i t0_ = _mm_unpacklo_epi32(a, b);				\
+    __m128i t1_ = _mm_unpacklo_epi32(c, d);				\
+    __m128i t2_ = _mm_unpackhi_epi32(a, b);				\
+    __m128i t3_ = _mm_unpackhi_epi32(c, d);				\
+    a = _mm_unpacklo_epi64(t0_, t1_);					\
+    b = _mm_unpackhi_epi64(t0_, t1_);					\
+    c = _mm_unpacklo_epi64(t2_, t3_);					\
+    d = _mm_unpackhi_epi64(t2_, t3_);					\
+  } while (0)
+
+#define XOR128(p, v) \
+  _mm_storeu_si128((__m128i *)(p), \
+		   _mm_xor_si128(_mm_loadu_si128((const __m128i *)(p)), v))
+
+__attribute__((target("sse2"))) static void
+chacha20_block_sse2(uint32_t state[16], unsigned char *msg) {
+  const __m128i s0 = _mm_loadu_si128((const __m128i *)state);
+  const __m128i s1 = _mm_loadu_si128((const __m128i *)state + 1);
+  const __m128i s2 = _mm_loadu_si128((const __m128i *)state + 2);
+  const __m128i s3 = _mm_loadu_si128((const __m128i *)state + 3);
+  __m128i a = s0, b = s1, c = s2, d = s3;
+  int i;
+
+  for (i = 0; i < 10; i++) {
+    QUARTERROUND128(a, b, c, d);
+    b = _mm_shuffle_epi32(b, 0x39);
+    c = _mm_shuffle_epi32(c, 0x4e);
+    d = _mm_shuffle_epi32(d, 0x93);
+    QUARTERROUND128(a, b, c, d);
+    b = _mm_shuffle_epi32(b, 0x93);
+    c = _mm_shuffle_epi32(c, 0x4e);
+    d = _mm_shuffle_epi32(d, 0x39);
+  }
+
+  XOR128(msg, _mm_add_epi32(a, s0));
+  XOR128(msg + 16, _mm_add_epi32(b, s1));
+  XOR128(msg + 32, _mm_add_epi32(c, s2));
+  XOR128(msg + 48, _mm_add_epi32(d, s3));
+  state[12]++;
+}
+
+__attribute__((target("sse2"))) static void
+chacha20_blocks_sse2(uint32_t state[16], unsigned char *msg, size_t nblocks) {
+  __m128i x[16], s[16];
+  int i, j;
+
+  for (; nblocks >= 4; nblocks -= 4, msg += 4 * 64) {
+    for (i = 0; i < 16; i++)
+      s[i] = _mm_set1_epi32(state[i]);
+    s[12] = _mm_add_epi32(s[12], _mm_set_epi32(3, 2, 1, 0));
+    memcpy(x, s, sizeof(x));
+
+    for (i = 0; i < 10; i++) {
+      QUARTERROUND128(x[0], x[4], x[8], x[12]);
+      QUARTERROUND128(x[1], x[5], x[9], x[13]);
+      QUARTERROUND128(x[2], x[6], x[10], x[14]);
+      QUARTERROUND128(x[3], x[7], x[11], x[15]);
+      QUARTERROUND128(x[0], x[5], x[10], x[15]);
+      QUARTERROUND128(x[1], x[6], x[11], x[12]);
+      QUARTERROUND128(x[2], x[7], x[8], x[13]);
+      QUARTERROUND128(x[3], x[4], x[9], x[14]);
+    }
+
+    for (i = 0; i < 16; i++)
+      x[i] = _mm_add_epi32(x[i], s[i]);
+    /* words 4j .. 4j + 3 of all four blocks */
+    for (j = 0; j < 4; j++) {
+      TRANSPOSE128(x[4 * j], x[4 * j + 1], x[4 * j + 2], x[4 * j + 3]);
+      for (i = 0; i < 4; i++)
+	XOR128(msg + 64 * i + 16 * j, x[4 * j + i]);
+    }
+    state[12] += 4;
+  }
+
+  while (nblocks--) {
+    chacha20_block_sse2(state, msg);
+    msg += 64;
+  }
+}
+
+/*
+ * AVX2 kernel computing eight blocks side by side. After the 4x4
+ * transposition within both 128-bit lanes, the low lanes hold blocks
+ * 0 .. 3 and the high lanes blocks 4 .. 7.
+ */
+
+#define ROTL256(v, n) \
+  _mm256_or_si256(_mm256_slli_epi32(v, n), _mm256_srli_epi32(v, 32 - (n)))
+
+#define QUARTERROUND256(a, b, c, d)					\
+  a = _mm256_add_epi32(a, b); d = _mm256_xor_si256(d, a);		\
+  d = _mm256_shuffle_epi8(d, rot16);					\
+  c = _mm256_add_epi32(c, d); b = _mm256_xor_si256(b, c);		\
+  b = ROTL256(b, 12);							\
+  a = _mm256_add_epi32(a, b); d = _mm256_xor_si256(d, a);		\
+  d = _mm256_shuffle_epi8(d, rot8);					\
+  c = _mm256_add_epi32(c, d); b = _mm256_xor_si256(b, c);		\
+  b = ROTL256(b, 7)
+
+#define TRANSPOSE256(a, b, c, d) do {					\
+    __m256i t0_ = _mm256_unpacklo_epi32(a, b);				\
+    __m256i t1_ = _mm256_unpacklo_epi32(c, d);				\
+    __m256i t2_ = _mm256_unpackhi_epi32(a, b);				\
+    __m256i t3_ = _mm256_unpackhi_epi32(c, d);				\
+    a = _mm256_unpacklo_epi64(t0_, t1_);				\
+    b = _mm256_unpackhi_epi64(t0_, t1_);				\
+    c = _mm256_unpacklo_epi64(t2_, t3_);				\
+    d = _mm256_unpackhi_epi64(t2_, t3_);				\
+  } while (0)
+
+#define XOR256(p, v) \
+  _mm256_storeu_si256((__m256i *)(p), \
+		      _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(p)), v))
+
+__attribute__((target("avx2"))) static void
+chacha20_blocks_avx2(uint32_t state[16], unsigned char *msg, size_t nblocks) {
+  const __m256i rot16 = _mm256_set_epi8(13, 12, 15, 14, 9, 8, 11, 10,
+					5, 4, 7, 6, 1, 0, 3, 2,
+					13, 12, 15, 14, 9, 8, 11, 10,
+					5, 4, 7, 6, 1, 0, 3, 2);
+  const __m256i rot8 = _mm256_set_epi8(14, 13, 12, 15, 10, 9, 8, 11,
+				       6, 5, 4, 7, 2, 1, 0, 3,
+				       14, 13, 12, 15, 10, 9, 8, 11,
+				       6, 5, 4, 7, 2, 1, 0, 3);
+  __m256i x[16], s[16];
+  int i, j;
+
+  for (; nblocks >= 8; nblocks -= 8, msg += 8 * 64) {
+    for (i = 0; i < 16; i++)
+      s[i] = _mm256_set1_epi32(state[i]);
+    s[12] = _mm256_add_epi32(s[12], _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+    memcpy(x, s, sizeof(x));
+
+    for (i = 0; i < 10; i++) {
+      QUARTERROUND256(x[0], x[4], x[8], x[12]);
+      QUARTERROUND256(x[1], x[5], x[9], x[13]);
+      QUARTERROUND256(x[2], x[6], x[10], x[14]);
+      QUARTERROUND256(x[3], x[7], x[11], x[15]);
+      QUARTERROUND256(x[0], x[5], x[10], x[15]);
+      QUARTERROUND256(x[1], x[6], x[11], x[12]);
+      QUARTERROUND256(x[2], x[7], x[8], x[13]);
+      QUARTERROUND256(x[3], x[4], x[9], x[14]);
+    }
+
+    for (i = 0; i < 16; i++)
+      x[i] = _mm256_add_epi32(x[i], s[i]);
+    for (j = 0; j < 4; j++)
+      TRANSPOSE256(x[4 * j], x[4 * j + 1], x[4 * j + 2], x[4 * j + 3]);
+    /* x[i] holds words 0..3 (i < 4), 4..7, 8..11 and 12..15 of
+     * block i % 4 and block i % 4 + 4 */
+    for (i = 0; i < 4; i++) {
+      XOR256(msg + 64 * i,
+	     _mm256_permute2x128_si256(x[i], x[4 + i], 0x20));
+      XOR256(msg + 64 * i + 32,
+	     _mm256_permute2x128_si256(x[8 + i], x[12 + i], 0x20));
+      XOR256(msg + 64 * (i + 4),
+	     _mm256_permute2x128_si256(x[i], x[4 + i], 0x31));
+      XOR256(msg + 64 * (i + 4) + 32,
+	     _mm256_permute2x128_si256(x[8 + i], x[12 + i], 0x31));
+    }
+    state[12] += 8;
+  }
+
+  chacha20_blocks_sse2(state, msg, nblocks);
+}
+#endif /* DTLS_CHACHA20_SIMD */
+
+static void
+chacha20_crypt(uint32_t state[16], unsigned char *msg, size_t len) {
+  unsigned char block[64];
+  size_t nblocks = len / 64;
+
+  switch (dtls_chacha20_get_impl()) {
+#ifdef DTLS_CHACHA20_SIMD
+  case DTLS_CHACHA20_IMPL_AVX2:
+    chacha20_blocks_avx2(state, msg, nblocks);
+    break;
+  case DTLS_CHACHA20_IMPL_SSE2:
+    chacha20_blocks_sse2(state, msg, nblocks);
+    break;
+#else /* DTLS_CHACHA20_SIMD */
+  case DTLS_CHACHA20_IMPL_AVX2:
+  case DTLS_CHACHA20_IMPL_SSE2:
+#endif /* DTLS_CHACHA20_SIMD */
+  case DTLS_CHACHA20_IMPL_AUTO:
+  case DTLS_CHACHA20_IMPL_PORTABLE:
+  default:
+    chacha20_blocks(state, msg, nblocks);
+  }
+
+  len -= 64 * nblocks;
+  if (len) {
+    /* keystream of the partial last block */
+    memcpy(block, msg + 64 * nblocks, len);
+    chacha20_blocks(state, block, 1);
+    memcpy(msg + 64 * nblocks, block, len);
+  }
+}
+
+void
+dtls_chacha20_xor(const unsigned char key[DTLS_CHACHA20_KEY_SIZE],
+		  uint32_t counter,
+		  const unsigned char nonce[DTLS_CHACHA20_NONCE_SIZE],
+		  unsigned char *msg, size_t len) {
+  uint32_t state[16];
+
+  chacha20_init(state, key, counter, nonce);
+  chacha20_crypt(state, msg, len);
+  memset(state, 0, sizeof(state));
+}
+
+/*
+ * Poly1305 with 26-bit limbs (poly1305-donna). The AVX2 kernel
+ * processes four blocks per multiplication with r^4, lane i of the
+ * accumulator collects blocks i, i + 4, ... and is multiplied with
+ * r^(4 - i) at the end.
+ */
+
+#define POLY1305_MASK 0x3ffffff
+
+/* minimum number of blocks for the AVX2 kernel */
+#define POLY1305_AVX2_MIN_BLOCKS 16
+
+typedef struct {
+  uint32_t r[5];		/**< the clamped key r */
+  uint32_t h[5];		/**< the accumulator */
+  uint32_t pad[4];		/**< the key s */
+  uint32_t rp[4][5];		/**< r^1 .. r^4 for the AVX2 kernel */
+  int have_powers;		/**< rp has been set up */
+  size_t leftover;		/**< number of bytes in buffer */
+  unsigned char buffer[16];
+} poly1305_state_t;
+
+static void
+poly1305_init(poly1305_state_t *st,
+	      const unsigned char key[DTLS_POLY1305_KEY_SIZE]) {
+  /* r &= 0xffffffc0ffffffc0ffffffc0fffffff */
+  st->r[0] = load32_le(key + 0) & 0x3ffffff;
+  st->r[1] = (load32_le(key + 3) >> 2) & 0x3ffff03;
+  st->r[2] = (load32_le(key + 6) >> 4) & 0x3ffc0ff;
+  st->r[3] = (load32_le(key + 9) >> 6) & 0x3f03fff;
+  st->r[4] = (load32_le(key + 12) >> 8) & 0x00fffff;
+
+  memset(st->h, 0, sizeof(st->h));
+  st->pad[0] = load32_le(key + 16);
+  st->pad[1] = load32_le(key + 20);
+  st->pad[2] = load32_le(key + 24);
+  st->pad[3] = load32_le(key + 28);
+
+  st->have_powers = 0;
+  st->leftover = 0;
+}
+
+/* h = h * r mod 2^130 - 5, partially reduced */
+static void
+poly1305_mul(uint32_t h[5], const uint32_t r[5]) {
+  const uint32_t s1 = r[1] * 5, s2 = r[2] * 5, s3 = r[3] * 5, s4 = r[4] * 5;
+  uint64_t d0, d1, d2, d3, d4;
+  uint32_t c;
+
+  d0 = (uint64_t)h[0] * r[0] + (uint64_t)h[1] * s4 + (uint64_t)h[2] * s3 +
+    (uint64_t)h[3] * s2 + (uint64_t)h[4] * s1;
+  d1 = (uint64_t)h[0] * r[1] + (uint64_t)h[1] * r[0] + (uint64_t)h[2] * s4 +
+    (uint64_t)h[3] * s3 + (uint64_t)h[4] * s2;
+  d2 = (uint64_t)h[0] * r[2] + (uint64_t)h[1] * r[1] + (uint64_t)h[2] * r[0] +
+    (uint64_t)h[3] * s4 + (uint64_t)h[4] * s3;
+  d3 = (uint64_t)h[0] * r[3] + (uint64_t)h[1] * r[2] + (uint64_t)h[2] * r[1] +
+    (uint64_t)h[3] * r[0] + (uint64_t)h[4] * s4;
+  d4 = (uint64_t)h[0] * r[4] + (uint64_t)h[1] * r[3] + (uint64_t)h[2] * r[2] +
+    (uint64_t)h[3] * r[1] + (uint64_t)h[4] * r[0];
+
+  c = (uint32_t)(d0 >> 26); h[0] = (uint32_t)d0 & POLY1305_MASK;
+  d1 += c; c = (uint32_t)(d1 >> 26); h[1] = (uint32_t)d1 & POLY1305_MASK;
+  d2 += c; c = (uint32_t)(d2 >> 26); h[2] = (uint32_t)d2 & POLY1305_MASK;
+  d3 += c; c = (uint32_t)(d3 >> 26); h[3] = (uint32_t)d3 & POLY1305_MASK;
+  d4 += c; c = (uint32_t)(d4 >> 26); h[4] = (uint32_t)d4 & POLY1305_MASK;
+  h[0] += c * 5; c = h[0] >> 26; h[0] &= POLY1305_MASK;
+  h[1] += c;
+}
+
+static void
+poly1305_blocks_generic(poly1305_state_t *st, const unsigned char *m,
+			size_t nblocks, uint32_t hibit) {
+  for (; nblocks; nblocks--, m += 16) {
+    st->h[0] += load32_le(m + 0) & POLY1305_MASK;
+    st->h[1] += (load32_le(m + 3) >> 2) & POLY1305_MASK;
+    st->h[2] += (load32_le(m + 6) >> 4) & POLY1305_MASK;
+    st->h[3] += (load32_le(m + 9) >> 6) & POLY1305_MASK;
+    st->h[4] += (load32_le(m + 12) >> 8) | hibit;
+    poly1305_mul(st->h, st->r);
+  }
+}
+
+#ifdef DTLS_CHACHA20_SIMD
+/* loads the 26-bit limbs of four message blocks, block i into lane i */
+__attribute__((target("avx2"))) static void
+poly1305_load4_avx2(const unsigned char *m, __m256i l[5]) {
+  uint32_t t[4][5];
+  int i;
+
+  for (i = 0; i < 4; i++, m += 16) {
+    t[i][0] = load32_le(m + 0) & POLY1305_MASK;
+    t[i][1] = (load32_le(m + 3) >> 2) & POLY1305_MASK;
+    t[i][2] = (load32_le(m + 6) >> 4) & POLY1305_MASK;
+    t[i][3] = (load32_le(m + 9) >> 6) & POLY1305_MASK;
+    t[i][4] = (load32_le(m + 12) >> 8) | (1 << 24);
+  }
+  for (i = 0; i < 5; i++)
+    l[i] = _mm256_set_epi64x(t[3][i], t[2][i], t[1][i], t[0][i]);
+}
+
+/* h = h * r with s = 5 * r in every lane, partially reduced */
+__attribute__((target("avx2"))) static void
+poly1305_mul_avx2(__m256i h[5], const __m256i r[5], const __m256i s[5]) {
+  const __m256i mask = _mm256_set1_epi64x(POLY1305_MASK);
+  __m256i d[5], c;
+
+#define MUL(a, b) _mm256_mul_epu32(a, b)
+  d[0] = _mm256_add_epi64(_mm256_add_epi64(MUL(h[0], r[0]), MUL(h[1], s[4])),
+			  _mm256_add_epi64(_mm256_add_epi64(MUL(h[2], s[3]), MUL(h[3], s[2])),
+					   MUL(h[4], s[1])));
+  d[1] = _mm256_add_epi64(_mm256_add_epi64(MUL(h[0], r[1]), MUL(h[1], r[0])),
+			  _mm256_add_epi64(_mm256_add_epi64(MUL(h[2], s[4]), MUL(h[3], s[3])),
+					   MUL(h[4], s[2])));
+  d[2] = _mm256_add_epi64(_mm256_add_epi64(MUL(h[0], r[2]), MUL(h[1], r[1])),
+			  _mm256_add_epi64(_mm256_add_epi64(MUL(h[2], r[0]), MUL(h[3], s[4])),
+					   MUL(h[4], s[3])));
+  d[3] = _mm256_add_epi64(_mm256_add_epi64(MUL(h[0], r[3]), MUL(h[1], r[2])),
+			  _mm256_add_epi64(_mm256_add_epi64(MUL(h[2], r[1]), MUL(h[3], r[0])),
+					   MUL(h[4], s[4])));
+  d[4] = _mm256_add_epi64(_mm256_add_epi64(MUL(h[0], r[4]), MUL(h[1], r[3])),
+			  _mm256_add_epi64(_mm256_add_epi64(MUL(h[2], r[2]), MUL(h[3], r[1])),
+					   MUL(h[4], r[0])));
+#undef MUL
+
+  c = _mm256_srli_epi64(d[0], 26); h[0] = _mm256_and_si256(d[0], mask);
+  d[1] = _mm256_add_epi64(d[1], c);
+  c = _mm256_srli_epi64(d[1], 26); h[1] = _mm256_and_si256(d[1], mask);
+  d[2] = _mm256_add_epi64(d[2], c);
+  c = _mm256_srli_epi64(d[2], 26); h[2] = _mm256_and_si256(d[2], mask);
+  d[3] = _mm256_add_epi64(d[3], c);
+  c = _mm256_srli_epi64(d[3], 26); h[3] = _mm256_and_si256(d[3], mask);
+  d[4] = _mm256_add_epi64(d[4], c);
+  c = _mm256_srli_epi64(d[4], 26); h[4] = _mm256_and_si256(d[4], mask);
+  /* the carry may exceed 32 bits, multiply by 5 with shift and add */
+  h[0] = _mm256_add_epi64(h[0], _mm256_add_epi64(c, _mm256_slli_epi64(c, 2)));
+  c = _mm256_srli_epi64(h[0], 26); h[0] = _mm256_and_si256(h[0], mask);
+  h[1] = _mm256_add_epi64(h[1], c);
+}
+
+/* nblocks must be a multiple of four */
+__attribute__((target("avx2"))) static void
+poly1305_blocks_avx2(poly1305_state_t *st, const unsigned char *m,
+		     size_t nblocks) {
+  __m256i h[5], r[5], s[5], l[5];
+  uint64_t t[5], c;
+  int i;
+
+  for (i = 0; i < 5; i++) {
+    r[i] = _mm256_set1_epi64x(st->rp[3][i]);
+    s[i] = _mm256_set1_epi64x(st->rp[3][i] * 5);
+  }
+
+  poly1305_load4_avx2(m, h);
+  for (i = 0; i < 5; i++)
+    h[i] = _mm256_add_epi64(h[i], _mm256_set_epi64x(0, 0, 0, st->h[i]));
+
+  for (nblocks -= 4, m += 64; nblocks; nblocks -= 4, m += 64) {
+    poly1305_mul_avx2(h, r, s);
+    poly1305_load4_avx2(m, l);
+    for (i = 0; i < 5; i++)
+      h[i] = _mm256_add_epi64(h[i], l[i]);
+  }
+
+  /* multiply lane i with r^(4 - i) and add up the lanes */
+  for (i = 0; i < 5; i++) {
+    r[i] = _mm256_set_epi64x(st->rp[0][i], st->rp[1][i],
+			     st->rp[2][i], st->rp[3][i]);
+    s[i] = _mm256_set_epi64x(st->rp[0][i] * 5, st->rp[1][i] * 5,
+			     st->rp[2][i] * 5, st->rp[3][i] * 5);
+  }
+  poly1305_mul_avx2(h, r, s);
+
+  for (i = 0; i < 5; i++) {
+    uint64_t v[2];
+
+    _mm_storeu_si128((__m128i *)v,
+		     _mm_add_epi64(_mm256_castsi256_si128(h[i]),
+				   _mm256_extracti128_si256(h[i], 1)));
+    t[i] = v[0] + v[1];
+  }
+
+  c = t[0] >> 26; t[0] &= POLY1305_MASK;
+  t[1] += c; c = t[1] >> 26; t[1] &= POLY1305_MASK;
+  t[2] += c; c = t[2] >> 26; t[2] &= POLY1305_MASK;
+  t[3] += c; c = t[3] >> 26; t[3] &= POLY1305_MASK;
+  t[4] += c; c = t[4] >> 26; t[4] &= POLY1305_MASK;
+  t[0] += c * 5; c = t[0] >> 26; t[0] &= POLY1305_MASK;
+  t[1] += c;
+  for (i = 0; i < 5; i++)
+    st->h[i] = (uint32_t)t[i];
+}
+#endif /* DTLS_CHACHA20_SIMD */
+
+static void
+poly1305_blocks(poly1305_state_t *st, const unsigned char *m, size_t nblocks) {
+#ifdef DTLS_CHACHA20_SIMD
+  if (nblocks >= POLY1305_AVX2_MIN_BLOCKS &&
+      dtls_chacha20_get_impl() == DTLS_CHACHA20_IMPL_AVX2) {
+    size_t n = nblocks & ~(size_t)3;
+    int i;
+
+    if (!st->have_powers) {
+      memcpy(st->rp[0], st->r, sizeof(st->r));
+      for (i = 1; i < 4; i++) {
+	memcpy(st->rp[i], st->rp[i - 1], sizeof(st->r));
+	poly1305_mul(st->rp[i], st->r);
+      }
+      st->have_powers = 1;
+    }
+    poly1305_blocks_avx2(st, m, n);
+    m += 16 * n;
+    nblocks -= n;
+  }
+#endif /* DTLS_CHACHA20_SIMD */
+  poly1305_blocks_generic(st, m, nblocks, 1 << 24);
+}
+
+static void
+poly1305_update(poly1305_state_t *st, const unsigned char *m, size_t len) {
+  size_t n;
+
+  if (st->leftover) {
+    n = min(16 - st->leftover, len);
+    memcpy(st->buffer + st->leftover, m, n);
+    st->leftover += n;
+    m += n;
+    len -= n;
+    if (st->leftover < 16)
+      return;
+    poly1305_blocks(st, st->buffer, 1);
+    st->leftover = 0;
+  }
+
+  if (len >= 16) {
+    n = len / 16;
+    poly1305_blocks(st, m, n);
+    m += 16 * n;
+    len -= 16 * n;
+  }
+
+  if (len) {
+    memcpy(st->buffer, m, len);
+    st->leftover = len;
+  }
+}
+
+static void
+poly1305_finish(poly1305_state_t *st, unsigned char tag[DTLS_POLY1305_TAG_SIZE]) {
+  uint32_t h0, h1, h2, h3, h4, c;
+  uint32_t g0, g1, g2, g3, g4, mask;
+  uint64_t f;
+
+  if (st->leftover) {
+    st->buffer[st->leftover] = 1;
+    memset(st->buffer + st->leftover + 1, 0, 16 - st->leftover - 1);
+    poly1305_blocks_generic(st, st->buffer, 1, 0);
+  }
+
+  /* fully carry h */
+  h0 = st->h[0]; h1 = st->h[1]; h2 = st->h[2]; h3 = st->h[3]; h4 = st->h[4];
+  c = h1 >> 26; h1 &= POLY1305_MASK;
+  h2 += c; c = h2 >> 26; h2 &= POLY1305_MASK;
+  h3 += c; c = h3 >> 26; h3 &= POLY1305_MASK;
+  h4 += c; c = h4 >> 26; h4 &= POLY1305_MASK;
+  h0 += c * 5; c = h0 >> 26; h0 &= POLY1305_MASK;
+  h1 += c;
+
+  /* g = h + -p, select h if g is negative */
+  g0 = h0 + 5; c = g0 >> 26; g0 &= POLY1305_MASK;
+  g1 = h1 + c; c = g1 >> 26; g1 &= POLY1305_MASK;
+  g2 = h2 + c; c = g2 >> 26; g2 &= POLY1305_MASK;
+  g3 = h3 + c; c = g3 >> 26; g3 &= POLY1305_MASK;
+  g4 = h4 + c - (1U << 26);
+
+  mask = (g4 >> 31) - 1;
+  g0 &= mask; g1 &= mask; g2 &= mask; g3 &= mask; g4 &= mask;
+  mask = ~mask;
+  h0 = (h0 & mask) | g0;
+  h1 = (h1 & mask) | g1;
+  h2 = (h2 & mask) | g2;
+  h3 = (h3 & mask) | g3;
+  h4 = (h4 & mask) | g4;
+
+  /* h = h % 2^128 + s */
+  h0 = h0 | (h1 << 26);
+  h1 = (h1 >> 6) | (h2 << 20);
+  h2 = (h2 >> 12) | (h3 << 14);
+  h3 = (h3 >> 18) | (h4 << 8);
+
+  f = (uint64_t)h0 + st->pad[0]; store32_le(tag + 0, (uint32_t)f);
+  f = (uint64_t)h1 + st->pad[1] + (f >> 32); store32_le(tag + 4, (uint32_t)f);
+  f = (uint64_t)h2 + st->pad[2] + (f >> 32); store32_le(tag + 8, (uint32_t)f);
+  f = (uint64_t)h3 + st->pad[3] + (f >> 32); store32_le(tag + 12, (uint32_t)f);
+
+  memset(st, 0, sizeof(*st));
+}
+
+void
+dtls_poly1305(const unsigned char key[DTLS_POLY1305_KEY_SIZE],
+	      const unsigned char *msg, size_t len,
+	      unsigned char tag[DTLS_POLY1305_TAG_SIZE]) {
+  poly1305_state_t st;
+
+  poly1305_init(&st, key);
+  poly1305_update(&st, msg, len);
+  poly1305_finish(&st, tag);
+}
+
+/*
+ * The AEAD construction of RFC 8439, Section 2.8. The Poly1305 key is
+ * taken from the keystream block with counter 0, the message is
+ * encrypted starting with counter 1.
+ */
+
+static void
+chacha20_poly1305_tag(uint32_t state[16],
+		      const unsigned char *c, size_t lc,
+		      const unsigned char *aad, size_t la,
+		      unsigned char tag[DTLS_POLY1305_TAG_SIZE]) {
+  static const unsigned char zeros[16] = { 0 };
+  unsigned char block[64];
+  poly1305_state_t st;
+
+  /* state[12] is 0 here, afterwards 1 as needed for the payload */
+  memset(block, 0, sizeof(block));
+  chacha20_crypt(state, block, sizeof(block));
+  poly1305_init(&st, block);
+  memset(block, 0, sizeof(block));
+
+  poly1305_update(&st, aad, la);
+  poly1305_update(&st, zeros, (16 - la % 16) % 16);
+  poly1305_update(&st, c, lc);
+  poly1305_update(&st, zeros, (16 - lc % 16) % 16);
+
+  store32_le(block, (uint32_t)la);
+  store32_le(block + 4, (uint32_t)((uint64_t)la >> 32));
+  store32_le(block + 8, (uint32_t)lc);
+  store32_le(block + 12, (uint32_t)((uint64_t)lc >> 32));
+  poly1305_update(&st, block, 16);
+  poly1305_finish(&st, tag);
+}
+
+long int
+dtls_chacha20_poly1305_encrypt_message(const unsigned char key[DTLS_CHACHA20_KEY_SIZE],
+				       const unsigned char nonce[DTLS_CHACHA20_NONCE_SIZE],
+				       unsigned char *msg, size_t lm,
+				       const unsigned char *aad, size_t la) {
+  uint32_t state[16];
+  uint32_t payload[16];
+
+  chacha20_init(state, key, 0, nonce);
+  memcpy(payload, state, sizeof(payload));
+  payload[12] = 1;
+  chacha20_crypt(payload, msg, lm);
+
+  chacha20_poly1305_tag(state, msg, lm, aad, la, msg + lm);
+
+  memset(state, 0, sizeof(state));
+  memset(payload, 0, sizeof(payload));
+  return lm + DTLS_POLY1305_TAG_SIZE;
+}
+
+long int
+dtls_chacha20_poly1305_decrypt_message(const unsigned char key[DTLS_CHACHA20_KEY_SIZE],
+				       const unsigned char nonce[DTLS_CHACHA20_NONCE_SIZE],
+				       unsigned char *msg, size_t lm,
+				       const unsigned char *aad, size_t la) {
+  uint32_t state[16];
+  unsigned char tag[DTLS_POLY1305_TAG_SIZE];
+
+  if (lm < DTLS_POLY1305_TAG_SIZE)
+    return -1;
+
+  lm -= DTLS_POLY1305_TAG_SIZE;
+
+  chacha20_init(state, key, 0, nonce);
+  chacha20_poly1305_tag(state, msg, lm, aad, la, tag);
+  if (!equals(tag, msg + lm, DTLS_POLY1305_TAG_SIZE)) {
+    memset(state, 0, sizeof(state));
+    return -1;
+  }
+
+  /* state[12] has been advanced to 1 by chacha20_poly1305_tag() */
+  chacha20_crypt(state, msg, lm);
+  memset(state, 0, sizeof(state));
+  return lm;
+}
@@ -0,0 +1,117 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2011-2023 Olaf Bergmann (TZI) and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *******************************************************************************/
+
+#ifndef _DTLS_CHACHA20_POLY1305_H_
+#define _DTLS_CHACHA20_POLY1305_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* implementation of the ChaCha20-Poly1305 AEAD, RFC 8439 */
+
+#define DTLS_CHACHA20_KEY_SIZE   32 /**< size of the ChaCha20 key */
+#define DTLS_CHACHA20_NONCE_SIZE 12 /**< size of nonce */
+#define DTLS_POLY1305_KEY_SIZE   32 /**< size of the one-time Poly1305 key */
+#define DTLS_POLY1305_TAG_SIZE   16 /**< size of the authentication tag */
+
+/* SSE2 and AVX2 kernels are available on x86 when building with gcc
+ * or clang. Define DTLS_CHACHA20_NO_SIMD to disable them. */
+#if !defined(DTLS_CHACHA20_NO_SIMD) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define DTLS_CHACHA20_SIMD 1
+#endif
+
+/** Implementations that can be selected with dtls_chacha20_set_impl(). */
+typedef enum {
+  DTLS_CHACHA20_IMPL_AUTO = 0,	/**< fastest one supported by the CPU */
+  DTLS_CHACHA20_IMPL_PORTABLE,	/**< portable C implementation */
+  DTLS_CHACHA20_IMPL_SSE2,	/**< SSE2 ChaCha20 kernels */
+  DTLS_CHACHA20_IMPL_AVX2	/**< AVX2 ChaCha20 and Poly1305 kernels */
+} dtls_chacha20_impl_t;
+
+/**
+ * Selects the implementation used by the functions below.
+ *
+ * \param impl The implementation to use.
+ * \return \c 0 on success, or \c -1 if \p impl is not available on
+ *         this CPU or build.
+ */
+int dtls_chacha20_set_impl(dtls_chacha20_impl_t impl);
+
+/** Returns the implementation currently in use. */
+dtls_chacha20_impl_t dtls_chacha20_get_impl(void);
+
+/**
+ * Encrypts (or decrypts) \p len bytes of \p msg in place with the
+ * ChaCha20 keystream starting at block \p counter.
+ *
+ * \param key     The \c DTLS_CHACHA20_KEY_SIZE bytes key.
+ * \param counter The initial block counter.
+ * \param nonce   The \c DTLS_CHACHA20_NONCE_SIZE bytes nonce.
+ * \param msg     The message to encrypt.
+ * \param len     The length of \p msg.
+ */
+void dtls_chacha20_xor(const unsigned char key[DTLS_CHACHA20_KEY_SIZE],
+		       uint32_t counter,
+		       const unsigned char nonce[DTLS_CHACHA20_NONCE_SIZE],
+		       unsigned char *msg, size_t len);
+
+/**
+ * Computes the Poly1305 authenticator of \p msg.
+ *
+ * \param key The one-time \c DTLS_POLY1305_KEY_SIZE bytes key.
+ * \param msg The message to authenticate.
+ * \param len The length of \p msg.
+ * \param tag The resulting \c DTLS_POLY1305_TAG_SIZE bytes tag.
+ */
+void dtls_poly1305(const unsigned char key[DTLS_POLY1305_KEY_SIZE],
+		   const unsigned char *msg, size_t len,
+		   unsigned char tag[DTLS_POLY1305_TAG_SIZE]);
+
+/**
+ * Authenticates and encrypts a message using ChaCha20-Poly1305. The
+ * encryption operation modifies the contents of \p msg and appends
+ * the \c DTLS_POLY1305_TAG_SIZE bytes authentication tag. Therefore,
+ * the buffer must be at least \p lm + \c DTLS_POLY1305_TAG_SIZE bytes
+ * large.
+ *
+ * \param key   The \c DTLS_CHACHA20_KEY_SIZE bytes key.
+ * \param nonce The \c DTLS_CHACHA20_NONCE_SIZE bytes nonce.
+ * \param msg   The message to encrypt.
+ * \param lm    The actual length of \p msg.
+ * \param aad   A pointer to the additional authentication data (can be
+ *              \c NULL if \p la is zero).
+ * \param la    The number of additional authentication octets.
+ * \return The length of the encrypted message including the tag.
+ */
+long int
+dtls_chacha20_poly1305_encrypt_message(const unsigned char key[DTLS_CHACHA20_KEY_SIZE],
+				       const unsigned char nonce[DTLS_CHACHA20_NONCE_SIZE],
+				       unsigned char *msg, size_t lm,
+				       const unsigned char *aad, size_t la);
+
+/**
+ * Verifies and decrypts a message encrypted with
+ * dtls_chacha20_poly1305_encrypt_message(). The message is only
+ * decrypted if the authentication tag is valid.
+ *
+ * \return The length of the cleartext, or \c -1 if the message could
+ *         not be verified.
+ */
+long int
+dtls_chacha20_poly1305_decrypt_message(const unsigned char key[DTLS_CHACHA20_KEY_SIZE],
+				       const unsigned char nonce[DTLS_CHACHA20_NONCE_SIZE],
+				       unsigned char *msg, size_t lm,
+				       const unsigned char *aad, size_t la);
+
+#endif /* _DTLS_CHACHA20_POLY1305_H_ */
@@ -59,23 +59,20 @@ memarray_t security_storage;
 #define HMAC_UPDATE_SEED(Context,Seed,Length)		\
   if (Seed) dtls_hmac_update(Context, (Seed), (Length))
 
-static struct dtls_cipher_context_t cipher_context;
-static dtls_mutex_t cipher_context_mutex = DTLS_MUTEX_INITIALIZER;
-
-static struct dtls_cipher_context_t *dtls_cipher_context_get(void)
-{
-  dtls_mutex_lock(&cipher_context_mutex);
-  return &cipher_context;
-}
-
-static void dtls_cipher_context_release(void)
-{
-  dtls_mutex_unlock(&cipher_context_mutex);
-}
+#ifdef DTLS_CONSTRAINED_STACK
+/* The key schedule for dtls_encrypt_params() and dtls_decrypt_params()
+ * is kept off the stack. The record layer uses the key schedules
+ * cached in the security parameters and does not take this lock. */
+static rijndael_ctx cipher_key_ctx;
+static dtls_mutex_t cipher_key_ctx_mutex = DTLS_MUTEX_INITIALIZER;
+#endif /* DTLS_CONSTRAINED_STACK */
 
 #if !(defined (WITH_CONTIKI)) && !(defined (RIOT_VERSION)) && !(defined (WITH_LMSTAX))
 void crypto_init(void)
 {
+#ifdef DTLS_ECC
+  ecc_init();
+#endif /* DTLS_ECC */
 }
 
 static dtls_handshake_parameters_t *dtls_handshake_malloc(void) {
@@ -97,6 +94,9 @@ static void dtls_security_dealloc(dtls_security_parameters_t *security) {
 #include "lm_tinydtls.h"
 void crypto_init(void)
 {
+#ifdef DTLS_ECC
+  ecc_init();
+#endif /* DTLS_ECC */
 }
 
 static dtls_handshake_parameters_t *dtls_handshake_malloc(void) {
@@ -123,6 +123,9 @@ MEMB(security_storage, dtls_security_parameters_t, DTLS_SECURITY_MAX);
 void crypto_init(void) {
   memb_init(&handshake_storage);
   memb_init(&security_storage);
+#ifdef DTLS_ECC
+  ecc_init();
+#endif /* DTLS_ECC */
 }
 
 static dtls_handshake_parameters_t *dtls_handshake_malloc(void) {
@@ -146,6 +149,9 @@ static void dtls_security_dealloc(dtls_security_parameters_t *security) {
 void crypto_init(void) {
   memarray_init(&handshake_storage, handshake_storage_data, sizeof(dtls_handshake_parameters_t), DTLS_HANDSHAKE_MAX);
   memarray_init(&security_storage, security_storage_data, sizeof(dtls_security_parameters_t), DTLS_SECURITY_MAX);
+#ifdef DTLS_ECC
+  ecc_init();
+#endif /* DTLS_ECC */
 }
 
 static dtls_handshake_parameters_t *dtls_handshake_malloc(void) {
@@ -193,6 +199,8 @@ void dtls_handshake_free(dtls_handshake_parameters_t *handshake)
     return;
 
   netq_delete_all(&handshake->reorder_queue);
+  netq_node_free(handshake->reassembly);
+  netq_node_free(handshake->ticket);
   dtls_handshake_dealloc(handshake);
 }
 
@@ -219,25 +227,52 @@ void dtls_security_free(dtls_security_parameters_t *security)
   if (!security)
     return;
 
+  /* prevent exposure of the key_block and the expanded keys */
+  memset(security, 0, sizeof(*security));
   dtls_security_dealloc(security);
 }
 
+int
+dtls_security_set_keys(dtls_security_parameters_t *security, int role) {
+  /* ChaCha20 uses the write keys from the key_block as they are */
+  if (dtls_kb_is_chacha20(security))
+    return 0;
+
+  if (rijndael_set_key_enc_only(&security->write_ctx,
+                                dtls_kb_local_write_key(security, role),
+                                8 * dtls_kb_key_size(security, role)) < 0 ||
+      rijndael_set_key_enc_only(&security->read_ctx,
+                                dtls_kb_remote_write_key(security, role),
+                                8 * dtls_kb_key_size(security, role)) < 0) {
+    dtls_warn("cannot set rijndael key\n");
+    return -1;
+  }
+
+#ifdef DTLS_GCM
+  if (security->cipher == TLS_PSK_WITH_AES_128_GCM_SHA256 ||
+      security->cipher == TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256) {
+    dtls_gcm_init(&security->write_gcm, &security->write_ctx);
+    dtls_gcm_init(&security->read_gcm, &security->read_ctx);
+  }
+#endif /* DTLS_GCM */
+
+  return 0;
+}
+
 size_t
-dtls_p_hash(dtls_hashfunc_t h,
-	    const unsigned char *key, size_t keylen,
-	    const unsigned char *label, size_t labellen,
-	    const unsigned char *random1, size_t random1len,
-	    const unsigned char *random2, size_t random2len,
-	    unsigned char *buf, size_t buflen) {
+dtls_p_hash_with_key(const dtls_hmac_key_t *key,
+		     const unsigned char *label, size_t labellen,
+		     const unsigned char *random1, size_t random1len,
+		     const unsigned char *random2, size_t random2len,
+		     unsigned char *buf, size_t buflen) {
   dtls_hmac_context_t hmac;
 
   unsigned char A[DTLS_HMAC_DIGEST_SIZE];
   unsigned char tmp[DTLS_HMAC_DIGEST_SIZE];
   size_t dlen;			/* digest length */
   size_t len = 0;			/* result length */
-  (void)h;
 
-  dtls_hmac_init(&hmac, key, keylen);
+  dtls_hmac_clone(&hmac, key);
 
   /* calculate A(1) from A(0) == seed */
   HMAC_UPDATE_SEED(&hmac, label, labellen);
@@ -247,7 +282,7 @@ dtls_p_hash(dtls_hashfunc_t h,
   dlen = dtls_hmac_finalize(&hmac, A);
 
   while (len < buflen) {
-    dtls_hmac_init(&hmac, key, keylen);
+    dtls_hmac_clone(&hmac, key);
     dtls_hmac_update(&hmac, A, dlen);
 
     HMAC_UPDATE_SEED(&hmac, label, labellen);
@@ -266,7 +301,7 @@ dtls_p_hash(dtls_hashfunc_t h,
     }
 
     /* calculate A(i+1) */
-    dtls_hmac_init(&hmac, key, keylen);
+    dtls_hmac_clone(&hmac, key);
     dtls_hmac_update(&hmac, A, dlen);
     dtls_hmac_finalize(&hmac, A);
   }
@@ -279,6 +314,28 @@ dtls_p_hash(dtls_hashfunc_t h,
   return buflen;
 }
 
+size_t
+dtls_p_hash(dtls_hashfunc_t h,
+	    const unsigned char *key, size_t keylen,
+	    const unsigned char *label, size_t labellen,
+	    const unsigned char *random1, size_t random1len,
+	    const unsigned char *random2, size_t random2len,
+	    unsigned char *buf, size_t buflen) {
+  dtls_hmac_key_t hmac_key;
+  (void)h;
+
+  /* the pads are hashed once for all HMACs of this expansion */
+  dtls_hmac_key_init(&hmac_key, key, keylen);
+  buflen = dtls_p_hash_with_key(&hmac_key,
+				label, labellen,
+				random1, random1len,
+				random2, random2len,
+				buf, buflen);
+
+  memset(&hmac_key, 0, sizeof(hmac_key));
+  return buflen;
+}
+
 size_t 
 dtls_prf(const unsigned char *key, size_t keylen,
 	 const unsigned char *label, size_t labellen,
@@ -296,6 +353,22 @@ dtls_prf(const unsigned char *key, size_t keylen,
 		     buf, buflen);
 }
 
+size_t
+dtls_prf_with_key(const dtls_hmac_key_t *key,
+		  const unsigned char *label, size_t labellen,
+		  const unsigned char *random1, size_t random1len,
+		  const unsigned char *random2, size_t random2len,
+		  unsigned char *buf, size_t buflen) {
+
+  /* Clear the result buffer */
+  memset(buf, 0, buflen);
+  return dtls_p_hash_with_key(key,
+			      label, labellen,
+			      random1, random1len,
+			      random2, random2len,
+			      buf, buflen);
+}
+
 void
 dtls_mac(dtls_hmac_context_t *hmac_ctx, 
 	 const unsigned char *record,
@@ -313,44 +386,6 @@ dtls_mac(dtls_hmac_context_t *hmac_ctx,
   dtls_hmac_finalize(hmac_ctx, buf);
 }
 
-static size_t
-dtls_ccm_encrypt(aes128_ccm_t *ccm_ctx, const unsigned char *src, size_t srclen,
-		 unsigned char *buf, 
-		 const unsigned char *nonce,
-		 const unsigned char *aad, size_t la) {
-  long int len;
-  (void)src;
-
-  assert(ccm_ctx);
-
-  len = dtls_ccm_encrypt_message(&ccm_ctx->ctx,
-                                 ccm_ctx->tag_length /* M */,
-				 ccm_ctx->l /* L */,
-				 nonce,
-				 buf, srclen,
-				 aad, la);
-  return len;
-}
-
-static size_t
-dtls_ccm_decrypt(aes128_ccm_t *ccm_ctx, const unsigned char *src,
-		 size_t srclen, unsigned char *buf,
-		 const unsigned char *nonce,
-		 const unsigned char *aad, size_t la) {
-  long int len;
-  (void)src;
-
-  assert(ccm_ctx);
-
-  len = dtls_ccm_decrypt_message(&ccm_ctx->ctx,
-                                 ccm_ctx->tag_length /* M */,
-				 ccm_ctx->l /* L */,
-				 nonce,
-				 buf, srclen,
-				 aad, la);
-  return len;
-}
-
 #ifdef DTLS_PSK
 int
 dtls_psk_pre_master_secret(unsigned char *key, size_t keylen,
@@ -499,10 +534,159 @@ dtls_ecdsa_generate_key(unsigned char *priv_key,
   dtls_ec_key_from_uint32(pub_y, key_size, pub_key_y);
 }
 
+int
+dtls_x25519_pre_master_secret(const unsigned char *priv_key,
+			      const unsigned char *pub_key,
+			      unsigned char *result, size_t result_len) {
+  if (result_len < DTLS_X25519_KEY_SIZE) {
+    return -1;
+  }
+
+  /* RFC 8422 requires to abort if the peer sent a point of small order */
+  if (dtls_x25519(result, priv_key, pub_key) < 0) {
+    dtls_warn("x25519 shared secret is all zero\n");
+    return -1;
+  }
+  return DTLS_X25519_KEY_SIZE;
+}
+
+void
+dtls_x25519_generate_key(unsigned char *priv_key, unsigned char *pub_key) {
+  dtls_prng(priv_key, DTLS_X25519_KEY_SIZE);
+  dtls_x25519_base(pub_key, priv_key);
+}
+
+#if DTLS_ECDSA_KEY_CACHE_SIZE && ECC_KEY_TABLE_TEETH
+typedef struct {
+  uint32_t pub_x[8];
+  uint32_t pub_y[8];
+  unsigned long last_used;	/**< 0 for an unused entry */
+  ecc_key_table_t table;
+} dtls_ecdsa_key_cache_entry_t;
+
+/* verification tables of recently seen public keys */
+static dtls_ecdsa_key_cache_entry_t key_cache[DTLS_ECDSA_KEY_CACHE_SIZE];
+static unsigned long key_cache_clock;
+static dtls_mutex_t key_cache_mutex = DTLS_MUTEX_INITIALIZER;
+
+/**
+ * Verifies the signature with the cached table for the public key. The
+ * lock is held only to copy a table out of the cache or to store one,
+ * the verification runs on the copy. The table for an unknown key is
+ * built on the stack and replaces the least recently used entry only
+ * if the signature is valid.
+ */
+static int
+dtls_ecdsa_verify_cached(const uint32_t *pub_x, const uint32_t *pub_y,
+			 const uint32_t *hash,
+			 const uint32_t *point_r, const uint32_t *point_s) {
+  dtls_ecdsa_key_cache_entry_t *entry;
+  dtls_ecdsa_key_cache_entry_t *lru;
+  ecc_key_table_t table;
+  int found = 0;
+  int ret;
+  size_t i;
+
+  dtls_mutex_lock(&key_cache_mutex);
+  for (i = 0; i < DTLS_ECDSA_KEY_CACHE_SIZE; i++) {
+    entry = &key_cache[i];
+    if (entry->last_used &&
+	memcmp(entry->pub_x, pub_x, sizeof(entry->pub_x)) == 0 &&
+	memcmp(entry->pub_y, pub_y, sizeof(entry->pub_y)) == 0) {
+      entry->last_used = ++key_cache_clock;
+      table = entry->table;
+      found = 1;
+      break;
+    }
+  }
+  dtls_mutex_unlock(&key_cache_mutex);
+
+  if (found)
+    return ecc_ecdsa_validate_table(&table, hash, point_r, point_s);
+
+  ecc_key_table_init(&table, pub_x, pub_y);
+  ret = ecc_ecdsa_validate_table(&table, hash, point_r, point_s);
+  if (ret != 0)
+    return ret;
+
+  /* only keep keys that have produced a valid signature */
+  dtls_mutex_lock(&key_cache_mutex);
+  lru = key_cache;
+  for (i = 0; i < DTLS_ECDSA_KEY_CACHE_SIZE; i++) {
+    entry = &key_cache[i];
+    if (entry->last_used &&
+	memcmp(entry->pub_x, pub_x, sizeof(entry->pub_x)) == 0 &&
+	memcmp(entry->pub_y, pub_y, sizeof(entry->pub_y)) == 0) {
+      /* added by another thread in the meantime */
+      lru = entry;
+      break;
+    }
+    if (entry->last_used < lru->last_used)
+      lru = entry;
+  }
+  memcpy(lru->pub_x, pub_x, sizeof(lru->pub_x));
+  memcpy(lru->pub_y, pub_y, sizeof(lru->pub_y));
+  lru->table = table;
+  lru->last_used = ++key_cache_clock;
+  dtls_mutex_unlock(&key_cache_mutex);
+  return ret;
+}
+#endif /* DTLS_ECDSA_KEY_CACHE_SIZE && ECC_KEY_TABLE_TEETH */
+
+void
+dtls_ecdsa_generate_key_batch(dtls_ecdhe_key_t *keys, size_t count) {
+  uint32_t priv[ECC_BATCH_SIZE][8];
+  uint32_t pub_x[ECC_BATCH_SIZE][8];
+  uint32_t pub_y[ECC_BATCH_SIZE][8];
+  size_t i, n;
+
+  for (; count; count -= n, keys += n) {
+    n = count < ECC_BATCH_SIZE ? count : ECC_BATCH_SIZE;
+    for (i = 0; i < n; i++) {
+      do {
+	dtls_prng((unsigned char *)priv[i], sizeof(priv[i]));
+      } while (!ecc_is_valid_key(priv[i]));
+    }
+
+    ecc_ec_mult_base_batch((const uint32_t (*)[8])priv, pub_x, pub_y, n);
+
+    for (i = 0; i < n; i++) {
+      dtls_ec_key_from_uint32(priv[i], DTLS_EC_KEY_SIZE, keys[i].priv_key);
+      dtls_ec_key_from_uint32(pub_x[i], DTLS_EC_KEY_SIZE, keys[i].pub_key_x);
+      dtls_ec_key_from_uint32(pub_y[i], DTLS_EC_KEY_SIZE, keys[i].pub_key_y);
+    }
+  }
+  memset(priv, 0, sizeof(priv));
+}
+
+void
+dtls_ecdsa_generate_presig_batch(dtls_ecdsa_presig_t *presig, size_t count) {
+  uint32_t randv[ECC_BATCH_SIZE][8];
+  uint32_t r[ECC_BATCH_SIZE][9];
+  uint32_t k_inv[ECC_BATCH_SIZE][8];
+  size_t i, n;
+
+  for (; count; count -= n, presig += n) {
+    n = count < ECC_BATCH_SIZE ? count : ECC_BATCH_SIZE;
+    do {
+      dtls_prng((unsigned char *)randv, n * sizeof(randv[0]));
+    } while (ecc_ecdsa_sign_precompute_batch((const uint32_t (*)[8])randv,
+					     r, k_inv, n));
+
+    for (i = 0; i < n; i++) {
+      memcpy(presig[i].r, r[i], sizeof(presig[i].r));
+      memcpy(presig[i].k_inv, k_inv[i], sizeof(presig[i].k_inv));
+    }
+  }
+  memset(randv, 0, sizeof(randv));
+  memset(k_inv, 0, sizeof(k_inv));
+}
+
 /* rfc4492#section-5.4 */
 void
 dtls_ecdsa_create_sig_hash(const unsigned char *priv_key, size_t key_size,
 			   const unsigned char *sign_hash, size_t sign_hash_size,
+			   dtls_ecdsa_presig_t *presig,
 			   uint32_t point_r[9], uint32_t point_s[9]) {
   int ret;
   uint32_t priv[8];
@@ -511,6 +695,13 @@ dtls_ecdsa_create_sig_hash(const unsigned char *priv_key, size_t key_size,
   
   dtls_ec_key_to_uint32(priv_key, key_size, priv);
   dtls_ec_key_to_uint32(sign_hash, sign_hash_size, hash);
+  if (presig) {
+    ret = ecc_ecdsa_sign_finish(priv, hash, presig->r, presig->k_inv, point_s);
+    memcpy(point_r, presig->r, sizeof(presig->r));
+    memset(presig, 0, sizeof(dtls_ecdsa_presig_t));
+    if (!ret)
+      return;
+  }
   do {
     dtls_prng((unsigned char *)randv, key_size);
     ret = ecc_ecdsa_sign(priv, hash, randv, point_r, point_s);
@@ -522,6 +713,7 @@ dtls_ecdsa_create_sig(const unsigned char *priv_key, size_t key_size,
 		      const unsigned char *client_random, size_t client_random_size,
 		      const unsigned char *server_random, size_t server_random_size,
 		      const unsigned char *keyx_params, size_t keyx_params_size,
+		      dtls_ecdsa_presig_t *presig,
 		      uint32_t point_r[9], uint32_t point_s[9]) {
   dtls_hash_ctx data;
   unsigned char sha256hash[DTLS_HMAC_DIGEST_SIZE];
@@ -533,7 +725,7 @@ dtls_ecdsa_create_sig(const unsigned char *priv_key, size_t key_size,
   dtls_hash_finalize(sha256hash, &data);
   
   dtls_ecdsa_create_sig_hash(priv_key, key_size, sha256hash,
-			     sizeof(sha256hash), point_r, point_s);
+			     sizeof(sha256hash), presig, point_r, point_s);
 }
 
 /* rfc4492#section-5.4 */
@@ -554,7 +746,11 @@ dtls_ecdsa_verify_sig_hash(const unsigned char *pub_key_x,
   dtls_ec_key_to_uint32(result_s, key_size, point_s);
   dtls_ec_key_to_uint32(sign_hash, sign_hash_size, hash);
 
+#if DTLS_ECDSA_KEY_CACHE_SIZE && ECC_KEY_TABLE_TEETH
+  return dtls_ecdsa_verify_cached(pub_x, pub_y, hash, point_r, point_s);
+#else /* DTLS_ECDSA_KEY_CACHE_SIZE && ECC_KEY_TABLE_TEETH */
   return ecc_ecdsa_validate(pub_x, pub_y, hash, point_r, point_s);
+#endif /* DTLS_ECDSA_KEY_CACHE_SIZE && ECC_KEY_TABLE_TEETH */
 }
 
 int
@@ -578,6 +774,121 @@ dtls_ecdsa_verify_sig(const unsigned char *pub_key_x,
 }
 #endif /* DTLS_ECC */
 
+int
+dtls_encrypt_params_ctx(const dtls_ccm_params_t *params,
+                        rijndael_ctx *key_ctx,
+                        const unsigned char *src, size_t length,
+                        unsigned char *buf,
+                        const unsigned char *aad, size_t la) {
+  assert(key_ctx);
+
+  if (src != buf)
+    memmove(buf, src, length);
+  return dtls_ccm_encrypt_message(key_ctx, params->tag_length /* M */,
+                                  params->l /* L */, params->nonce,
+                                  buf, length, aad, la);
+}
+
+int
+dtls_encrypt_params_multi(const dtls_ccm_params_t params[],
+                          rijndael_ctx *key_ctx[],
+                          unsigned char *buf[], size_t length,
+                          const unsigned char *aad[], size_t la,
+                          size_t n) {
+  const unsigned char *nonce[8];
+  size_t i, k;
+  long int ret = 0;
+
+  for (i = 0; i < n; i++) {
+    if (params[i].tag_length != params[0].tag_length ||
+        params[i].l != params[0].l)
+      return -1;
+  }
+
+  for (; n; n -= k, params += k, key_ctx += k, buf += k, aad += k) {
+    k = min(n, sizeof(nonce) / sizeof(nonce[0]));
+    for (i = 0; i < k; i++)
+      nonce[i] = params[i].nonce;
+    ret = dtls_ccm_encrypt_multi(key_ctx, params[0].tag_length /* M */,
+                                 params[0].l /* L */, nonce,
+                                 buf, length, aad, la, k);
+  }
+  return ret;
+}
+
+int
+dtls_decrypt_params_ctx(const dtls_ccm_params_t *params,
+                        rijndael_ctx *key_ctx,
+                        const unsigned char *src, size_t length,
+                        unsigned char *buf,
+                        const unsigned char *aad, size_t la) {
+  assert(key_ctx);
+
+  if (src != buf)
+    memmove(buf, src, length);
+  return dtls_ccm_decrypt_message(key_ctx, params->tag_length /* M */,
+                                  params->l /* L */, params->nonce,
+                                  buf, length, aad, la);
+}
+
+#ifdef DTLS_GCM
+int
+dtls_encrypt_gcm_ctx(rijndael_ctx *key_ctx,
+                     const dtls_gcm_ghash_t *ghash,
+                     const unsigned char *nonce,
+                     const unsigned char *src, size_t length,
+                     unsigned char *buf,
+                     const unsigned char *aad, size_t la) {
+  assert(key_ctx);
+
+  if (src != buf)
+    memmove(buf, src, length);
+  return dtls_gcm_encrypt_message(key_ctx, ghash, nonce, buf, length,
+                                  aad, la);
+}
+
+int
+dtls_decrypt_gcm_ctx(rijndael_ctx *key_ctx,
+                     const dtls_gcm_ghash_t *ghash,
+                     const unsigned char *nonce,
+                     const unsigned char *src, size_t length,
+                     unsigned char *buf,
+                     const unsigned char *aad, size_t la) {
+  assert(key_ctx);
+
+  if (src != buf)
+    memmove(buf, src, length);
+  return dtls_gcm_decrypt_message(key_ctx, ghash, nonce, buf, length,
+                                  aad, la);
+}
+#endif /* DTLS_GCM */
+
+#ifdef DTLS_CHACHA20
+int
+dtls_encrypt_chacha20_poly1305(const unsigned char *key,
+                               const unsigned char *nonce,
+                               const unsigned char *src, size_t length,
+                               unsigned char *buf,
+                               const unsigned char *aad, size_t la) {
+  if (src != buf)
+    memmove(buf, src, length);
+  return dtls_chacha20_poly1305_encrypt_message(key, nonce, buf, length,
+                                                aad, la);
+}
+
+int
+dtls_decrypt_chacha20_poly1305(const unsigned char *key,
+                               const unsigned char *nonce,
+                               const unsigned char *src, size_t length,
+                               unsigned char *buf,
+                               const unsigned char *aad, size_t la) {
+  if (src != buf)
+    memmove(buf, src, length);
+  return dtls_chacha20_poly1305_decrypt_message(key, nonce, buf, length,
+                                                aad, la);
+}
+#endif /* DTLS_CHACHA20 */
+
 int
 dtls_encrypt_params(const dtls_ccm_params_t *params,
                     const unsigned char *src, size_t length,
@@ -585,23 +896,30 @@ dtls_encrypt_params(const dtls_ccm_params_t *params,
                     const unsigned char *key, size_t keylen,
                     const unsigned char *aad, size_t la) {
   int ret;
-  struct dtls_cipher_context_t *ctx = dtls_cipher_context_get();
-  ctx->data.tag_length = params->tag_length;
-  ctx->data.l = params->l;
+#ifdef DTLS_CONSTRAINED_STACK
+  rijndael_ctx *key_ctx = &cipher_key_ctx;
 
-  ret = rijndael_set_key_enc_only(&ctx->data.ctx, key, 8 * keylen);
+  dtls_mutex_lock(&cipher_key_ctx_mutex);
+#else /* ! DTLS_CONSTRAINED_STACK */
+  rijndael_ctx ctx;
+  rijndael_ctx *key_ctx = &ctx;
+#endif /* ! DTLS_CONSTRAINED_STACK */
+
+  ret = rijndael_set_key_enc_only(key_ctx, key, 8 * keylen);
   if (ret < 0) {
     /* cleanup everything in case the key has the wrong size */
     dtls_warn("cannot set rijndael key\n");
     goto error;
   }
 
-  if (src != buf)
-    memmove(buf, src, length);
-  ret = dtls_ccm_encrypt(&ctx->data, src, length, buf, params->nonce, aad, la);
+  ret = dtls_encrypt_params_ctx(params, key_ctx, src, length, buf, aad, la);
 
 error:
-  dtls_cipher_context_release();
+  /* prevent exposure of the expanded key */
+  memset(key_ctx, 0, sizeof(rijndael_ctx));
+#ifdef DTLS_CONSTRAINED_STACK
+  dtls_mutex_unlock(&cipher_key_ctx_mutex);
+#endif /* DTLS_CONSTRAINED_STACK */
   return ret;
 }
 
@@ -627,23 +945,30 @@ dtls_decrypt_params(const dtls_ccm_params_t *params,
                     const unsigned char *aad, size_t la)
 {
   int ret;
-  struct dtls_cipher_context_t *ctx = dtls_cipher_context_get();
-  ctx->data.tag_length = params->tag_length;
-  ctx->data.l = params->l;
+#ifdef DTLS_CONSTRAINED_STACK
+  rijndael_ctx *key_ctx = &cipher_key_ctx;
+
+  dtls_mutex_lock(&cipher_key_ctx_mutex);
+#else /* ! DTLS_CONSTRAINED_STACK */
+  rijndael_ctx ctx;
+  rijndael_ctx *key_ctx = &ctx;
+#endif /* ! DTLS_CONSTRAINED_STACK */
 
-  ret = rijndael_set_key_enc_only(&ctx->data.ctx, key, 8 * keylen);
+  ret = rijndael_set_key_enc_only(key_ctx, key, 8 * keylen);
   if (ret < 0) {
     /* cleanup everything in case the key has the wrong size */
     dtls_warn("cannot set rijndael key\n");
     goto error;
   }
 
-  if (src != buf)
-    memmove(buf, src, length);
-  ret = dtls_ccm_decrypt(&ctx->data, src, length, buf, params->nonce, aad, la);
+  ret = dtls_decrypt_params_ctx(params, key_ctx, src, length, buf, aad, la);
 
 error:
-  dtls_cipher_context_release();
+  /* prevent exposure of the expanded key */
+  memset(key_ctx, 0, sizeof(rijndael_ctx));
+#ifdef DTLS_CONSTRAINED_STACK
+  dtls_mutex_unlock(&cipher_key_ctx_mutex);
+#endif /* DTLS_CONSTRAINED_STACK */
   return ret;
 }
 
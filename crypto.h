@@ -29,31 +29,48 @@
 #include "numeric.h"
 #include "hmac.h"
 #include "ccm.h"
+#include "gcm.h"
+#include "chacha20_poly1305.h"
+#include "x25519.h"
 
-/* TLS_PSK_WITH_AES_128_CCM_8 */
+/* TLS_PSK_WITH_AES_128_CCM_8, the AES_128_GCM_SHA256 suites use the same
+ * key block layout (RFC 5288) */
 #define DTLS_MAC_KEY_LENGTH    0
 #define DTLS_KEY_LENGTH        16 /* AES-128 */
 #define DTLS_BLK_LENGTH        16 /* AES-128 */
 #define DTLS_MAC_LENGTH        DTLS_HMAC_DIGEST_SIZE
 #define DTLS_IV_LENGTH         4  /* length of nonce_explicit */
 
+/* TLS_PSK_WITH_CHACHA20_POLY1305_SHA256, see RFC 7905 */
+#define DTLS_CHACHA20_KEY_LENGTH DTLS_CHACHA20_KEY_SIZE
+#define DTLS_CHACHA20_IV_LENGTH  DTLS_CHACHA20_NONCE_SIZE /* fixed_iv_length */
+
 /** 
  * Maximum size of the generated keyblock. Note that MAX_KEYBLOCK_LENGTH must 
  * be large enough to hold the pre_master_secret, i.e. twice the length of the 
  * pre-shared key + 1.
  */
+#ifdef DTLS_CHACHA20
+#define MAX_KEYBLOCK_LENGTH  \
+  (2 * DTLS_MAC_KEY_LENGTH + 2 * DTLS_CHACHA20_KEY_LENGTH + \
+   2 * DTLS_CHACHA20_IV_LENGTH)
+#else /* DTLS_CHACHA20 */
 #define MAX_KEYBLOCK_LENGTH  \
   (2 * DTLS_MAC_KEY_LENGTH + 2 * DTLS_KEY_LENGTH + 2 * DTLS_IV_LENGTH)
+#endif /* DTLS_CHACHA20 */
 
 /** Length of DTLS master_secret */
 #define DTLS_MASTER_SECRET_LENGTH 48
 #define DTLS_RANDOM_LENGTH 32
+/** Maximum length of a session id, also used for the ids we create */
+#define DTLS_SESSION_ID_LENGTH 32
 
 typedef enum { AES128=0 
 } dtls_crypto_alg;
 
 typedef enum {
-  DTLS_ECDH_CURVE_SECP256R1
+  DTLS_ECDH_CURVE_SECP256R1,
+  DTLS_ECDH_CURVE_X25519
 } dtls_ecdh_curve;
 
 /** Crypto context for TLS_PSK_WITH_AES_128_CCM_8 cipher suite. */
@@ -75,6 +92,9 @@ typedef struct {
   uint8 other_eph_pub_y[32];
   uint8 other_pub_x[32];
   uint8 other_pub_y[32];
+  dtls_ecdh_curve curve;	/**< the curve used for the ephemeral keys,
+				 *   x25519 keys use own_eph_priv and
+				 *   other_eph_pub_x only */
 } dtls_handshake_parameters_ecdsa_t;
 
 /* This is the maximal supported length of the psk client identity and psk
@@ -116,6 +136,19 @@ typedef struct {
    * access the components of the key block.
    */
   uint8 key_block[MAX_KEYBLOCK_LENGTH];
+
+  /**
+   * Expanded AES key schedules for the local and remote write keys
+   * of this epoch. Both are set up once from the key_block by
+   * dtls_security_set_keys() and used for every record instead of
+   * running the key expansion per record.
+   */
+  rijndael_ctx write_ctx;	/**< key schedule of the local write key */
+  rijndael_ctx read_ctx;	/**< key schedule of the remote write key */
+#ifdef DTLS_GCM
+  dtls_gcm_ghash_t write_gcm;	/**< GHASH subkey of the local write key */
+  dtls_gcm_ghash_t read_gcm;	/**< GHASH subkey of the remote write key */
+#endif /* DTLS_GCM */
   
   seqnum_t cseq;        /**<sequence number of last record received*/
 } dtls_security_parameters_t;
@@ -131,13 +164,22 @@ typedef struct {
     /** the session's master secret */
     uint8 master_secret[DTLS_MASTER_SECRET_LENGTH];
   } tmp;
+  /** HMAC key prepared from tmp.master_secret for the Finished PRF */
+  dtls_hmac_key_t master_key;
   struct netq_t *reorder_queue;	/**< the packets to reorder */
+  struct netq_t *reassembly;	/**< the fragmented message being reassembled */
+  struct netq_t *ticket;	/**< the session ticket received by a client */
   dtls_hs_state_t hs_state;  /**< handshake protocol status */
 
   dtls_compression_t compression;		/**< compression method */
   dtls_cipher_t cipher;		/**< cipher type */
   unsigned int do_client_auth:1;
   unsigned int extended_master_secret:1;
+  unsigned int resumed:1;	/**< abbreviated handshake of a cached session */
+  unsigned int new_session_ticket:1; /**< the server sends a NewSessionTicket */
+  uint8 session_id_length;	/**< length of session_id, 0 if there is none */
+  /** the session id offered by the client or chosen by the server */
+  uint8 session_id[DTLS_SESSION_ID_LENGTH];
   union {
 #ifdef DTLS_ECC
     dtls_handshake_parameters_ecdsa_t ecdsa;
@@ -149,7 +191,16 @@ typedef struct {
 } dtls_handshake_parameters_t;
 
 /* The following macros provide access to the components of the
- * key_block in the security parameters. */
+ * key_block in the security parameters. The sizes of the write keys
+ * and IVs depend on the cipher of the security parameters. */
+
+#ifdef DTLS_CHACHA20
+#define dtls_kb_is_chacha20(Param)					\
+  ((Param)->cipher == TLS_PSK_WITH_CHACHA20_POLY1305_SHA256 ||		\
+   (Param)->cipher == TLS_ECDHE_ECDSA_WITH_CHACHA20_POLY1305_SHA256)
+#else /* DTLS_CHACHA20 */
+#define dtls_kb_is_chacha20(Param) 0
+#endif /* DTLS_CHACHA20 */
 
 #define dtls_kb_client_mac_secret(Param, Role) ((Param)->key_block)
 #define dtls_kb_server_mac_secret(Param, Role)				\
@@ -166,7 +217,7 @@ typedef struct {
 #define dtls_kb_client_write_key(Param, Role)				\
   (dtls_kb_server_mac_secret(Param, Role) + DTLS_MAC_KEY_LENGTH)
 #define dtls_kb_server_write_key(Param, Role)				\
-  (dtls_kb_client_write_key(Param, Role) + DTLS_KEY_LENGTH)
+  (dtls_kb_client_write_key(Param, Role) + dtls_kb_key_size(Param, Role))
 #define dtls_kb_remote_write_key(Param, Role)				\
   ((Role) == DTLS_SERVER						\
    ? dtls_kb_client_write_key(Param, Role)				\
@@ -175,11 +226,12 @@ typedef struct {
   ((Role) == DTLS_CLIENT						\
    ? dtls_kb_client_write_key(Param, Role)				\
    : dtls_kb_server_write_key(Param, Role))
-#define dtls_kb_key_size(Param, Role) DTLS_KEY_LENGTH
+#define dtls_kb_key_size(Param, Role)					\
+  (dtls_kb_is_chacha20(Param) ? DTLS_CHACHA20_KEY_LENGTH : DTLS_KEY_LENGTH)
 #define dtls_kb_client_iv(Param, Role)					\
-  (dtls_kb_server_write_key(Param, Role) + DTLS_KEY_LENGTH)
+  (dtls_kb_server_write_key(Param, Role) + dtls_kb_key_size(Param, Role))
 #define dtls_kb_server_iv(Param, Role)					\
-  (dtls_kb_client_iv(Param, Role) + DTLS_IV_LENGTH)
+  (dtls_kb_client_iv(Param, Role) + dtls_kb_iv_size(Param, Role))
 #define dtls_kb_remote_iv(Param, Role)					\
   ((Role) == DTLS_SERVER						\
    ? dtls_kb_client_iv(Param, Role)					\
@@ -188,7 +240,8 @@ typedef struct {
   ((Role) == DTLS_CLIENT						\
    ? dtls_kb_client_iv(Param, Role)					\
    : dtls_kb_server_iv(Param, Role))
-#define dtls_kb_iv_size(Param, Role) DTLS_IV_LENGTH
+#define dtls_kb_iv_size(Param, Role)					\
+  (dtls_kb_is_chacha20(Param) ? DTLS_CHACHA20_IV_LENGTH : DTLS_IV_LENGTH)
 
 #define dtls_kb_size(Param, Role)					\
   (2 * (dtls_kb_mac_secret_size(Param, Role) +				\
@@ -220,6 +273,17 @@ size_t dtls_p_hash(dtls_hashfunc_t h,
 		   const unsigned char *random2, size_t random2len,
 		   unsigned char *buf, size_t buflen);
 
+/**
+ * Same as dtls_p_hash() with the hash function HASH_SHA256, but
+ * uses the HMAC key \p key that has been prepared from the secret
+ * with dtls_hmac_key_init().
+ */
+size_t dtls_p_hash_with_key(const dtls_hmac_key_t *key,
+			    const unsigned char *label, size_t labellen,
+			    const unsigned char *random1, size_t random1len,
+			    const unsigned char *random2, size_t random2len,
+			    unsigned char *buf, size_t buflen);
+
 /**
  * This function implements the TLS PRF for DTLS_VERSION. For version
  * 1.0, the PRF is P_MD5 ^ P_SHA1 while version 1.2 uses
@@ -231,6 +295,17 @@ size_t dtls_prf(const unsigned char *key, size_t keylen,
 		const unsigned char *random2, size_t random2len,
 		unsigned char *buf, size_t buflen);
 
+/**
+ * Same as dtls_prf(), but with a secret that has been prepared with
+ * dtls_hmac_key_init(). Use this function when the PRF is applied
+ * more than once with the same secret.
+ */
+size_t dtls_prf_with_key(const dtls_hmac_key_t *key,
+			 const unsigned char *label, size_t labellen,
+			 const unsigned char *random1, size_t random1len,
+			 const unsigned char *random2, size_t random2len,
+			 unsigned char *buf, size_t buflen);
+
 /**
  * Calculates MAC for record + cleartext packet and places the result
  * in \p buf. The given \p hmac_ctx must be initialized with the HMAC
@@ -287,6 +362,51 @@ int dtls_encrypt_params(const dtls_ccm_params_t *params,
                         const unsigned char *key, size_t keylen,
                         const unsigned char *aad, size_t aad_length);
 
+/**
+ * Encrypts the specified \p src of given \p length like
+ * dtls_encrypt_params() but uses the already expanded key schedule
+ * \p key_ctx instead of a raw key.
+ *
+ * \param params  AEAD parameters: Nonce, M and L.
+ * \param key_ctx The initialized AES key schedule to use.
+ * \param src     The data to encrypt.
+ * \param length  The actual size of of \p src.
+ * \param buf     The result buffer.
+ * \param aad     additional data for AEAD ciphers
+ * \param aad_length actual size of @p aad
+ * \return The number of encrypted bytes on success, less than zero
+ *         otherwise.
+ */
+int dtls_encrypt_params_ctx(const dtls_ccm_params_t *params,
+                            rijndael_ctx *key_ctx,
+                            const unsigned char *src, size_t length,
+                            unsigned char *buf,
+                            const unsigned char *aad, size_t aad_length);
+
+/**
+ * Encrypts \p n buffers of the same \p length in place, buffer \p buf[i]
+ * with the AEAD parameters \p params[i], the key schedule \p key_ctx[i]
+ * and the additional data \p aad[i]. This gives the same result as
+ * calling dtls_encrypt_params_ctx() for every buffer but processes
+ * several buffers side by side. All \p params must use the same M and
+ * L. Each buffer must provide room for the MAC after \p length bytes.
+ *
+ * \param params  AEAD parameters: Nonce, M and L, one per buffer.
+ * \param key_ctx The initialized AES key schedules, one per buffer.
+ * \param buf     The data to encrypt.
+ * \param length  The actual size of each buffer in \p buf.
+ * \param aad     additional data for AEAD ciphers, one per buffer
+ * \param aad_length actual size of each @p aad
+ * \param n       The number of buffers.
+ * \return The number of encrypted bytes per buffer on success, less
+ *         than zero otherwise.
+ */
+int dtls_encrypt_params_multi(const dtls_ccm_params_t params[],
+                              rijndael_ctx *key_ctx[],
+                              unsigned char *buf[], size_t length,
+                              const unsigned char *aad[], size_t aad_length,
+                              size_t n);
+
 /** 
  * Encrypts the specified \p src of given \p length, writing the
  * result to \p buf. The cipher implementation may add more data to
@@ -339,6 +459,27 @@ int dtls_decrypt_params(const dtls_ccm_params_t *params,
                         const unsigned char *key, size_t keylen,
                         const unsigned char *aad, size_t aad_length);
 
+/**
+ * Decrypts the given buffer \p src of given \p length like
+ * dtls_decrypt_params() but uses the already expanded key schedule
+ * \p key_ctx instead of a raw key.
+ *
+ * \param params  AEAD parameters: Nonce, M and L.
+ * \param key_ctx The initialized AES key schedule to use.
+ * \param src     The buffer to decrypt.
+ * \param length  The length of the input buffer.
+ * \param buf     The result buffer.
+ * \param aad     additional authentication data for AEAD ciphers
+ * \param aad_length actual size of @p aad
+ * \return Less than zero on error, the number of decrypted bytes
+ *         otherwise.
+ */
+int dtls_decrypt_params_ctx(const dtls_ccm_params_t *params,
+                            rijndael_ctx *key_ctx,
+                            const unsigned char *src, size_t length,
+                            unsigned char *buf,
+                            const unsigned char *aad, size_t aad_length);
+
 /** 
  * Decrypts the given buffer \p src of given \p length, writing the
  * result to \p buf. The function returns \c -1 in case of an error,
@@ -366,6 +507,103 @@ int dtls_decrypt(const unsigned char *src, size_t length,
 		 const unsigned char *key, size_t keylen,
 		 const unsigned char *a_data, size_t a_data_length);
 
+#ifdef DTLS_GCM
+/**
+ * Encrypts the specified \p src of given \p length with AES-GCM,
+ * writing the result and the \c DTLS_GCM_TAG_SIZE bytes tag to \p
+ * buf. The provided \p src and \p buf may overlap.
+ *
+ * \param key_ctx The initialized AES key schedule to use.
+ * \param ghash   The GHASH subkey set up for \p key_ctx.
+ * \param nonce   The nonce, must be exactly \c DTLS_GCM_NONCE_SIZE
+ *                bytes.
+ * \param src     The data to encrypt.
+ * \param length  The actual size of of \p src.
+ * \param buf     The result buffer.
+ * \param aad     additional data for AEAD ciphers
+ * \param aad_length actual size of @p aad
+ * \return The number of encrypted bytes on success, less than zero
+ *         otherwise.
+ */
+int dtls_encrypt_gcm_ctx(rijndael_ctx *key_ctx,
+                         const dtls_gcm_ghash_t *ghash,
+                         const unsigned char *nonce,
+                         const unsigned char *src, size_t length,
+                         unsigned char *buf,
+                         const unsigned char *aad, size_t aad_length);
+
+/**
+ * Verifies and decrypts the given buffer \p src of given \p length
+ * that has been encrypted with dtls_encrypt_gcm_ctx(). The provided
+ * \p src and \p buf may overlap.
+ *
+ * \param key_ctx The initialized AES key schedule to use.
+ * \param ghash   The GHASH subkey set up for \p key_ctx.
+ * \param nonce   The nonce, must be exactly \c DTLS_GCM_NONCE_SIZE
+ *                bytes.
+ * \param src     The buffer to decrypt.
+ * \param length  The length of the input buffer including the tag.
+ * \param buf     The result buffer.
+ * \param aad     additional authentication data for AEAD ciphers
+ * \param aad_length actual size of @p aad
+ * \return Less than zero on error, the number of decrypted bytes
+ *         otherwise.
+ */
+int dtls_decrypt_gcm_ctx(rijndael_ctx *key_ctx,
+                         const dtls_gcm_ghash_t *ghash,
+                         const unsigned char *nonce,
+                         const unsigned char *src, size_t length,
+                         unsigned char *buf,
+                         const unsigned char *aad, size_t aad_length);
+#endif /* DTLS_GCM */
+
+#ifdef DTLS_CHACHA20
+/**
+ * Encrypts the specified \p src of given \p length with
+ * ChaCha20-Poly1305, writing the result and the \c
+ * DTLS_POLY1305_TAG_SIZE bytes tag to \p buf. The provided \p src
+ * and \p buf may overlap.
+ *
+ * \param key     The \c DTLS_CHACHA20_KEY_LENGTH bytes key.
+ * \param nonce   The nonce, must be exactly \c DTLS_CHACHA20_IV_LENGTH
+ *                bytes.
+ * \param src     The data to encrypt.
+ * \param length  The actual size of of \p src.
+ * \param buf     The result buffer.
+ * \param aad     additional data for AEAD ciphers
+ * \param aad_length actual size of @p aad
+ * \return The number of encrypted bytes on success, less than zero
+ *         otherwise.
+ */
+int dtls_encrypt_chacha20_poly1305(const unsigned char *key,
+                                   const unsigned char *nonce,
+                                   const unsigned char *src, size_t length,
+                                   unsigned char *buf,
+                                   const unsigned char *aad, size_t aad_length);
+
+/**
+ * Verifies and decrypts the given buffer \p src of given \p length
+ * that has been encrypted with dtls_encrypt_chacha20_poly1305(). The
+ * provided \p src and \p buf may overlap.
+ *
+ * \param key     The \c DTLS_CHACHA20_KEY_LENGTH bytes key.
+ * \param nonce   The nonce, must be exactly \c DTLS_CHACHA20_IV_LENGTH
+ *                bytes.
+ * \param src     The buffer to decrypt.
+ * \param length  The length of the input buffer including the tag.
+ * \param buf     The result buffer.
+ * \param aad     additional authentication data for AEAD ciphers
+ * \param aad_length actual size of @p aad
+ * \return Less than zero on error, the number of decrypted bytes
+ *         otherwise.
+ */
+int dtls_decrypt_chacha20_poly1305(const unsigned char *key,
+                                   const unsigned char *nonce,
+                                   const unsigned char *src, size_t length,
+                                   unsigned char *buf,
+                                   const unsigned char *aad, size_t aad_length);
+#endif /* DTLS_CHACHA20 */
+
 /* helper functions */
 
 /** 
@@ -383,6 +621,21 @@ int dtls_psk_pre_master_secret(unsigned char *key, size_t keylen,
 
 #define DTLS_EC_KEY_SIZE 32
 
+/**
+ * Number of peer public keys for which dtls_ecdsa_verify_sig() keeps
+ * a precomputed verification table, least recently used keys are
+ * replaced first. Each entry takes about 1 KiB with the default
+ * ECC_KEY_TABLE_TEETH, a verification keeps one more table on the
+ * stack. 0 disables the cache.
+ */
+#ifndef DTLS_ECDSA_KEY_CACHE_SIZE
+#if defined(WITH_CONTIKI) || defined(RIOT_VERSION) || defined(WITH_ZEPHYR) || defined(WITH_LMSTAX)
+#define DTLS_ECDSA_KEY_CACHE_SIZE 0
+#else
+#define DTLS_ECDSA_KEY_CACHE_SIZE 8
+#endif
+#endif /* DTLS_ECDSA_KEY_CACHE_SIZE */
+
 int dtls_ecdh_pre_master_secret(unsigned char *priv_key,
 				unsigned char *pub_key_x,
                                 unsigned char *pub_key_y,
@@ -395,14 +648,78 @@ void dtls_ecdsa_generate_key(unsigned char *priv_key,
 			     unsigned char *pub_key_y,
 			     size_t key_size);
 
+/**
+ * Computes the x25519 shared secret of @p priv_key and the peer's
+ * public key @p pub_key as in RFC 8422, section 5.11.
+ *
+ * @return The length of @p result, or @c -1 if @p result_len is too
+ *         small or the shared secret is all zero.
+ */
+int dtls_x25519_pre_master_secret(const unsigned char *priv_key,
+				  const unsigned char *pub_key,
+				  unsigned char *result, size_t result_len);
+
+/**
+ * Generates an ephemeral x25519 key pair, both
+ * @c DTLS_X25519_KEY_SIZE bytes long.
+ */
+void dtls_x25519_generate_key(unsigned char *priv_key,
+			      unsigned char *pub_key);
+
+/**
+ * The message independent part of an ECDSA signature, i.e. r and the
+ * inverse of the random nonce k. Must be used for one signature only.
+ */
+typedef struct {
+  uint32_t r[9];
+  uint32_t k_inv[8];
+} dtls_ecdsa_presig_t;
+
+/** An ephemeral ECDHE key pair generated ahead of the handshake. */
+typedef struct {
+  unsigned char priv_key[DTLS_EC_KEY_SIZE];
+  unsigned char pub_key_x[DTLS_EC_KEY_SIZE];
+  unsigned char pub_key_y[DTLS_EC_KEY_SIZE];
+} dtls_ecdhe_key_t;
+
+/**
+ * Maximum number of key pairs or signature nonces that a pool refill
+ * computes in one go. Larger batches share more field inversions but
+ * take longer before the pool lock is taken again. Only the pool
+ * refills are batched, the scalar multiplications that a handshake
+ * cannot take from a pool are still computed one at a time.
+ */
+#ifndef DTLS_ECC_BATCH_SIZE
+#define DTLS_ECC_BATCH_SIZE 8
+#endif /* DTLS_ECC_BATCH_SIZE */
+
+/**
+ * Generates @p count ephemeral key pairs. The key pairs are computed
+ * together, sharing the field inversions.
+ */
+void dtls_ecdsa_generate_key_batch(dtls_ecdhe_key_t *keys, size_t count);
+
+/**
+ * Draws @p count fresh nonces and computes @p presig from them. The
+ * entries are computed together, sharing the field inversions.
+ */
+void dtls_ecdsa_generate_presig_batch(dtls_ecdsa_presig_t *presig, size_t count);
+
+/**
+ * Signs @p sign_hash with @p priv_key. If @p presig is not @c NULL,
+ * its precomputed values are used and wiped afterwards, otherwise a
+ * new nonce is drawn.
+ */
 void dtls_ecdsa_create_sig_hash(const unsigned char *priv_key, size_t key_size,
 				const unsigned char *sign_hash, size_t sign_hash_size,
+				dtls_ecdsa_presig_t *presig,
 				uint32_t point_r[9], uint32_t point_s[9]);
 
 void dtls_ecdsa_create_sig(const unsigned char *priv_key, size_t key_size,
 			   const unsigned char *client_random, size_t client_random_size,
 			   const unsigned char *server_random, size_t server_random_size,
 			   const unsigned char *keyx_params, size_t keyx_params_size,
+			   dtls_ecdsa_presig_t *presig,
 			   uint32_t point_r[9], uint32_t point_s[9]);
 
 int dtls_ecdsa_verify_sig_hash(const unsigned char *pub_key_x,
@@ -428,6 +745,18 @@ void dtls_handshake_free(dtls_handshake_parameters_t *handshake);
 dtls_security_parameters_t *dtls_security_new(void);
 
 void dtls_security_free(dtls_security_parameters_t *security);
+
+/**
+ * Expands the local and remote write keys of the key_block in
+ * @p security into the cached key schedules write_ctx and read_ctx.
+ * This must be called once the key_block has been calculated.
+ *
+ * @param security The security parameters of the new epoch.
+ * @param role     The local role, DTLS_CLIENT or DTLS_SERVER.
+ * @return @c 0 on success, less than zero on error.
+ */
+int dtls_security_set_keys(dtls_security_parameters_t *security, int role);
+
 void crypto_init(void);
 
 #endif /* _DTLS_CRYPTO_H_ */
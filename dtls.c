@@ -123,14 +123,22 @@ memarray_t dtlscontext_storage;
 #define DTLS_HS_LENGTH sizeof(dtls_handshake_header_t)
 #define DTLS_CH_LENGTH sizeof(dtls_client_hello_t) /* no variable length fields! */
 #define DTLS_COOKIE_LENGTH_MAX 32
-#define DTLS_CH_LENGTH_MAX sizeof(dtls_client_hello_t) + DTLS_COOKIE_LENGTH_MAX + 12 + 26 + 12
+#if DTLS_SESSION_TICKETS
+/* the session ticket extension */
+#define DTLS_CH_TICKET_LENGTH_MAX (4 + DTLS_SESSION_TICKET_MAX_LENGTH)
+#else /* DTLS_SESSION_TICKETS */
+#define DTLS_CH_TICKET_LENGTH_MAX 0
+#endif /* DTLS_SESSION_TICKETS */
+#define DTLS_CH_LENGTH_MAX sizeof(dtls_client_hello_t) + DTLS_SESSION_ID_LENGTH + DTLS_COOKIE_LENGTH_MAX + 20 + 26 + 14 + DTLS_CH_TICKET_LENGTH_MAX
 #define DTLS_HV_LENGTH sizeof(dtls_hello_verify_t)
-#define DTLS_SH_LENGTH (2 + DTLS_RANDOM_LENGTH + 1 + 2 + 1)
+#define DTLS_SH_LENGTH (2 + DTLS_RANDOM_LENGTH + 1 + DTLS_SESSION_ID_LENGTH + 2 + 1)
 #define DTLS_SKEXEC_LENGTH (1 + 2 + 1 + 1 + DTLS_EC_KEY_SIZE + DTLS_EC_KEY_SIZE + 1 + 1 + 2 + 70)
+#define DTLS_SKEXEC_X25519_LENGTH (1 + 2 + 1 + DTLS_X25519_KEY_SIZE + 1 + 1 + 2 + 70)
 #define DTLS_SKEXECPSK_LENGTH_MIN 2
 #define DTLS_SKEXECPSK_LENGTH_MAX 2 + DTLS_PSK_MAX_CLIENT_IDENTITY_LEN
 #define DTLS_CKXPSK_LENGTH_MIN 2
 #define DTLS_CKXEC_LENGTH (1 + 1 + max(DTLS_EC_KEY_SIZE + DTLS_EC_KEY_SIZE, DTLS_PSK_MAX_CLIENT_IDENTITY_LEN))
+#define DTLS_CKXEC_X25519_LENGTH (1 + DTLS_X25519_KEY_SIZE)
 #define DTLS_CV_LENGTH (1 + 1 + 2 + 1 + 1 + 1 + 1 + DTLS_EC_KEY_SIZE + 1 + 1 + DTLS_EC_KEY_SIZE)
 #define DTLS_FIN_LENGTH 12
 
@@ -374,35 +382,73 @@ dtls_get_cookie(uint8 *msg, size_t msglen, uint8 **cookie) {
   return dtls_alert_fatal_create(DTLS_ALERT_HANDSHAKE_FAILURE);
 }
 
+#if DTLS_SESSION_TICKETS
+/**
+ * Looks for the session ticket extension in the ClientHello \p msg.
+ * On success, \p ticket points to the ticket, which is empty if the
+ * client has none.
+ *
+ * \return The length of the ticket, or less than zero if the client
+ *         did not send the extension.
+ */
 static int
-dtls_create_cookie(dtls_context_t *ctx,
-		   session_t *session,
-		   uint8 *msg, size_t msglen,
-		   uint8 *cookie, int *clen) {
-  unsigned char buf[DTLS_HMAC_MAX];
-  size_t e, fragment_length;
-  int len;
+dtls_get_session_ticket(uint8 *msg, size_t msglen, uint8 **ticket) {
+  int type, length;
 
-  /* create cookie with HMAC-SHA256 over:
-   * - SECRET
-   * - session parameters (only IP address?)
-   * - client version
-   * - random gmt and bytes
-   * - session id
-   * - cipher_suites
-   * - compression method
-   */
+  if (msglen < DTLS_HS_LENGTH + DTLS_CH_LENGTH)
+    return -1;
 
-  /* Note that the buffer size must fit with the default hash algorithm. */
+  msglen -= DTLS_HS_LENGTH + DTLS_CH_LENGTH;
+  msg += DTLS_HS_LENGTH + DTLS_CH_LENGTH;
 
-  dtls_hmac_context_t hmac_context;
-  dtls_hmac_init(&hmac_context, ctx->cookie_secret, DTLS_COOKIE_SECRET_LENGTH);
+  SKIP_VAR_FIELD(msg, msglen, uint8); /* skip session id */
+  SKIP_VAR_FIELD(msg, msglen, uint8); /* skip cookie */
+  SKIP_VAR_FIELD(msg, msglen, uint16); /* skip cipher suites */
+  SKIP_VAR_FIELD(msg, msglen, uint8); /* skip compression methods */
 
-  dtls_hmac_update(&hmac_context,
-		   (unsigned char *)&session->addr, session->size);
+  /* the extensions */
+  if (msglen < sizeof(uint16))
+    return -1;
+  length = dtls_uint16_to_int(msg);
+  msg += sizeof(uint16);
+  msglen -= sizeof(uint16);
+  if (msglen > (size_t)length)
+    msglen = length;
+
+  while (msglen >= 2 * sizeof(uint16)) {
+    type = dtls_uint16_to_int(msg);
+    length = dtls_uint16_to_int(msg + sizeof(uint16));
+    msg += 2 * sizeof(uint16);
+    msglen -= 2 * sizeof(uint16);
+    if (msglen < (size_t)length)
+      break;
+
+    if (type == TLS_EXT_SESSION_TICKET) {
+      *ticket = msg;
+      return length;
+    }
+    msg += length;
+    msglen -= length;
+  }
+
+ error:
+  return -1;
+}
+#endif /* DTLS_SESSION_TICKETS */
+
+/**
+ * Determines the parts of the ClientHello \p msg that are covered by
+ * the cookie: the \p prefix_len bytes after the handshake header up
+ * to and including the session id, and the \p tail_len bytes at
+ * offset \p tail_offset that follow the cookie.
+ */
+static int
+dtls_cookie_parts(uint8 *msg, size_t msglen, size_t *prefix_len,
+		  size_t *tail_offset, size_t *tail_len) {
+  size_t e, fragment_length;
 
-  /* feed in the beginning of the Client Hello up to and including the
-     session id */
+  /* the beginning of the Client Hello up to and including the session
+     id */
   e = DTLS_CH_LENGTH;
   if (e + DTLS_HS_LENGTH + sizeof(uint8_t) > msglen)
     return dtls_alert_fatal_create(DTLS_ALERT_HANDSHAKE_FAILURE);
@@ -412,7 +458,7 @@ dtls_create_cookie(dtls_context_t *ctx,
   if (e + DTLS_HS_LENGTH > msglen)
     return dtls_alert_fatal_create(DTLS_ALERT_HANDSHAKE_FAILURE);
 
-  dtls_hmac_update(&hmac_context, msg + DTLS_HS_LENGTH, e);
+  *prefix_len = e;
 
   if (e + DTLS_HS_LENGTH + sizeof(uint8_t) > msglen)
     return dtls_alert_fatal_create(DTLS_ALERT_HANDSHAKE_FAILURE);
@@ -425,9 +471,43 @@ dtls_create_cookie(dtls_context_t *ctx,
   if ((fragment_length < e) || (e + DTLS_HS_LENGTH) > msglen)
     return dtls_alert_fatal_create(DTLS_ALERT_HANDSHAKE_FAILURE);
 
+  *tail_offset = DTLS_HS_LENGTH + e;
+  *tail_len = fragment_length - e;
+  return 0;
+}
+
+static int
+dtls_create_cookie(dtls_context_t *ctx,
+		   session_t *session,
+		   uint8 *msg, size_t msglen,
+		   uint8 *cookie, int *clen) {
+  unsigned char buf[DTLS_HMAC_MAX];
+  size_t prefix_len, tail_offset, tail_len;
+  int len;
+
+  /* create cookie with HMAC-SHA256 over:
+   * - SECRET
+   * - session parameters (only IP address?)
+   * - client version
+   * - random gmt and bytes
+   * - session id
+   * - cipher_suites
+   * - compression method
+   */
+
+  /* Note that the buffer size must fit with the default hash algorithm. */
+
+  len = dtls_cookie_parts(msg, msglen, &prefix_len, &tail_offset, &tail_len);
+  if (len < 0)
+    return len;
+
+  dtls_hmac_context_t hmac_context;
+  dtls_hmac_clone(&hmac_context, &ctx->cookie_key);
+
   dtls_hmac_update(&hmac_context,
-		   msg + DTLS_HS_LENGTH + e,
-		   fragment_length - e);
+		   (unsigned char *)&session->addr, session->size);
+  dtls_hmac_update(&hmac_context, msg + DTLS_HS_LENGTH, prefix_len);
+  dtls_hmac_update(&hmac_context, msg + tail_offset, tail_len);
 
   len = dtls_hmac_finalize(&hmac_context, buf);
 
@@ -589,6 +669,108 @@ static inline int is_tls_psk_with_aes_128_ccm_8(dtls_cipher_t cipher)
 #endif /* DTLS_PSK */
 }
 
+/** returns true if the cipher matches TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256 */
+static inline int is_tls_ecdhe_ecdsa_with_aes_128_gcm_sha256(dtls_cipher_t cipher)
+{
+#if defined(DTLS_ECC) && defined(DTLS_GCM)
+  return cipher == TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256;
+#else
+  (void) cipher;
+  return 0;
+#endif /* DTLS_ECC && DTLS_GCM */
+}
+
+/** returns true if the cipher matches TLS_PSK_WITH_AES_128_GCM_SHA256 */
+static inline int is_tls_psk_with_aes_128_gcm_sha256(dtls_cipher_t cipher)
+{
+#if defined(DTLS_PSK) && defined(DTLS_GCM)
+  return cipher == TLS_PSK_WITH_AES_128_GCM_SHA256;
+#else
+  (void) cipher;
+  return 0;
+#endif /* DTLS_PSK && DTLS_GCM */
+}
+
+/** returns true if the cipher matches TLS_ECDHE_ECDSA_WITH_CHACHA20_POLY1305_SHA256 */
+static inline int is_tls_ecdhe_ecdsa_with_chacha20_poly1305_sha256(dtls_cipher_t cipher)
+{
+#if defined(DTLS_ECC) && defined(DTLS_CHACHA20)
+  return cipher == TLS_ECDHE_ECDSA_WITH_CHACHA20_POLY1305_SHA256;
+#else
+  (void) cipher;
+  return 0;
+#endif /* DTLS_ECC && DTLS_CHACHA20 */
+}
+
+/** returns true if the cipher matches TLS_PSK_WITH_CHACHA20_POLY1305_SHA256 */
+static inline int is_tls_psk_with_chacha20_poly1305_sha256(dtls_cipher_t cipher)
+{
+#if defined(DTLS_PSK) && defined(DTLS_CHACHA20)
+  return cipher == TLS_PSK_WITH_CHACHA20_POLY1305_SHA256;
+#else
+  (void) cipher;
+  return 0;
+#endif /* DTLS_PSK && DTLS_CHACHA20 */
+}
+
+/** returns true if the cipher uses the ECDHE_ECDSA key exchange */
+static inline int is_key_exchange_ecdhe_ecdsa(dtls_cipher_t cipher)
+{
+  return is_tls_ecdhe_ecdsa_with_aes_128_ccm_8(cipher) ||
+         is_tls_ecdhe_ecdsa_with_aes_128_gcm_sha256(cipher) ||
+         is_tls_ecdhe_ecdsa_with_chacha20_poly1305_sha256(cipher);
+}
+
+/** returns true if the cipher uses the PSK key exchange */
+static inline int is_key_exchange_psk(dtls_cipher_t cipher)
+{
+  return is_tls_psk_with_aes_128_ccm_8(cipher) ||
+         is_tls_psk_with_aes_128_gcm_sha256(cipher) ||
+         is_tls_psk_with_chacha20_poly1305_sha256(cipher);
+}
+
+#ifdef DTLS_ECC
+/** returns true if the ECDHE key exchange uses x25519 */
+static inline int is_ecdh_curve_x25519(const dtls_handshake_parameters_t *handshake)
+{
+#ifdef DTLS_X25519
+  return handshake->keyx.ecdsa.curve == DTLS_ECDH_CURVE_X25519;
+#else
+  (void) handshake;
+  return 0;
+#endif /* DTLS_X25519 */
+}
+#endif /* DTLS_ECC */
+
+/** returns true if records are protected with AES-128-GCM */
+static inline int is_aes_128_gcm(dtls_cipher_t cipher)
+{
+  return is_tls_psk_with_aes_128_gcm_sha256(cipher) ||
+         is_tls_ecdhe_ecdsa_with_aes_128_gcm_sha256(cipher);
+}
+
+/** returns true if records are protected with ChaCha20-Poly1305 */
+static inline int is_chacha20_poly1305(dtls_cipher_t cipher)
+{
+  return is_tls_psk_with_chacha20_poly1305_sha256(cipher) ||
+         is_tls_ecdhe_ecdsa_with_chacha20_poly1305_sha256(cipher);
+}
+
+/** returns the size of the authentication tag of the record cipher */
+static inline size_t dtls_cipher_tag_size(dtls_cipher_t cipher)
+{
+  if (is_chacha20_poly1305(cipher))
+    return DTLS_POLY1305_TAG_SIZE;
+  return is_aes_128_gcm(cipher) ? DTLS_GCM_TAG_SIZE : 8;
+}
+
+/** returns the size of the nonce_explicit sent with each record, the
+ * ChaCha20-Poly1305 nonce is derived from the sequence number only */
+static inline size_t dtls_cipher_explicit_nonce_size(dtls_cipher_t cipher)
+{
+  return is_chacha20_poly1305(cipher) ? 0 : 8;
+}
+
 /** returns true if the application is configured for psk */
 static inline int is_psk_supported(dtls_context_t *ctx)
 {
@@ -641,8 +823,8 @@ known_cipher(dtls_context_t *ctx, dtls_cipher_t code, int is_client) {
 
   psk = is_psk_supported(ctx);
   ecdsa = is_ecdsa_supported(ctx, is_client);
-  return (psk && is_tls_psk_with_aes_128_ccm_8(code)) ||
-	 (ecdsa && is_tls_ecdhe_ecdsa_with_aes_128_ccm_8(code));
+  return (psk && is_key_exchange_psk(code)) ||
+	 (ecdsa && is_key_exchange_ecdhe_ecdsa(code));
 }
 
 /** Dump out the cipher keys and IVs used for the symmetric cipher. */
@@ -690,6 +872,8 @@ dtls_handshake_type_to_name(int type)
     return "server_hello";
   case DTLS_HT_HELLO_VERIFY_REQUEST:
     return "hello_verify_request";
+  case DTLS_HT_NEW_SESSION_TICKET:
+    return "new_session_ticket";
   case DTLS_HT_CERTIFICATE:
     return "certificate";
   case DTLS_HT_SERVER_KEY_EXCHANGE:
@@ -727,6 +911,46 @@ dtls_message_type_to_name(int type)
 }
 
 
+/**
+ * Creates the key block of the next epoch in \p security from the
+ * \p master_secret and the random values of both sides.
+ */
+static int
+calculate_key_block_from_master(dtls_handshake_parameters_t *handshake,
+				dtls_security_parameters_t *security,
+				const uint8 *master_secret,
+				dtls_peer_type role) {
+  /* create key_block from master_secret
+   * key_block = PRF(master_secret,
+                    "key expansion" + tmp.random.server + tmp.random.client)
+   * The size of the key_block depends on the cipher. */
+  security->cipher = handshake->cipher;
+
+  /* the master secret is used again for both Finished messages */
+  dtls_hmac_key_init(&handshake->master_key,
+		     master_secret, DTLS_MASTER_SECRET_LENGTH);
+
+  dtls_prf_with_key(&handshake->master_key,
+		    PRF_LABEL(key), PRF_LABEL_SIZE(key),
+		    handshake->tmp.random.server, DTLS_RANDOM_LENGTH,
+		    handshake->tmp.random.client, DTLS_RANDOM_LENGTH,
+		    security->key_block,
+		    dtls_kb_size(security, role));
+
+  memcpy(handshake->tmp.master_secret, master_secret, DTLS_MASTER_SECRET_LENGTH);
+  dtls_debug_keyblock(security);
+
+  /* expand the write keys once for the lifetime of this epoch */
+  if (dtls_security_set_keys(security, role) < 0) {
+    return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
+  }
+
+  security->compression = handshake->compression;
+  security->rseq = 0;
+
+  return 0;
+}
+
 /**
  * Calculate the pre master secret and after that calculate the master-secret.
  */
@@ -742,7 +966,6 @@ calculate_key_block(dtls_context_t *ctx,
   int pre_master_len = 0;
   dtls_security_parameters_t *security = dtls_security_params_next(peer);
   uint8 master_secret[DTLS_MASTER_SECRET_LENGTH];
-  (void)role; /* The macro dtls_kb_size() does not use role. */
 
   if (!security) {
     return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
@@ -752,6 +975,12 @@ calculate_key_block(dtls_context_t *ctx,
 
   switch (handshake->cipher) {
 #ifdef DTLS_PSK
+#ifdef DTLS_GCM
+  case TLS_PSK_WITH_AES_128_GCM_SHA256:
+#endif /* DTLS_GCM */
+#ifdef DTLS_CHACHA20
+  case TLS_PSK_WITH_CHACHA20_POLY1305_SHA256:
+#endif /* DTLS_CHACHA20 */
   case TLS_PSK_WITH_AES_128_CCM_8: {
     unsigned char psk[DTLS_PSK_MAX_KEY_LEN];
     int len;
@@ -781,7 +1010,22 @@ calculate_key_block(dtls_context_t *ctx,
   }
 #endif /* DTLS_PSK */
 #ifdef DTLS_ECC
+#ifdef DTLS_GCM
+  case TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256:
+#endif /* DTLS_GCM */
+#ifdef DTLS_CHACHA20
+  case TLS_ECDHE_ECDSA_WITH_CHACHA20_POLY1305_SHA256:
+#endif /* DTLS_CHACHA20 */
   case TLS_ECDHE_ECDSA_WITH_AES_128_CCM_8: {
+    if (is_ecdh_curve_x25519(handshake)) {
+      pre_master_len = dtls_x25519_pre_master_secret(handshake->keyx.ecdsa.own_eph_priv,
+						     handshake->keyx.ecdsa.other_eph_pub_x,
+						     pre_master_secret,
+						     MAX_KEYBLOCK_LENGTH);
+      if (pre_master_len < 0)
+	return dtls_alert_fatal_create(DTLS_ALERT_ILLEGAL_PARAMETER);
+      break;
+    }
     pre_master_len = dtls_ecdh_pre_master_secret(handshake->keyx.ecdsa.own_eph_priv,
 						 handshake->keyx.ecdsa.other_eph_pub_x,
 						 handshake->keyx.ecdsa.other_eph_pub_y,
@@ -807,11 +1051,27 @@ calculate_key_block(dtls_context_t *ctx,
   case TLS_PSK_WITH_AES_128_CCM_8:
     /* fall through to default */
 #endif /* !DTLS_PSK */
+#if !defined(DTLS_PSK) || !defined(DTLS_GCM)
+  case TLS_PSK_WITH_AES_128_GCM_SHA256:
+    /* fall through to default */
+#endif /* !DTLS_PSK || !DTLS_GCM */
+#if !defined(DTLS_PSK) || !defined(DTLS_CHACHA20)
+  case TLS_PSK_WITH_CHACHA20_POLY1305_SHA256:
+    /* fall through to default */
+#endif /* !DTLS_PSK || !DTLS_CHACHA20 */
 
 #ifndef DTLS_ECC
   case TLS_ECDHE_ECDSA_WITH_AES_128_CCM_8:
     /* fall through to default */
 #endif /* !DTLS_ECC */
+#if !defined(DTLS_ECC) || !defined(DTLS_GCM)
+  case TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256:
+    /* fall through to default */
+#endif /* !DTLS_ECC || !DTLS_GCM */
+#if !defined(DTLS_ECC) || !defined(DTLS_CHACHA20)
+  case TLS_ECDHE_ECDSA_WITH_CHACHA20_POLY1305_SHA256:
+    /* fall through to default */
+#endif /* !DTLS_ECC || !DTLS_CHACHA20 */
 
   default:
     dtls_crit("calculate_key_block: unknown cipher %04x\n", handshake->cipher);
@@ -825,53 +1085,537 @@ calculate_key_block(dtls_context_t *ctx,
   if (handshake->extended_master_secret) {
     unsigned char sha256hash[DTLS_HMAC_DIGEST_SIZE];
 
-    dtls_hash_finalize(sha256hash, &peer->handshake_params->hs_state.ext_hash);
+    dtls_hash_finalize(sha256hash, &peer->handshake_params->hs_state.ext_hash);
+
+    dtls_prf(pre_master_secret, pre_master_len,
+  	     PRF_LABEL(extended_master), PRF_LABEL_SIZE(extended_master),
+	     sha256hash, sizeof(sha256hash),
+	     NULL, 0,
+	     master_secret,
+	     DTLS_MASTER_SECRET_LENGTH);
+
+    dtls_debug_dump("extended_master_secret", master_secret, DTLS_MASTER_SECRET_LENGTH);
+  }
+  else {
+    dtls_prf(pre_master_secret, pre_master_len,
+  	     PRF_LABEL(master), PRF_LABEL_SIZE(master),
+	     handshake->tmp.random.client, DTLS_RANDOM_LENGTH,
+	     handshake->tmp.random.server, DTLS_RANDOM_LENGTH,
+	     master_secret,
+	     DTLS_MASTER_SECRET_LENGTH);
+
+    dtls_debug_dump("master_secret", master_secret, DTLS_MASTER_SECRET_LENGTH);
+  }
+
+  return calculate_key_block_from_master(handshake, security,
+					 master_secret, role);
+}
+
+#if DTLS_SESSION_CACHE_SIZE
+/**
+ * Looks up a cached session. As a server, the session is identified
+ * by the session id \p id, as a client by the address of the server
+ * in \p session.
+ *
+ * \param ctx       The current DTLS context.
+ * \param role      Our role in the session.
+ * \param session   The server's address, only used by a client.
+ * \param id        The session id, only used by a server.
+ * \param id_length The length of \p id.
+ * \return The cache entry or \c NULL if there is none.
+ */
+static dtls_session_cache_entry_t *
+dtls_session_cache_find(dtls_context_t *ctx, dtls_peer_type role,
+			const session_t *session,
+			const uint8 *id, size_t id_length) {
+  dtls_session_cache_entry_t *entry;
+  size_t i;
+
+  for (i = 0; i < DTLS_SESSION_CACHE_SIZE; i++) {
+    entry = &ctx->session_cache.entry[i];
+    if (!entry->id_length || entry->role != role)
+      continue;
+
+    if (role == DTLS_SERVER) {
+      if (entry->id_length == id_length && !memcmp(entry->id, id, id_length))
+	return entry;
+    } else if (dtls_session_equals(&entry->session, session)) {
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+/** Marks \p entry as the most recently used session. */
+static inline void
+dtls_session_cache_touch(dtls_context_t *ctx,
+			 dtls_session_cache_entry_t *entry) {
+  entry->last_used = ++ctx->session_cache.clock;
+}
+
+/**
+ * Copies the identity that the peer has been authenticated with in
+ * the handshake with \p peer to \p identity: the PSK identity, or the
+ * ECDSA key of the peer. A server that does not ask for the
+ * certificate of a client stores an empty identity.
+ */
+static void
+dtls_session_identity_get(dtls_context_t *ctx, dtls_peer_t *peer,
+			  dtls_session_identity_t *identity) {
+  const dtls_handshake_parameters_t *handshake = peer->handshake_params;
+
+  (void)ctx;
+  identity->length = 0;
+#ifdef DTLS_PSK
+  if (is_key_exchange_psk(handshake->cipher)) {
+    identity->length = handshake->keyx.psk.id_length;
+    memcpy(identity->data, handshake->keyx.psk.identity, identity->length);
+  }
+#endif /* DTLS_PSK */
+#ifdef DTLS_ECC
+  if (is_key_exchange_ecdhe_ecdsa(handshake->cipher) &&
+      (peer->role == DTLS_CLIENT || is_ecdsa_client_auth_supported(ctx))) {
+    identity->length = 2 * DTLS_EC_KEY_SIZE;
+    memcpy(identity->data, handshake->keyx.ecdsa.other_pub_x,
+	   DTLS_EC_KEY_SIZE);
+    memcpy(identity->data + DTLS_EC_KEY_SIZE,
+	   handshake->keyx.ecdsa.other_pub_y, DTLS_EC_KEY_SIZE);
+  }
+#endif /* DTLS_ECC */
+}
+
+/**
+ * Asks the application whether it still accepts the \p identity of a
+ * session with \p cipher before the session is resumed, as it would
+ * in a full handshake: the PSK for the identity must still exist and
+ * the ECDSA key of the peer must still be trusted.
+ *
+ * \return 0 if the session may be resumed, less than zero otherwise.
+ */
+static int
+dtls_session_identity_check(dtls_context_t *ctx, dtls_peer_t *peer,
+			    dtls_cipher_t cipher,
+			    const dtls_session_identity_t *identity) {
+#ifdef DTLS_PSK
+  if (is_key_exchange_psk(cipher)) {
+    unsigned char psk[DTLS_PSK_MAX_KEY_LEN];
+    int len;
+
+    if (identity->length > DTLS_PSK_MAX_CLIENT_IDENTITY_LEN)
+      return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
+
+    len = CALL(ctx, get_psk_info, &peer->session, DTLS_PSK_KEY,
+	       identity->data, identity->length, psk, DTLS_PSK_MAX_KEY_LEN);
+    memset(psk, 0, DTLS_PSK_MAX_KEY_LEN);
+    return len < 0 ? len : 0;
+  }
+#endif /* DTLS_PSK */
+#ifdef DTLS_ECC
+  if (is_key_exchange_ecdhe_ecdsa(cipher)) {
+    /* a server that does not authenticate its clients has nothing to check */
+    if (peer->role == DTLS_SERVER && !is_ecdsa_client_auth_supported(ctx))
+      return 0;
+
+    if (identity->length != 2 * DTLS_EC_KEY_SIZE)
+      return dtls_alert_fatal_create(DTLS_ALERT_HANDSHAKE_FAILURE);
+
+    return CALL(ctx, verify_ecdsa_key, &peer->session, identity->data,
+		identity->data + DTLS_EC_KEY_SIZE, DTLS_EC_KEY_SIZE);
+  }
+#endif /* DTLS_ECC */
+  (void)ctx;
+  (void)peer;
+  (void)identity;
+  return dtls_alert_fatal_create(DTLS_ALERT_HANDSHAKE_FAILURE);
+}
+
+/**
+ * Restores the \p identity of a resumed session to the handshake with
+ * \p peer, so that it is kept if the session is stored again.
+ */
+static void
+dtls_session_identity_restore(dtls_peer_t *peer,
+			      const dtls_session_identity_t *identity) {
+  dtls_handshake_parameters_t *handshake = peer->handshake_params;
+
+#ifdef DTLS_PSK
+  if (is_key_exchange_psk(handshake->cipher) &&
+      identity->length <= DTLS_PSK_MAX_CLIENT_IDENTITY_LEN) {
+    handshake->keyx.psk.id_length = identity->length;
+    memcpy(handshake->keyx.psk.identity, identity->data, identity->length);
+  }
+#endif /* DTLS_PSK */
+#ifdef DTLS_ECC
+  if (is_key_exchange_ecdhe_ecdsa(handshake->cipher) &&
+      identity->length == 2 * DTLS_EC_KEY_SIZE) {
+    memcpy(handshake->keyx.ecdsa.other_pub_x, identity->data,
+	   DTLS_EC_KEY_SIZE);
+    memcpy(handshake->keyx.ecdsa.other_pub_y,
+	   identity->data + DTLS_EC_KEY_SIZE, DTLS_EC_KEY_SIZE);
+  }
+#endif /* DTLS_ECC */
+  (void)handshake;
+  (void)identity;
+}
+
+#if DTLS_SESSION_TICKETS
+/** Copies the ticket that a client has received in \p handshake to \p entry. */
+static void
+dtls_session_cache_set_ticket(dtls_session_cache_entry_t *entry,
+			      const dtls_handshake_parameters_t *handshake) {
+  if (handshake->ticket) {
+    entry->ticket_length = handshake->ticket->length;
+    memcpy(entry->ticket, handshake->ticket->data, entry->ticket_length);
+  } else {
+    entry->ticket_length = 0;
+  }
+}
+#endif /* DTLS_SESSION_TICKETS */
+
+/**
+ * Stores the session just negotiated with \p peer. A client keeps
+ * only the latest session with each server. If the cache is full,
+ * the least recently used session is replaced.
+ */
+static void
+dtls_session_cache_add(dtls_context_t *ctx, dtls_peer_t *peer) {
+  dtls_handshake_parameters_t *handshake = peer->handshake_params;
+  dtls_session_cache_t *cache = &ctx->session_cache;
+  dtls_session_cache_entry_t *entry = NULL;
+  size_t i;
+
+  if (peer->role == DTLS_CLIENT)
+    entry = dtls_session_cache_find(ctx, DTLS_CLIENT, &peer->session,
+				    NULL, 0);
+
+  if (!entry) {
+    for (i = 0; i < DTLS_SESSION_CACHE_SIZE; i++) {
+      if (!cache->entry[i].id_length) {
+	entry = &cache->entry[i];
+	break;
+      }
+      if (!entry || cache->entry[i].last_used < entry->last_used)
+	entry = &cache->entry[i];
+    }
+    if (entry->id_length) {
+      dtls_debug("session cache full, replace least recently used session\n");
+      cache->evictions++;
+    }
+  }
+
+  memcpy(&entry->session, &peer->session, sizeof(session_t));
+  entry->role = peer->role;
+  entry->id_length = handshake->session_id_length;
+  memcpy(entry->id, handshake->session_id, handshake->session_id_length);
+  memcpy(entry->master_secret, handshake->tmp.master_secret,
+	 DTLS_MASTER_SECRET_LENGTH);
+  entry->cipher = handshake->cipher;
+  entry->extended_master_secret = handshake->extended_master_secret;
+  dtls_session_identity_get(ctx, peer, &entry->identity);
+#if DTLS_SESSION_TICKETS
+  dtls_session_cache_set_ticket(entry, handshake);
+  /* A client presents its ticket with a session id of its own, which
+   * the server returns if it resumes the session (RFC 5077, 3.4). */
+  if (!entry->id_length) {
+    entry->id_length = DTLS_SESSION_ID_LENGTH;
+    dtls_prng(entry->id, DTLS_SESSION_ID_LENGTH);
+  }
+#endif /* DTLS_SESSION_TICKETS */
+  dtls_session_cache_touch(ctx, entry);
+}
+
+#if DTLS_SESSION_TICKETS
+/**
+ * Replaces the ticket of the session that a client has just resumed
+ * with the new one from the server.
+ */
+static void
+dtls_session_cache_renew_ticket(dtls_context_t *ctx, dtls_peer_t *peer) {
+  dtls_session_cache_entry_t *entry;
+
+  entry = dtls_session_cache_find(ctx, DTLS_CLIENT, &peer->session, NULL, 0);
+  if (entry)
+    dtls_session_cache_set_ticket(entry, peer->handshake_params);
+}
+#endif /* DTLS_SESSION_TICKETS */
+
+/**
+ * Removes the sessions with \p peer from the cache. A session must
+ * not be resumed once a connection was terminated with a fatal
+ * alert (RFC 5246, section 7.2.2).
+ */
+static void
+dtls_session_cache_remove(dtls_context_t *ctx, dtls_peer_t *peer) {
+  dtls_handshake_parameters_t *handshake = peer->handshake_params;
+  dtls_session_cache_entry_t *entry;
+  size_t i;
+
+  for (i = 0; i < DTLS_SESSION_CACHE_SIZE; i++) {
+    entry = &ctx->session_cache.entry[i];
+    if (!entry->id_length || entry->role != peer->role)
+      continue;
+
+    if (dtls_session_equals(&entry->session, &peer->session) ||
+	(handshake && entry->id_length == handshake->session_id_length &&
+	 !memcmp(entry->id, handshake->session_id, entry->id_length))) {
+      dtls_debug("remove session from cache\n");
+      memset(entry, 0, sizeof(dtls_session_cache_entry_t));
+    }
+  }
+}
+
+/**
+ * Creates the key block of the next epoch of \p peer from the
+ * \p master_secret of a cached session or a session ticket for an
+ * abbreviated handshake.
+ */
+static int
+dtls_session_resume(dtls_peer_t *peer, const uint8 *master_secret) {
+  dtls_security_parameters_t *security = dtls_security_params_next(peer);
+
+  if (!security) {
+    return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
+  }
+
+  dtls_debug("resume session\n");
+  return calculate_key_block_from_master(peer->handshake_params, security,
+					 master_secret, peer->role);
+}
+#endif /* DTLS_SESSION_CACHE_SIZE */
+
+#if DTLS_SESSION_TICKETS
+/* A session ticket consists of the name of the ticket key, the CCM
+ * nonce, the encrypted state of the session and the MAC. The state
+ * holds the cipher suite, the extended master secret flag, the time
+ * the ticket was issued, the master secret and the identity of the
+ * client. The key name is authenticated as additional data. */
+#define DTLS_TICKET_NONCE_LENGTH 12 /* CCM with L = 3 */
+#define DTLS_TICKET_STATE_LENGTH(Id_Length)				\
+  (sizeof(uint16) + sizeof(uint8) + sizeof(uint32) +			\
+   DTLS_MASTER_SECRET_LENGTH + sizeof(uint8) + (Id_Length))
+#define DTLS_TICKET_MAC_LENGTH 8
+#if DTLS_SESSION_IDENTITY_LENGTH > 255
+#error "the identity in a session ticket is limited to 255 bytes"
+#endif
+#define DTLS_TICKET_LENGTH(Id_Length)					\
+  (DTLS_TICKET_KEY_NAME_LENGTH + DTLS_TICKET_NONCE_LENGTH +		\
+   DTLS_TICKET_STATE_LENGTH(Id_Length) + DTLS_TICKET_MAC_LENGTH)
+
+/* The lifetime hint sent with each ticket, in seconds. Older tickets
+ * are rejected. */
+#define DTLS_TICKET_LIFETIME (DTLS_TICKET_KEY_LIFETIME / CLOCK_SECOND)
+
+/**
+ * Returns the time in seconds that is stored as issue time in a
+ * ticket. Servers that share a ticket key must agree on it, so the
+ * wall clock is used where there is one.
+ */
+static uint32_t
+dtls_session_ticket_time(void) {
+#if defined(WITH_POSIX) && defined(HAVE_TIME_H)
+  return (uint32_t)time(NULL);
+#else /* WITH_POSIX && HAVE_TIME_H */
+  dtls_tick_t now;
+
+  dtls_ticks(&now);
+  return (uint32_t)(now / DTLS_TICKS_PER_SECOND);
+#endif /* WITH_POSIX && HAVE_TIME_H */
+}
+
+static int
+dtls_ticket_key_set(dtls_ticket_key_t *key, const uint8 *name,
+		    const uint8 *secret) {
+  memcpy(key->name, name, DTLS_TICKET_KEY_NAME_LENGTH);
+  if (rijndael_set_key_enc_only(&key->ctx, secret,
+				8 * DTLS_TICKET_KEY_LENGTH) < 0) {
+    dtls_warn("cannot set ticket key\n");
+    memset(key, 0, sizeof(dtls_ticket_key_t));
+    return -1;
+  }
+  dtls_ticks(&key->created);
+  key->valid = 1;
+  return 0;
+}
+
+/**
+ * Returns the key for new tickets. Unless the application sets the
+ * keys, the current key is replaced by a random one once it is older
+ * than DTLS_TICKET_KEY_LIFETIME and then kept as previous key for
+ * another DTLS_TICKET_KEY_LIFETIME.
+ *
+ * \return The current key or \c NULL if no key could be generated.
+ */
+static dtls_ticket_key_t *
+dtls_session_ticket_key(dtls_context_t *ctx) {
+  dtls_session_tickets_t *tickets = &ctx->tickets;
+  uint8 name[DTLS_TICKET_KEY_NAME_LENGTH];
+  uint8 secret[DTLS_TICKET_KEY_LENGTH];
+  dtls_tick_t now;
+  int res;
+
+  if (tickets->fixed)
+    return tickets->current.valid ? &tickets->current : NULL;
+
+  dtls_ticks(&now);
+  if (tickets->current.valid &&
+      now - tickets->current.created < DTLS_TICKET_KEY_LIFETIME)
+    return &tickets->current;
+
+  if (tickets->current.valid) {
+    dtls_debug("replace ticket key\n");
+    tickets->rotations++;
+  }
+  if (tickets->current.valid &&
+      now - tickets->current.created < 2 * DTLS_TICKET_KEY_LIFETIME)
+    tickets->previous = tickets->current;
+  else
+    memset(&tickets->previous, 0, sizeof(dtls_ticket_key_t));
+
+  if (!dtls_prng(name, sizeof(name)) || !dtls_prng(secret, sizeof(secret))) {
+    memset(&tickets->current, 0, sizeof(dtls_ticket_key_t));
+    return NULL;
+  }
+  res = dtls_ticket_key_set(&tickets->current, name, secret);
+  memset(secret, 0, sizeof(secret));
+  return res < 0 ? NULL : &tickets->current;
+}
+
+/**
+ * Writes a ticket with the state of the session negotiated with
+ * \p peer to \p buf, which must provide
+ * DTLS_TICKET_LENGTH(DTLS_SESSION_IDENTITY_LENGTH) bytes.
+ *
+ * \return The length of the ticket, less than zero on error.
+ */
+static int
+dtls_session_ticket_encrypt(dtls_context_t *ctx, dtls_peer_t *peer,
+			    uint8 *buf) {
+  dtls_handshake_parameters_t *handshake = peer->handshake_params;
+  dtls_ticket_key_t *key = dtls_session_ticket_key(ctx);
+  dtls_session_identity_t identity;
+  uint8 *nonce = buf + DTLS_TICKET_KEY_NAME_LENGTH;
+  uint8 *state = nonce + DTLS_TICKET_NONCE_LENGTH;
+  uint8 *p = state;
+  dtls_ccm_params_t params = { nonce, DTLS_TICKET_MAC_LENGTH,
+			       15 - DTLS_TICKET_NONCE_LENGTH };
+
+  if (!key || !dtls_prng(nonce, DTLS_TICKET_NONCE_LENGTH))
+    return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
+
+  dtls_session_identity_get(ctx, peer, &identity);
+
+  memcpy(buf, key->name, DTLS_TICKET_KEY_NAME_LENGTH);
+  dtls_int_to_uint16(p, handshake->cipher);
+  p += sizeof(uint16);
+  dtls_int_to_uint8(p, handshake->extended_master_secret);
+  p += sizeof(uint8);
+  dtls_int_to_uint32(p, dtls_session_ticket_time());
+  p += sizeof(uint32);
+  memcpy(p, handshake->tmp.master_secret, DTLS_MASTER_SECRET_LENGTH);
+  p += DTLS_MASTER_SECRET_LENGTH;
+  dtls_int_to_uint8(p, identity.length);
+  p += sizeof(uint8);
+  memcpy(p, identity.data, identity.length);
+
+  if (dtls_encrypt_params_ctx(&params, &key->ctx,
+			      state, DTLS_TICKET_STATE_LENGTH(identity.length),
+			      state, buf, DTLS_TICKET_KEY_NAME_LENGTH) < 0)
+    return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
+
+  return DTLS_TICKET_LENGTH(identity.length);
+}
 
-    dtls_prf(pre_master_secret, pre_master_len,
-  	     PRF_LABEL(extended_master), PRF_LABEL_SIZE(extended_master),
-	     sha256hash, sizeof(sha256hash),
-	     NULL, 0,
-	     master_secret,
-	     DTLS_MASTER_SECRET_LENGTH);
+/**
+ * Recovers the master secret and the client's identity of a session
+ * from the \p ticket of the client \p peer. The ticket must have been
+ * issued under the current or the previous ticket key no longer than
+ * DTLS_TICKET_LIFETIME seconds ago, and for the cipher suite and
+ * extended master secret setting just negotiated with \p peer.
+ *
+ * \return \c 0 on success, less than zero if the ticket cannot be
+ *         used.
+ */
+static int
+dtls_session_ticket_decrypt(dtls_context_t *ctx, dtls_peer_t *peer,
+			    const uint8 *ticket, size_t length,
+			    uint8 *master_secret,
+			    dtls_session_identity_t *identity) {
+  dtls_handshake_parameters_t *handshake = peer->handshake_params;
+  dtls_ticket_key_t *key;
+  uint8 state[DTLS_TICKET_STATE_LENGTH(DTLS_SESSION_IDENTITY_LENGTH) +
+	      DTLS_TICKET_MAC_LENGTH];
+  const uint8 *p = state;
+  dtls_ccm_params_t params = { ticket + DTLS_TICKET_KEY_NAME_LENGTH,
+			       DTLS_TICKET_MAC_LENGTH,
+			       15 - DTLS_TICKET_NONCE_LENGTH };
+  size_t state_length;
+  uint32_t issued, now;
+  int res = -1;
 
-    dtls_debug_dump("extended_master_secret", master_secret, DTLS_MASTER_SECRET_LENGTH);
+  if (length < DTLS_TICKET_LENGTH(0) ||
+      length > DTLS_TICKET_LENGTH(DTLS_SESSION_IDENTITY_LENGTH)) {
+    dtls_debug("session ticket has wrong length\n");
+    return -1;
   }
-  else {
-    dtls_prf(pre_master_secret, pre_master_len,
-  	     PRF_LABEL(master), PRF_LABEL_SIZE(master),
-	     handshake->tmp.random.client, DTLS_RANDOM_LENGTH,
-	     handshake->tmp.random.server, DTLS_RANDOM_LENGTH,
-	     master_secret,
-	     DTLS_MASTER_SECRET_LENGTH);
+  state_length = length - DTLS_TICKET_KEY_NAME_LENGTH -
+    DTLS_TICKET_NONCE_LENGTH;
 
-    dtls_debug_dump("master_secret", master_secret, DTLS_MASTER_SECRET_LENGTH);
+  key = dtls_session_ticket_key(ctx);
+  if (!key || memcmp(ticket, key->name, DTLS_TICKET_KEY_NAME_LENGTH)) {
+    key = &ctx->tickets.previous;
+    if (!key->valid ||
+	memcmp(ticket, key->name, DTLS_TICKET_KEY_NAME_LENGTH)) {
+      dtls_debug("session ticket key unknown or expired\n");
+      return -1;
+    }
   }
 
-  /* create key_block from master_secret
-   * key_block = PRF(master_secret,
-                    "key expansion" + tmp.random.server + tmp.random.client) */
+  if (dtls_decrypt_params_ctx(&params, &key->ctx,
+			      ticket + DTLS_TICKET_KEY_NAME_LENGTH +
+			      DTLS_TICKET_NONCE_LENGTH, state_length, state,
+			      ticket, DTLS_TICKET_KEY_NAME_LENGTH) < 0) {
+    dtls_debug("session ticket cannot be decrypted\n");
+    goto finish;
+  }
 
-  dtls_prf(master_secret,
-	   DTLS_MASTER_SECRET_LENGTH,
-	   PRF_LABEL(key), PRF_LABEL_SIZE(key),
-	   handshake->tmp.random.server, DTLS_RANDOM_LENGTH,
-	   handshake->tmp.random.client, DTLS_RANDOM_LENGTH,
-	   security->key_block,
-	   dtls_kb_size(security, role));
+  if (dtls_uint16_to_int(p) != handshake->cipher ||
+      dtls_uint8_to_int(p + sizeof(uint16)) !=
+      handshake->extended_master_secret) {
+    dtls_debug("session ticket does not match the negotiated parameters\n");
+    goto finish;
+  }
+  p += sizeof(uint16) + sizeof(uint8);
 
-  memcpy(handshake->tmp.master_secret, master_secret, DTLS_MASTER_SECRET_LENGTH);
-  dtls_debug_keyblock(security);
+  /* a ticket from the future is as unusable as an expired one */
+  issued = dtls_uint32_to_int(p);
+  now = dtls_session_ticket_time();
+  if (issued > now || now - issued >= DTLS_TICKET_LIFETIME) {
+    dtls_debug("session ticket has expired\n");
+    goto finish;
+  }
+  p += sizeof(uint32) + DTLS_MASTER_SECRET_LENGTH;
 
-  security->cipher = handshake->cipher;
-  security->compression = handshake->compression;
-  security->rseq = 0;
+  identity->length = dtls_uint8_to_int(p);
+  if (state_length != DTLS_TICKET_STATE_LENGTH(identity->length) +
+      DTLS_TICKET_MAC_LENGTH) {
+    dtls_debug("session ticket has a malformed identity\n");
+    goto finish;
+  }
+  memcpy(identity->data, p + sizeof(uint8), identity->length);
+  memcpy(master_secret, p - DTLS_MASTER_SECRET_LENGTH,
+	 DTLS_MASTER_SECRET_LENGTH);
+  res = 0;
 
-  return 0;
+ finish:
+  memset(state, 0, sizeof(state));
+  return res;
 }
+#endif /* DTLS_SESSION_TICKETS */
 
 /* TODO: add a generic method which iterates over a list and searches for a specific key */
-static int verify_ext_eliptic_curves(uint8 *data, size_t data_length) {
-  int i, curve_name;
+static int verify_ext_eliptic_curves(uint8 *data, size_t data_length,
+				     dtls_ecdh_curve *curve) {
+  int i, curve_name, secp256r1 = 0;
 
   /* length of curve list */
   i = dtls_uint16_to_int(data);
@@ -887,7 +1631,19 @@ static int verify_ext_eliptic_curves(uint8 *data, size_t data_length) {
     data += sizeof(uint16);
 
     if (curve_name == TLS_EXT_ELLIPTIC_CURVES_SECP256R1)
+      secp256r1 = 1;
+#ifdef DTLS_X25519
+    /* x25519 is preferred, regardless of its position in the list */
+    if (curve_name == TLS_EXT_ELLIPTIC_CURVES_X25519) {
+      *curve = DTLS_ECDH_CURVE_X25519;
       return 0;
+    }
+#endif /* DTLS_X25519 */
+  }
+
+  if (secp256r1) {
+    *curve = DTLS_ECDH_CURVE_SECP256R1;
+    return 0;
   }
 
   dtls_warn("no supported elliptic curve found\n");
@@ -981,11 +1737,12 @@ dtls_check_tls_extension(dtls_peer_t *peer,
   int ext_client_cert_type = 0;
   int ext_server_cert_type = 0;
   int ext_ec_point_formats = 0;
+  dtls_ecdh_curve curve = DTLS_ECDH_CURVE_SECP256R1;
   dtls_handshake_parameters_t *handshake = peer->handshake_params;
 
   if (data_length < sizeof(uint16)) {
     /* no tls extensions specified */
-    if (is_tls_ecdhe_ecdsa_with_aes_128_ccm_8(handshake->cipher)) {
+    if (is_key_exchange_ecdhe_ecdsa(handshake->cipher)) {
       goto error;
     }
     return 0;
@@ -1020,8 +1777,12 @@ dtls_check_tls_extension(dtls_peer_t *peer,
     switch (i) {
       case TLS_EXT_ELLIPTIC_CURVES:
         ext_elliptic_curve = 1;
-        if (verify_ext_eliptic_curves(data, j))
+        if (verify_ext_eliptic_curves(data, j, &curve))
           goto error;
+#ifdef DTLS_ECC
+        if (is_key_exchange_ecdhe_ecdsa(handshake->cipher))
+          handshake->keyx.ecdsa.curve = curve;
+#endif /* DTLS_ECC */
         break;
       case TLS_EXT_CLIENT_CERTIFICATE_TYPE:
         ext_client_cert_type = 1;
@@ -1061,6 +1822,15 @@ dtls_check_tls_extension(dtls_peer_t *peer,
         if (verify_ext_sig_hash_algo(data, j))
           goto error;
         break;
+#if DTLS_SESSION_TICKETS
+      case TLS_EXT_SESSION_TICKET:
+	/* The client's ticket is taken from the ClientHello by
+	 * dtls_get_session_ticket(). A server that returns the
+	 * extension sends a NewSessionTicket. */
+	if (!client_hello)
+	  handshake->new_session_ticket = 1;
+	break;
+#endif /* DTLS_SESSION_TICKETS */
       default:
         dtls_warn("unsupported tls extension: %i\n", i);
         break;
@@ -1068,13 +1838,13 @@ dtls_check_tls_extension(dtls_peer_t *peer,
     data += j;
     data_length -= j;
   }
-  if (is_tls_ecdhe_ecdsa_with_aes_128_ccm_8(handshake->cipher) && client_hello) {
+  if (is_key_exchange_ecdhe_ecdsa(handshake->cipher) && client_hello) {
     if (!ext_elliptic_curve || !ext_client_cert_type || !ext_server_cert_type
 	|| !ext_ec_point_formats) {
       dtls_warn("not all required tls extensions found in client hello\n");
       goto error;
     }
-  } else if (is_tls_ecdhe_ecdsa_with_aes_128_ccm_8(handshake->cipher) && !client_hello) {
+  } else if (is_key_exchange_ecdhe_ecdsa(handshake->cipher) && !client_hello) {
     if (!ext_server_cert_type) {
       dtls_warn("not all required tls extensions found in server hello\n");
       goto error;
@@ -1109,7 +1879,11 @@ dtls_update_parameters(dtls_context_t *ctx,
   int i;
   unsigned int j;
   int ok;
+  uint8 *session_id;
   dtls_handshake_parameters_t *config = peer->handshake_params;
+#if DTLS_SESSION_CACHE_SIZE
+  dtls_session_cache_entry_t *cached;
+#endif /* DTLS_SESSION_CACHE_SIZE */
 
   assert(config);
   assert(data_length > DTLS_HS_LENGTH + DTLS_CH_LENGTH);
@@ -1124,9 +1898,19 @@ dtls_update_parameters(dtls_context_t *ctx,
   data_length -= DTLS_RANDOM_LENGTH;
 
   /* Caution: SKIP_VAR_FIELD may jump to error: */
+  session_id = data;
   SKIP_VAR_FIELD(data, data_length, uint8);	/* skip session id */
   SKIP_VAR_FIELD(data, data_length, uint8);	/* skip cookie */
 
+  /* store the id of the session the client wants to resume */
+  if (dtls_uint8_to_int(session_id) > DTLS_SESSION_ID_LENGTH) {
+    dtls_debug("session id too long\n");
+    goto error;
+  }
+  config->session_id_length = dtls_uint8_to_int(session_id);
+  memcpy(config->session_id, session_id + sizeof(uint8),
+	 config->session_id_length);
+
   if (data_length < sizeof(uint16)) {
     dtls_debug("cipher suites length exceeds record\n");
     goto error;
@@ -1153,6 +1937,21 @@ dtls_update_parameters(dtls_context_t *ctx,
   data_length -= sizeof(uint16) + i;
 
   ok = 0;
+#if DTLS_SESSION_CACHE_SIZE
+  /* The cipher suite of a cached session is preferred, so that it
+   * can be resumed. It must be offered again (RFC 5246, 7.4.1.2). */
+  cached = dtls_session_cache_find(ctx, DTLS_SERVER, NULL, config->session_id,
+				   config->session_id_length);
+  if (cached && known_cipher(ctx, cached->cipher, 0)) {
+    for (j = 0; j + sizeof(uint16) <= (unsigned int)i && !ok;
+	 j += sizeof(uint16)) {
+      if (dtls_uint16_to_int(data + j) == cached->cipher) {
+	config->cipher = cached->cipher;
+	ok = 1;
+      }
+    }
+  }
+#endif /* DTLS_SESSION_CACHE_SIZE */
   while ((i >= (int)sizeof(uint16)) && !ok) {
     config->cipher = dtls_uint16_to_int(data);
     ok = known_cipher(ctx, config->cipher, 0);
@@ -1230,7 +2029,23 @@ check_client_keyexchange(dtls_context_t *ctx,
 
   (void) ctx;
 #ifdef DTLS_ECC
-  if (is_tls_ecdhe_ecdsa_with_aes_128_ccm_8(handshake->cipher)) {
+  if (is_key_exchange_ecdhe_ecdsa(handshake->cipher) &&
+      is_ecdh_curve_x25519(handshake)) {
+
+    if (length < DTLS_HS_LENGTH + DTLS_CKXEC_X25519_LENGTH) {
+      dtls_debug("The client key exchange is too short\n");
+      return dtls_alert_fatal_create(DTLS_ALERT_HANDSHAKE_FAILURE);
+    }
+    data += DTLS_HS_LENGTH;
+
+    if (dtls_uint8_to_int(data) != DTLS_X25519_KEY_SIZE) {
+      dtls_alert("expected 32 bytes long public key\n");
+      return dtls_alert_fatal_create(DTLS_ALERT_HANDSHAKE_FAILURE);
+    }
+    data += sizeof(uint8);
+
+    memcpy(handshake->keyx.ecdsa.other_eph_pub_x, data, DTLS_X25519_KEY_SIZE);
+  } else if (is_key_exchange_ecdhe_ecdsa(handshake->cipher)) {
 
     if (length < DTLS_HS_LENGTH + DTLS_CKXEC_LENGTH) {
       dtls_debug("The client key exchange is too short\n");
@@ -1260,7 +2075,7 @@ check_client_keyexchange(dtls_context_t *ctx,
   }
 #endif /* DTLS_ECC */
 #ifdef DTLS_PSK
-  if (is_tls_psk_with_aes_128_ccm_8(handshake->cipher)) {
+  if (is_key_exchange_psk(handshake->cipher)) {
     int id_length;
 
     if (length < DTLS_HS_LENGTH + DTLS_CKXPSK_LENGTH_MIN) {
@@ -1361,12 +2176,11 @@ check_finished(dtls_context_t *ctx, dtls_peer_t *peer,
     label_size = PRF_LABEL_SIZE(client);
   }
 
-  dtls_prf(peer->handshake_params->tmp.master_secret,
-	   DTLS_MASTER_SECRET_LENGTH,
-	   label, label_size,
-	   PRF_LABEL(finished), PRF_LABEL_SIZE(finished),
-	   buf, digest_length,
-	   b.verify_data, sizeof(b.verify_data));
+  dtls_prf_with_key(&peer->handshake_params->master_key,
+		    label, label_size,
+		    PRF_LABEL(finished), PRF_LABEL_SIZE(finished),
+		    buf, digest_length,
+		    b.verify_data, sizeof(b.verify_data));
 
   dtls_debug_dump("d:", data + DTLS_HS_LENGTH, sizeof(b.verify_data));
   dtls_debug_dump("v:", b.verify_data, sizeof(b.verify_data));
@@ -1377,6 +2191,55 @@ check_finished(dtls_context_t *ctx, dtls_peer_t *peer,
     : dtls_alert_create(DTLS_ALERT_LEVEL_FATAL, DTLS_ALERT_DECRYPT_ERROR);
 }
 
+/**
+ * length of additional_data for the AEAD cipher which consists of
+ * seq_num(2+6) + type(1) + version(2) + length(2)
+ */
+#define A_DATA_LEN 13
+
+/**
+ * Sets up the AEAD nonce and additional data for the record in
+ * \p sendbuf. The record header must have been created with
+ * dtls_set_record_header() before.
+ *
+ * \param peer     The remote peer the record will be sent to.
+ * \param security The encryption parameters used for the record.
+ * \param sendbuf  The record starting with the record header.
+ * \param length   The length of the cleartext fragment without the
+ *                 explicit nonce.
+ * \param nonce    Output buffer for the nonce.
+ * \param A_DATA   Output buffer for the additional data.
+ */
+static void
+dtls_set_record_nonce(dtls_peer_t *peer, dtls_security_parameters_t *security,
+		      uint8 *sendbuf, size_t length,
+		      unsigned char nonce[DTLS_CCM_BLOCKSIZE],
+		      unsigned char A_DATA[A_DATA_LEN]) {
+  memset(nonce, 0, DTLS_CCM_BLOCKSIZE);
+  memcpy(nonce, dtls_kb_local_iv(security, peer->role),
+	 dtls_kb_iv_size(security, peer->role));
+  if (is_chacha20_poly1305(security->cipher)) {
+    /* RFC 7905: the padded sequence number is XORed with the IV */
+    memxor(nonce + 4, DTLS_RECORD_HEADER(sendbuf)->epoch, 8);
+  } else {
+    memcpy(nonce + dtls_kb_iv_size(security, peer->role),
+	   &DTLS_RECORD_HEADER(sendbuf)->epoch, 8); /* epoch + seq_num */
+  }
+
+  dtls_debug_dump("nonce:", nonce, DTLS_CCM_BLOCKSIZE);
+  dtls_debug_dump("key:", dtls_kb_local_write_key(security, peer->role),
+		  dtls_kb_key_size(security, peer->role));
+
+  /* re-use N to create additional data according to RFC 5246, Section 6.2.3.3:
+   *
+   * additional_data = seq_num + TLSCompressed.type +
+   *                   TLSCompressed.version + TLSCompressed.length;
+   */
+  memcpy(A_DATA, &DTLS_RECORD_HEADER(sendbuf)->epoch, 8); /* epoch and seq_num */
+  memcpy(A_DATA + 8,  &DTLS_RECORD_HEADER(sendbuf)->content_type, 3); /* type and version */
+  dtls_int_to_uint16(A_DATA + 11, length); /* length */
+}
+
 /**
  * Prepares the payload given in \p data for sending with
  * dtls_send(). The \p data is encrypted and compressed according to
@@ -1439,22 +2302,26 @@ dtls_prepare_record(dtls_peer_t *peer, dtls_security_parameters_t *security,
       p += data_len_array[i];
       res += data_len_array[i];
     }
-  } else { /* TLS_PSK_WITH_AES_128_CCM_8 or TLS_ECDHE_ECDSA_WITH_AES_128_CCM_8 */
-    /**
-     * length of additional_data for the AEAD cipher which consists of
-     * seq_num(2+6) + type(1) + version(2) + length(2)
-     */
-#define A_DATA_LEN 13
+  } else { /* AES_128_CCM_8, AES_128_GCM_SHA256 or CHACHA20_POLY1305_SHA256 */
     unsigned char nonce[DTLS_CCM_BLOCKSIZE];
     unsigned char A_DATA[A_DATA_LEN];
     /* For backwards-compatibility, dtls_encrypt_params is called with
      * M=<macLen> and L=3. */
     const dtls_ccm_params_t params = { nonce, 8, 3 };
+    const size_t nonce_explicit = dtls_cipher_explicit_nonce_size(security->cipher);
 
     if (is_tls_psk_with_aes_128_ccm_8(security->cipher)) {
       dtls_debug("dtls_prepare_record(): encrypt using TLS_PSK_WITH_AES_128_CCM_8\n");
     } else if (is_tls_ecdhe_ecdsa_with_aes_128_ccm_8(security->cipher)) {
       dtls_debug("dtls_prepare_record(): encrypt using TLS_ECDHE_ECDSA_WITH_AES_128_CCM_8\n");
+    } else if (is_tls_psk_with_aes_128_gcm_sha256(security->cipher)) {
+      dtls_debug("dtls_prepare_record(): encrypt using TLS_PSK_WITH_AES_128_GCM_SHA256\n");
+    } else if (is_tls_ecdhe_ecdsa_with_aes_128_gcm_sha256(security->cipher)) {
+      dtls_debug("dtls_prepare_record(): encrypt using TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256\n");
+    } else if (is_tls_psk_with_chacha20_poly1305_sha256(security->cipher)) {
+      dtls_debug("dtls_prepare_record(): encrypt using TLS_PSK_WITH_CHACHA20_POLY1305_SHA256\n");
+    } else if (is_tls_ecdhe_ecdsa_with_chacha20_poly1305_sha256(security->cipher)) {
+      dtls_debug("dtls_prepare_record(): encrypt using TLS_ECDHE_ECDSA_WITH_CHACHA20_POLY1305_SHA256\n");
     } else {
       dtls_debug("dtls_prepare_record(): encrypt using unknown cipher\n");
     }
@@ -1497,11 +2364,13 @@ dtls_prepare_record(dtls_peer_t *peer, dtls_security_parameters_t *security,
    	             case server:
    	               CCMServerNonce:
    	            } CCMNonceExample;
+
+       ChaCha20-Poly1305 records have no nonce_explicit, see RFC 7905.
     */
 
-    memcpy(p, &DTLS_RECORD_HEADER(sendbuf)->epoch, 8);
-    p += 8;
-    res = 8;
+    memcpy(p, &DTLS_RECORD_HEADER(sendbuf)->epoch, nonce_explicit);
+    p += nonce_explicit;
+    res = nonce_explicit;
 
     for (i = 0; i < data_array_len; i++) {
       /* check the minimum that we need for packets that are not encrypted */
@@ -1515,33 +2384,38 @@ dtls_prepare_record(dtls_peer_t *peer, dtls_security_parameters_t *security,
       res += data_len_array[i];
     }
 
-    memset(nonce, 0, DTLS_CCM_BLOCKSIZE);
-    memcpy(nonce, dtls_kb_local_iv(security, peer->role),
-	   dtls_kb_iv_size(security, peer->role));
-    memcpy(nonce + dtls_kb_iv_size(security, peer->role), start, 8); /* epoch + seq_num */
-
-    dtls_debug_dump("nonce:", nonce, DTLS_CCM_BLOCKSIZE);
-    dtls_debug_dump("key:", dtls_kb_local_write_key(security, peer->role),
-		    dtls_kb_key_size(security, peer->role));
+    /* make room for the authentication tag */
+    if (*rlen < res + DTLS_RH_LENGTH + dtls_cipher_tag_size(security->cipher)) {
+      dtls_debug("dtls_prepare_record: send buffer too small\n");
+      return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
+    }
 
-    /* re-use N to create additional data according to RFC 5246, Section 6.2.3.3:
-     *
-     * additional_data = seq_num + TLSCompressed.type +
-     *                   TLSCompressed.version + TLSCompressed.length;
-     */
-    memcpy(A_DATA, &DTLS_RECORD_HEADER(sendbuf)->epoch, 8); /* epoch and seq_num */
-    memcpy(A_DATA + 8,  &DTLS_RECORD_HEADER(sendbuf)->content_type, 3); /* type and version */
-    dtls_int_to_uint16(A_DATA + 11, res - 8); /* length */
+    dtls_set_record_nonce(peer, security, sendbuf, res - nonce_explicit,
+			  nonce, A_DATA);
 
-    res = dtls_encrypt_params(&params, start + 8, res - 8, start + 8,
-               dtls_kb_local_write_key(security, peer->role),
-               dtls_kb_key_size(security, peer->role),
+#ifdef DTLS_CHACHA20
+    if (is_chacha20_poly1305(security->cipher))
+      res = dtls_encrypt_chacha20_poly1305(dtls_kb_local_write_key(security, peer->role),
+                                           nonce, start, res, start,
+                                           A_DATA, A_DATA_LEN);
+    else
+#endif /* DTLS_CHACHA20 */
+#ifdef DTLS_GCM
+    /* the GCM nonce consists of the same salt and nonce_explicit */
+    if (is_aes_128_gcm(security->cipher))
+      res = dtls_encrypt_gcm_ctx(&security->write_ctx, &security->write_gcm,
+                                 nonce, start + 8, res - 8, start + 8,
+                                 A_DATA, A_DATA_LEN);
+    else
+#endif /* DTLS_GCM */
+    res = dtls_encrypt_params_ctx(&params, &security->write_ctx,
+               start + 8, res - 8, start + 8,
                A_DATA, A_DATA_LEN);
 
     if (res < 0)
       return res;
 
-    res += 8;			/* increment res by size of nonce_explicit */
+    res += nonce_explicit;	/* increment res by size of nonce_explicit */
     dtls_debug_dump("message:", start, res);
   }
 
@@ -1650,6 +2524,15 @@ dtls_0_send_hello_verify_request(dtls_context_t *ctx,
   return CALL(ctx, write, ephemeral_peer->session, buf, sizeof(buf));
 }
 
+/** returns the number of bytes the record layer adds to a fragment */
+static inline size_t
+dtls_record_overhead(const dtls_security_parameters_t *security) {
+  if (security->cipher == TLS_NULL_WITH_NULL_NULL)
+    return DTLS_RH_LENGTH;
+  return DTLS_RH_LENGTH + dtls_cipher_explicit_nonce_size(security->cipher)
+    + dtls_cipher_tag_size(security->cipher);
+}
+
 static int
 dtls_send_handshake_msg_hash(dtls_context_t *ctx,
 			     dtls_peer_t *peer,
@@ -1661,7 +2544,8 @@ dtls_send_handshake_msg_hash(dtls_context_t *ctx,
   uint8 buf[DTLS_HS_LENGTH];
   uint8 *data_array[2];
   size_t data_len_array[2];
-  int i = 0;
+  size_t offset, overhead, max_fragment;
+  int i = 0, res, sent = 0;
   dtls_security_parameters_t *security = dtls_security_params(peer);
 
   dtls_set_handshake_header(header_type, &(peer->handshake_params->hs_state.mseq_s), data_length, 0,
@@ -1682,10 +2566,47 @@ dtls_send_handshake_msg_hash(dtls_context_t *ctx,
     data_len_array[i] = data_length;
     i++;
   }
-  dtls_debug("send handshake packet of type: %s (%i)\n",
+
+  /* The initial ClientHello is processed without keeping state at the
+   * server and therefore never fragmented. */
+  overhead = security ? dtls_record_overhead(security) + DTLS_HS_LENGTH : 0;
+  max_fragment = security && header_type != DTLS_HT_CLIENT_HELLO ?
+    ctx->mtu - overhead : data_length;
+  if (data_length <= max_fragment) {
+    dtls_debug("send handshake packet of type: %s (%i)\n",
+	       dtls_handshake_type_to_name(header_type), header_type);
+    return dtls_send_multi(ctx, peer, security, session, DTLS_CT_HANDSHAKE,
+			   data_array, data_len_array, i);
+  }
+
+  /* Split the message into fragments that fit into the path MTU, see
+   * Section 4.2.3 of RFC 6347. The hash above covers the message as
+   * if it was sent in one piece. */
+  dtls_debug("send handshake packet of type: %s (%i) in fragments\n",
 	     dtls_handshake_type_to_name(header_type), header_type);
-  return dtls_send_multi(ctx, peer, security, session, DTLS_CT_HANDSHAKE,
-			 data_array, data_len_array, i);
+  for (offset = 0; offset < data_length; offset += data_len_array[1]) {
+    data_array[1] = data + offset;
+    data_len_array[1] = data_length - offset;
+
+    /* fill up the datagram of the current flight first */
+    if (ctx->flight.peer == peer && ctx->flight.length + overhead < ctx->mtu) {
+      if (data_len_array[1] > ctx->mtu - ctx->flight.length - overhead)
+	data_len_array[1] = ctx->mtu - ctx->flight.length - overhead;
+    } else if (data_len_array[1] > max_fragment) {
+      data_len_array[1] = max_fragment;
+    }
+
+    dtls_int_to_uint24(DTLS_HANDSHAKE_HEADER(buf)->fragment_offset, offset);
+    dtls_int_to_uint24(DTLS_HANDSHAKE_HEADER(buf)->fragment_length,
+		       data_len_array[1]);
+
+    res = dtls_send_multi(ctx, peer, security, session, DTLS_CT_HANDSHAKE,
+			  data_array, data_len_array, 2);
+    if (res < 0)
+      return res;
+    sent += res;
+  }
+  return sent;
 }
 
 static int
@@ -1727,10 +2648,325 @@ static dtls_mutex_t static_mutex = DTLS_MUTEX_INITIALIZER;
 static unsigned char sendbuf[DTLS_MAX_BUF];
 #endif /* DTLS_CONSTRAINED_STACK */
 
+/* Handshake and ChangeCipherSpec records are kept in the retransmit
+ * buffer as content type (1 byte), epoch (2 bytes), length (2 bytes)
+ * and the plaintext fragment. All records of one netq node are
+ * encrypted with fresh sequence numbers on each (re-)transmission and
+ * sent in a single datagram. */
+#define DTLS_NETQ_RECORD_LENGTH 5
+
+/**
+ * Encrypts the records stored in @p node and sends them in one
+ * datagram to the node's peer.
+ *
+ * @param ctx  The DTLS context in effect.
+ * @param node The retransmit buffer entry to send.
+ * @return Less than zero in case of an error or the number of
+ *   bytes that have been sent otherwise.
+ */
+static int
+dtls_send_datagram(dtls_context_t *ctx, netq_t *node)
+{
+#ifndef DTLS_CONSTRAINED_STACK
+  unsigned char sendbuf[DTLS_MAX_BUF];
+#endif /* ! DTLS_CONSTRAINED_STACK */
+  dtls_security_parameters_t *security;
+  uint8 *data = node->data;
+  size_t length, rlen, len = 0;
+  uint16_t epoch;
+  uint8 type;
+  int res;
+
+#ifdef DTLS_CONSTRAINED_STACK
+  dtls_mutex_lock(&static_mutex);
+#endif /* DTLS_CONSTRAINED_STACK */
+
+  while (data < node->data + node->length) {
+    type = data[0];
+    epoch = dtls_uint16_to_int(data + 1);
+    length = dtls_uint16_to_int(data + 3);
+    data += DTLS_NETQ_RECORD_LENGTH;
+
+    security = dtls_security_params_epoch(node->peer, epoch);
+    rlen = sizeof(sendbuf) - len;
+    res = dtls_prepare_record(node->peer, security, type, &data, &length, 1,
+			      sendbuf + len, &rlen);
+    if (res < 0)
+      goto return_unlock;
+
+    /* Signal DTLS version 1.0 in the record layer of ClientHello
+     * handshake messages according to Section 4.2.1 of RFC 6347.
+     *
+     * This does not apply to a renegotation ClientHello
+     */
+    if (epoch == 0 && type == DTLS_CT_HANDSHAKE &&
+	data[0] == DTLS_HT_CLIENT_HELLO) {
+      dtls_int_to_uint16(sendbuf + len + 1, DTLS10_VERSION);
+    }
+
+    dtls_debug_hexdump("send header", sendbuf + len, sizeof(dtls_record_header_t));
+    dtls_debug_hexdump("send unencrypted", data, length);
+
+    len += rlen;
+    data += length;
+  }
+
+  res = CALL(ctx, write, &node->peer->session, sendbuf, len);
+
+return_unlock:
+#ifdef DTLS_CONSTRAINED_STACK
+  dtls_mutex_unlock(&static_mutex);
+#endif /* DTLS_CONSTRAINED_STACK */
+
+  return res;
+}
+
+/**
+ * Starts a new flight for @p peer. Handshake records sent to @p peer
+ * are collected in @p flight until dtls_flight_end() is called.
+ */
+static void
+dtls_flight_begin(dtls_flight_t *flight, dtls_peer_t *peer) {
+  flight->peer = peer;
+  flight->node = NULL;
+  flight->length = 0;
+}
+
+/**
+ * Returns the timeout for the first transmission of a flight to
+ * @p peer, the initial timeout of @p ctx until a round trip to the
+ * peer has been measured.
+ */
+static clock_time_t
+dtls_peer_rto(const dtls_context_t *ctx, const dtls_peer_t *peer) {
+  clock_time_t rto = ctx->rto.initial;
+
+  if (peer && peer->rtt.samples)
+    rto = peer->rtt.rto;
+  if (rto < ctx->rto.min)
+    rto = ctx->rto.min;
+  else if (rto > ctx->rto.max)
+    rto = ctx->rto.max;
+  return rto;
+}
+
+/**
+ * Sends the datagram collected in @p flight and adds it to the
+ * retransmit buffer.
+ *
+ * @return Less than zero in case of an error or the number of
+ *   bytes that have been sent otherwise.
+ */
+static int
+dtls_flight_flush(dtls_context_t *ctx, dtls_flight_t *flight) {
+  netq_t *n = flight->node;
+  dtls_tick_t now;
+  int res;
+
+  if (!n)
+    return 0;
+
+  flight->node = NULL;
+  flight->length = 0;
+
+  dtls_ticks(&now);
+  n->timeout = dtls_peer_rto(ctx, flight->peer);
+  n->t = now + n->timeout;
+  n->retransmit_cnt = 0;
+  n->job = RESEND;
+
+  if (!netq_insert_node(&ctx->sendqueue, n)) {
+    dtls_warn("cannot add packet to retransmit buffer\n");
+    res = dtls_send_datagram(ctx, n);
+    netq_node_free(n);
+    return res;
+  }
+
+#ifdef WITH_CONTIKI
+  /* must set timer within the context of the retransmit process */
+  PROCESS_CONTEXT_BEGIN(&dtls_retransmit_process);
+  etimer_set(&ctx->retransmit_timer, n->timeout);
+  PROCESS_CONTEXT_END(&dtls_retransmit_process);
+#else /* WITH_CONTIKI */
+  dtls_debug("copied to sendqueue\n");
+#endif /* WITH_CONTIKI */
+
+  return dtls_send_datagram(ctx, n);
+}
+
+/**
+ * Finishes @p flight. If @p res is not negative, the remaining records
+ * are sent, otherwise they are discarded.
+ *
+ * @param ctx    The DTLS context in effect.
+ * @param flight The flight to finish.
+ * @param res    The result of creating the flight's messages.
+ * @return @p res, or the error of sending the last datagram.
+ */
+static int
+dtls_flight_end(dtls_context_t *ctx, dtls_flight_t *flight, int res) {
+  if (res >= 0) {
+    int err = dtls_flight_flush(ctx, flight);
+    if (err < 0)
+      res = err;
+    else
+      ctx->rto.flights++;
+  } else if (flight->node) {
+    netq_node_free(flight->node);
+  }
+
+  flight->peer = NULL;
+  flight->node = NULL;
+  flight->length = 0;
+  return res;
+}
+
+/**
+ * Updates the retransmission timeout of @p peer with the measured
+ * round-trip time @p rtt as in RFC 6298, section 2. The smoothed
+ * round-trip time and its variation are kept scaled by 8 and 4.
+ */
+static void
+dtls_rto_sample(dtls_context_t *ctx, dtls_peer_t *peer, clock_time_t rtt) {
+  dtls_peer_rtt_t *est = &peer->rtt;
+  clock_time_t delta;
+
+  if (!est->samples) {
+    est->srtt = rtt << 3;
+    est->rttvar = rtt << 1;
+  } else {
+    delta = (est->srtt >> 3) > rtt ? (est->srtt >> 3) - rtt : rtt - (est->srtt >> 3);
+    est->rttvar += delta - (est->rttvar >> 2);
+    est->srtt += rtt - (est->srtt >> 3);
+  }
+  est->samples++;
+  ctx->rto.samples++;
+
+  /* RTO = SRTT + max(G, 4 * RTTVAR) with a clock granularity G of one tick */
+  est->rto = (est->srtt >> 3) + (est->rttvar ? est->rttvar : 1);
+  if (est->rto < ctx->rto.min)
+    est->rto = ctx->rto.min;
+  else if (est->rto > ctx->rto.max)
+    est->rto = ctx->rto.max;
+
+  dtls_debug("rtt %lu, srtt %lu, rttvar %lu, rto %lu\n",
+	     (unsigned long)rtt, (unsigned long)(est->srtt >> 3),
+	     (unsigned long)(est->rttvar >> 2), (unsigned long)est->rto);
+}
+
+/**
+ * Removes the flight sent to @p peer from the retransmit buffer when
+ * a message of the peer's next flight arrives. The round trip of the
+ * flight updates the retransmission timeout unless the flight was
+ * retransmitted.
+ */
+static void
+dtls_flight_acked(dtls_context_t *ctx, dtls_peer_t *peer) {
+  netq_t *node = netq_head(&ctx->sendqueue);
+  netq_t *tmp;
+  dtls_tick_t now;
+  int sampled = 0;
+
+  dtls_ticks(&now);
+  while (node) {
+    tmp = node;
+    node = netq_next(node);
+    if (tmp->job == RESEND &&
+	dtls_session_equals(&tmp->peer->session, &peer->session)) {
+      /* the first datagram of the flight was sent at t - timeout */
+      if (!sampled && tmp->retransmit_cnt == 0) {
+	dtls_rto_sample(ctx, peer, now - (tmp->t - tmp->timeout));
+      }
+      sampled = 1;
+      netq_remove(&ctx->sendqueue, tmp);
+      netq_node_free(tmp);
+    }
+  }
+}
+
+static int
+dtls_send_record(dtls_context_t *ctx, dtls_peer_t *peer,
+		 dtls_security_parameters_t *security , session_t *session,
+		 unsigned char type, uint8 *buf_array[],
+		 size_t buf_len_array[], size_t buf_array_len);
+
+/**
+ * Adds a record of type @p type to @p flight. The datagram collected
+ * so far is sent first if the new record does not fit.
+ *
+ * @return Less than zero in case of an error or the length of the
+ *   record's payload otherwise.
+ */
+static int
+dtls_flight_add(dtls_context_t *ctx, dtls_flight_t *flight,
+		dtls_security_parameters_t *security, unsigned char type,
+		uint8 *buf_array[], size_t buf_len_array[],
+		size_t buf_array_len) {
+  dtls_peer_t *peer = flight->peer;
+  size_t overall_len = 0, rlen;
+  unsigned int i;
+  uint8 *p;
+  netq_t *n;
+  int res;
+
+  if (!security) {
+    dtls_alert("security parameter missing\n");
+    return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
+  }
+
+  for (i = 0; i < buf_array_len; i++) {
+    overall_len += buf_len_array[i];
+  }
+
+  rlen = overall_len + dtls_record_overhead(security);
+  if (rlen > DTLS_MAX_BUF) {
+    dtls_debug("dtls_flight_add: send buffer too small\n");
+    return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
+  }
+
+  if (flight->length + rlen > ctx->mtu) {
+    res = dtls_flight_flush(ctx, flight);
+    if (res < 0)
+      return res;
+  }
+
+  if (!flight->node) {
+    /* the stored records are smaller than their encrypted form */
+    n = netq_node_new(DTLS_MAX_BUF);
+    if (!n) {
+      dtls_warn("retransmit buffer full\n");
+      return dtls_send_record(ctx, peer, security, &peer->session, type,
+			      buf_array, buf_len_array, buf_array_len);
+    }
+    n->peer = peer;
+    n->epoch = security->epoch;
+    n->type = type;
+    n->length = 0;
+    flight->node = n;
+  }
+
+  n = flight->node;
+  p = n->data + n->length;
+  *p = type;
+  dtls_int_to_uint16(p + 1, security->epoch);
+  dtls_int_to_uint16(p + 3, overall_len);
+  p += DTLS_NETQ_RECORD_LENGTH;
+  for (i = 0; i < buf_array_len; i++) {
+    memcpy(p, buf_array[i], buf_len_array[i]);
+    p += buf_len_array[i];
+  }
+  n->length = p - n->data;
+  flight->length += rlen;
+
+  return (int)overall_len;
+}
+
 /**
  * Sends the data passed in @p buf as a DTLS record of type @p type to
  * the given peer. The data will be encrypted and compressed according
- * to the security parameters for @p peer.
+ * to the security parameters for @p peer. Handshake and
+ * ChangeCipherSpec records are added to the current flight, or sent
+ * as a flight of their own.
  *
  * @param ctx             The DTLS context in effect.
  * @param peer            The remote party where the packet is sent.
@@ -1743,10 +2979,39 @@ static unsigned char sendbuf[DTLS_MAX_BUF];
  *   bytes that have been sent otherwise.
  */
 static int
-dtls_send_multi(dtls_context_t *ctx, dtls_peer_t *peer,
-		dtls_security_parameters_t *security , session_t *session,
-		unsigned char type, uint8 *buf_array[],
-		size_t buf_len_array[], size_t buf_array_len)
+dtls_send_multi(dtls_context_t *ctx, dtls_peer_t *peer,
+		dtls_security_parameters_t *security , session_t *session,
+		unsigned char type, uint8 *buf_array[],
+		size_t buf_len_array[], size_t buf_array_len)
+{
+  if (type == DTLS_CT_HANDSHAKE || type == DTLS_CT_CHANGE_CIPHER_SPEC) {
+    dtls_flight_t single;
+
+    if (ctx->flight.peer == peer) {
+      return dtls_flight_add(ctx, &ctx->flight, security, type,
+			     buf_array, buf_len_array, buf_array_len);
+    }
+
+    dtls_flight_begin(&single, peer);
+    return dtls_flight_end(ctx, &single,
+			   dtls_flight_add(ctx, &single, security, type,
+					   buf_array, buf_len_array,
+					   buf_array_len));
+  }
+
+  return dtls_send_record(ctx, peer, security, session, type,
+			  buf_array, buf_len_array, buf_array_len);
+}
+
+/**
+ * Sends a single record of type @p type to the given peer without
+ * keeping a copy for retransmission.
+ */
+static int
+dtls_send_record(dtls_context_t *ctx, dtls_peer_t *peer,
+		 dtls_security_parameters_t *security , session_t *session,
+		 unsigned char type, uint8 *buf_array[],
+		 size_t buf_len_array[], size_t buf_array_len)
 {
   /* We cannot use ctx->sendbuf here as it is reserved for collecting
    * the input for this function, i.e. buf == ctx->sendbuf.
@@ -1771,10 +3036,6 @@ dtls_send_multi(dtls_context_t *ctx, dtls_peer_t *peer,
   if (res < 0)
     goto return_unlock;
 
-  /* if (peer && MUST_HASH(peer, type, buf, buflen)) */
-  /*   update_hs_hash(peer, buf, buflen); */
-
-
   /* Signal DTLS version 1.0 in the record layer of ClientHello and
    * HelloVerifyRequest handshake messages according to Section 4.2.1
    * of RFC 6347.
@@ -1795,45 +3056,6 @@ dtls_send_multi(dtls_context_t *ctx, dtls_peer_t *peer,
     overall_len += buf_len_array[i];
   }
 
-  if (type == DTLS_CT_HANDSHAKE || type == DTLS_CT_CHANGE_CIPHER_SPEC) {
-    /* copy messages of handshake into retransmit buffer */
-    netq_t *n = netq_node_new(overall_len);
-    if (n) {
-      dtls_tick_t now;
-      dtls_ticks(&now);
-      n->t = now + 2 * CLOCK_SECOND;
-      n->retransmit_cnt = 0;
-      n->timeout = 2 * CLOCK_SECOND;
-      n->peer = peer;
-      n->epoch = (security) ? security->epoch : 0;
-      n->type = type;
-      n->job = RESEND;
-      n->length = 0;
-      for (i = 0; i < buf_array_len; i++) {
-        memcpy(n->data + n->length, buf_array[i], buf_len_array[i]);
-        n->length += buf_len_array[i];
-      }
-
-      if (!netq_insert_node(&ctx->sendqueue, n)) {
-        dtls_warn("cannot add packet to retransmit buffer\n");
-        netq_node_free(n);
-#ifdef WITH_CONTIKI
-      } else {
-        /* must set timer within the context of the retransmit process */
-        PROCESS_CONTEXT_BEGIN(&dtls_retransmit_process);
-        etimer_set(&ctx->retransmit_timer, n->timeout);
-        PROCESS_CONTEXT_END(&dtls_retransmit_process);
-#else /* WITH_CONTIKI */
-        dtls_debug("copied to sendqueue\n");
-#endif /* WITH_CONTIKI */
-      }
-    } else {
-      dtls_warn("retransmit buffer full\n");
-    }
-  }
-
-  /* FIXME: copy to peer's sendqueue (after fragmentation if
-   * necessary) and initialize retransmit timer */
   res = CALL(ctx, write, session, sendbuf, len);
 
 return_unlock:
@@ -1847,6 +3069,106 @@ return_unlock:
   return res <= 0 ? res : (int)(overall_len - (len - (unsigned int)res));
 }
 
+/* maximum number of records encrypted side by side in dtls_write_many() */
+#ifndef DTLS_WRITE_MANY_BATCH
+#define DTLS_WRITE_MANY_BATCH 8
+#endif
+
+#ifdef DTLS_CONSTRAINED_STACK
+static unsigned char write_many_buf[DTLS_WRITE_MANY_BATCH][DTLS_MAX_BUF];
+#endif /* DTLS_CONSTRAINED_STACK */
+
+int
+dtls_write_many(struct dtls_context_t *ctx, session_t *sessions[], size_t n,
+		uint8 *buf, size_t len) {
+#ifndef DTLS_CONSTRAINED_STACK
+  unsigned char write_many_buf[DTLS_WRITE_MANY_BATCH][DTLS_MAX_BUF];
+#endif /* ! DTLS_CONSTRAINED_STACK */
+  dtls_peer_t *peer[DTLS_WRITE_MANY_BATCH];
+  unsigned char nonce[DTLS_WRITE_MANY_BATCH][DTLS_CCM_BLOCKSIZE];
+  unsigned char A_DATA[DTLS_WRITE_MANY_BATCH][A_DATA_LEN];
+  dtls_ccm_params_t params[DTLS_WRITE_MANY_BATCH];
+  rijndael_ctx *key_ctx[DTLS_WRITE_MANY_BATCH];
+  unsigned char *data[DTLS_WRITE_MANY_BATCH];
+  const unsigned char *aad[DTLS_WRITE_MANY_BATCH];
+  dtls_security_parameters_t *security;
+  dtls_peer_t *p;
+  size_t i = 0, j, k;
+  int res, sent = 0;
+
+  /* record header, nonce_explicit, payload and MAC must fit in one
+   * record buffer */
+  if (DTLS_RH_LENGTH + 8 + len + 8 > sizeof(write_many_buf[0])) {
+    dtls_warn("dtls_write_many: send buffer too small\n");
+    return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
+  }
+
+  while (i < n) {
+    /* collect the next batch of connected peers */
+    for (k = 0; k < DTLS_WRITE_MANY_BATCH && i < n; i++) {
+      p = dtls_get_peer(ctx, sessions[i]);
+      if (!p || p->state != DTLS_STATE_CONNECTED)
+	continue;
+
+      security = dtls_security_params(p);
+      if (!is_tls_psk_with_aes_128_ccm_8(security->cipher) &&
+	  !is_tls_ecdhe_ecdsa_with_aes_128_ccm_8(security->cipher)) {
+	/* cannot be batched, send a single record */
+	if (dtls_send_multi(ctx, p, security, &p->session,
+			    DTLS_CT_APPLICATION_DATA, &buf, &len, 1) >= 0)
+	  sent++;
+	continue;
+      }
+      peer[k++] = p;
+    }
+
+    if (!k)
+      continue;
+
+#ifdef DTLS_CONSTRAINED_STACK
+    dtls_mutex_lock(&static_mutex);
+#endif /* DTLS_CONSTRAINED_STACK */
+
+    for (j = 0; j < k; j++) {
+      security = dtls_security_params(peer[j]);
+      data[j] = dtls_set_record_header(DTLS_CT_APPLICATION_DATA,
+				       security->epoch, &(security->rseq),
+				       write_many_buf[j]);
+      memcpy(data[j], &DTLS_RECORD_HEADER(write_many_buf[j])->epoch, 8);
+      data[j] += 8;
+      memcpy(data[j], buf, len);
+
+      dtls_set_record_nonce(peer[j], security, write_many_buf[j], len,
+			    nonce[j], A_DATA[j]);
+      params[j].nonce = nonce[j];
+      params[j].tag_length = 8;
+      params[j].l = 3;
+      key_ctx[j] = &security->write_ctx;
+      aad[j] = A_DATA[j];
+    }
+
+    res = dtls_encrypt_params_multi(params, key_ctx, data, len,
+				    aad, A_DATA_LEN, k);
+
+    for (j = 0; res >= 0 && j < k; j++) {
+      /* fix length of fragment */
+      dtls_int_to_uint16(write_many_buf[j] + 11, res + 8);
+      if (CALL(ctx, write, &peer[j]->session, write_many_buf[j],
+	       DTLS_RH_LENGTH + 8 + res) >= 0)
+	sent++;
+    }
+
+#ifdef DTLS_CONSTRAINED_STACK
+    dtls_mutex_unlock(&static_mutex);
+#endif /* DTLS_CONSTRAINED_STACK */
+
+    if (res < 0)
+      return res;
+  }
+
+  return sent;
+}
+
 static inline int
 dtls_send_alert(dtls_context_t *ctx, dtls_peer_t *peer, dtls_alert_level_t level,
 		dtls_alert_t description) {
@@ -1936,13 +3258,16 @@ dtls_destroy_peer(dtls_context_t *ctx, dtls_peer_t *peer, int flags) {
  * \param ephemeral_peer   The remote party we are talking to, if any.
  * \param data             The received datagram.
  * \param data_length      Length of \p msg.
+ * \param precomputed      The cookie for \p data if it has already been
+ *                         computed, or \c NULL.
  * \return \c 0 if msg is a ClientHello with a valid cookie, \c 1 or
  * \c -1 otherwise.
  */
 static int
 dtls_0_verify_peer(dtls_context_t *ctx,
 		 dtls_ephemeral_peer_t *ephemeral_peer,
-		 uint8 *data, size_t data_length)
+		 uint8 *data, size_t data_length,
+		 const uint8 *precomputed)
 {
   uint8 buf[DTLS_HV_LENGTH + DTLS_COOKIE_LENGTH];
   uint8 *p = buf;
@@ -1953,9 +3278,13 @@ dtls_0_verify_peer(dtls_context_t *ctx,
 #define mycookie (buf + DTLS_HV_LENGTH)
 
   /* Store cookie where we can reuse it for the HelloVerifyRequest. */
-  err = dtls_create_cookie(ctx, ephemeral_peer->session, data, data_length, mycookie, &len);
-  if (err < 0)
-    return err;
+  if (precomputed) {
+    memcpy(mycookie, precomputed, DTLS_COOKIE_LENGTH);
+  } else {
+    err = dtls_create_cookie(ctx, ephemeral_peer->session, data, data_length, mycookie, &len);
+    if (err < 0)
+      return err;
+  }
 
   dtls_debug_dump("create cookie", mycookie, len);
 
@@ -2155,7 +3484,7 @@ check_client_certificate_verify(dtls_context_t *ctx,
   dtls_hash_ctx hs_hash;
   unsigned char sha256hash[DTLS_HMAC_DIGEST_SIZE];
 
-  assert(is_tls_ecdhe_ecdsa_with_aes_128_ccm_8(config->cipher));
+  assert(is_key_exchange_ecdhe_ecdsa(config->cipher));
 
   data += DTLS_HS_LENGTH;
   data_length -= DTLS_HS_LENGTH;
@@ -2200,15 +3529,16 @@ dtls_send_server_hello(dtls_context_t *ctx, dtls_peer_t *peer)
   /* Ensure that the largest message to create fits in our source
    * buffer. (The size of the destination buffer is checked by the
    * encoding function, so we do not need to guess.) */
-  uint8 buf[DTLS_SH_LENGTH + 2 + 5 + 5 + 8 + 6 + 4];
+  uint8 buf[DTLS_SH_LENGTH + 2 + 5 + 5 + 8 + 6 + 4 + 4];
   uint8 *p;
   int ecdsa;
   uint8 extension_size;
   dtls_handshake_parameters_t *handshake = peer->handshake_params;
 
-  ecdsa = is_tls_ecdhe_ecdsa_with_aes_128_ccm_8(handshake->cipher);
+  ecdsa = is_key_exchange_ecdhe_ecdsa(handshake->cipher);
 
   extension_size = (handshake->extended_master_secret ? 4 : 0) +
+                   (handshake->new_session_ticket ? 4 : 0) +
                    (ecdsa ? 5 + 5 + 6 : 0);
 
   /* Handshake header */
@@ -2224,7 +3554,26 @@ dtls_send_server_hello(dtls_context_t *ctx, dtls_peer_t *peer)
   memcpy(p, handshake->tmp.random.server, DTLS_RANDOM_LENGTH);
   p += DTLS_RANDOM_LENGTH;
 
-  *p++ = 0;			/* no session id */
+  /* A resumed session keeps its id, a new one gets an id to be
+   * resumed later if we have a session cache. A session that is
+   * resumed with a ticket is not cached and gets no id. */
+  if (!handshake->resumed) {
+#if DTLS_SESSION_CACHE_SIZE
+    if (handshake->new_session_ticket) {
+      handshake->session_id_length = 0;
+    } else {
+      handshake->session_id_length = DTLS_SESSION_ID_LENGTH;
+      dtls_prng(handshake->session_id, DTLS_SESSION_ID_LENGTH);
+    }
+#else /* DTLS_SESSION_CACHE_SIZE */
+    handshake->session_id_length = 0;
+#endif /* DTLS_SESSION_CACHE_SIZE */
+  }
+
+  dtls_int_to_uint8(p, handshake->session_id_length);
+  p += sizeof(uint8);
+  memcpy(p, handshake->session_id, handshake->session_id_length);
+  p += handshake->session_id_length;
 
   if (handshake->cipher != TLS_NULL_WITH_NULL_NULL) {
     /* selected cipher suite */
@@ -2289,6 +3638,15 @@ dtls_send_server_hello(dtls_context_t *ctx, dtls_peer_t *peer)
     dtls_int_to_uint16(p, 0);
     p += sizeof(uint16);
   }
+  if (handshake->new_session_ticket) {
+    /* session ticket, announces the NewSessionTicket */
+    dtls_int_to_uint16(p, TLS_EXT_SESSION_TICKET);
+    p += sizeof(uint16);
+
+    /* length of this extension type */
+    dtls_int_to_uint16(p, 0);
+    p += sizeof(uint16);
+  }
 
   assert((buf <= p) && ((unsigned int)(p - buf) <= sizeof(buf)));
 
@@ -2379,6 +3737,95 @@ dtls_add_ecdsa_signature_elem(uint8 *p, uint32_t *point_r, uint32_t *point_s)
   return p;
 }
 
+#if DTLS_ECDHE_POOL_SIZE
+/**
+ * Returns the keys of the pool of @p ctx for @p curve and sets @p count
+ * to their fill level. The pool mutex must be held.
+ */
+static dtls_ecdhe_key_t *
+dtls_ecdhe_pool_keys(dtls_context_t *ctx, dtls_ecdh_curve curve,
+		     size_t **count) {
+#ifdef DTLS_X25519
+  if (curve == DTLS_ECDH_CURVE_X25519) {
+    *count = &ctx->ecdhe_pool.x25519_count;
+    return ctx->ecdhe_pool.x25519;
+  }
+#else /* DTLS_X25519 */
+  (void)curve;
+#endif /* DTLS_X25519 */
+  *count = &ctx->ecdhe_pool.count;
+  return ctx->ecdhe_pool.key;
+}
+#endif /* DTLS_ECDHE_POOL_SIZE */
+
+/**
+ * Provides a fresh ephemeral key pair for @p curve, from the key pool
+ * of @p ctx if there is one left. For x25519, the public key is
+ * written to @p pub_key_x and @p pub_key_y is not used.
+ */
+static void
+dtls_ecdhe_generate_key(dtls_context_t *ctx, dtls_ecdh_curve curve,
+			unsigned char *priv_key,
+			unsigned char *pub_key_x, unsigned char *pub_key_y) {
+#if DTLS_ECDHE_POOL_SIZE
+  dtls_ecdhe_key_t *key;
+  size_t *count;
+
+  dtls_mutex_lock(&ctx->pool_mutex);
+  key = dtls_ecdhe_pool_keys(ctx, curve, &count);
+  if (*count) {
+    key += --*count;
+    memcpy(priv_key, key->priv_key, DTLS_EC_KEY_SIZE);
+    memcpy(pub_key_x, key->pub_key_x, DTLS_EC_KEY_SIZE);
+    if (curve == DTLS_ECDH_CURVE_SECP256R1)
+      memcpy(pub_key_y, key->pub_key_y, DTLS_EC_KEY_SIZE);
+    memset(key, 0, sizeof(dtls_ecdhe_key_t));
+    ctx->ecdhe_pool.hits++;
+    dtls_mutex_unlock(&ctx->pool_mutex);
+    return;
+  }
+  ctx->ecdhe_pool.misses++;
+  dtls_mutex_unlock(&ctx->pool_mutex);
+#else /* DTLS_ECDHE_POOL_SIZE */
+  (void)ctx;
+#endif /* DTLS_ECDHE_POOL_SIZE */
+
+#ifdef DTLS_X25519
+  if (curve == DTLS_ECDH_CURVE_X25519) {
+    dtls_x25519_generate_key(priv_key, pub_key_x);
+    return;
+  }
+#endif /* DTLS_X25519 */
+  dtls_ecdsa_generate_key(priv_key, pub_key_x, pub_key_y, DTLS_EC_KEY_SIZE);
+}
+
+/**
+ * Moves a precomputed signature nonce from the pool of @p ctx to
+ * @p presig. Returns @p presig, or @c NULL if the pool is empty.
+ */
+static dtls_ecdsa_presig_t *
+dtls_ecdsa_take_presig(dtls_context_t *ctx, dtls_ecdsa_presig_t *presig) {
+#if DTLS_ECDSA_SIGN_POOL_SIZE
+  dtls_ecdsa_presig_t *entry;
+
+  dtls_mutex_lock(&ctx->pool_mutex);
+  if (ctx->ecdsa_sign_pool.count) {
+    entry = &ctx->ecdsa_sign_pool.presig[--ctx->ecdsa_sign_pool.count];
+    *presig = *entry;
+    memset(entry, 0, sizeof(dtls_ecdsa_presig_t));
+    ctx->ecdsa_sign_pool.hits++;
+    dtls_mutex_unlock(&ctx->pool_mutex);
+    return presig;
+  }
+  ctx->ecdsa_sign_pool.misses++;
+  dtls_mutex_unlock(&ctx->pool_mutex);
+#else /* DTLS_ECDSA_SIGN_POOL_SIZE */
+  (void)ctx;
+  (void)presig;
+#endif /* DTLS_ECDSA_SIGN_POOL_SIZE */
+  return NULL;
+}
+
 static int
 dtls_send_server_key_exchange_ecdh(dtls_context_t *ctx, dtls_peer_t *peer,
 				   const dtls_ecdsa_key_t *key)
@@ -2392,6 +3839,7 @@ dtls_send_server_key_exchange_ecdh(dtls_context_t *ctx, dtls_peer_t *peer,
   uint8 *ephemeral_pub_y;
   uint32_t point_r[9];
   uint32_t point_s[9];
+  dtls_ecdsa_presig_t presig;
   dtls_handshake_parameters_t *config = peer->handshake_params;
 
   /* ServerKeyExchange
@@ -2404,34 +3852,48 @@ dtls_send_server_key_exchange_ecdh(dtls_context_t *ctx, dtls_peer_t *peer,
   dtls_int_to_uint8(p, 3);
   p += sizeof(uint8);
 
-  /* NamedCurve namedcurve: secp256r1 */
-  dtls_int_to_uint16(p, TLS_EXT_ELLIPTIC_CURVES_SECP256R1);
-  p += sizeof(uint16);
+  if (is_ecdh_curve_x25519(config)) {
+    /* NamedCurve namedcurve: x25519 */
+    dtls_int_to_uint16(p, TLS_EXT_ELLIPTIC_CURVES_X25519);
+    p += sizeof(uint16);
 
-  dtls_int_to_uint8(p, 1 + 2 * DTLS_EC_KEY_SIZE);
-  p += sizeof(uint8);
+    dtls_int_to_uint8(p, DTLS_X25519_KEY_SIZE);
+    p += sizeof(uint8);
 
-  /* This should be an uncompressed point, but I do not have access to the spec. */
-  dtls_int_to_uint8(p, 4);
-  p += sizeof(uint8);
+    dtls_ecdhe_generate_key(ctx, DTLS_ECDH_CURVE_X25519,
+			    config->keyx.ecdsa.own_eph_priv, p, NULL);
+    p += DTLS_X25519_KEY_SIZE;
+  } else {
+    /* NamedCurve namedcurve: secp256r1 */
+    dtls_int_to_uint16(p, TLS_EXT_ELLIPTIC_CURVES_SECP256R1);
+    p += sizeof(uint16);
 
-  /* store the pointer to the x component of the pub key and make space */
-  ephemeral_pub_x = p;
-  p += DTLS_EC_KEY_SIZE;
+    dtls_int_to_uint8(p, 1 + 2 * DTLS_EC_KEY_SIZE);
+    p += sizeof(uint8);
 
-  /* store the pointer to the y component of the pub key and make space */
-  ephemeral_pub_y = p;
-  p += DTLS_EC_KEY_SIZE;
+    /* This should be an uncompressed point, but I do not have access to the spec. */
+    dtls_int_to_uint8(p, 4);
+    p += sizeof(uint8);
+
+    /* store the pointer to the x component of the pub key and make space */
+    ephemeral_pub_x = p;
+    p += DTLS_EC_KEY_SIZE;
+
+    /* store the pointer to the y component of the pub key and make space */
+    ephemeral_pub_y = p;
+    p += DTLS_EC_KEY_SIZE;
 
-  dtls_ecdsa_generate_key(config->keyx.ecdsa.own_eph_priv,
-			  ephemeral_pub_x, ephemeral_pub_y,
-			  DTLS_EC_KEY_SIZE);
+    dtls_ecdhe_generate_key(ctx, DTLS_ECDH_CURVE_SECP256R1,
+			    config->keyx.ecdsa.own_eph_priv,
+			    ephemeral_pub_x, ephemeral_pub_y);
+  }
 
   /* sign the ephemeral and its paramaters */
   dtls_ecdsa_create_sig(key->priv_key, DTLS_EC_KEY_SIZE,
 		       config->tmp.random.client, DTLS_RANDOM_LENGTH,
 		       config->tmp.random.server, DTLS_RANDOM_LENGTH,
 		       key_params, p - key_params,
+		       dtls_ecdsa_take_presig(ctx, &presig),
 		       point_r, point_s);
 
   p = dtls_add_ecdsa_signature_elem(p, point_r, point_s);
@@ -2541,7 +4003,7 @@ dtls_send_server_hello_msgs(dtls_context_t *ctx, dtls_peer_t *peer)
   }
 
 #ifdef DTLS_ECC
-  if (is_tls_ecdhe_ecdsa_with_aes_128_ccm_8(peer->handshake_params->cipher)) {
+  if (is_key_exchange_ecdhe_ecdsa(peer->handshake_params->cipher)) {
     const dtls_ecdsa_key_t *ecdsa_key;
 
     res = CALL(ctx, get_ecdsa_key, &peer->session, &ecdsa_key);
@@ -2564,7 +4026,7 @@ dtls_send_server_hello_msgs(dtls_context_t *ctx, dtls_peer_t *peer)
       return res;
     }
 
-    if (is_tls_ecdhe_ecdsa_with_aes_128_ccm_8(peer->handshake_params->cipher) &&
+    if (is_key_exchange_ecdhe_ecdsa(peer->handshake_params->cipher) &&
 	is_ecdsa_client_auth_supported(ctx)) {
       res = dtls_send_server_certificate_request(ctx, peer);
 
@@ -2577,7 +4039,7 @@ dtls_send_server_hello_msgs(dtls_context_t *ctx, dtls_peer_t *peer)
 #endif /* DTLS_ECC */
 
 #ifdef DTLS_PSK
-  if (is_tls_psk_with_aes_128_ccm_8(peer->handshake_params->cipher)) {
+  if (is_key_exchange_psk(peer->handshake_params->cipher)) {
     unsigned char psk_hint[DTLS_PSK_MAX_CLIENT_IDENTITY_LEN];
     int len;
 
@@ -2632,6 +4094,12 @@ dtls_send_client_key_exchange(dtls_context_t *ctx, dtls_peer_t *peer)
   memset(buf, 0, sizeof(buf));
   switch (handshake->cipher) {
 #ifdef DTLS_PSK
+#ifdef DTLS_GCM
+  case TLS_PSK_WITH_AES_128_GCM_SHA256:
+#endif /* DTLS_GCM */
+#ifdef DTLS_CHACHA20
+  case TLS_PSK_WITH_CHACHA20_POLY1305_SHA256:
+#endif /* DTLS_CHACHA20 */
   case TLS_PSK_WITH_AES_128_CCM_8: {
     int len;
 
@@ -2663,10 +4131,26 @@ dtls_send_client_key_exchange(dtls_context_t *ctx, dtls_peer_t *peer)
   }
 #endif /* DTLS_PSK */
 #ifdef DTLS_ECC
+#ifdef DTLS_GCM
+  case TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256:
+#endif /* DTLS_GCM */
+#ifdef DTLS_CHACHA20
+  case TLS_ECDHE_ECDSA_WITH_CHACHA20_POLY1305_SHA256:
+#endif /* DTLS_CHACHA20 */
   case TLS_ECDHE_ECDSA_WITH_AES_128_CCM_8: {
     uint8 *ephemeral_pub_x;
     uint8 *ephemeral_pub_y;
 
+    if (is_ecdh_curve_x25519(handshake)) {
+      dtls_int_to_uint8(p, DTLS_X25519_KEY_SIZE);
+      p += sizeof(uint8);
+
+      dtls_ecdhe_generate_key(ctx, DTLS_ECDH_CURVE_X25519,
+			      handshake->keyx.ecdsa.own_eph_priv, p, NULL);
+      p += DTLS_X25519_KEY_SIZE;
+      break;
+    }
+
     dtls_int_to_uint8(p, 1 + 2 * DTLS_EC_KEY_SIZE);
     p += sizeof(uint8);
 
@@ -2679,9 +4163,9 @@ dtls_send_client_key_exchange(dtls_context_t *ctx, dtls_peer_t *peer)
     ephemeral_pub_y = p;
     p += DTLS_EC_KEY_SIZE;
 
-    dtls_ecdsa_generate_key(peer->handshake_params->keyx.ecdsa.own_eph_priv,
-    			    ephemeral_pub_x, ephemeral_pub_y,
-    			    DTLS_EC_KEY_SIZE);
+    dtls_ecdhe_generate_key(ctx, DTLS_ECDH_CURVE_SECP256R1,
+			    peer->handshake_params->keyx.ecdsa.own_eph_priv,
+			    ephemeral_pub_x, ephemeral_pub_y);
 
     break;
   }
@@ -2699,11 +4183,27 @@ dtls_send_client_key_exchange(dtls_context_t *ctx, dtls_peer_t *peer)
   case TLS_PSK_WITH_AES_128_CCM_8:
     /* fall through to default */
 #endif /* !DTLS_PSK */
+#if !defined(DTLS_PSK) || !defined(DTLS_GCM)
+  case TLS_PSK_WITH_AES_128_GCM_SHA256:
+    /* fall through to default */
+#endif /* !DTLS_PSK || !DTLS_GCM */
+#if !defined(DTLS_PSK) || !defined(DTLS_CHACHA20)
+  case TLS_PSK_WITH_CHACHA20_POLY1305_SHA256:
+    /* fall through to default */
+#endif /* !DTLS_PSK || !DTLS_CHACHA20 */
 
 #ifndef DTLS_ECC
   case TLS_ECDHE_ECDSA_WITH_AES_128_CCM_8:
     /* fall through to default */
 #endif /* !DTLS_ECC */
+#if !defined(DTLS_ECC) || !defined(DTLS_GCM)
+  case TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256:
+    /* fall through to default */
+#endif /* !DTLS_ECC || !DTLS_GCM */
+#if !defined(DTLS_ECC) || !defined(DTLS_CHACHA20)
+  case TLS_ECDHE_ECDSA_WITH_CHACHA20_POLY1305_SHA256:
+    /* fall through to default */
+#endif /* !DTLS_ECC || !DTLS_CHACHA20 */
 
   default:
     dtls_crit("cipher %04x not supported\n", handshake->cipher);
@@ -2734,6 +4234,7 @@ dtls_send_certificate_verify_ecdh(dtls_context_t *ctx, dtls_peer_t *peer,
   uint8 *p;
   uint32_t point_r[9];
   uint32_t point_s[9];
+  dtls_ecdsa_presig_t presig;
   dtls_hash_ctx hs_hash;
   unsigned char sha256hash[DTLS_HMAC_DIGEST_SIZE];
 
@@ -2749,6 +4250,7 @@ dtls_send_certificate_verify_ecdh(dtls_context_t *ctx, dtls_peer_t *peer,
   /* sign the ephemeral and its paramaters */
   dtls_ecdsa_create_sig_hash(key->priv_key, DTLS_EC_KEY_SIZE,
 			     sha256hash, sizeof(sha256hash),
+			     dtls_ecdsa_take_presig(ctx, &presig),
 			     point_r, point_s);
 
   p = dtls_add_ecdsa_signature_elem(p, point_r, point_s);
@@ -2774,12 +4276,11 @@ dtls_send_finished(dtls_context_t *ctx, dtls_peer_t *peer,
 
   length = dtls_hash_finalize(hash, &hs_hash);
 
-  dtls_prf(peer->handshake_params->tmp.master_secret,
-	   DTLS_MASTER_SECRET_LENGTH,
-	   label, labellen,
-	   PRF_LABEL(finished), PRF_LABEL_SIZE(finished),
-	   hash, length,
-	   p, DTLS_FIN_LENGTH);
+  dtls_prf_with_key(&peer->handshake_params->master_key,
+		    label, labellen,
+		    PRF_LABEL(finished), PRF_LABEL_SIZE(finished),
+		    hash, length,
+		    p, DTLS_FIN_LENGTH);
 
   dtls_debug_dump("server finished MAC", p, DTLS_FIN_LENGTH);
 
@@ -2791,27 +4292,171 @@ dtls_send_finished(dtls_context_t *ctx, dtls_peer_t *peer,
 				 buf, p - buf);
 }
 
+#if DTLS_SESSION_TICKETS
+/**
+ * Sends a NewSessionTicket with the state of the session negotiated
+ * with \p peer. The client presents the ticket to resume the session
+ * later.
+ */
+static int
+dtls_send_new_session_ticket(dtls_context_t *ctx, dtls_peer_t *peer)
+{
+  uint8 buf[sizeof(uint32) + sizeof(uint16) +
+	    DTLS_TICKET_LENGTH(DTLS_SESSION_IDENTITY_LENGTH)];
+  uint8 *p = buf;
+  int res;
+
+  /* ticket lifetime hint in seconds */
+  dtls_int_to_uint32(p, DTLS_TICKET_LIFETIME);
+  p += sizeof(uint32);
+
+  res = dtls_session_ticket_encrypt(ctx, peer, p + sizeof(uint16));
+  if (res < 0) {
+    return res;
+  }
+  dtls_int_to_uint16(p, res);
+  p += sizeof(uint16) + res;
+
+  assert((buf <= p) && ((unsigned int)(p - buf) <= sizeof(buf)));
+
+  ctx->tickets.issued++;
+  return dtls_send_handshake_msg(ctx, peer, DTLS_HT_NEW_SESSION_TICKET,
+				 buf, p - buf);
+}
+#endif /* DTLS_SESSION_TICKETS */
+
+#if DTLS_SESSION_CACHE_SIZE
+/**
+ * Sends the server's flight of an abbreviated handshake that resumes
+ * the session with the given \p master_secret: ServerHello,
+ * NewSessionTicket if the client supports tickets, ChangeCipherSpec
+ * and Finished.
+ */
+static int
+dtls_send_server_hello_abbreviated(dtls_context_t *ctx, dtls_peer_t *peer,
+				   const uint8 *master_secret)
+{
+  int res;
+
+  res = dtls_send_server_hello(ctx, peer);
+  if (res < 0) {
+    dtls_debug("dtls_server_hello: cannot prepare ServerHello record\n");
+    return res;
+  }
+
+  /* the server random is known now */
+  res = dtls_session_resume(peer, master_secret);
+  if (res < 0) {
+    return res;
+  }
+
+#if DTLS_SESSION_TICKETS
+  if (peer->handshake_params->new_session_ticket) {
+    res = dtls_send_new_session_ticket(ctx, peer);
+    if (res < 0) {
+      dtls_debug("cannot send NewSessionTicket message\n");
+      return res;
+    }
+  }
+#endif /* DTLS_SESSION_TICKETS */
+
+  res = dtls_send_ccs(ctx, peer);
+  if (res < 0) {
+    dtls_debug("cannot send CCS message\n");
+    return res;
+  }
+
+  dtls_security_params_switch(peer);
+
+  return dtls_send_finished(ctx, peer, PRF_LABEL(server), PRF_LABEL_SIZE(server));
+}
+#endif /* DTLS_SESSION_CACHE_SIZE */
+
 static int
 dtls_send_client_hello(dtls_context_t *ctx, dtls_peer_t *peer,
                        uint8 cookie[], size_t cookie_length) {
   uint8 buf[DTLS_CH_LENGTH_MAX];
   uint8 *p = buf;
   uint8_t cipher_size;
-  uint8_t extension_size;
+  uint16_t extension_size;
   int psk;
   int ecdsa;
+#ifdef DTLS_CHACHA20
+  int prefer_chacha20;
+#endif /* DTLS_CHACHA20 */
   dtls_handshake_parameters_t *handshake = peer->handshake_params;
+#if DTLS_SESSION_CACHE_SIZE
+  dtls_session_cache_entry_t *cached = NULL;
+  size_t length;
+#endif /* DTLS_SESSION_CACHE_SIZE */
+#if DTLS_SESSION_TICKETS
+  size_t ticket_length = 0;
+#endif /* DTLS_SESSION_TICKETS */
 
   psk = is_psk_supported(ctx);
   ecdsa = is_ecdsa_supported(ctx, 1);
 
   cipher_size = 2 + ((ecdsa) ? 2 : 0) + ((psk) ? 2 : 0);
+#ifdef DTLS_GCM
+  /* the AES_128_GCM_SHA256 variants are offered in addition */
+  cipher_size += ((ecdsa) ? 2 : 0) + ((psk) ? 2 : 0);
+#endif /* DTLS_GCM */
+#ifdef DTLS_CHACHA20
+  /* so are the CHACHA20_POLY1305_SHA256 variants */
+  cipher_size += ((ecdsa) ? 2 : 0) + ((psk) ? 2 : 0);
+
+  /* Without AES instructions, ChaCha20 is both faster and free of the
+   * cache-timing issues of the table based AES. */
+  prefer_chacha20 = rijndael_get_impl() != RIJNDAEL_IMPL_AESNI;
+#endif /* DTLS_CHACHA20 */
   extension_size = 4 + ((ecdsa) ? 6 + 6 + 8 + 6 + 8: 0);
+#ifdef DTLS_X25519
+  /* x25519 is listed before secp256r1 */
+  extension_size += (ecdsa) ? 2 : 0;
+#endif /* DTLS_X25519 */
+#if DTLS_SESSION_TICKETS
+  /* the session ticket extension, without a ticket */
+  extension_size += 4;
+#endif /* DTLS_SESSION_TICKETS */
 
   if (cipher_size == 0) {
     dtls_crit("no cipher callbacks implemented\n");
   }
 
+#if DTLS_SESSION_CACHE_SIZE
+  /* offer the last session with this server in the initial handshake */
+  if (dtls_security_params(peer)->epoch == 0)
+    cached = dtls_session_cache_find(ctx, DTLS_CLIENT, &peer->session,
+				     NULL, 0);
+
+  /* a session with a server that is no longer trusted is dropped */
+  if (cached && cookie_length == 0 &&
+      dtls_session_identity_check(ctx, peer, cached->cipher,
+				  &cached->identity) < 0) {
+    dtls_debug("identity of the cached session is no longer accepted\n");
+    memset(cached, 0, sizeof(dtls_session_cache_entry_t));
+    cached = NULL;
+  }
+
+  /* The ClientHello is never fragmented. The session is offered only
+   * if the ClientHello still fits into a record with the longest
+   * cookie, so that the request with cookie offers the same. */
+  if (cached) {
+    length = DTLS_RH_LENGTH + DTLS_HS_LENGTH + DTLS_CH_LENGTH +
+      sizeof(uint8) + cached->id_length + sizeof(uint8) +
+      DTLS_COOKIE_LENGTH_MAX + cipher_size + 2 * sizeof(uint8) +
+      sizeof(uint16) + extension_size;
+#if DTLS_SESSION_TICKETS
+    if (length + cached->ticket_length <= DTLS_MAX_BUF)
+      ticket_length = cached->ticket_length;
+#endif /* DTLS_SESSION_TICKETS */
+    if (length > DTLS_MAX_BUF) {
+      dtls_debug("cached session does not fit into the ClientHello\n");
+      cached = NULL;
+    }
+  }
+#endif /* DTLS_SESSION_CACHE_SIZE */
+
   dtls_int_to_uint16(p, DTLS_VERSION);
   p += sizeof(uint16);
 
@@ -2823,14 +4468,31 @@ dtls_send_client_hello(dtls_context_t *ctx, dtls_peer_t *peer,
   if (cookie_length == 0) {
     /* Set 32 bytes of client random data */
     dtls_prng(handshake->tmp.random.client, DTLS_RANDOM_LENGTH);
-  }
+
+#if DTLS_SESSION_CACHE_SIZE
+    if (cached) {
+      handshake->session_id_length = cached->id_length;
+      memcpy(handshake->session_id, cached->id, cached->id_length);
+    }
+#endif /* DTLS_SESSION_CACHE_SIZE */
+  }
+#if DTLS_SESSION_TICKETS
+  /* the ticket goes with the session id it was stored with */
+  if (ticket_length &&
+      (handshake->session_id_length != cached->id_length ||
+       memcmp(handshake->session_id, cached->id, cached->id_length)))
+    ticket_length = 0;
+  extension_size += ticket_length;
+#endif /* DTLS_SESSION_TICKETS */
   /* we must use the same Client Random as for the previous request */
   memcpy(p, handshake->tmp.random.client, DTLS_RANDOM_LENGTH);
   p += DTLS_RANDOM_LENGTH;
 
-  /* session id (length 0) */
-  dtls_int_to_uint8(p, 0);
+  /* session id, the same for the request with cookie */
+  dtls_int_to_uint8(p, handshake->session_id_length);
   p += sizeof(uint8);
+  memcpy(p, handshake->session_id, handshake->session_id_length);
+  p += handshake->session_id_length;
 
   /* cookie */
   dtls_int_to_uint8(p, cookie_length);
@@ -2844,11 +4506,46 @@ dtls_send_client_hello(dtls_context_t *ctx, dtls_peer_t *peer,
   dtls_int_to_uint16(p, cipher_size - 2);
   p += sizeof(uint16);
 
+  /* The server picks the first cipher suite it knows, so the GCM
+   * suites are listed before their CCM_8 counterparts. ChaCha20 goes
+   * first if AES is not hardware accelerated, and after GCM otherwise. */
   if (ecdsa) {
+#ifdef DTLS_CHACHA20
+    if (prefer_chacha20) {
+      dtls_int_to_uint16(p, TLS_ECDHE_ECDSA_WITH_CHACHA20_POLY1305_SHA256);
+      p += sizeof(uint16);
+    }
+#endif /* DTLS_CHACHA20 */
+#ifdef DTLS_GCM
+    dtls_int_to_uint16(p, TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256);
+    p += sizeof(uint16);
+#endif /* DTLS_GCM */
+#ifdef DTLS_CHACHA20
+    if (!prefer_chacha20) {
+      dtls_int_to_uint16(p, TLS_ECDHE_ECDSA_WITH_CHACHA20_POLY1305_SHA256);
+      p += sizeof(uint16);
+    }
+#endif /* DTLS_CHACHA20 */
     dtls_int_to_uint16(p, TLS_ECDHE_ECDSA_WITH_AES_128_CCM_8);
     p += sizeof(uint16);
   }
   if (psk) {
+#ifdef DTLS_CHACHA20
+    if (prefer_chacha20) {
+      dtls_int_to_uint16(p, TLS_PSK_WITH_CHACHA20_POLY1305_SHA256);
+      p += sizeof(uint16);
+    }
+#endif /* DTLS_CHACHA20 */
+#ifdef DTLS_GCM
+    dtls_int_to_uint16(p, TLS_PSK_WITH_AES_128_GCM_SHA256);
+    p += sizeof(uint16);
+#endif /* DTLS_GCM */
+#ifdef DTLS_CHACHA20
+    if (!prefer_chacha20) {
+      dtls_int_to_uint16(p, TLS_PSK_WITH_CHACHA20_POLY1305_SHA256);
+      p += sizeof(uint16);
+    }
+#endif /* DTLS_CHACHA20 */
     dtls_int_to_uint16(p, TLS_PSK_WITH_AES_128_CCM_8);
     p += sizeof(uint16);
   }
@@ -2899,6 +4596,18 @@ dtls_send_client_hello(dtls_context_t *ctx, dtls_peer_t *peer,
     dtls_int_to_uint16(p, TLS_EXT_ELLIPTIC_CURVES);
     p += sizeof(uint16);
 
+#ifdef DTLS_X25519
+    /* length of this extension type */
+    dtls_int_to_uint16(p, 6);
+    p += sizeof(uint16);
+
+    /* length of the list */
+    dtls_int_to_uint16(p, 4);
+    p += sizeof(uint16);
+
+    dtls_int_to_uint16(p, TLS_EXT_ELLIPTIC_CURVES_X25519);
+    p += sizeof(uint16);
+#else /* DTLS_X25519 */
     /* length of this extension type */
     dtls_int_to_uint16(p, 4);
     p += sizeof(uint16);
@@ -2906,6 +4615,7 @@ dtls_send_client_hello(dtls_context_t *ctx, dtls_peer_t *peer,
     /* length of the list */
     dtls_int_to_uint16(p, 2);
     p += sizeof(uint16);
+#endif /* DTLS_X25519 */
 
     dtls_int_to_uint16(p, TLS_EXT_ELLIPTIC_CURVES_SECP256R1);
     p += sizeof(uint16);
@@ -2955,6 +4665,21 @@ dtls_send_client_hello(dtls_context_t *ctx, dtls_peer_t *peer,
   p += sizeof(uint16);
   handshake->extended_master_secret = 1;
 
+#if DTLS_SESSION_TICKETS
+  /* session ticket, empty if we have none for this server */
+  dtls_int_to_uint16(p, TLS_EXT_SESSION_TICKET);
+  p += sizeof(uint16);
+
+  /* length of this extension type */
+  dtls_int_to_uint16(p, ticket_length);
+  p += sizeof(uint16);
+
+  if (ticket_length) {
+    memcpy(p, cached->ticket, ticket_length);
+    p += ticket_length;
+  }
+#endif /* DTLS_SESSION_TICKETS */
+
   handshake->hs_state.read_epoch = dtls_security_params(peer)->epoch;
   assert((buf <= p) && ((unsigned int)(p - buf) <= sizeof(buf)));
 
@@ -2971,6 +4696,11 @@ check_server_hello(dtls_context_t *ctx,
 		      uint8 *data, size_t data_length)
 {
   dtls_handshake_parameters_t *handshake = peer->handshake_params;
+  uint8 *session_id;
+  int res;
+#if DTLS_SESSION_CACHE_SIZE
+  dtls_session_cache_entry_t *cached;
+#endif /* DTLS_SESSION_CACHE_SIZE */
 
   /*
    * Check we have enough data for the ServerHello
@@ -3009,7 +4739,32 @@ check_server_hello(dtls_context_t *ctx,
   data += DTLS_RANDOM_LENGTH;
   data_length -= DTLS_RANDOM_LENGTH;
 
+  session_id = data;
   SKIP_VAR_FIELD(data, data_length, uint8); /* skip session id */
+
+  if (dtls_uint8_to_int(session_id) > DTLS_SESSION_ID_LENGTH) {
+    dtls_alert("session id too long\n");
+    return dtls_alert_fatal_create(DTLS_ALERT_DECODE_ERROR);
+  }
+
+  /* The server resumes the session if it returns the offered id,
+   * otherwise it starts a new session. */
+  if (handshake->session_id_length) {
+    handshake->resumed =
+      dtls_uint8_to_int(session_id) == handshake->session_id_length &&
+      !memcmp(session_id + sizeof(uint8), handshake->session_id,
+	      handshake->session_id_length);
+#if DTLS_SESSION_CACHE_SIZE
+    if (handshake->resumed)
+      ctx->session_cache.hits++;
+    else
+      ctx->session_cache.misses++;
+#endif /* DTLS_SESSION_CACHE_SIZE */
+  }
+  handshake->session_id_length = dtls_uint8_to_int(session_id);
+  memcpy(handshake->session_id, session_id + sizeof(uint8),
+	 handshake->session_id_length);
+
   /*
    * Need to re-check in case session id was not empty
    *   2 bytes for the selected cipher suite
@@ -3042,12 +4797,87 @@ check_server_hello(dtls_context_t *ctx,
 
   /* Server may not support extended master secret */
   handshake->extended_master_secret = 0;
-  return dtls_check_tls_extension(peer, data, data_length, 0);
+  res = dtls_check_tls_extension(peer, data, data_length, 0);
+  if (res < 0 || !handshake->resumed)
+    return res;
+
+#if DTLS_SESSION_CACHE_SIZE
+  /* the resumed session must not change (RFC 7627, 5.3) */
+  cached = dtls_session_cache_find(ctx, DTLS_CLIENT, &peer->session, NULL, 0);
+  if (!cached || cached->id_length != handshake->session_id_length ||
+      memcmp(cached->id, handshake->session_id, cached->id_length) ||
+      cached->cipher != handshake->cipher ||
+      cached->extended_master_secret != handshake->extended_master_secret) {
+    dtls_alert("resumed session does not match the cached one\n");
+    return dtls_alert_fatal_create(DTLS_ALERT_ILLEGAL_PARAMETER);
+  }
+  dtls_session_cache_touch(ctx, cached);
+  dtls_session_identity_restore(peer, &cached->identity);
+  return dtls_session_resume(peer, cached->master_secret);
+#else /* DTLS_SESSION_CACHE_SIZE */
+  return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
+#endif /* DTLS_SESSION_CACHE_SIZE */
 
 error:
   return dtls_alert_fatal_create(DTLS_ALERT_DECODE_ERROR);
 }
 
+#if DTLS_SESSION_TICKETS
+/**
+ * Keeps the ticket from the server's NewSessionTicket until the
+ * handshake is complete. An empty ticket or one that is too long to
+ * be stored is ignored.
+ */
+static int
+check_new_session_ticket(dtls_context_t *ctx,
+			 dtls_peer_t *peer,
+			 uint8 *data, size_t data_length)
+{
+  dtls_handshake_parameters_t *handshake = peer->handshake_params;
+  size_t ticket_length;
+  (void)ctx;
+
+  if (data_length < DTLS_HS_LENGTH + sizeof(uint32) + sizeof(uint16)) {
+    dtls_alert("Insufficient length for NewSessionTicket\n");
+    return dtls_alert_fatal_create(DTLS_ALERT_DECODE_ERROR);
+  }
+
+  update_hs_hash(peer, data, data_length);
+
+  /* skip the ticket lifetime hint, tickets are used until rejected */
+  data += DTLS_HS_LENGTH + sizeof(uint32);
+  data_length -= DTLS_HS_LENGTH + sizeof(uint32);
+
+  ticket_length = dtls_uint16_to_int(data);
+  data += sizeof(uint16);
+  data_length -= sizeof(uint16);
+
+  if (data_length < ticket_length) {
+    dtls_alert("Insufficient length for NewSessionTicket\n");
+    return dtls_alert_fatal_create(DTLS_ALERT_DECODE_ERROR);
+  }
+
+  handshake->new_session_ticket = 0;
+  netq_node_free(handshake->ticket);
+  handshake->ticket = NULL;
+
+  if (!ticket_length || ticket_length > DTLS_SESSION_TICKET_MAX_LENGTH ||
+      ticket_length > sizeof(netq_packet_t)) {
+    dtls_debug("ignore session ticket of %zu bytes\n", ticket_length);
+    return 0;
+  }
+
+  handshake->ticket = netq_node_new(ticket_length);
+  if (!handshake->ticket) {
+    dtls_warn("cannot store session ticket\n");
+    return 0;
+  }
+  handshake->ticket->length = ticket_length;
+  memcpy(handshake->ticket->data, data, ticket_length);
+  return 0;
+}
+#endif /* DTLS_SESSION_TICKETS */
+
 static int
 check_server_hello_verify_request(dtls_context_t *ctx,
 				  dtls_peer_t *peer,
@@ -3082,7 +4912,7 @@ check_server_certificate(dtls_context_t *ctx,
 
   update_hs_hash(peer, data, data_length);
 
-  assert(is_tls_ecdhe_ecdsa_with_aes_128_ccm_8(config->cipher));
+  assert(is_key_exchange_ecdhe_ecdsa(config->cipher));
 
   data += DTLS_HS_LENGTH;
 
@@ -3130,19 +4960,22 @@ check_server_key_exchange_ecdsa(dtls_context_t *ctx,
   unsigned char result_r[DTLS_EC_KEY_SIZE];
   unsigned char result_s[DTLS_EC_KEY_SIZE];
   unsigned char *key_params;
+  size_t key_params_length;
 
   update_hs_hash(peer, data, data_length);
 
-  assert(is_tls_ecdhe_ecdsa_with_aes_128_ccm_8(config->cipher));
+  assert(is_key_exchange_ecdhe_ecdsa(config->cipher));
 
   data += DTLS_HS_LENGTH;
   data_length -= DTLS_HS_LENGTH;
 
-  if (data_length < DTLS_SKEXEC_LENGTH - 2 * DTLS_EC_KEY_SIZE) {
+  if (data_length < DTLS_SKEXEC_X25519_LENGTH - 2 * DTLS_EC_KEY_SIZE) {
     /*
      * Some of the ASN.1 integer in the signature may be less than
      * DTLS_EC_KEY_SIZE if leading bits are 0.
      * dtls_check_ecdsa_signature_elem() knows how to handle this undersize.
+     * The length of the public point is checked below, x25519 has
+     * the shorter one.
      */
     dtls_alert("the packet length does not match the expected\n");
     return dtls_alert_fatal_create(DTLS_ALERT_DECODE_ERROR);
@@ -3156,34 +4989,58 @@ check_server_key_exchange_ecdsa(dtls_context_t *ctx,
   data += sizeof(uint8);
   data_length -= sizeof(uint8);
 
-  if (dtls_uint16_to_int(data) != TLS_EXT_ELLIPTIC_CURVES_SECP256R1) {
-    dtls_alert("secp256r1 supported\n");
+  switch (dtls_uint16_to_int(data)) {
+  case TLS_EXT_ELLIPTIC_CURVES_SECP256R1:
+    config->keyx.ecdsa.curve = DTLS_ECDH_CURVE_SECP256R1;
+    break;
+#ifdef DTLS_X25519
+  case TLS_EXT_ELLIPTIC_CURVES_X25519:
+    config->keyx.ecdsa.curve = DTLS_ECDH_CURVE_X25519;
+    break;
+#endif /* DTLS_X25519 */
+  default:
+    dtls_alert("unsupported named curve\n");
     return dtls_alert_fatal_create(DTLS_ALERT_HANDSHAKE_FAILURE);
   }
   data += sizeof(uint16);
   data_length -= sizeof(uint16);
 
-  if (dtls_uint8_to_int(data) != 1 + 2 * DTLS_EC_KEY_SIZE) {
-    dtls_alert("expected 65 bytes long public point\n");
-    return dtls_alert_fatal_create(DTLS_ALERT_HANDSHAKE_FAILURE);
-  }
-  data += sizeof(uint8);
-  data_length -= sizeof(uint8);
+  if (is_ecdh_curve_x25519(config)) {
+    if (dtls_uint8_to_int(data) != DTLS_X25519_KEY_SIZE) {
+      dtls_alert("expected 32 bytes long public key\n");
+      return dtls_alert_fatal_create(DTLS_ALERT_HANDSHAKE_FAILURE);
+    }
+    data += sizeof(uint8);
+    data_length -= sizeof(uint8);
 
-  if (dtls_uint8_to_int(data) != 4) {
-    dtls_alert("expected uncompressed public point\n");
-    return dtls_alert_fatal_create(DTLS_ALERT_DECODE_ERROR);
-  }
-  data += sizeof(uint8);
-  data_length -= sizeof(uint8);
+    memcpy(config->keyx.ecdsa.other_eph_pub_x, data, DTLS_X25519_KEY_SIZE);
+    data += DTLS_X25519_KEY_SIZE;
+    data_length -= DTLS_X25519_KEY_SIZE;
+  } else {
+    if (data_length < 1 + 1 + 2 * DTLS_EC_KEY_SIZE ||
+	dtls_uint8_to_int(data) != 1 + 2 * DTLS_EC_KEY_SIZE) {
+      dtls_alert("expected 65 bytes long public point\n");
+      return dtls_alert_fatal_create(DTLS_ALERT_HANDSHAKE_FAILURE);
+    }
+    data += sizeof(uint8);
+    data_length -= sizeof(uint8);
+
+    if (dtls_uint8_to_int(data) != 4) {
+      dtls_alert("expected uncompressed public point\n");
+      return dtls_alert_fatal_create(DTLS_ALERT_DECODE_ERROR);
+    }
+    data += sizeof(uint8);
+    data_length -= sizeof(uint8);
 
-  memcpy(config->keyx.ecdsa.other_eph_pub_x, data, sizeof(config->keyx.ecdsa.other_eph_pub_y));
-  data += sizeof(config->keyx.ecdsa.other_eph_pub_y);
-  data_length -= sizeof(config->keyx.ecdsa.other_eph_pub_y);
+    memcpy(config->keyx.ecdsa.other_eph_pub_x, data, sizeof(config->keyx.ecdsa.other_eph_pub_y));
+    data += sizeof(config->keyx.ecdsa.other_eph_pub_y);
+    data_length -= sizeof(config->keyx.ecdsa.other_eph_pub_y);
 
-  memcpy(config->keyx.ecdsa.other_eph_pub_y, data, sizeof(config->keyx.ecdsa.other_eph_pub_y));
-  data += sizeof(config->keyx.ecdsa.other_eph_pub_y);
-  data_length -= sizeof(config->keyx.ecdsa.other_eph_pub_y);
+    memcpy(config->keyx.ecdsa.other_eph_pub_y, data, sizeof(config->keyx.ecdsa.other_eph_pub_y));
+    data += sizeof(config->keyx.ecdsa.other_eph_pub_y);
+    data_length -= sizeof(config->keyx.ecdsa.other_eph_pub_y);
+  }
+  key_params_length = data - key_params;
 
   ret = dtls_check_ecdsa_signature_elem(data, data_length, result_r, result_s);
   if (ret < 0) {
@@ -3196,8 +5053,7 @@ check_server_key_exchange_ecdsa(dtls_context_t *ctx,
 			    sizeof(config->keyx.ecdsa.other_pub_x),
 			    config->tmp.random.client, DTLS_RANDOM_LENGTH,
 			    config->tmp.random.server, DTLS_RANDOM_LENGTH,
-			    key_params,
-			    1 + 2 + 1 + 1 + (2 * DTLS_EC_KEY_SIZE),
+			    key_params, key_params_length,
 			    result_r, result_s);
 
   if (ret < 0) {
@@ -3220,7 +5076,7 @@ check_server_key_exchange_psk(dtls_context_t *ctx,
 
   update_hs_hash(peer, data, data_length);
 
-  assert(is_tls_psk_with_aes_128_ccm_8(config->cipher));
+  assert(is_key_exchange_psk(config->cipher));
 
   data += DTLS_HS_LENGTH;
 
@@ -3264,7 +5120,7 @@ check_certificate_request(dtls_context_t *ctx,
 
   update_hs_hash(peer, data, data_length);
 
-  assert(is_tls_ecdhe_ecdsa_with_aes_128_ccm_8(peer->handshake_params->cipher));
+  assert(is_key_exchange_ecdhe_ecdsa(peer->handshake_params->cipher));
 
   data += DTLS_HS_LENGTH;
 
@@ -3431,7 +5287,7 @@ decrypt_verify(dtls_peer_t *peer, uint8 *packet, size_t length,
   if (security->cipher == TLS_NULL_WITH_NULL_NULL) {
     /* no cipher suite selected */
     return clen;
-  } else { /* TLS_PSK_WITH_AES_128_CCM_8 or TLS_ECDHE_ECDSA_WITH_AES_128_CCM_8 */
+  } else { /* AES_128_CCM_8, AES_128_GCM_SHA256 or CHACHA20_POLY1305_SHA256 */
     /**
      * length of additional_data for the AEAD cipher which consists of
      * seq_num(2+6) + type(1) + version(2) + length(2)
@@ -3443,17 +5299,25 @@ decrypt_verify(dtls_peer_t *peer, uint8 *packet, size_t length,
      * M=<macLen> and L=3. */
     const dtls_ccm_params_t params = { nonce, 8, 3 };
 
-    if (clen < 16)		/* need at least IV and MAC */
+    size_t tag_size = dtls_cipher_tag_size(security->cipher);
+    size_t nonce_explicit = dtls_cipher_explicit_nonce_size(security->cipher);
+
+    if (clen < (int)(nonce_explicit + tag_size))	/* need at least IV and MAC */
       return -1;
 
     memset(nonce, 0, DTLS_CCM_BLOCKSIZE);
     memcpy(nonce, dtls_kb_remote_iv(security, peer->role),
 	   dtls_kb_iv_size(security, peer->role));
 
-    /* read epoch and seq_num from message */
-    memcpy(nonce + dtls_kb_iv_size(security, peer->role), *cleartext, 8);
-    *cleartext += 8;
-    clen -= 8; /* length without nonce_explicit */
+    if (is_chacha20_poly1305(security->cipher)) {
+      /* RFC 7905: the padded sequence number is XORed with the IV */
+      memxor(nonce + 4, DTLS_RECORD_HEADER(packet)->epoch, 8);
+    } else {
+      /* read epoch and seq_num from message */
+      memcpy(nonce + dtls_kb_iv_size(security, peer->role), *cleartext, 8);
+      *cleartext += 8;
+      clen -= 8; /* length without nonce_explicit */
+    }
 
     dtls_debug_dump("nonce", nonce, DTLS_CCM_BLOCKSIZE);
     dtls_debug_dump("key", dtls_kb_remote_write_key(security, peer->role),
@@ -3468,11 +5332,24 @@ decrypt_verify(dtls_peer_t *peer, uint8 *packet, size_t length,
     memcpy(A_DATA, &DTLS_RECORD_HEADER(packet)->epoch, 8); /* epoch and seq_num */
     memcpy(A_DATA + 8,  &DTLS_RECORD_HEADER(packet)->content_type, 3); /* type and version */
 
-    dtls_int_to_uint16(A_DATA + 11, clen - 8); /* length without MAC */
+    dtls_int_to_uint16(A_DATA + 11, clen - tag_size); /* length without MAC */
 
-    clen = dtls_decrypt_params(&params, *cleartext, clen, *cleartext,
-               dtls_kb_remote_write_key(security, peer->role),
-               dtls_kb_key_size(security, peer->role),
+#ifdef DTLS_CHACHA20
+    if (is_chacha20_poly1305(security->cipher))
+      clen = dtls_decrypt_chacha20_poly1305(dtls_kb_remote_write_key(security, peer->role),
+                                            nonce, *cleartext, clen, *cleartext,
+                                            A_DATA, A_DATA_LEN);
+    else
+#endif /* DTLS_CHACHA20 */
+#ifdef DTLS_GCM
+    if (is_aes_128_gcm(security->cipher))
+      clen = dtls_decrypt_gcm_ctx(&security->read_ctx, &security->read_gcm,
+                                  nonce, *cleartext, clen, *cleartext,
+                                  A_DATA, A_DATA_LEN);
+    else
+#endif /* DTLS_GCM */
+    clen = dtls_decrypt_params_ctx(&params, &security->read_ctx,
+               *cleartext, clen, *cleartext,
                A_DATA, A_DATA_LEN);
     if (clen < 0)
       dtls_warn("decryption failed\n");
@@ -3545,6 +5422,17 @@ dtls_renegotiate(dtls_context_t *ctx, const session_t *dst)
 static int
 handle_verified_client_hello(dtls_context_t *ctx, dtls_peer_t *peer,
 		uint8 *data, size_t data_length) {
+#if DTLS_SESSION_CACHE_SIZE
+  dtls_handshake_parameters_t *handshake = peer->handshake_params;
+  dtls_session_cache_entry_t *cached = NULL;
+  const uint8 *master_secret = NULL;
+#endif /* DTLS_SESSION_CACHE_SIZE */
+#if DTLS_SESSION_TICKETS
+  uint8 ticket_secret[DTLS_MASTER_SECRET_LENGTH];
+  dtls_session_identity_t ticket_identity;
+  uint8 *ticket;
+  int ticket_length;
+#endif /* DTLS_SESSION_TICKETS */
 
   clear_hs_hash(peer);
 
@@ -3563,11 +5451,87 @@ handle_verified_client_hello(dtls_context_t *ctx, dtls_peer_t *peer,
   /* update finish MAC */
   update_hs_hash(peer, data, data_length);
 
-  err = dtls_send_server_hello_msgs(ctx, peer);
+#if DTLS_SESSION_TICKETS
+  /* A client that supports tickets gets a ticket instead of an entry
+   * in our session cache. A ticket resumes the session only if the
+   * client has sent a session id to return (RFC 5077, 3.4). */
+  ticket_length = dtls_get_session_ticket(data, data_length, &ticket);
+  if (ticket_length >= 0 && dtls_security_params(peer)->epoch == 0) {
+    handshake->new_session_ticket = 1;
+    if (ticket_length > 0 && handshake->session_id_length) {
+      /* the client must still be accepted as in a full handshake */
+      if (dtls_session_ticket_decrypt(ctx, peer, ticket, ticket_length,
+				      ticket_secret, &ticket_identity) == 0 &&
+	  dtls_session_identity_check(ctx, peer, handshake->cipher,
+				      &ticket_identity) == 0) {
+	ctx->tickets.accepted++;
+	dtls_session_identity_restore(peer, &ticket_identity);
+	master_secret = ticket_secret;
+      } else {
+	ctx->tickets.rejected++;
+	memset(ticket_secret, 0, sizeof(ticket_secret));
+      }
+    }
+  }
+#endif /* DTLS_SESSION_TICKETS */
+
+#if DTLS_SESSION_CACHE_SIZE
+  /* Sessions are resumed in the initial handshake only. The
+   * extended master secret must be used as before (RFC 7627, 5.3). */
+  if (!master_secret && handshake->session_id_length) {
+    cached = dtls_session_cache_find(ctx, DTLS_SERVER, NULL,
+				     handshake->session_id,
+				     handshake->session_id_length);
+    if (cached && (dtls_security_params(peer)->epoch != 0 ||
+		   cached->cipher != handshake->cipher ||
+		   cached->extended_master_secret != handshake->extended_master_secret))
+      cached = NULL;
+
+    /* the peer must still be accepted as in a full handshake */
+    if (cached && dtls_session_identity_check(ctx, peer, cached->cipher,
+					      &cached->identity) < 0) {
+      dtls_debug("identity of the cached session is no longer accepted\n");
+      memset(cached, 0, sizeof(dtls_session_cache_entry_t));
+      cached = NULL;
+    }
+
+    if (cached) {
+      ctx->session_cache.hits++;
+      dtls_session_cache_touch(ctx, cached);
+      /* the client may have a new address */
+      memcpy(&cached->session, &peer->session, sizeof(session_t));
+      dtls_session_identity_restore(peer, &cached->identity);
+      master_secret = cached->master_secret;
+    } else {
+      ctx->session_cache.misses++;
+    }
+  }
+
+  if (master_secret) {
+    handshake->resumed = 1;
+
+    dtls_flight_begin(&ctx->flight, peer);
+    err = dtls_flight_end(ctx, &ctx->flight,
+			  dtls_send_server_hello_abbreviated(ctx, peer,
+							     master_secret));
+#if DTLS_SESSION_TICKETS
+    memset(ticket_secret, 0, sizeof(ticket_secret));
+#endif /* DTLS_SESSION_TICKETS */
+    if (err < 0) {
+      return err;
+    }
+    peer->state = DTLS_STATE_WAIT_CHANGECIPHERSPEC;
+    return err;
+  }
+#endif /* DTLS_SESSION_CACHE_SIZE */
+
+  dtls_flight_begin(&ctx->flight, peer);
+  err = dtls_flight_end(ctx, &ctx->flight,
+			dtls_send_server_hello_msgs(ctx, peer));
   if (err < 0) {
     return err;
   }
-  if (is_tls_ecdhe_ecdsa_with_aes_128_ccm_8(peer->handshake_params->cipher) &&
+  if (is_key_exchange_ecdhe_ecdsa(peer->handshake_params->cipher) &&
 		  is_ecdsa_client_auth_supported(ctx))
     peer->state = DTLS_STATE_WAIT_CLIENTCERTIFICATE;
   else
@@ -3625,7 +5589,11 @@ handle_handshake_msg(dtls_context_t *ctx, dtls_peer_t *peer, uint8 *data, size_t
       dtls_warn("error in check_server_hello err: %i\n", err);
       return err;
     }
-    if (is_tls_ecdhe_ecdsa_with_aes_128_ccm_8(peer->handshake_params->cipher))
+    if (peer->handshake_params->resumed)
+      /* abbreviated handshake, the server continues with CCS, or
+       * NewSessionTicket and CCS */
+      peer->state = DTLS_STATE_WAIT_CHANGECIPHERSPEC;
+    else if (is_key_exchange_ecdhe_ecdsa(peer->handshake_params->cipher))
       peer->state = DTLS_STATE_WAIT_SERVERCERTIFICATE;
     else {
       peer->optional_handshake_message = DTLS_HT_SERVER_KEY_EXCHANGE;
@@ -3635,6 +5603,25 @@ handle_handshake_msg(dtls_context_t *ctx, dtls_peer_t *peer, uint8 *data, size_t
 
     break;
 
+#if DTLS_SESSION_TICKETS
+  case DTLS_HT_NEW_SESSION_TICKET:
+
+    /* sent before the server's ChangeCipherSpec if announced in
+     * the ServerHello */
+    if (role != DTLS_CLIENT || state != DTLS_STATE_WAIT_CHANGECIPHERSPEC ||
+	!peer->handshake_params->new_session_ticket) {
+      return dtls_alert_fatal_create(DTLS_ALERT_UNEXPECTED_MESSAGE);
+    }
+
+    err = check_new_session_ticket(ctx, peer, data, data_length);
+    if (err < 0) {
+      dtls_warn("error in check_new_session_ticket err: %i\n", err);
+      return err;
+    }
+
+    break;
+#endif /* DTLS_SESSION_TICKETS */
+
 #ifdef DTLS_ECC
   case DTLS_HT_CERTIFICATE:
 
@@ -3663,7 +5650,7 @@ handle_handshake_msg(dtls_context_t *ctx, dtls_peer_t *peer, uint8 *data, size_t
     }
 
 #ifdef DTLS_ECC
-    if (is_tls_ecdhe_ecdsa_with_aes_128_ccm_8(peer->handshake_params->cipher)) {
+    if (is_key_exchange_ecdhe_ecdsa(peer->handshake_params->cipher)) {
       if (state != DTLS_STATE_WAIT_SERVERKEYEXCHANGE) {
         return dtls_alert_fatal_create(DTLS_ALERT_UNEXPECTED_MESSAGE);
       }
@@ -3672,7 +5659,7 @@ handle_handshake_msg(dtls_context_t *ctx, dtls_peer_t *peer, uint8 *data, size_t
     }
 #endif /* DTLS_ECC */
 #ifdef DTLS_PSK
-    if (is_tls_psk_with_aes_128_ccm_8(peer->handshake_params->cipher)) {
+    if (is_key_exchange_psk(peer->handshake_params->cipher)) {
       if (state != DTLS_STATE_WAIT_SERVERHELLODONE || peer->optional_handshake_message != DTLS_HT_SERVER_KEY_EXCHANGE) {
         return dtls_alert_fatal_create(DTLS_ALERT_UNEXPECTED_MESSAGE);
       }
@@ -3696,7 +5683,9 @@ handle_handshake_msg(dtls_context_t *ctx, dtls_peer_t *peer, uint8 *data, size_t
       return dtls_alert_fatal_create(DTLS_ALERT_UNEXPECTED_MESSAGE);
     }
 
-    err = check_server_hellodone(ctx, peer, data, data_length);
+    dtls_flight_begin(&ctx->flight, peer);
+    err = dtls_flight_end(ctx, &ctx->flight,
+			  check_server_hellodone(ctx, peer, data, data_length));
     if (err < 0) {
       dtls_warn("error in check_server_hellodone err: %i\n", err);
       return err;
@@ -3711,7 +5700,7 @@ handle_handshake_msg(dtls_context_t *ctx, dtls_peer_t *peer, uint8 *data, size_t
 
     if (state != DTLS_STATE_WAIT_SERVERHELLODONE ||
         peer->optional_handshake_message != DTLS_HT_CERTIFICATE_REQUEST ||
-        !is_tls_ecdhe_ecdsa_with_aes_128_ccm_8(peer->handshake_params->cipher)) {
+        !is_key_exchange_ecdhe_ecdsa(peer->handshake_params->cipher)) {
       return dtls_alert_fatal_create(DTLS_ALERT_UNEXPECTED_MESSAGE);
     }
     peer->optional_handshake_message = DTLS_HT_NO_OPTIONAL_MESSAGE;
@@ -3736,25 +5725,54 @@ handle_handshake_msg(dtls_context_t *ctx, dtls_peer_t *peer, uint8 *data, size_t
       dtls_warn("error in check_finished err: %i\n", err);
       return err;
     }
-    if (role == DTLS_SERVER) {
-      /* send ServerFinished */
+    /* The first Finished is answered by the server in a full
+     * handshake, and by the client in an abbreviated one. */
+    if ((role == DTLS_SERVER) != peer->handshake_params->resumed) {
+      /* send our Finished */
       update_hs_hash(peer, data, data_length);
 
+      dtls_flight_begin(&ctx->flight, peer);
+#if DTLS_SESSION_TICKETS
+      if (role == DTLS_SERVER && peer->handshake_params->new_session_ticket) {
+	err = dtls_send_new_session_ticket(ctx, peer);
+	if (err < 0) {
+	  dtls_warn("cannot send NewSessionTicket message\n");
+	  return dtls_flight_end(ctx, &ctx->flight, err);
+	}
+      }
+#endif /* DTLS_SESSION_TICKETS */
+
       /* send change cipher spec message and switch to new configuration */
       err = dtls_send_ccs(ctx, peer);
       if (err < 0) {
         dtls_warn("cannot send CCS message\n");
-        return err;
+        return dtls_flight_end(ctx, &ctx->flight, err);
       }
 
       dtls_security_params_switch(peer);
 
-      err = dtls_send_finished(ctx, peer, PRF_LABEL(server), PRF_LABEL_SIZE(server));
+      if (role == DTLS_SERVER)
+	err = dtls_send_finished(ctx, peer, PRF_LABEL(server),
+				 PRF_LABEL_SIZE(server));
+      else
+	err = dtls_send_finished(ctx, peer, PRF_LABEL(client),
+				 PRF_LABEL_SIZE(client));
+      err = dtls_flight_end(ctx, &ctx->flight, err);
       if (err < 0) {
-        dtls_warn("sending server Finished failed\n");
+        dtls_warn("sending Finished failed\n");
         return err;
       }
     }
+#if DTLS_SESSION_CACHE_SIZE
+    if (!peer->handshake_params->resumed &&
+	(peer->handshake_params->session_id_length ||
+	 peer->handshake_params->ticket))
+      dtls_session_cache_add(ctx, peer);
+#if DTLS_SESSION_TICKETS
+    else if (peer->handshake_params->ticket)
+      dtls_session_cache_renew_ticket(ctx, peer);
+#endif /* DTLS_SESSION_TICKETS */
+#endif /* DTLS_SESSION_CACHE_SIZE */
     dtls_handshake_free(peer->handshake_params);
     peer->handshake_params = NULL;
     dtls_debug("Handshake complete\n");
@@ -3787,7 +5805,7 @@ handle_handshake_msg(dtls_context_t *ctx, dtls_peer_t *peer, uint8 *data, size_t
            &peer->handshake_params->hs_state.hs_hash,
 	   sizeof(peer->handshake_params->hs_state.ext_hash));
 
-    if (is_tls_ecdhe_ecdsa_with_aes_128_ccm_8(peer->handshake_params->cipher) &&
+    if (is_key_exchange_ecdhe_ecdsa(peer->handshake_params->cipher) &&
 	is_ecdsa_client_auth_supported(ctx))
       peer->state = DTLS_STATE_WAIT_CERTIFICATEVERIFY;
     else
@@ -3970,11 +5988,12 @@ handle_0_verified_client_hello(dtls_context_t *ctx, dtls_ephemeral_peer_t *ephem
  * \param ephemeral_peer   The ephemeral remote peer.
  * \param data             The data to send.
  * \param data_length      The actual length of \p buf.
+ * \param cookie           The precomputed cookie for \p data, or \c NULL.
  * \return Less than zero on error, the number of bytes written otherwise.
  */
 static int
 handle_0_client_hello(dtls_context_t *ctx, dtls_ephemeral_peer_t *ephemeral_peer,
-         uint8 *data, size_t data_length)
+         uint8 *data, size_t data_length, const uint8 *cookie)
 {
   dtls_handshake_header_t *hs_header;
   size_t packet_length;
@@ -3990,7 +6009,8 @@ handle_0_client_hello(dtls_context_t *ctx, dtls_ephemeral_peer_t *ephemeral_peer
   fragment_length = dtls_uint24_to_int(hs_header->fragment_length);
   fragment_offset = dtls_uint24_to_int(hs_header->fragment_offset);
   if (packet_length != fragment_length || fragment_offset != 0) {
-    dtls_warn("No fragment support (yet)\n");
+    /* cannot be reassembled without keeping state */
+    dtls_warn("fragmented ClientHello not supported\n");
     return 0;
   }
   if (fragment_length + DTLS_HS_LENGTH != data_length) {
@@ -3998,7 +6018,7 @@ handle_0_client_hello(dtls_context_t *ctx, dtls_ephemeral_peer_t *ephemeral_peer
     return 0;
   }
   ephemeral_peer->mseq = dtls_uint16_to_int(hs_header->message_seq);
-  err = dtls_0_verify_peer(ctx, ephemeral_peer, data, data_length);
+  err = dtls_0_verify_peer(ctx, ephemeral_peer, data, data_length, cookie);
   if (err < 0) {
     dtls_warn("error in dtls_verify_peer err: %i\n", err);
     return err;
@@ -4016,6 +6036,86 @@ handle_0_client_hello(dtls_context_t *ctx, dtls_ephemeral_peer_t *ephemeral_peer
   return err;
 }
 
+/**
+ * Adds the handshake message fragment @p data to the reassembly
+ * buffer of @p handshake. Only fragments of the next expected message
+ * are collected, together with a bitmap of the bytes received so far.
+ * Fragments of later messages are dropped and recovered when the
+ * peer retransmits its flight.
+ *
+ * @param handshake The handshake parameters of the peer.
+ * @param data      The fragment, starting with its handshake header.
+ * @param message   Set to the reassembled message on completion. The
+ *                  caller must release it with netq_node_free().
+ * @return @c 1 if the message is complete, @c 0 if fragments are
+ *         missing, or less than zero on error.
+ */
+static int
+dtls_reassemble(dtls_handshake_parameters_t *handshake, const uint8 *data,
+		netq_t **message) {
+  const dtls_handshake_header_t *hs_header = DTLS_HANDSHAKE_HEADER(data);
+  size_t length = dtls_uint24_to_int(hs_header->length);
+  size_t offset = dtls_uint24_to_int(hs_header->fragment_offset);
+  size_t fragment_length = dtls_uint24_to_int(hs_header->fragment_length);
+  uint16_t mseq = dtls_uint16_to_int(hs_header->message_seq);
+  netq_t *n = handshake->reassembly;
+  uint8 *bitmap;
+  size_t i;
+
+  if (mseq != handshake->hs_state.mseq_r) {
+    dtls_info("drop fragment of message %u, expected %u\n",
+	      mseq, handshake->hs_state.mseq_r);
+    return 0;
+  }
+
+  if (length > DTLS_MAX_REASSEMBLY) {
+    dtls_warn("fragmented message too large (%zu bytes)\n", length);
+    return dtls_alert_fatal_create(DTLS_ALERT_HANDSHAKE_FAILURE);
+  }
+
+  /* msg_type, length and message_seq must match the buffered message */
+  if (n && memcmp(n->data, data, 6) != 0) {
+    dtls_debug("discard incomplete message %u\n",
+	       dtls_uint16_to_int(DTLS_HANDSHAKE_HEADER(n->data)->message_seq));
+    netq_node_free(n);
+    n = handshake->reassembly = NULL;
+  }
+
+  if (!n) {
+    n = netq_node_new(DTLS_HS_LENGTH + length + (length + 7) / 8);
+    if (!n) {
+      dtls_warn("no space in reassembly buffer\n");
+      return 0;
+    }
+    memcpy(n->data, data, DTLS_HS_LENGTH);
+    dtls_int_to_uint24(DTLS_HANDSHAKE_HEADER(n->data)->fragment_offset, 0);
+    dtls_int_to_uint24(DTLS_HANDSHAKE_HEADER(n->data)->fragment_length, length);
+    n->length = DTLS_HS_LENGTH + length;
+    memset(n->data + n->length, 0, (length + 7) / 8);
+    handshake->reassembly = n;
+  }
+
+  memcpy(n->data + DTLS_HS_LENGTH + offset, data + DTLS_HS_LENGTH,
+	 fragment_length);
+
+  bitmap = n->data + n->length;
+  for (i = offset; i < offset + fragment_length; i++) {
+    bitmap[i >> 3] |= 1 << (i & 7);
+  }
+
+  for (i = 0; i < length; i++) {
+    if (!(bitmap[i >> 3] & (1 << (i & 7)))) {
+      dtls_debug("message %u: got %zu bytes at offset %zu\n",
+		 mseq, fragment_length, offset);
+      return 0;
+    }
+  }
+
+  handshake->reassembly = NULL;
+  *message = n;
+  return 1;
+}
+
 static int
 handle_handshake(dtls_context_t *ctx, dtls_peer_t *peer, uint8 *data, size_t data_length)
 {
@@ -4040,9 +6140,9 @@ handle_handshake(dtls_context_t *ctx, dtls_peer_t *peer, uint8 *data, size_t dat
   packet_length = dtls_uint24_to_int(hs_header->length);
   fragment_length = dtls_uint24_to_int(hs_header->fragment_length);
   fragment_offset = dtls_uint24_to_int(hs_header->fragment_offset);
-  if (packet_length != fragment_length || fragment_offset != 0) {
-    dtls_warn("No fragment support (yet)\n");
-    return dtls_alert_fatal_create(DTLS_ALERT_HANDSHAKE_FAILURE);
+  if (fragment_offset + fragment_length > packet_length) {
+    dtls_warn("Fragment exceeds message length\n");
+    return dtls_alert_fatal_create(DTLS_ALERT_DECODE_ERROR);
   }
   if (fragment_length + DTLS_HS_LENGTH != data_length) {
     dtls_warn("Fragment size does not match packet size\n");
@@ -4059,6 +6159,26 @@ handle_handshake(dtls_context_t *ctx, dtls_peer_t *peer, uint8 *data, size_t dat
       return 0;
     }
   }
+
+  /* A new message of the peer's next flight shows that our last
+   * flight has arrived. */
+  if (dtls_uint16_to_int(hs_header->message_seq) >=
+      peer->handshake_params->hs_state.mseq_r) {
+    dtls_flight_acked(ctx, peer);
+  }
+
+  if (packet_length != fragment_length) {
+    netq_t *message;
+
+    res = dtls_reassemble(peer->handshake_params, data, &message);
+    if (res <= 0)
+      return res;
+
+    /* handle the complete message like an unfragmented one */
+    res = handle_handshake(ctx, peer, message->data, message->length);
+    netq_node_free(message);
+    return res;
+  }
   uint16_t mseq = dtls_uint16_to_int(hs_header->message_seq);
   if (mseq < peer->handshake_params->hs_state.mseq_r) {
     dtls_warn("The message sequence number is too small, expected %i, got: %i\n",
@@ -4165,8 +6285,17 @@ handle_ccs(dtls_context_t *ctx, dtls_peer_t *peer,
   if (data_length != 1 || data[0] != 1)
     return dtls_alert_fatal_create(DTLS_ALERT_DECODE_ERROR);
 
-  /* Just change the cipher when we are on the same epoch */
-  if (peer->role == DTLS_SERVER) {
+  /* The announced NewSessionTicket must come first. If it was lost,
+   * the server sends the whole flight again. */
+  if (peer->role == DTLS_CLIENT &&
+      peer->handshake_params->new_session_ticket) {
+    dtls_warn("ChangeCipherSpec before NewSessionTicket\n");
+    return 0;
+  }
+
+  /* Just change the cipher when we are on the same epoch. In an
+   * abbreviated handshake, the keys are known already. */
+  if (peer->role == DTLS_SERVER && !peer->handshake_params->resumed) {
     err = calculate_key_block(ctx, peer->handshake_params, peer,
 			      &peer->session, peer->role);
     if (err < 0) {
@@ -4214,6 +6343,11 @@ handle_alert(dtls_context_t *ctx, dtls_peer_t *peer,
     else
       dtls_alert("%d invalidate peer\n", data[1]);
 
+#if DTLS_SESSION_CACHE_SIZE
+    if (!close_notify)
+      dtls_session_cache_remove(ctx, peer);
+#endif /* DTLS_SESSION_CACHE_SIZE */
+
     DEL_PEER(ctx->peers, peer);
 
 #ifdef WITH_CONTIKI
@@ -4255,9 +6389,16 @@ static int dtls_alert_send_from_err(dtls_context_t *ctx, dtls_peer_t *peer, int
   if (dtls_is_alert(err)) {
     dtls_alert_level_t level = ((-err) & 0xff00) >> 8;
     dtls_alert_t desc = (-err) & 0xff;
+#if DTLS_SESSION_CACHE_SIZE
+    if (level == DTLS_ALERT_LEVEL_FATAL)
+      dtls_session_cache_remove(ctx, peer);
+#endif /* DTLS_SESSION_CACHE_SIZE */
     peer->state = DTLS_STATE_CLOSING;
     return dtls_send_alert(ctx, peer, level, desc);
   } else if (err == -1) {
+#if DTLS_SESSION_CACHE_SIZE
+    dtls_session_cache_remove(ctx, peer);
+#endif /* DTLS_SESSION_CACHE_SIZE */
     peer->state = DTLS_STATE_CLOSING;
     return dtls_send_alert(ctx, peer, DTLS_ALERT_LEVEL_FATAL, DTLS_ALERT_INTERNAL_ERROR);
   }
@@ -4265,12 +6406,15 @@ static int dtls_alert_send_from_err(dtls_context_t *ctx, dtls_peer_t *peer, int
 }
 
 /**
- * Handles incoming data as DTLS message from given peer.
+ * Handles incoming data as DTLS message from given peer. If \p msg
+ * starts with a ClientHello of epoch 0, \p cookie may hold the cookie
+ * that has already been computed for it.
  */
-int
-dtls_handle_message(dtls_context_t *ctx,
-		    session_t *session,
-		    uint8 *msg, int msglen) {
+static int
+dtls_handle_message_cookie(dtls_context_t *ctx,
+			   session_t *session,
+			   uint8 *msg, int msglen,
+			   const uint8 *cookie) {
   dtls_peer_t *peer = NULL;
   unsigned int rlen;		/* record length */
   uint8 *data; 			/* (decrypted) payload */
@@ -4314,7 +6458,7 @@ dtls_handle_message(dtls_context_t *ctx,
          */
         dtls_info("client_hello epoch 0\n");
         dtls_ephemeral_peer_t ephemeral_peer = {session, dtls_uint48_to_int(header->sequence_number), 0};
-        err = handle_0_client_hello(ctx, &ephemeral_peer, data, data_length);
+        err = handle_0_client_hello(ctx, &ephemeral_peer, data, data_length, cookie);
         if (err < 0) {
           dtls_warn("error while handling handshake packet\n");
         }
@@ -4513,6 +6657,92 @@ dtls_handle_message(dtls_context_t *ctx,
   return 0;
 }
 
+int
+dtls_handle_message(dtls_context_t *ctx,
+		    session_t *session,
+		    uint8 *msg, int msglen) {
+  return dtls_handle_message_cookie(ctx, session, msg, msglen, NULL);
+}
+
+/* maximum number of cookies computed side by side in dtls_handle_many() */
+#ifndef DTLS_HANDLE_MANY_BATCH
+#define DTLS_HANDLE_MANY_BATCH 8
+#endif
+
+#ifdef DTLS_CONSTRAINED_STACK
+static unsigned char handle_many_buf[DTLS_HANDLE_MANY_BATCH][sizeof(session_t) + DTLS_MAX_BUF];
+#endif /* DTLS_CONSTRAINED_STACK */
+
+int
+dtls_handle_many(dtls_context_t *ctx, session_t *sessions[],
+		 uint8 *msgs[], int msglens[], size_t n) {
+#ifndef DTLS_CONSTRAINED_STACK
+  unsigned char handle_many_buf[DTLS_HANDLE_MANY_BATCH][sizeof(session_t) + DTLS_MAX_BUF];
+#endif /* ! DTLS_CONSTRAINED_STACK */
+  unsigned char cookie[DTLS_HANDLE_MANY_BATCH][DTLS_HMAC_DIGEST_SIZE];
+  unsigned char *result[DTLS_HANDLE_MANY_BATCH];
+  const unsigned char *input[DTLS_HANDLE_MANY_BATCH];
+  size_t input_len[DTLS_HANDLE_MANY_BATCH];
+  const uint8 *precomputed[DTLS_HANDLE_MANY_BATCH];
+  size_t prefix_len, tail_offset, tail_len;
+  size_t i = 0, j, k, start;
+  unsigned int rlen;
+  uint8 *data;
+  int res = 0, err;
+
+  while (i < n) {
+#ifdef DTLS_CONSTRAINED_STACK
+    dtls_mutex_lock(&static_mutex);
+#endif /* DTLS_CONSTRAINED_STACK */
+
+    /* collect the ClientHellos of epoch 0 in the next batch, their
+     * cookies are computed in one go */
+    for (start = i, k = 0; i < n && i - start < DTLS_HANDLE_MANY_BATCH; i++) {
+      precomputed[i - start] = NULL;
+      if (msglens[i] < 0 || !(rlen = is_record(msgs[i], msglens[i])))
+	continue;
+      if (dtls_get_content_type(DTLS_RECORD_HEADER(msgs[i])) != DTLS_CT_HANDSHAKE ||
+	  dtls_get_epoch(DTLS_RECORD_HEADER(msgs[i])) != 0 ||
+	  rlen < DTLS_RH_LENGTH + DTLS_HS_LENGTH)
+	continue;
+
+      data = msgs[i] + DTLS_RH_LENGTH;
+      if (DTLS_HANDSHAKE_HEADER(data)->msg_type != DTLS_HT_CLIENT_HELLO ||
+	  dtls_cookie_parts(data, rlen - DTLS_RH_LENGTH,
+			    &prefix_len, &tail_offset, &tail_len) < 0 ||
+	  sessions[i]->size + prefix_len + tail_len > sizeof(handle_many_buf[k]))
+	continue;
+
+      /* same input as in dtls_create_cookie() */
+      memcpy(handle_many_buf[k], &sessions[i]->addr, sessions[i]->size);
+      input_len[k] = sessions[i]->size;
+      memcpy(handle_many_buf[k] + input_len[k], data + DTLS_HS_LENGTH, prefix_len);
+      input_len[k] += prefix_len;
+      memcpy(handle_many_buf[k] + input_len[k], data + tail_offset, tail_len);
+      input_len[k] += tail_len;
+      input[k] = handle_many_buf[k];
+      result[k] = cookie[k];
+      precomputed[i - start] = cookie[k];
+      k++;
+    }
+
+    dtls_hmac_multi(&ctx->cookie_key, input, input_len, k, result);
+
+#ifdef DTLS_CONSTRAINED_STACK
+    dtls_mutex_unlock(&static_mutex);
+#endif /* DTLS_CONSTRAINED_STACK */
+
+    for (j = start; j < i; j++) {
+      err = dtls_handle_message_cookie(ctx, sessions[j], msgs[j], msglens[j],
+				       precomputed[j - start]);
+      if (err < 0 && res == 0)
+	res = err;
+    }
+  }
+
+  return res;
+}
+
 dtls_context_t *
 dtls_new_context(void *app_data) {
   dtls_context_t *c;
@@ -4526,7 +6756,13 @@ dtls_new_context(void *app_data) {
     goto error;
 
   memset(c, 0, sizeof(dtls_context_t));
+#if DTLS_ECDHE_POOL_SIZE || DTLS_ECDSA_SIGN_POOL_SIZE
+  dtls_mutex_init(&c->pool_mutex);
+#endif /* DTLS_ECDHE_POOL_SIZE || DTLS_ECDSA_SIGN_POOL_SIZE */
   c->app = app_data;
+  c->mtu = DTLS_MAX_BUF;
+  dtls_set_retransmit_timeout(c, DTLS_DEFAULT_RTO_INITIAL,
+			      DTLS_DEFAULT_RTO_MIN, DTLS_DEFAULT_RTO_MAX);
 
 #ifdef WITH_CONTIKI
   process_start(&dtls_retransmit_process, (char *)c);
@@ -4541,6 +6777,15 @@ dtls_new_context(void *app_data) {
   else
     goto error;
 
+  dtls_hmac_key_init(&c->cookie_key, c->cookie_secret, DTLS_COOKIE_SECRET_LENGTH);
+
+#if DTLS_ECDHE_POOL_SIZE
+  c->ecdhe_pool.watermark = DTLS_ECDHE_POOL_WATERMARK;
+#endif /* DTLS_ECDHE_POOL_SIZE */
+#if DTLS_ECDSA_SIGN_POOL_SIZE
+  c->ecdsa_sign_pool.watermark = DTLS_ECDSA_SIGN_POOL_WATERMARK;
+#endif /* DTLS_ECDSA_SIGN_POOL_SIZE */
+
   return c;
 
  error:
@@ -4550,6 +6795,321 @@ dtls_new_context(void *app_data) {
   return NULL;
 }
 
+#if DTLS_ECDHE_POOL_SIZE
+/**
+ * Adds up to @p max key pairs for @p curve to the pool of @p ctx, 0
+ * fills the pool of that group completely. Returns the number of keys
+ * added.
+ */
+static size_t
+dtls_ecdhe_pool_fill(dtls_context_t *ctx, dtls_ecdh_curve curve, size_t max) {
+  dtls_ecdhe_key_t batch[DTLS_ECC_BATCH_SIZE];
+  dtls_ecdhe_key_t *keys;
+  size_t *count;
+  size_t added = 0;
+  size_t i, n;
+
+  while (!max || added < max) {
+    dtls_mutex_lock(&ctx->pool_mutex);
+    dtls_ecdhe_pool_keys(ctx, curve, &count);
+    n = DTLS_ECDHE_POOL_SIZE - *count;
+    dtls_mutex_unlock(&ctx->pool_mutex);
+    if (max && n > max - added)
+      n = max - added;
+    if (n > DTLS_ECC_BATCH_SIZE)
+      n = DTLS_ECC_BATCH_SIZE;
+    if (!n)
+      break;
+
+    /* generate without holding the lock, the pool may fill up meanwhile */
+#ifdef DTLS_X25519
+    if (curve == DTLS_ECDH_CURVE_X25519) {
+      for (i = 0; i < n; i++)
+	dtls_x25519_generate_key(batch[i].priv_key, batch[i].pub_key_x);
+    } else
+#endif /* DTLS_X25519 */
+      dtls_ecdsa_generate_key_batch(batch, n);
+
+    dtls_mutex_lock(&ctx->pool_mutex);
+    keys = dtls_ecdhe_pool_keys(ctx, curve, &count);
+    for (i = 0; i < n && *count < DTLS_ECDHE_POOL_SIZE; i++) {
+      keys[(*count)++] = batch[i];
+      ctx->ecdhe_pool.generated++;
+    }
+    dtls_mutex_unlock(&ctx->pool_mutex);
+    added += i;
+    if (i < n)
+      break;
+  }
+  memset(batch, 0, sizeof(batch));
+  return added;
+}
+#endif /* DTLS_ECDHE_POOL_SIZE */
+
+size_t
+dtls_ecdhe_pool_refill(dtls_context_t *ctx, size_t max) {
+#if DTLS_ECDHE_POOL_SIZE
+  size_t added = 0;
+
+#ifdef DTLS_X25519
+  /* x25519 is preferred and its keys are cheap, fill it first */
+  added = dtls_ecdhe_pool_fill(ctx, DTLS_ECDH_CURVE_X25519, max);
+  if (max && added >= max)
+    return added;
+#endif /* DTLS_X25519 */
+  added += dtls_ecdhe_pool_fill(ctx, DTLS_ECDH_CURVE_SECP256R1,
+				max ? max - added : 0);
+  return added;
+#else /* DTLS_ECDHE_POOL_SIZE */
+  (void)ctx;
+  (void)max;
+  return 0;
+#endif /* DTLS_ECDHE_POOL_SIZE */
+}
+
+int
+dtls_ecdhe_pool_needs_refill(dtls_context_t *ctx) {
+#if DTLS_ECDHE_POOL_SIZE
+  int res;
+
+  dtls_mutex_lock(&ctx->pool_mutex);
+  res = ctx->ecdhe_pool.count < ctx->ecdhe_pool.watermark;
+#ifdef DTLS_X25519
+  res = res || ctx->ecdhe_pool.x25519_count < ctx->ecdhe_pool.watermark;
+#endif /* DTLS_X25519 */
+  dtls_mutex_unlock(&ctx->pool_mutex);
+  return res;
+#else /* DTLS_ECDHE_POOL_SIZE */
+  (void)ctx;
+  return 0;
+#endif /* DTLS_ECDHE_POOL_SIZE */
+}
+
+void
+dtls_set_mtu(dtls_context_t *ctx, size_t mtu) {
+  if (mtu < DTLS_MIN_MTU)
+    mtu = DTLS_MIN_MTU;
+  else if (mtu > DTLS_MAX_BUF)
+    mtu = DTLS_MAX_BUF;
+  ctx->mtu = mtu;
+}
+
+void
+dtls_set_retransmit_timeout(dtls_context_t *ctx, clock_time_t initial,
+			    clock_time_t min, clock_time_t max) {
+  if (!min)
+    min = 1;
+  if (max < min)
+    max = min;
+  if (initial < min)
+    initial = min;
+  else if (initial > max)
+    initial = max;
+
+  memset(&ctx->rto, 0, sizeof(dtls_rto_t));
+  ctx->rto.initial = initial;
+  ctx->rto.min = min;
+  ctx->rto.max = max;
+}
+
+void
+dtls_get_retransmit_stats(dtls_context_t *ctx,
+			  dtls_retransmit_stats_t *stats) {
+  stats->flights = ctx->rto.flights;
+  stats->retransmissions = ctx->rto.retransmissions;
+  stats->failures = ctx->rto.failures;
+  stats->samples = ctx->rto.samples;
+}
+
+int
+dtls_get_peer_rtt(dtls_context_t *ctx, const session_t *session,
+		  dtls_rtt_stats_t *stats) {
+  dtls_peer_t *peer = dtls_get_peer(ctx, session);
+
+  memset(stats, 0, sizeof(dtls_rtt_stats_t));
+  if (!peer)
+    return -1;
+  stats->samples = peer->rtt.samples;
+  stats->srtt = peer->rtt.srtt >> 3;
+  stats->rttvar = peer->rtt.rttvar >> 2;
+  stats->rto = dtls_peer_rto(ctx, peer);
+  return 0;
+}
+
+void
+dtls_ecdhe_pool_set_watermark(dtls_context_t *ctx, size_t watermark) {
+#if DTLS_ECDHE_POOL_SIZE
+  dtls_mutex_lock(&ctx->pool_mutex);
+  ctx->ecdhe_pool.watermark = watermark;
+  dtls_mutex_unlock(&ctx->pool_mutex);
+#else /* DTLS_ECDHE_POOL_SIZE */
+  (void)ctx;
+  (void)watermark;
+#endif /* DTLS_ECDHE_POOL_SIZE */
+}
+
+void
+dtls_ecdhe_pool_get_stats(dtls_context_t *ctx,
+			  dtls_pool_stats_t *stats) {
+  memset(stats, 0, sizeof(dtls_pool_stats_t));
+#if DTLS_ECDHE_POOL_SIZE
+  dtls_mutex_lock(&ctx->pool_mutex);
+  stats->available = ctx->ecdhe_pool.count;
+#ifdef DTLS_X25519
+  stats->available += ctx->ecdhe_pool.x25519_count;
+#endif /* DTLS_X25519 */
+  stats->hits = ctx->ecdhe_pool.hits;
+  stats->misses = ctx->ecdhe_pool.misses;
+  stats->generated = ctx->ecdhe_pool.generated;
+  dtls_mutex_unlock(&ctx->pool_mutex);
+#else /* DTLS_ECDHE_POOL_SIZE */
+  (void)ctx;
+#endif /* DTLS_ECDHE_POOL_SIZE */
+}
+
+size_t
+dtls_ecdsa_sign_pool_refill(dtls_context_t *ctx, size_t max) {
+#if DTLS_ECDSA_SIGN_POOL_SIZE
+  dtls_ecdsa_presig_t batch[DTLS_ECC_BATCH_SIZE];
+  size_t added = 0;
+  size_t i, n;
+
+  while (!max || added < max) {
+    dtls_mutex_lock(&ctx->pool_mutex);
+    n = DTLS_ECDSA_SIGN_POOL_SIZE - ctx->ecdsa_sign_pool.count;
+    dtls_mutex_unlock(&ctx->pool_mutex);
+    if (max && n > max - added)
+      n = max - added;
+    if (n > DTLS_ECC_BATCH_SIZE)
+      n = DTLS_ECC_BATCH_SIZE;
+    if (!n)
+      break;
+
+    /* precompute without holding the lock, the pool may fill up meanwhile */
+    dtls_ecdsa_generate_presig_batch(batch, n);
+
+    dtls_mutex_lock(&ctx->pool_mutex);
+    for (i = 0; i < n && ctx->ecdsa_sign_pool.count < DTLS_ECDSA_SIGN_POOL_SIZE; i++) {
+      ctx->ecdsa_sign_pool.presig[ctx->ecdsa_sign_pool.count++] = batch[i];
+      ctx->ecdsa_sign_pool.generated++;
+    }
+    dtls_mutex_unlock(&ctx->pool_mutex);
+    added += i;
+    if (i < n)
+      break;
+  }
+  memset(batch, 0, sizeof(batch));
+  return added;
+#else /* DTLS_ECDSA_SIGN_POOL_SIZE */
+  (void)ctx;
+  (void)max;
+  return 0;
+#endif /* DTLS_ECDSA_SIGN_POOL_SIZE */
+}
+
+int
+dtls_ecdsa_sign_pool_needs_refill(dtls_context_t *ctx) {
+#if DTLS_ECDSA_SIGN_POOL_SIZE
+  int res;
+
+  dtls_mutex_lock(&ctx->pool_mutex);
+  res = ctx->ecdsa_sign_pool.count < ctx->ecdsa_sign_pool.watermark;
+  dtls_mutex_unlock(&ctx->pool_mutex);
+  return res;
+#else /* DTLS_ECDSA_SIGN_POOL_SIZE */
+  (void)ctx;
+  return 0;
+#endif /* DTLS_ECDSA_SIGN_POOL_SIZE */
+}
+
+void
+dtls_ecdsa_sign_pool_set_watermark(dtls_context_t *ctx, size_t watermark) {
+#if DTLS_ECDSA_SIGN_POOL_SIZE
+  dtls_mutex_lock(&ctx->pool_mutex);
+  ctx->ecdsa_sign_pool.watermark = watermark;
+  dtls_mutex_unlock(&ctx->pool_mutex);
+#else /* DTLS_ECDSA_SIGN_POOL_SIZE */
+  (void)ctx;
+  (void)watermark;
+#endif /* DTLS_ECDSA_SIGN_POOL_SIZE */
+}
+
+void
+dtls_ecdsa_sign_pool_get_stats(dtls_context_t *ctx,
+			       dtls_pool_stats_t *stats) {
+  memset(stats, 0, sizeof(dtls_pool_stats_t));
+#if DTLS_ECDSA_SIGN_POOL_SIZE
+  dtls_mutex_lock(&ctx->pool_mutex);
+  stats->available = ctx->ecdsa_sign_pool.count;
+  stats->hits = ctx->ecdsa_sign_pool.hits;
+  stats->misses = ctx->ecdsa_sign_pool.misses;
+  stats->generated = ctx->ecdsa_sign_pool.generated;
+  dtls_mutex_unlock(&ctx->pool_mutex);
+#else /* DTLS_ECDSA_SIGN_POOL_SIZE */
+  (void)ctx;
+#endif /* DTLS_ECDSA_SIGN_POOL_SIZE */
+}
+
+void
+dtls_session_cache_get_stats(dtls_context_t *ctx,
+			     dtls_session_cache_stats_t *stats) {
+  memset(stats, 0, sizeof(dtls_session_cache_stats_t));
+#if DTLS_SESSION_CACHE_SIZE
+  size_t i;
+
+  for (i = 0; i < DTLS_SESSION_CACHE_SIZE; i++) {
+    if (ctx->session_cache.entry[i].id_length)
+      stats->entries++;
+  }
+  stats->hits = ctx->session_cache.hits;
+  stats->misses = ctx->session_cache.misses;
+  stats->evictions = ctx->session_cache.evictions;
+#else /* DTLS_SESSION_CACHE_SIZE */
+  (void)ctx;
+#endif /* DTLS_SESSION_CACHE_SIZE */
+}
+
+void
+dtls_session_cache_flush(dtls_context_t *ctx) {
+#if DTLS_SESSION_CACHE_SIZE
+  memset(ctx->session_cache.entry, 0, sizeof(ctx->session_cache.entry));
+#else /* DTLS_SESSION_CACHE_SIZE */
+  (void)ctx;
+#endif /* DTLS_SESSION_CACHE_SIZE */
+}
+
+int
+dtls_session_ticket_set_key(dtls_context_t *ctx, const uint8 *name,
+			    const uint8 *key) {
+#if DTLS_SESSION_TICKETS
+  dtls_session_tickets_t *tickets = &ctx->tickets;
+
+  if (tickets->current.valid)
+    tickets->previous = tickets->current;
+  tickets->fixed = 1;
+  return dtls_ticket_key_set(&tickets->current, name, key);
+#else /* DTLS_SESSION_TICKETS */
+  (void)ctx;
+  (void)name;
+  (void)key;
+  return -1;
+#endif /* DTLS_SESSION_TICKETS */
+}
+
+void
+dtls_session_ticket_get_stats(dtls_context_t *ctx,
+			      dtls_session_ticket_stats_t *stats) {
+  memset(stats, 0, sizeof(dtls_session_ticket_stats_t));
+#if DTLS_SESSION_TICKETS
+  stats->issued = ctx->tickets.issued;
+  stats->accepted = ctx->tickets.accepted;
+  stats->rejected = ctx->tickets.rejected;
+  stats->rotations = ctx->tickets.rotations;
+#else /* DTLS_SESSION_TICKETS */
+  (void)ctx;
+#endif /* DTLS_SESSION_TICKETS */
+}
+
 void dtls_reset_peer(dtls_context_t *ctx, dtls_peer_t *peer)
 {
   dtls_destroy_peer(ctx, peer, DTLS_DESTROY_CLOSE);
@@ -4573,6 +7133,20 @@ dtls_free_context(dtls_context_t *ctx) {
     }
   }
 
+#if DTLS_ECDHE_POOL_SIZE
+  memset(&ctx->ecdhe_pool, 0, sizeof(dtls_ecdhe_pool_t));
+#endif /* DTLS_ECDHE_POOL_SIZE */
+#if DTLS_ECDSA_SIGN_POOL_SIZE
+  memset(&ctx->ecdsa_sign_pool, 0, sizeof(dtls_ecdsa_sign_pool_t));
+#endif /* DTLS_ECDSA_SIGN_POOL_SIZE */
+#if DTLS_ECDHE_POOL_SIZE || DTLS_ECDSA_SIGN_POOL_SIZE
+  dtls_mutex_destroy(&ctx->pool_mutex);
+#endif /* DTLS_ECDHE_POOL_SIZE || DTLS_ECDSA_SIGN_POOL_SIZE */
+  dtls_session_cache_flush(ctx);
+#if DTLS_SESSION_TICKETS
+  memset(&ctx->tickets, 0, sizeof(dtls_session_tickets_t));
+#endif /* DTLS_SESSION_TICKETS */
+
   free_context(ctx);
 }
 
@@ -4645,76 +7219,88 @@ dtls_connect(dtls_context_t *ctx, const session_t *dst) {
 
 static void
 dtls_retransmit(dtls_context_t *context, netq_t *node) {
+  netq_t *flight = NULL;
+  netq_t *n, *tmp;
+  dtls_tick_t now;
+  clock_time_t timeout;
+  unsigned char i, cnt;
+
   if (!context || !node)
     return;
 
-  /* re-initialize timeout when maximum number of retransmissions are not reached yet */
-  if (node->retransmit_cnt < DTLS_DEFAULT_MAX_RETRANSMIT) {
-#ifndef DTLS_CONSTRAINED_STACK
-      unsigned char sendbuf[DTLS_MAX_BUF];
-#endif /* ! DTLS_CONSTRAINED_STACK */
-      size_t len = sizeof(sendbuf);
-      int err;
-      unsigned char *data = node->data;
-      size_t length = node->length;
-      dtls_tick_t now;
-      dtls_security_parameters_t *security = dtls_security_params_epoch(node->peer, node->epoch);
-
-      if (node->job == TIMEOUT) {
-        if (node->type == DTLS_CT_ALERT) {
-          dtls_debug("** alert times out\n");
-          handle_alert(context, node->peer, NULL, data, length);
-        }
-        netq_node_free(node);
-        return;
-      }
-
-#ifdef DTLS_CONSTRAINED_STACK
-      dtls_mutex_lock(&static_mutex);
-#endif /* DTLS_CONSTRAINED_STACK */
-
-      dtls_ticks(&now);
-      node->retransmit_cnt++;
-      node->t = now + (node->timeout << node->retransmit_cnt);
-      netq_insert_node(&context->sendqueue, node);
-
-      if (node->type == DTLS_CT_HANDSHAKE) {
-        dtls_debug("** retransmit handshake packet of type: %s (%i)\n",
-                   dtls_handshake_type_to_name(DTLS_HANDSHAKE_HEADER(data)->msg_type),
-                   DTLS_HANDSHAKE_HEADER(data)->msg_type);
-      } else {
-        dtls_debug("** retransmit packet\n");
-      }
-
-      err = dtls_prepare_record(node->peer, security, node->type, &data, &length,
-                1, sendbuf, &len);
-      if (err < 0) {
-        dtls_warn("can not retransmit packet, err: %i\n", err);
-        goto return_unlock;
-      }
-      dtls_debug_hexdump("retransmit header", sendbuf, sizeof(dtls_record_header_t));
-      dtls_debug_hexdump("retransmit unencrypted", node->data, node->length);
+  if (node->job == TIMEOUT) {
+    if (node->type == DTLS_CT_ALERT) {
+      dtls_debug("** alert times out\n");
+      handle_alert(context, node->peer, NULL, node->data, node->length);
+    }
+    netq_node_free(node);
+    return;
+  }
 
-      (void)CALL(context, write, &node->peer->session, sendbuf, len);
-return_unlock:
-#ifdef DTLS_CONSTRAINED_STACK
-      dtls_mutex_unlock(&static_mutex);
-#endif /* DTLS_CONSTRAINED_STACK */
+  /* The datagrams of a flight share one timer and are resent together,
+   * see Section 4.2.4 of RFC 6347. */
+  LL_APPEND(flight, node);
+  n = netq_head(&context->sendqueue);
+  while (n) {
+    tmp = n;
+    n = netq_next(n);
+    if (tmp->job == RESEND &&
+	dtls_session_equals(&tmp->peer->session, &node->peer->session)) {
+      netq_remove(&context->sendqueue, tmp);
+      LL_APPEND(flight, tmp);
+    }
+  }
 
-      return;
+  if (node->retransmit_cnt >= DTLS_DEFAULT_MAX_RETRANSMIT) {
+    /* no more retransmissions, remove flight from system */
+    dtls_debug("** removed transaction\n");
+    context->rto.failures++;
+    LL_FOREACH_SAFE(flight, n, tmp) {
+      netq_node_free(n);
+    }
+    return;
   }
 
-  /* no more retransmissions, remove node from system */
+  /* double the timeout for each retransmission */
+  cnt = node->retransmit_cnt + 1;
+  timeout = node->timeout;
+  for (i = 0; i < cnt && timeout < context->rto.max; i++) {
+    timeout <<= 1;
+  }
+  if (timeout > context->rto.max)
+    timeout = context->rto.max;
 
-  dtls_debug("** removed transaction\n");
+  context->rto.retransmissions++;
+  dtls_ticks(&now);
+  LL_FOREACH_SAFE(flight, n, tmp) {
+    n->retransmit_cnt = cnt;
+    n->t = now + timeout;
+    netq_insert_node(&context->sendqueue, n);
+
+    if (n->type == DTLS_CT_HANDSHAKE) {
+      uint8 *data = n->data + DTLS_NETQ_RECORD_LENGTH;
+      dtls_debug("** retransmit handshake packet of type: %s (%i)\n",
+                 dtls_handshake_type_to_name(DTLS_HANDSHAKE_HEADER(data)->msg_type),
+                 DTLS_HANDSHAKE_HEADER(data)->msg_type);
+    } else {
+      dtls_debug("** retransmit packet\n");
+    }
 
-  /* And finally delete the node */
-  netq_node_free(node);
+    if (dtls_send_datagram(context, n) < 0) {
+      dtls_warn("can not retransmit packet\n");
+    }
+  }
 }
 
 static void
 dtls_stop_retransmission(dtls_context_t *context, dtls_peer_t *peer) {
   netq_t *node;
+
+  /* drop the records of an unfinished flight */
+  if (context->flight.peer == peer) {
+    dtls_flight_end(context, &context->flight, -1);
+  }
+
   node = netq_head(&context->sendqueue);
 
   while (node) {
@@ -39,6 +39,7 @@
 
 #include "global.h"
 #include "dtls_time.h"
+#include "dtls_mutex.h"
 
 #ifndef DTLSv12
 #define DTLS_VERSION 0xfeff	/* DTLS v1.1 */
@@ -60,6 +61,11 @@ typedef struct dtls_ecdsa_key_t {
 /** Length of the secret that is used for generating Hello Verify cookies. */
 #define DTLS_COOKIE_SECRET_LENGTH 12
 
+/** Smallest path MTU accepted by dtls_set_mtu(). A datagram must hold
+ * the record and handshake headers, the explicit nonce, the MAC and
+ * some payload. */
+#define DTLS_MIN_MTU 64
+
 struct dtls_context_t;
 
 /**
@@ -211,10 +217,288 @@ typedef struct {
 
 struct netq_t;
 
+/** Number of ECDHE key pairs kept ready per context, 0 disables the pool. */
+#ifdef DTLS_ECC
+#ifndef DTLS_ECDHE_POOL_SIZE
+#if defined(WITH_CONTIKI) || defined(RIOT_VERSION) || defined(WITH_ZEPHYR) || defined(WITH_LMSTAX)
+#define DTLS_ECDHE_POOL_SIZE 0
+#else
+#define DTLS_ECDHE_POOL_SIZE 4
+#endif
+#endif /* DTLS_ECDHE_POOL_SIZE */
+#else /* DTLS_ECC */
+#undef DTLS_ECDHE_POOL_SIZE
+#define DTLS_ECDHE_POOL_SIZE 0
+#endif /* DTLS_ECC */
+
+#ifndef DTLS_ECDHE_POOL_WATERMARK
+/** Default fill level below which dtls_ecdhe_pool_needs_refill() is true. */
+#define DTLS_ECDHE_POOL_WATERMARK ((DTLS_ECDHE_POOL_SIZE + 1) / 2)
+#endif
+
+#if DTLS_ECDHE_POOL_SIZE
+/**
+ * Pool of ECDHE key pairs, filled by dtls_ecdhe_pool_refill(). Each
+ * named group has its own DTLS_ECDHE_POOL_SIZE keys.
+ */
+typedef struct {
+  dtls_ecdhe_key_t key[DTLS_ECDHE_POOL_SIZE]; /**< secp256r1 key pairs */
+  size_t count;			/**< number of unused keys in key */
+#ifdef DTLS_X25519
+  /** x25519 key pairs, the public key is kept in pub_key_x */
+  dtls_ecdhe_key_t x25519[DTLS_ECDHE_POOL_SIZE];
+  size_t x25519_count;		/**< number of unused keys in x25519 */
+#endif /* DTLS_X25519 */
+  size_t watermark;		/**< refill level */
+  unsigned long hits;		/**< handshakes served from the pool */
+  unsigned long misses;		/**< handshakes that had to generate a key */
+  unsigned long generated;	/**< keys added by dtls_ecdhe_pool_refill() */
+} dtls_ecdhe_pool_t;
+#endif /* DTLS_ECDHE_POOL_SIZE */
+
+/** Number of precomputed ECDSA signature nonces kept per context, 0 disables the pool. */
+#ifdef DTLS_ECC
+#ifndef DTLS_ECDSA_SIGN_POOL_SIZE
+#if defined(WITH_CONTIKI) || defined(RIOT_VERSION) || defined(WITH_ZEPHYR) || defined(WITH_LMSTAX)
+#define DTLS_ECDSA_SIGN_POOL_SIZE 0
+#else
+#define DTLS_ECDSA_SIGN_POOL_SIZE 4
+#endif
+#endif /* DTLS_ECDSA_SIGN_POOL_SIZE */
+#else /* DTLS_ECC */
+#undef DTLS_ECDSA_SIGN_POOL_SIZE
+#define DTLS_ECDSA_SIGN_POOL_SIZE 0
+#endif /* DTLS_ECC */
+
+#ifndef DTLS_ECDSA_SIGN_POOL_WATERMARK
+/** Default fill level below which dtls_ecdsa_sign_pool_needs_refill() is true. */
+#define DTLS_ECDSA_SIGN_POOL_WATERMARK ((DTLS_ECDSA_SIGN_POOL_SIZE + 1) / 2)
+#endif
+
+#if DTLS_ECDSA_SIGN_POOL_SIZE
+/** Pool of signature nonces, filled by dtls_ecdsa_sign_pool_refill(). */
+typedef struct {
+  dtls_ecdsa_presig_t presig[DTLS_ECDSA_SIGN_POOL_SIZE];
+  size_t count;			/**< number of unused entries in presig */
+  size_t watermark;		/**< refill level */
+  unsigned long hits;		/**< signatures served from the pool */
+  unsigned long misses;		/**< signatures that had to draw a nonce */
+  unsigned long generated;	/**< entries added by dtls_ecdsa_sign_pool_refill() */
+} dtls_ecdsa_sign_pool_t;
+#endif /* DTLS_ECDSA_SIGN_POOL_SIZE */
+
+/**
+ * Statistics of a precomputation pool, see dtls_ecdhe_pool_get_stats()
+ * and dtls_ecdsa_sign_pool_get_stats().
+ */
+typedef struct {
+  size_t available;		/**< entries ready for use */
+  unsigned long hits;		/**< requests served from the pool */
+  unsigned long misses;		/**< requests computed on the spot */
+  unsigned long generated;	/**< entries added by the refill function */
+} dtls_pool_stats_t;
+
+/** Number of sessions kept for resumption per context, 0 disables resumption. */
+#ifndef DTLS_SESSION_CACHE_SIZE
+#if defined(WITH_CONTIKI) || defined(RIOT_VERSION) || defined(WITH_ZEPHYR) || defined(WITH_LMSTAX)
+#define DTLS_SESSION_CACHE_SIZE 1
+#else
+#define DTLS_SESSION_CACHE_SIZE 16
+#endif
+#endif /* DTLS_SESSION_CACHE_SIZE */
+
+/**
+ * Enables stateless session resumption with session tickets (RFC
+ * 5077). A server sends the state of the session encrypted under its
+ * ticket key to the client instead of keeping it in the session
+ * cache. A client keeps its tickets in the session cache, which must
+ * be enabled for that.
+ */
+#ifndef DTLS_SESSION_TICKETS
+#if defined(WITH_CONTIKI) || defined(RIOT_VERSION) || defined(WITH_ZEPHYR) || defined(WITH_LMSTAX)
+#define DTLS_SESSION_TICKETS 0
+#else
+#define DTLS_SESSION_TICKETS DTLS_SESSION_CACHE_SIZE
+#endif
+#endif /* DTLS_SESSION_TICKETS */
+
+#if DTLS_SESSION_TICKETS && !DTLS_SESSION_CACHE_SIZE
+#error "DTLS_SESSION_TICKETS requires DTLS_SESSION_CACHE_SIZE > 0"
+#endif
+
+#ifndef DTLS_SESSION_TICKET_MAX_LENGTH
+/** Longest ticket a client keeps, longer ones are ignored. */
+#define DTLS_SESSION_TICKET_MAX_LENGTH 256
+#endif /* DTLS_SESSION_TICKET_MAX_LENGTH */
+
+#ifndef DTLS_TICKET_KEY_LIFETIME
+/**
+ * Lifetime of a session ticket, which is sent to the client as the
+ * lifetime hint. Older tickets are rejected, also under a key set
+ * with dtls_session_ticket_set_key(). A generated ticket key is
+ * replaced after this time and still accepted for older tickets
+ * until they expire.
+ */
+#define DTLS_TICKET_KEY_LIFETIME (3600 * CLOCK_SECOND)
+#endif /* DTLS_TICKET_KEY_LIFETIME */
+
+#define DTLS_TICKET_KEY_NAME_LENGTH 16 /**< identifies the key of a ticket */
+#define DTLS_TICKET_KEY_LENGTH 16	/**< AES-128 */
+
+#if DTLS_SESSION_TICKETS
+/** A key that protects the session tickets of a server. */
+typedef struct {
+  uint8 name[DTLS_TICKET_KEY_NAME_LENGTH]; /**< the name sent in the ticket */
+  rijndael_ctx ctx;		/**< key schedule of the AES-CCM key */
+  dtls_tick_t created;		/**< the time the key has been set */
+  unsigned int valid:1;		/**< the key has been set */
+} dtls_ticket_key_t;
+
+/** The ticket keys of a server and their statistics. */
+typedef struct {
+  dtls_ticket_key_t current;	/**< protects new tickets */
+  dtls_ticket_key_t previous;	/**< still accepted for resumption */
+  unsigned int fixed:1;		/**< set by dtls_session_ticket_set_key() */
+  unsigned long issued;		/**< NewSessionTicket messages sent */
+  unsigned long accepted;	/**< tickets that resumed a session */
+  unsigned long rejected;	/**< tickets that could not be used */
+  unsigned long rotations;	/**< keys replaced after DTLS_TICKET_KEY_LIFETIME */
+} dtls_session_tickets_t;
+#endif /* DTLS_SESSION_TICKETS */
+
+/** Statistics of the session tickets, see dtls_session_ticket_get_stats(). */
+typedef struct {
+  unsigned long issued;		/**< NewSessionTicket messages sent */
+  unsigned long accepted;	/**< tickets that resumed a session */
+  unsigned long rejected;	/**< tickets that could not be used */
+  unsigned long rotations;	/**< keys replaced after DTLS_TICKET_KEY_LIFETIME */
+} dtls_session_ticket_stats_t;
+
+#if DTLS_SESSION_CACHE_SIZE
+/** Longest peer identity that is kept with a session. */
+#if DTLS_PSK_MAX_CLIENT_IDENTITY_LEN > 2 * DTLS_EC_KEY_SIZE
+#define DTLS_SESSION_IDENTITY_LENGTH DTLS_PSK_MAX_CLIENT_IDENTITY_LEN
+#else
+#define DTLS_SESSION_IDENTITY_LENGTH (2 * DTLS_EC_KEY_SIZE)
+#endif
+
+/**
+ * The identity that the peer of a session has been authenticated
+ * with: the PSK identity, or the x and y coordinates of the peer's
+ * ECDSA key. It is checked again before the session is resumed.
+ */
+typedef struct {
+  uint16_t length;		/**< length of data, 0 if the peer has not
+				 *   been authenticated */
+  uint8 data[DTLS_SESSION_IDENTITY_LENGTH]; /**< the identity */
+} dtls_session_identity_t;
+
+/**
+ * A session that can be resumed with an abbreviated handshake. A
+ * server looks its sessions up by id, a client by the address of the
+ * server.
+ */
+typedef struct {
+  session_t session;		/**< address of the peer */
+  dtls_peer_type role;		/**< our role in the session */
+  uint8 id_length;		/**< length of id, 0 if the entry is unused */
+  uint8 id[DTLS_SESSION_ID_LENGTH]; /**< the session id */
+  uint8 master_secret[DTLS_MASTER_SECRET_LENGTH]; /**< the session's master secret */
+  dtls_cipher_t cipher;		/**< the negotiated cipher suite */
+  unsigned int extended_master_secret:1; /**< RFC 7627 master secret */
+  dtls_session_identity_t identity; /**< the identity of the peer */
+  unsigned long last_used;	/**< value of the cache clock at the last use */
+#if DTLS_SESSION_TICKETS
+  uint16_t ticket_length;	/**< length of ticket, 0 if there is none */
+  /** the ticket that a client presents to resume the session */
+  uint8 ticket[DTLS_SESSION_TICKET_MAX_LENGTH];
+#endif /* DTLS_SESSION_TICKETS */
+} dtls_session_cache_entry_t;
+
+/** Resumable sessions, the least recently used one is replaced first. */
+typedef struct {
+  dtls_session_cache_entry_t entry[DTLS_SESSION_CACHE_SIZE];
+  unsigned long clock;		/**< counts the uses of entries */
+  unsigned long hits;		/**< handshakes that resumed a session */
+  unsigned long misses;		/**< offered sessions that were not resumed */
+  unsigned long evictions;	/**< sessions replaced by newer ones */
+} dtls_session_cache_t;
+#endif /* DTLS_SESSION_CACHE_SIZE */
+
+/** Statistics of the session cache, see dtls_session_cache_get_stats(). */
+typedef struct {
+  size_t entries;		/**< sessions in the cache */
+  unsigned long hits;		/**< handshakes that resumed a session */
+  unsigned long misses;		/**< offered sessions that were not resumed */
+  unsigned long evictions;	/**< sessions replaced by newer ones */
+} dtls_session_cache_stats_t;
+
+/**
+ * The handshake flight that is currently sent to a peer. Consecutive
+ * handshake and ChangeCipherSpec records are packed into one datagram
+ * until the next record does not fit into the path MTU.
+ */
+typedef struct {
+  dtls_peer_t *peer;		/**< receiver of the flight, or NULL */
+  struct netq_t *node;		/**< the records of the datagram not sent yet */
+  size_t length;		/**< encrypted size of that datagram */
+} dtls_flight_t;
+
+#ifndef DTLS_DEFAULT_RTO_INITIAL
+/** Retransmission timeout before a round trip has been measured. */
+#define DTLS_DEFAULT_RTO_INITIAL (2 * CLOCK_SECOND)
+#endif /* DTLS_DEFAULT_RTO_INITIAL */
+
+#ifndef DTLS_DEFAULT_RTO_MIN
+/** Lower bound of the retransmission timeout. */
+#define DTLS_DEFAULT_RTO_MIN (CLOCK_SECOND / 4)
+#endif /* DTLS_DEFAULT_RTO_MIN */
+
+#ifndef DTLS_DEFAULT_RTO_MAX
+/** Upper bound of the retransmission timeout, also for the backoff. */
+#define DTLS_DEFAULT_RTO_MAX (60 * CLOCK_SECOND)
+#endif /* DTLS_DEFAULT_RTO_MAX */
+
+/** Statistics of the handshake flight retransmissions. */
+typedef struct {
+  unsigned long flights;	/**< flights sent */
+  unsigned long retransmissions; /**< flights resent after a timeout */
+  unsigned long failures;	/**< flights given up after
+				     DTLS_DEFAULT_MAX_RETRANSMIT retransmissions */
+  unsigned long samples;	/**< round trips measured */
+} dtls_retransmit_stats_t;
+
+/** Round-trip estimate of one peer, see dtls_get_peer_rtt(). */
+typedef struct {
+  unsigned long samples;	/**< round trips measured */
+  clock_time_t srtt;		/**< smoothed round-trip time */
+  clock_time_t rttvar;		/**< round-trip time variation */
+  clock_time_t rto;		/**< retransmission timeout of the next flight */
+} dtls_rtt_stats_t;
+
+/**
+ * Configures the retransmission timeout of handshake flights. The
+ * timeout is estimated per peer from the round trips of its flights
+ * as described in RFC 6298, see dtls_peer_rtt_t. A round trip is the
+ * time from sending a flight until the first message of the peer's
+ * next flight arrives. Flights that were retransmitted are not
+ * measured.
+ */
+typedef struct {
+  clock_time_t initial;		/**< timeout without a measured round trip */
+  clock_time_t min;		/**< lower bound of the timeout */
+  clock_time_t max;		/**< upper bound of the timeout */
+  unsigned long flights;	/**< flights sent */
+  unsigned long retransmissions; /**< flights resent after a timeout */
+  unsigned long failures;	/**< flights given up */
+  unsigned long samples;	/**< round trips measured */
+} dtls_rto_t;
+
 /** Holds global information of the DTLS engine. */
 typedef struct dtls_context_t {
   unsigned char cookie_secret[DTLS_COOKIE_SECRET_LENGTH];
   clock_time_t cookie_secret_age; /**< the time the secret has been generated */
+  dtls_hmac_key_t cookie_key;	/**< HMAC key prepared from cookie_secret */
 
   dtls_peer_t *peers;		/**< peer hash map */
 #ifdef WITH_CONTIKI
@@ -222,10 +506,30 @@ typedef struct dtls_context_t {
 #endif /* WITH_CONTIKI */
 
   struct netq_t *sendqueue;     /**< the packets to send */
+  dtls_flight_t flight;		/**< the handshake flight in progress */
+  size_t mtu;			/**< largest datagram to send, see dtls_set_mtu() */
+  dtls_rto_t rto;		/**< retransmission timeout bounds and statistics */
 
   void *app;			/**< application-specific data */
 
   dtls_handler_t *h;		/**< callback handlers */
+
+#if DTLS_ECDHE_POOL_SIZE || DTLS_ECDSA_SIGN_POOL_SIZE
+  /** protects the pools, which may be refilled from another thread */
+  dtls_mutex_t pool_mutex;
+#endif /* DTLS_ECDHE_POOL_SIZE || DTLS_ECDSA_SIGN_POOL_SIZE */
+#if DTLS_ECDHE_POOL_SIZE
+  dtls_ecdhe_pool_t ecdhe_pool;	/**< pre-generated ECDHE key pairs */
+#endif /* DTLS_ECDHE_POOL_SIZE */
+#if DTLS_ECDSA_SIGN_POOL_SIZE
+  dtls_ecdsa_sign_pool_t ecdsa_sign_pool; /**< precomputed signature nonces */
+#endif /* DTLS_ECDSA_SIGN_POOL_SIZE */
+#if DTLS_SESSION_CACHE_SIZE
+  dtls_session_cache_t session_cache; /**< sessions for resumption */
+#endif /* DTLS_SESSION_CACHE_SIZE */
+#if DTLS_SESSION_TICKETS
+  dtls_session_tickets_t tickets; /**< ticket keys of a server */
+#endif /* DTLS_SESSION_TICKETS */
 } dtls_context_t;
 
 /** 
@@ -242,6 +546,106 @@ dtls_context_t *dtls_new_context(void *app_data);
 /** Releases any storage that has been allocated for \p ctx. */
 void dtls_free_context(dtls_context_t *ctx);
 
+/**
+ * Generates ephemeral ECDHE key pairs for the key pool of @p ctx, so
+ * that ServerKeyExchange and ClientKeyExchange need not wait for the
+ * key generation. Each key is handed out only once. This should be
+ * called when the application is idle, e.g. whenever
+ * dtls_ecdhe_pool_needs_refill() is true, and may also be called from
+ * a helper thread. x25519 keys are generated first, then secp256r1
+ * keys in batches of up to DTLS_ECC_BATCH_SIZE, which share the field
+ * inversions. Only keys that have been taken are replaced, so a group
+ * that is never negotiated costs no work after the first fill.
+ *
+ * @param ctx The DTLS context.
+ * @param max The maximum number of keys to generate, 0 to fill the
+ *            pool completely. A small value bounds the time a call
+ *            takes, so that a handshake arriving in the meantime is
+ *            not held up for long. tests/handshake-bench measures the
+ *            effect on handshake latency and throughput.
+ * @return The number of keys added.
+ */
+size_t dtls_ecdhe_pool_refill(dtls_context_t *ctx, size_t max);
+
+/**
+ * Returns 1 if the ECDHE key pool of @p ctx has fewer keys of any group
+ * than its watermark, 0 otherwise or if the pool is disabled.
+ */
+int dtls_ecdhe_pool_needs_refill(dtls_context_t *ctx);
+
+/**
+ * Sets the fill level below which dtls_ecdhe_pool_needs_refill()
+ * returns 1. The default is DTLS_ECDHE_POOL_WATERMARK.
+ */
+void dtls_ecdhe_pool_set_watermark(dtls_context_t *ctx, size_t watermark);
+
+/** Copies the statistics of the ECDHE key pool of @p ctx to @p stats. */
+void dtls_ecdhe_pool_get_stats(dtls_context_t *ctx,
+			       dtls_pool_stats_t *stats);
+
+/**
+ * Precomputes the message independent part of ECDSA signatures (the
+ * nonce k, its inverse and r) for the signature pool of @p ctx, so
+ * that ServerKeyExchange and CertificateVerify only have to finish the
+ * signature. Each entry is used for one signature only and is wiped
+ * afterwards. Like dtls_ecdhe_pool_refill(), this should be called
+ * when the application is idle and works in batches of up to
+ * DTLS_ECC_BATCH_SIZE entries.
+ *
+ * @param ctx The DTLS context.
+ * @param max The maximum number of entries to compute, 0 to fill the
+ *            pool completely.
+ * @return The number of entries added.
+ */
+size_t dtls_ecdsa_sign_pool_refill(dtls_context_t *ctx, size_t max);
+
+/**
+ * Returns 1 if the signature pool of @p ctx has fewer entries than its
+ * watermark, 0 otherwise or if the pool is disabled.
+ */
+int dtls_ecdsa_sign_pool_needs_refill(dtls_context_t *ctx);
+
+/**
+ * Sets the fill level below which dtls_ecdsa_sign_pool_needs_refill()
+ * returns 1. The default is DTLS_ECDSA_SIGN_POOL_WATERMARK.
+ */
+void dtls_ecdsa_sign_pool_set_watermark(dtls_context_t *ctx, size_t watermark);
+
+/** Copies the statistics of the signature pool of @p ctx to @p stats. */
+void dtls_ecdsa_sign_pool_get_stats(dtls_context_t *ctx,
+				    dtls_pool_stats_t *stats);
+
+/** Copies the statistics of the session cache of @p ctx to @p stats. */
+void dtls_session_cache_get_stats(dtls_context_t *ctx,
+				  dtls_session_cache_stats_t *stats);
+
+/**
+ * Removes all sessions from the cache of @p ctx. The next handshake
+ * with any peer will be a full handshake.
+ */
+void dtls_session_cache_flush(dtls_context_t *ctx);
+
+/**
+ * Sets the key that protects the session tickets issued by @p ctx.
+ * Servers that share this key accept each other's tickets. The key
+ * that was used before is still accepted until the next call. Once a
+ * key has been set, it is no longer replaced automatically after
+ * DTLS_TICKET_KEY_LIFETIME, the application must set a new one
+ * instead. Tickets still expire after DTLS_TICKET_KEY_LIFETIME, so
+ * the clocks of servers that share a key must be synchronized.
+ *
+ * @param ctx  The DTLS context.
+ * @param name The name of the key, DTLS_TICKET_KEY_NAME_LENGTH bytes.
+ * @param key  The AES key, DTLS_TICKET_KEY_LENGTH bytes.
+ * @return @c 0 on success, less than zero if tickets are disabled.
+ */
+int dtls_session_ticket_set_key(dtls_context_t *ctx, const uint8 *name,
+				const uint8 *key);
+
+/** Copies the statistics of the session tickets of @p ctx to @p stats. */
+void dtls_session_ticket_get_stats(dtls_context_t *ctx,
+				   dtls_session_ticket_stats_t *stats);
+
 #define dtls_set_app_data(CTX,DATA) ((CTX)->app = (DATA))
 #define dtls_get_app_data(CTX) ((CTX)->app)
 
@@ -250,6 +654,48 @@ static inline void dtls_set_handler(dtls_context_t *ctx, dtls_handler_t *h) {
   ctx->h = h;
 }
 
+/**
+ * Sets the path MTU for @p ctx, i.e. the size of the largest datagram
+ * that is sent. Handshake messages that do not fit are fragmented,
+ * except for the ClientHello. The value is limited to the range DTLS_MIN_MTU to DTLS_MAX_BUF,
+ * the latter being the default.
+ *
+ * @param ctx The DTLS context to configure.
+ * @param mtu The maximum datagram size in bytes.
+ */
+void dtls_set_mtu(dtls_context_t *ctx, size_t mtu);
+
+/**
+ * Configures the retransmission timeout of handshake flights for
+ * @p ctx. The timeout starts at @p initial and follows the measured
+ * round trips within @p min and @p max. Each retransmission of a
+ * flight doubles its timeout up to @p max. All values are given in
+ * clock ticks, i.e. CLOCK_SECOND per second. Calling this function
+ * resets the statistics. Peers keep the round trips measured so far,
+ * but their timeouts are limited to the new bounds.
+ *
+ * @param ctx     The DTLS context to configure.
+ * @param initial The timeout before a round trip is measured,
+ *                DTLS_DEFAULT_RTO_INITIAL by default.
+ * @param min     The lower bound, DTLS_DEFAULT_RTO_MIN by default.
+ * @param max     The upper bound, DTLS_DEFAULT_RTO_MAX by default.
+ */
+void dtls_set_retransmit_timeout(dtls_context_t *ctx, clock_time_t initial,
+				 clock_time_t min, clock_time_t max);
+
+/** Copies the retransmission statistics of @p ctx to @p stats. */
+void dtls_get_retransmit_stats(dtls_context_t *ctx,
+			       dtls_retransmit_stats_t *stats);
+
+/**
+ * Copies the round-trip estimate of the peer at @p session to
+ * @p stats.
+ *
+ * @return @c 0 on success, less than zero if there is no such peer.
+ */
+int dtls_get_peer_rtt(dtls_context_t *ctx, const session_t *session,
+		      dtls_rtt_stats_t *stats);
+
 /**
  * Establishes a DTLS channel with the specified remote peer @p dst.
  * This function returns @c 0 if that channel already exists, a value
@@ -323,6 +769,25 @@ int dtls_writev(struct dtls_context_t *ctx,
 int dtls_write(struct dtls_context_t *ctx, session_t *session,
 	       uint8 *buf, size_t len);
 
+/**
+ * Writes the application data given in @p buf to each of the @p n
+ * peers specified by @p sessions. The records for up to eight peers
+ * are encrypted side by side, each with the key of its peer, and are
+ * then handed to the write callback one after another. Peers that
+ * are not connected are skipped.
+ *
+ * @param ctx      The DTLS context to use.
+ * @param sessions The remote transport addresses and local interfaces.
+ * @param n        The number of entries in @p sessions.
+ * @param buf      The data to write.
+ * @param len      The actual length of @p buf.
+ *
+ * @return The number of peers the data was written to, or a value
+ *         less than zero on error.
+ */
+int dtls_write_many(struct dtls_context_t *ctx, session_t *sessions[],
+		    size_t n, uint8 *buf, size_t len);
+
 /**
  * Checks sendqueue of given DTLS context object for any outstanding
  * packets to be transmitted. 
@@ -357,6 +822,7 @@ typedef struct __attribute__((__packed__)) {
 #define DTLS_HT_CLIENT_HELLO         1
 #define DTLS_HT_SERVER_HELLO         2
 #define DTLS_HT_HELLO_VERIFY_REQUEST 3
+#define DTLS_HT_NEW_SESSION_TICKET   4
 #define DTLS_HT_CERTIFICATE         11
 #define DTLS_HT_SERVER_KEY_EXCHANGE 12
 #define DTLS_HT_CERTIFICATE_REQUEST 13
@@ -422,6 +888,24 @@ int dtls_record_read(dtls_state_t *state, uint8 *msg, int msglen);
 int dtls_handle_message(dtls_context_t *ctx, session_t *session,
 			uint8 *msg, int msglen);
 
+/**
+ * Handles the @p n datagrams in @p msgs as if dtls_handle_message()
+ * had been called for each of them in turn. The cookies of initial
+ * ClientHellos are computed for up to eight datagrams at once, so
+ * that a server can verify them, or answer them with a
+ * HelloVerifyRequest, for a whole receive batch in one pass.
+ *
+ * @param ctx      The dtls context to use.
+ * @param sessions The sessions the datagrams were received from.
+ * @param msgs     The received datagrams.
+ * @param msglens  The actual lengths of the datagrams in @p msgs.
+ * @param n        The number of datagrams.
+ * @return The first value less than zero returned for a datagram, or
+ *         zero if all datagrams were handled successfully.
+ */
+int dtls_handle_many(dtls_context_t *ctx, session_t *sessions[],
+		     uint8 *msgs[], int msglens[], size_t n);
+
 /**
  * Check if @p session is associated with a peer object in @p context.
  * This function returns a pointer to the peer if found, NULL otherwise.
@@ -31,6 +31,8 @@ typedef mutex_t dtls_mutex_t;
 #define dtls_mutex_lock(a) mutex_lock(a)
 #define dtls_mutex_trylock(a) mutex_trylock(a)
 #define dtls_mutex_unlock(a) mutex_unlock(a)
+#define dtls_mutex_init(a) mutex_init(a)
+#define dtls_mutex_destroy(a) ((void)(a))
 
 #elif defined(WITH_CONTIKI)
 
@@ -41,6 +43,8 @@ typedef int dtls_mutex_t;
 #define dtls_mutex_lock(a) *(a) = 1
 #define dtls_mutex_trylock(a) *(a) = 1
 #define dtls_mutex_unlock(a) *(a) = 0
+#define dtls_mutex_init(a) *(a) = 0
+#define dtls_mutex_destroy(a) ((void)(a))
 
 #elif defined(WITH_ZEPHYR)
 
@@ -51,6 +55,8 @@ typedef int dtls_mutex_t;
 #define dtls_mutex_lock(a) *(a) = 1
 #define dtls_mutex_trylock(a) *(a) = 1
 #define dtls_mutex_unlock(a) *(a) = 0
+#define dtls_mutex_init(a) *(a) = 0
+#define dtls_mutex_destroy(a) ((void)(a))
 
 #elif defined(WITH_LMSTAX)
 
@@ -61,6 +67,8 @@ typedef int dtls_mutex_t;
 #define dtls_mutex_lock(a) *(a) = 1
 #define dtls_mutex_trylock(a) *(a) = 1
 #define dtls_mutex_unlock(a) *(a) = 0
+#define dtls_mutex_init(a) *(a) = 0
+#define dtls_mutex_destroy(a) ((void)(a))
 
 #else /* ! RIOT_VERSION && ! WITH_CONTIKI && ! WITH_ZEPHYR && ! WITH_LMSTAX*/
 
@@ -71,6 +79,8 @@ typedef pthread_mutex_t dtls_mutex_t;
 #define dtls_mutex_lock(a) pthread_mutex_lock(a)
 #define dtls_mutex_trylock(a) pthread_mutex_trylock(a)
 #define dtls_mutex_unlock(a) pthread_mutex_unlock(a)
+#define dtls_mutex_init(a) pthread_mutex_init(a, NULL)
+#define dtls_mutex_destroy(a) pthread_mutex_destroy(a)
 
 #endif /* ! RIOT_VERSION && ! WITH_CONTIKI */
 
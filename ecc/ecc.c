@@ -154,103 +154,143 @@ static int fieldSub(const uint32_t *x, const uint32_t *y, const uint32_t *modulu
 	return 0;
 }
 
+#ifdef ECC_64BIT_LIMBS
+__extension__ typedef unsigned __int128 uint128_t;
+
+static void load64(const uint32_t *x, uint64_t *r){
+	uint8_t n;
+	for (n = 0; n < 4; n++)
+		r[n] = x[2 * n] | ((uint64_t)x[2 * n + 1] << 32);
+}
+
+static void store64(const uint64_t *x, uint32_t *r){
+	uint8_t n;
+	for (n = 0; n < 8; n++){
+		r[2 * n] = (uint32_t)x[n];
+		r[2 * n + 1] = (uint32_t)(x[n] >> 32);
+	}
+}
+
+//4x64bit * 4x64bit = 8x64bit
+static void mult256(const uint64_t *x, const uint64_t *y, uint64_t *result){
+	uint128_t l;
+	uint64_t carry;
+	uint8_t k, n;
+	memset(result, 0, 8 * sizeof(uint64_t));
+	for (k = 0; k < 4; k++){
+		carry = 0;
+		for (n = 0; n < 4; n++){
+			l = (uint128_t)x[n] * y[k] + result[n + k] + carry;
+			result[n + k] = (uint64_t)l;
+			carry = (uint64_t)(l >> 64);
+		}
+		result[k + 4] = carry;
+	}
+}
+
+//x^2, computes the cross products only once
+static void square256(const uint64_t *x, uint64_t *result){
+	uint128_t l;
+	uint64_t carry;
+	uint8_t k, n;
+	memset(result, 0, 8 * sizeof(uint64_t));
+	for (k = 0; k < 3; k++){
+		carry = 0;
+		for (n = k + 1; n < 4; n++){
+			l = (uint128_t)x[n] * x[k] + result[n + k] + carry;
+			result[n + k] = (uint64_t)l;
+			carry = (uint64_t)(l >> 64);
+		}
+		result[k + 4] = carry;
+	}
+	for (n = 7; n > 0; n--)
+		result[n] = (result[n] << 1) | (result[n - 1] >> 63);
+	carry = 0;
+	for (k = 0; k < 4; k++){
+		l = (uint128_t)x[k] * x[k] + result[2 * k] + carry;
+		result[2 * k] = (uint64_t)l;
+		l = (uint128_t)result[2 * k + 1] + (uint64_t)(l >> 64);
+		result[2 * k + 1] = (uint64_t)l;
+		carry = (uint64_t)(l >> 64);
+	}
+}
+#endif /* ECC_64BIT_LIMBS */
+
 //finite Field multiplication
 //32bit * 32bit = 64bit
 static int fieldMult(const uint32_t *x, const uint32_t *y, uint32_t *result, uint8_t length){
-	uint32_t temp[length * 2];
-	setZero(temp, length * 2);
-	setZero(result, length * 2);
 	uint8_t k, n;
 	uint64_t l;
+	uint32_t carry;
+#ifdef ECC_64BIT_LIMBS
+	if (length == arrayLength){
+		uint64_t x64[4], y64[4], r64[8];
+		load64(x, x64);
+		load64(y, y64);
+		mult256(x64, y64, r64);
+		store64(r64, result);
+		return 0;
+	}
+#endif /* ECC_64BIT_LIMBS */
+	setZero(result, length * 2);
 	for (k = 0; k < length; k++){
-		for (n = 0; n < length; n++){ 
-			l = (uint64_t)x[n]*(uint64_t)y[k];
-			temp[n+k] = l&0xFFFFFFFF;
-			temp[n+k+1] = l>>32;
-			add(&temp[n+k], &result[n+k], &result[n+k], (length * 2) - (n + k));
-
-			setZero(temp, length * 2);
+		carry = 0;
+		for (n = 0; n < length; n++){
+			l = (uint64_t)x[n]*(uint64_t)y[k] + result[n+k] + carry;
+			result[n+k] = l&0xFFFFFFFF;
+			carry = l>>32;
 		}
+		result[k+length] = carry;
 	}
 	return 0;
 }
 
-//TODO: maximum:
-//fffffffe00000002fffffffe0000000100000001fffffffe00000001fffffffe00000001fffffffefffffffffffffffffffffffe000000000000000000000001_16
+/*
+ * NIST fast reduction of the 512 bit B with one signed 64 bit accumulator
+ * per 32 bit word of the result, T + 2*S1 + 2*S2 + S3 + S4 - D1 - D2 - D3
+ * - D4 in a single pass. The remaining carry is folded back in with
+ * 2^256 = 2^224 - 2^192 - 2^96 + 1 mod p. Works for any 512 bit input.
+ */
 static void fieldModP(uint32_t *A, const uint32_t *B)
 {
+	int64_t t[8];
+	int64_t carry;
 	uint32_t tempm[8];
-	uint32_t tempm2[8];
 	uint8_t n;
-	setZero(tempm, 8);
-	setZero(tempm2, 8);
-	/* A = T */ 
-	copy(B,A,arrayLength);
-
-	/* Form S1 */ 
-	for(n=0;n<3;n++) tempm[n]=0; 
-	for(n=3;n<8;n++) tempm[n]=B[n+8];
-
-	/* tempm2=T+S1 */ 
-	fieldAdd(A,tempm,ecc_prime_r,tempm2);
-	/* A=T+S1+S1 */ 
-	fieldAdd(tempm2,tempm,ecc_prime_r,A);
-	/* Form S2 */ 
-	for(n=0;n<3;n++) tempm[n]=0; 
-	for(n=3;n<7;n++) tempm[n]=B[n+9]; 
-	for(n=7;n<8;n++) tempm[n]=0;
-	/* tempm2=T+S1+S1+S2 */ 
-	fieldAdd(A,tempm,ecc_prime_r,tempm2);
-	/* A=T+S1+S1+S2+S2 */ 
-	fieldAdd(tempm2,tempm,ecc_prime_r,A);
-	/* Form S3 */ 
-	for(n=0;n<3;n++) tempm[n]=B[n+8]; 
-	for(n=3;n<6;n++) tempm[n]=0; 
-	for(n=6;n<8;n++) tempm[n]=B[n+8];
-	/* tempm2=T+S1+S1+S2+S2+S3 */ 
-	fieldAdd(A,tempm,ecc_prime_r,tempm2);
-	/* Form S4 */ 
-	for(n=0;n<3;n++) tempm[n]=B[n+9]; 
-	for(n=3;n<6;n++) tempm[n]=B[n+10]; 
-	for(n=6;n<7;n++) tempm[n]=B[n+7]; 
-	for(n=7;n<8;n++) tempm[n]=B[n+1];
-	/* A=T+S1+S1+S2+S2+S3+S4 */ 
-	fieldAdd(tempm2,tempm,ecc_prime_r,A);
-	/* Form D1 */ 
-	for(n=0;n<3;n++) tempm[n]=B[n+11]; 
-	for(n=3;n<6;n++) tempm[n]=0; 
-	for(n=6;n<7;n++) tempm[n]=B[n+2]; 
-	for(n=7;n<8;n++) tempm[n]=B[n+3];
-	/* tempm2=T+S1+S1+S2+S2+S3+S4-D1 */ 
-	fieldSub(A,tempm,ecc_prime_m,tempm2);
-	/* Form D2 */ 
-	for(n=0;n<4;n++) tempm[n]=B[n+12]; 
-	for(n=4;n<6;n++) tempm[n]=0; 
-	for(n=6;n<7;n++) tempm[n]=B[n+3]; 
-	for(n=7;n<8;n++) tempm[n]=B[n+4];
-	/* A=T+S1+S1+S2+S2+S3+S4-D1-D2 */ 
-	fieldSub(tempm2,tempm,ecc_prime_m,A);
-	/* Form D3 */ 
-	for(n=0;n<3;n++) tempm[n]=B[n+13]; 
-	for(n=3;n<6;n++) tempm[n]=B[n+5]; 
-	for(n=6;n<7;n++) tempm[n]=0; 
-	for(n=7;n<8;n++) tempm[n]=B[n+5];
-	/* tempm2=T+S1+S1+S2+S2+S3+S4-D1-D2-D3 */ 
-	fieldSub(A,tempm,ecc_prime_m,tempm2);
-	/* Form D4 */ 
-	for(n=0;n<2;n++) tempm[n]=B[n+14]; 
-	for(n=2;n<3;n++) tempm[n]=0; 
-	for(n=3;n<6;n++) tempm[n]=B[n+6]; 
-	for(n=6;n<7;n++) tempm[n]=0; 
-	for(n=7;n<8;n++) tempm[n]=B[n+6];
-	/* A=T+S1+S1+S2+S2+S3+S4-D1-D2-D3-D4 */ 
-	fieldSub(tempm2,tempm,ecc_prime_m,A);
+
+	t[0] = (int64_t)B[0] + B[8] + B[9] - B[11] - B[12] - B[13] - B[14];
+	t[1] = (int64_t)B[1] + B[9] + B[10] - B[12] - B[13] - B[14] - B[15];
+	t[2] = (int64_t)B[2] + B[10] + B[11] - B[13] - B[14] - B[15];
+	t[3] = (int64_t)B[3] + 2 * (int64_t)B[11] + 2 * (int64_t)B[12] + B[13] - B[15] - B[8] - B[9];
+	t[4] = (int64_t)B[4] + 2 * (int64_t)B[12] + 2 * (int64_t)B[13] + B[14] - B[9] - B[10];
+	t[5] = (int64_t)B[5] + 2 * (int64_t)B[13] + 2 * (int64_t)B[14] + B[15] - B[10] - B[11];
+	t[6] = (int64_t)B[6] + 3 * (int64_t)B[14] + 2 * (int64_t)B[15] + B[13] - B[8] - B[9];
+	t[7] = (int64_t)B[7] + 3 * (int64_t)B[15] + B[8] - B[10] - B[11] - B[12] - B[13];
+
+	carry = 0;
+	for (n = 0; n < 8; n++){
+		carry += t[n];
+		A[n] = (uint32_t)carry;
+		carry = (carry - A[n]) / ((int64_t)1 << 32); //exact, carry may be negative
+	}
+	while (carry){
+		memset(t, 0, sizeof(t));
+		t[0] = carry;
+		t[3] = -carry;
+		t[6] = -carry;
+		t[7] = carry;
+		carry = 0;
+		for (n = 0; n < 8; n++){
+			carry += (int64_t)A[n] + t[n];
+			A[n] = (uint32_t)carry;
+			carry = (carry - A[n]) / ((int64_t)1 << 32);
+		}
+	}
 	if(isGreater(A, ecc_prime_m, arrayLength) >= 0){
-		fieldSub(A, ecc_prime_m, ecc_prime_m, tempm);
+		sub(A, ecc_prime_m, tempm, arrayLength);
 		copy(tempm, A, arrayLength);
 	}
 }
-
 /**
  * calculate the result = A mod n.
  * n is the order of the eliptic curve.
@@ -425,11 +465,44 @@ static void fieldInv(const uint32_t *A, const uint32_t *modulus, const uint32_t
 	}
 }
 
+/* result = x * y mod p */
+static void fieldMultP(const uint32_t *x, const uint32_t *y, uint32_t *result){
+	uint32_t tempD[16];
+
+	fieldMult(x, y, tempD, arrayLength);
+	fieldModP(result, tempD);
+}
+
+/* result = x^2 mod p */
+static void fieldSquareP(const uint32_t *x, uint32_t *result){
+#ifdef ECC_64BIT_LIMBS
+	uint64_t x64[4], r64[8];
+	uint32_t tempD[16];
+
+	load64(x, x64);
+	square256(x64, r64);
+	store64(r64, tempD);
+	fieldModP(result, tempD);
+#else /* ECC_64BIT_LIMBS */
+	fieldMultP(x, x, result);
+#endif /* ECC_64BIT_LIMBS */
+}
+
+/* result = x + y mod p, for x and y smaller than p */
+static void fieldAddP(const uint32_t *x, const uint32_t *y, uint32_t *result){
+	uint32_t tempas[8];
+
+	fieldAdd(x, y, ecc_prime_r, result);
+	if(isGreater(result, ecc_prime_m, arrayLength) >= 0){
+		sub(result, ecc_prime_m, tempas, arrayLength);
+		copy(tempas, result, arrayLength);
+	}
+}
+
 static void ec_double(const uint32_t *px, const uint32_t *py, uint32_t *Dx, uint32_t *Dy){
 	uint32_t tempA[8];
 	uint32_t tempB[8];
 	uint32_t tempC[8];
-	uint32_t tempD[16];
 
 	if(isZero(px) && isZero(py)){
 		copy(px, Dx,arrayLength);
@@ -437,27 +510,22 @@ static void ec_double(const uint32_t *px, const uint32_t *py, uint32_t *Dx, uint
 		return;
 	}
 
-	fieldMult(px, px, tempD, arrayLength);
-	fieldModP(tempA, tempD);
+	fieldSquareP(px, tempA);
 	setZero(tempB, 8);
 	tempB[0] = 0x00000001;
 	fieldSub(tempA, tempB, ecc_prime_m, tempC); //tempC = (qx^2-1)
 	tempB[0] = 0x00000003;
-	fieldMult(tempC, tempB, tempD, arrayLength);
-	fieldModP(tempA, tempD);//tempA = 3*(qx^2-1)
+	fieldMultP(tempC, tempB, tempA);//tempA = 3*(qx^2-1)
 	fieldAdd(py, py, ecc_prime_r, tempB); //tempB = 2*qy
 	fieldInv(tempB, ecc_prime_m, ecc_prime_r, tempC); //tempC = 1/(2*qy)
-	fieldMult(tempA, tempC, tempD, arrayLength); //tempB = lambda = (3*(qx^2-1))/(2*qy)
-	fieldModP(tempB, tempD);
+	fieldMultP(tempA, tempC, tempB); //tempB = lambda = (3*(qx^2-1))/(2*qy)
 
-	fieldMult(tempB, tempB, tempD, arrayLength); //tempC = lambda^2
-	fieldModP(tempC, tempD);
+	fieldSquareP(tempB, tempC); //tempC = lambda^2
 	fieldSub(tempC, px, ecc_prime_m, tempA); //lambda^2 - Px
 	fieldSub(tempA, px, ecc_prime_m, Dx); //lambda^2 - Px - Qx
 
 	fieldSub(px, Dx, ecc_prime_m, tempA); //tempA = qx-dx
-	fieldMult(tempB, tempA, tempD, arrayLength); //tempC = lambda * (qx-dx)
-	fieldModP(tempC, tempD);
+	fieldMultP(tempB, tempA, tempC); //tempC = lambda * (qx-dx)
 	fieldSub(tempC, py, ecc_prime_m, Dy); //Dy = lambda * (qx-dx) - px
 }
 
@@ -465,7 +533,6 @@ static void ec_add(const uint32_t *px, const uint32_t *py, const uint32_t *qx, c
 	uint32_t tempA[8];
 	uint32_t tempB[8];
 	uint32_t tempC[8];
-	uint32_t tempD[16];
 
 	if(isZero(px) && isZero(py)){
 		copy(qx, Sx,arrayLength);
@@ -491,74 +558,499 @@ static void ec_add(const uint32_t *px, const uint32_t *py, const uint32_t *qx, c
 	fieldSub(py, qy, ecc_prime_m, tempA);
 	fieldSub(px, qx, ecc_prime_m, tempB);
 	fieldInv(tempB, ecc_prime_m, ecc_prime_r, tempB);
-	fieldMult(tempA, tempB, tempD, arrayLength); 
-	fieldModP(tempC, tempD); //tempC = lambda
+	fieldMultP(tempA, tempB, tempC); //tempC = lambda
 
-	fieldMult(tempC, tempC, tempD, arrayLength); //tempA = lambda^2
-	fieldModP(tempA, tempD);
+	fieldSquareP(tempC, tempA); //tempA = lambda^2
 	fieldSub(tempA, px, ecc_prime_m, tempB); //lambda^2 - Px
 	fieldSub(tempB, qx, ecc_prime_m, Sx); //lambda^2 - Px - Qx
 
 	fieldSub(qx, Sx, ecc_prime_m, tempB);
-	fieldMult(tempC, tempB, tempD, arrayLength);
-	fieldModP(tempC, tempD);
+	fieldMultP(tempC, tempB, tempC);
 	fieldSub(tempC, qy, ecc_prime_m, Sy);
 }
 
-void ecc_ec_mult(const uint32_t *px, const uint32_t *py, const uint32_t *secret, uint32_t *resultx, uint32_t *resulty){
-	uint32_t Qx[8];
-	uint32_t Qy[8];
-	setZero(Qx, 8);
-	setZero(Qy, 8);
+/*
+ * Point arithmetic in Jacobian coordinates: (X, Y, Z) stands for the
+ * affine point (X/Z^2, Y/Z^3) and Z = 0 for the point at infinity.
+ * Unlike ec_add() and ec_double() these need no field inversion, only
+ * the conversion back to affine coordinates does.
+ */
 
-	uint32_t tempx[8];
-	uint32_t tempy[8];
+/* (X, Y, Z) = 2 * (X, Y, Z), using a = -3 */
+static void ec_double_jacobian(uint32_t *X, uint32_t *Y, uint32_t *Z){
+	uint32_t delta[8];
+	uint32_t gamma[8];
+	uint32_t beta[8];
+	uint32_t alpha[8];
+	uint32_t tempA[8];
+	uint32_t tempB[8];
+
+	if(isZero(Z))
+		return;
+
+	fieldSquareP(Z, delta); //delta = Z^2
+	fieldSquareP(Y, gamma); //gamma = Y^2
+	fieldMultP(X, gamma, beta); //beta = X * gamma
+	fieldSub(X, delta, ecc_prime_m, tempA);
+	fieldAddP(X, delta, tempB);
+	fieldMultP(tempA, tempB, alpha);
+	fieldAddP(alpha, alpha, tempA);
+	fieldAddP(tempA, alpha, alpha); //alpha = 3 * (X - delta) * (X + delta)
+
+	fieldMultP(Y, Z, tempA);
+	fieldAddP(tempA, tempA, Z); //Z3 = 2 * Y * Z
+
+	fieldAddP(beta, beta, beta);
+	fieldAddP(beta, beta, beta); //beta = 4 * beta
+	fieldSquareP(alpha, tempA);
+	fieldAddP(beta, beta, tempB);
+	fieldSub(tempA, tempB, ecc_prime_m, X); //X3 = alpha^2 - 8 * beta
+
+	fieldSub(beta, X, ecc_prime_m, tempA);
+	fieldMultP(alpha, tempA, tempB);
+	fieldSquareP(gamma, tempA);
+	fieldAddP(tempA, tempA, tempA);
+	fieldAddP(tempA, tempA, tempA);
+	fieldAddP(tempA, tempA, tempA);
+	fieldSub(tempB, tempA, ecc_prime_m, Y); //Y3 = alpha * (4 * beta - X3) - 8 * gamma^2
+}
+
+/* (X, Y, Z) = (X, Y, Z) + (qx, qy), the latter in affine coordinates */
+static void ec_add_jacobian(uint32_t *X, uint32_t *Y, uint32_t *Z, const uint32_t *qx, const uint32_t *qy){
+	uint32_t ZZ[8];
+	uint32_t H[8];
+	uint32_t R[8];
+	uint32_t HH[8];
+	uint32_t HHH[8];
+	uint32_t tempA[8];
+	uint32_t tempB[8];
+
+	if(isZero(qx) && isZero(qy))
+		return;
+
+	if(isZero(Z)){
+		copy(qx, X, arrayLength);
+		copy(qy, Y, arrayLength);
+		setZero(Z, 8);
+		Z[0] = 1;
+		return;
+	}
+
+	fieldSquareP(Z, ZZ);
+	fieldMultP(qx, ZZ, tempA); //U2 = qx * Z^2
+	fieldMultP(Z, ZZ, tempB);
+	fieldMultP(qy, tempB, R); //S2 = qy * Z^3
+	fieldSub(tempA, X, ecc_prime_m, H); //H = U2 - X
+	fieldSub(R, Y, ecc_prime_m, R); //R = S2 - Y
+
+	if(isZero(H)){
+		if(isZero(R))
+			ec_double_jacobian(X, Y, Z);
+		else
+			setZero(Z, 8);
+		return;
+	}
+
+	fieldSquareP(H, HH);
+	fieldMultP(HH, H, HHH);
+	fieldMultP(X, HH, tempB); //tempB = X * H^2
+	fieldMultP(Z, H, Z); //Z3 = Z * H
+
+	fieldSquareP(R, tempA);
+	fieldSub(tempA, HHH, ecc_prime_m, tempA);
+	fieldSub(tempA, tempB, ecc_prime_m, tempA);
+	fieldSub(tempA, tempB, ecc_prime_m, X); //X3 = R^2 - H^3 - 2 * X * H^2
+
+	fieldSub(tempB, X, ecc_prime_m, tempA);
+	fieldMultP(R, tempA, tempB);
+	fieldMultP(Y, HHH, tempA);
+	fieldSub(tempB, tempA, ecc_prime_m, Y); //Y3 = R * (X * H^2 - X3) - Y * H^3
+}
+
+/* converts (X, Y, Z) to affine coordinates with one field inversion */
+static void ec_jacobian_to_affine(const uint32_t *X, const uint32_t *Y, const uint32_t *Z, uint32_t *resultx, uint32_t *resulty){
+	uint32_t zInv[8];
+	uint32_t zInv2[8];
+	uint32_t zInv3[8];
+
+	if(isZero(Z)){
+		setZero(resultx, 8);
+		setZero(resulty, 8);
+		return;
+	}
+
+	fieldInv(Z, ecc_prime_m, ecc_prime_r, zInv);
+	fieldSquareP(zInv, zInv2);
+	fieldMultP(zInv2, zInv, zInv3);
+	fieldMultP(X, zInv2, resultx);
+	fieldMultP(Y, zInv3, resulty);
+}
+
+/*
+ * Converts n points from Jacobian to affine coordinates in place with a
+ * single field inversion (Montgomery's trick). Z must not be zero and
+ * is destroyed.
+ */
+static void ec_jacobian_to_affine_batch(uint32_t (*X)[8], uint32_t (*Y)[8], uint32_t (*Z)[8], uint32_t (*tmp)[8], int n){
+	uint32_t inv[8];
+	uint32_t zInv[8];
+	uint32_t zInv2[8];
+	int i;
+
+	copy(Z[0], tmp[0], arrayLength);
+	for (i = 1; i < n; i++)
+		fieldMultP(tmp[i - 1], Z[i], tmp[i]);
+	fieldInv(tmp[n - 1], ecc_prime_m, ecc_prime_r, inv);
+	for (i = n - 1; i >= 0; i--){
+		if (i > 0){
+			fieldMultP(inv, tmp[i - 1], zInv);
+			fieldMultP(inv, Z[i], inv);
+		} else {
+			copy(inv, zInv, arrayLength);
+		}
+		fieldSquareP(zInv, zInv2);
+		fieldMultP(X[i], zInv2, X[i]);
+		fieldMultP(zInv2, zInv, zInv2);
+		fieldMultP(Y[i], zInv2, Y[i]);
+	}
+}
+
+#if ECC_WINDOW_BITS || ECC_COMB_TEETH
+//to = mask ? from : to, mask being 0 or 0xffffffff
+static void selectCopy(const uint32_t *from, uint32_t *to, uint32_t mask){
+	uint8_t n;
+	for (n = 0; n < 8; n++)
+		to[n] = (from[n] & mask) | (to[n] & ~mask);
+}
+#endif /* ECC_WINDOW_BITS || ECC_COMB_TEETH */
+
+#if ECC_WINDOW_BITS
+/*
+ * Signed fixed window scalar multiplication. For an odd scalar k the
+ * digits d_i = (bits w*i .. w*i+w of k, lowest bit set) - 2^w are odd
+ * and sum up to k with weights 2^(w*i), the top digit is the remaining
+ * bits with the lowest bit set. Every window thus takes w doublings and
+ * one addition of a point from a table of P, 3P, ..., (2^w - 1)P, which
+ * is read completely for every window. An even k is computed as
+ * (k + 1)P - P. The field arithmetic itself is not constant-time.
+ */
+#define WINDOW_POINTS (1 << (ECC_WINDOW_BITS - 1))
+#define WINDOW_STEPS ((256 + ECC_WINDOW_BITS) / ECC_WINDOW_BITS - 1)
+
+//bits [pos, pos + count) of k, count < 32
+static uint32_t getBits(const uint32_t *k, int pos, int count){
+	uint32_t bits;
+
+	if (pos >= 256)
+		return 0;
+	bits = k[pos / 32] >> (pos % 32);
+	if (pos % 32 + count > 32 && pos / 32 < 7)
+		bits |= k[pos / 32 + 1] << (32 - pos % 32);
+	return bits & (((uint32_t)1 << count) - 1);
+}
+
+static void ec_mult_jacobian(const uint32_t *px, const uint32_t *py, const uint32_t *secret, uint32_t *X, uint32_t *Y, uint32_t *Z){
+	uint32_t tableX[WINDOW_POINTS][8];
+	uint32_t tableY[WINDOW_POINTS][8];
+	uint32_t tableZ[WINDOW_POINTS][8];
+	uint32_t tmp[WINDOW_POINTS][8];
+	uint32_t k[8];
+	uint32_t qx[8];
+	uint32_t qy[8];
+	uint32_t negy[8];
+	uint32_t digit, sign, even;
+	int i, j;
+
+	if(isZero(px) && isZero(py)){
+		setZero(X, 8);
+		setZero(Y, 8);
+		setZero(Z, 8);
+		return;
+	}
+
+	/*
+	 * tableX/Y[j] = (2j + 1)P. With 2P = (X, Y, Z) the table is built on
+	 * the isomorphic curve (x * Z^2, y * Z^3), on which 2P is affine and
+	 * the additions are mixed ones. Multiplying the resulting Z by Z maps
+	 * the points back, so this needs no extra inversion.
+	 */
+	copy(px, X, arrayLength);
+	copy(py, Y, arrayLength);
+	setZero(Z, 8);
+	Z[0] = 1;
+	ec_double_jacobian(X, Y, Z);
+	fieldSquareP(Z, qy);
+	fieldMultP(px, qy, tableX[0]);
+	fieldMultP(qy, Z, qx);
+	fieldMultP(py, qx, tableY[0]);
+	setZero(tableZ[0], 8);
+	tableZ[0][0] = 1;
+	for (j = 1; j < WINDOW_POINTS; j++){
+		copy(tableX[j - 1], tableX[j], arrayLength);
+		copy(tableY[j - 1], tableY[j], arrayLength);
+		copy(tableZ[j - 1], tableZ[j], arrayLength);
+		ec_add_jacobian(tableX[j], tableY[j], tableZ[j], X, Y);
+	}
+	for (j = 0; j < WINDOW_POINTS; j++)
+		fieldMultP(tableZ[j], Z, tableZ[j]);
+	ec_jacobian_to_affine_batch(tableX, tableY, tableZ, tmp, WINDOW_POINTS);
+
+	copy(secret, k, arrayLength);
+	even = (k[0] & 1) - 1;
+	k[0] |= 1;
+
+	digit = getBits(k, WINDOW_STEPS * ECC_WINDOW_BITS, ECC_WINDOW_BITS) | 1;
+	for (j = 0; j < WINDOW_POINTS; j++){
+		selectCopy(tableX[j], X, -(uint32_t)(digit == (uint32_t)(2 * j + 1)));
+		selectCopy(tableY[j], Y, -(uint32_t)(digit == (uint32_t)(2 * j + 1)));
+	}
+	setZero(Z, 8);
+	Z[0] = 1;
+
+	for (i = WINDOW_STEPS; i--;){
+		for (j = 0; j < ECC_WINDOW_BITS; j++)
+			ec_double_jacobian(X, Y, Z);
+		digit = getBits(k, i * ECC_WINDOW_BITS, ECC_WINDOW_BITS + 1) | 1;
+		//digit - 2^w = sign * (2 * j + 1)
+		sign = -(digit >> ECC_WINDOW_BITS);
+		digit = ((digit ^ ~sign) & ((1 << ECC_WINDOW_BITS) - 1)) >> 1;
+		for (j = 0; j < WINDOW_POINTS; j++){
+			selectCopy(tableX[j], qx, -(uint32_t)(digit == (uint32_t)j));
+			selectCopy(tableY[j], qy, -(uint32_t)(digit == (uint32_t)j));
+		}
+		sub(ecc_prime_m, qy, negy, arrayLength);
+		selectCopy(negy, qy, ~sign);
+		ec_add_jacobian(X, Y, Z, qx, qy);
+	}
+
+	//subtract P again for an even scalar
+	copy(X, tableX[0], arrayLength);
+	copy(Y, tableY[0], arrayLength);
+	copy(Z, tableZ[0], arrayLength);
+	sub(ecc_prime_m, py, negy, arrayLength);
+	ec_add_jacobian(tableX[0], tableY[0], tableZ[0], px, negy);
+	selectCopy(tableX[0], X, even);
+	selectCopy(tableY[0], Y, even);
+	selectCopy(tableZ[0], Z, even);
+}
+#else /* ECC_WINDOW_BITS */
+static void ec_mult_jacobian(const uint32_t *px, const uint32_t *py, const uint32_t *secret, uint32_t *X, uint32_t *Y, uint32_t *Z){
+	setZero(X, 8);
+	setZero(Y, 8);
+	setZero(Z, 8);
 
 	int i;
 	for (i = 256;i--;){
-		ec_double(Qx, Qy, tempx, tempy);
-		copy(tempx, Qx,arrayLength);
-		copy(tempy, Qy,arrayLength);
+		ec_double_jacobian(X, Y, Z);
 		if (((secret[i / 32]) & ((uint32_t)1 << (i % 32)))) {
-			ec_add(Qx, Qy, px, py, tempx, tempy); //eccAdd
-			copy(tempx, Qx,arrayLength);
-			copy(tempy, Qy,arrayLength);
+			ec_add_jacobian(X, Y, Z, px, py);
+		}
+	}
+}
+#endif /* ECC_WINDOW_BITS */
+
+void ecc_ec_mult(const uint32_t *px, const uint32_t *py, const uint32_t *secret, uint32_t *resultx, uint32_t *resulty){
+	uint32_t X[8];
+	uint32_t Y[8];
+	uint32_t Z[8];
+
+	ec_mult_jacobian(px, py, secret, X, Y, Z);
+	ec_jacobian_to_affine(X, Y, Z, resultx, resulty);
+}
+
+/*
+ * result = k1 * P + k2 * Q with Shamir's trick: one pass over the bits of
+ * both scalars with a shared doubling, adding P, Q or P + Q depending on
+ * the bit pair. This saves 256 doublings over two ecc_ec_mult() calls.
+ */
+static void ec_mult_twin(const uint32_t *px, const uint32_t *py, const uint32_t *k1, const uint32_t *qx, const uint32_t *qy, const uint32_t *k2, uint32_t *resultx, uint32_t *resulty){
+	uint32_t sumx[8];
+	uint32_t sumy[8];
+	uint32_t X[8];
+	uint32_t Y[8];
+	uint32_t Z[8];
+	uint32_t mask;
+	int i, b1, b2;
+
+	ec_add(px, py, qx, qy, sumx, sumy);
+	setZero(X, 8);
+	setZero(Y, 8);
+	setZero(Z, 8);
+
+	for (i = 256;i--;){
+		ec_double_jacobian(X, Y, Z);
+		mask = (uint32_t)1 << (i % 32);
+		b1 = (k1[i / 32] & mask) != 0;
+		b2 = (k2[i / 32] & mask) != 0;
+		if (b1 && b2)
+			ec_add_jacobian(X, Y, Z, sumx, sumy);
+		else if (b1)
+			ec_add_jacobian(X, Y, Z, px, py);
+		else if (b2)
+			ec_add_jacobian(X, Y, Z, qx, qy);
+	}
+	ec_jacobian_to_affine(X, Y, Z, resultx, resulty);
+}
+
+#if ECC_COMB_TEETH || ECC_KEY_TABLE_TEETH
+/*
+ * Fixed-base comb of P with the given number of teeth: the scalar is
+ * split into teeth rows of spacing bits, tx/ty[j - 1] holds the sum of
+ * 2^(t * spacing) * P over the bits t set in j.
+ */
+static void comb_build(const uint32_t *px, const uint32_t *py, uint32_t (*tx)[8], uint32_t (*ty)[8], int teeth, int spacing){
+	uint32_t X[8];
+	uint32_t Y[8];
+	uint32_t Z[8];
+	int t, i, j;
+
+	copy(px, tx[0], arrayLength);
+	copy(py, ty[0], arrayLength);
+	for (t = 1; t < teeth; t++){
+		j = 1 << t;
+		copy(tx[(j >> 1) - 1], X, arrayLength);
+		copy(ty[(j >> 1) - 1], Y, arrayLength);
+		setZero(Z, 8);
+		Z[0] = 1;
+		for (i = 0; i < spacing; i++)
+			ec_double_jacobian(X, Y, Z);
+		ec_jacobian_to_affine(X, Y, Z, tx[j - 1], ty[j - 1]);
+		for (i = 1; i < j; i++)
+			ec_add(tx[j - 1], ty[j - 1], tx[i - 1], ty[i - 1], tx[j + i - 1], ty[j + i - 1]);
+	}
+}
+
+//comb table index for column i of k
+static int combIndex(const uint32_t *k, int i, int teeth, int spacing){
+	int t, bit, idx = 0;
+
+	for (t = 0; t < teeth; t++){
+		bit = i + t * spacing;
+		if (bit < 256)
+			idx |= (int)((k[bit / 32] >> (bit % 32)) & 1) << t;
+	}
+	return idx;
+}
+#endif /* ECC_COMB_TEETH || ECC_KEY_TABLE_TEETH */
+
+#if ECC_COMB_TEETH
+/*
+ * Fixed-base comb for multiples of the generator, see comb_build().
+ * This takes COMB_SPACING doublings and additions instead of 256
+ * doublings and about 128 additions. Like the signed window, every
+ * column reads the whole table and adds a point, the sum is dropped
+ * for a zero column. The table is built by ecc_init(), before that
+ * ec_mult_jacobian() is used.
+ */
+#define COMB_SPACING ((256 + ECC_COMB_TEETH - 1) / ECC_COMB_TEETH)
+#define COMB_POINTS ((1 << ECC_COMB_TEETH) - 1)
+
+static uint32_t comb_x[COMB_POINTS][8];
+static uint32_t comb_y[COMB_POINTS][8];
+static int comb_ready = 0;
+
+static void ec_mult_base_jacobian(const uint32_t *secret, uint32_t *X, uint32_t *Y, uint32_t *Z){
+	uint32_t qx[8];
+	uint32_t qy[8];
+	uint32_t sumX[8];
+	uint32_t sumY[8];
+	uint32_t sumZ[8];
+	uint32_t mask;
+	int i, j, idx;
+
+	if (!comb_ready){
+		ec_mult_jacobian(ecc_g_point_x, ecc_g_point_y, secret, X, Y, Z);
+		return;
+	}
+
+	setZero(X, 8);
+	setZero(Y, 8);
+	setZero(Z, 8);
+	for (i = COMB_SPACING; i--;){
+		ec_double_jacobian(X, Y, Z);
+		idx = combIndex(secret, i, ECC_COMB_TEETH, COMB_SPACING);
+		copy(comb_x[0], qx, arrayLength);
+		copy(comb_y[0], qy, arrayLength);
+		for (j = 1; j < COMB_POINTS; j++){
+			selectCopy(comb_x[j], qx, -(uint32_t)(idx == j + 1));
+			selectCopy(comb_y[j], qy, -(uint32_t)(idx == j + 1));
+		}
+		copy(X, sumX, arrayLength);
+		copy(Y, sumY, arrayLength);
+		copy(Z, sumZ, arrayLength);
+		ec_add_jacobian(sumX, sumY, sumZ, qx, qy);
+		mask = -(uint32_t)(idx != 0);
+		selectCopy(sumX, X, mask);
+		selectCopy(sumY, Y, mask);
+		selectCopy(sumZ, Z, mask);
+	}
+}
+#else /* ECC_COMB_TEETH */
+static void ec_mult_base_jacobian(const uint32_t *secret, uint32_t *X, uint32_t *Y, uint32_t *Z){
+	ec_mult_jacobian(ecc_g_point_x, ecc_g_point_y, secret, X, Y, Z);
+}
+#endif /* ECC_COMB_TEETH */
+
+void ecc_ec_mult_base(const uint32_t *secret, uint32_t *resultx, uint32_t *resulty){
+	uint32_t X[8];
+	uint32_t Y[8];
+	uint32_t Z[8];
+
+	ec_mult_base_jacobian(secret, X, Y, Z);
+	ec_jacobian_to_affine(X, Y, Z, resultx, resulty);
+}
+
+/*
+ * Batched generator multiplications for up to ECC_BATCH_SIZE scalars at
+ * a time, which share the inversion of the conversion to affine
+ * coordinates (Montgomery's trick).
+ */
+void ecc_ec_mult_base_batch(const uint32_t (*secret)[8], uint32_t (*resultx)[8], uint32_t (*resulty)[8], int n){
+	uint32_t Z[ECC_BATCH_SIZE][8];
+	uint32_t tmp[ECC_BATCH_SIZE][8];
+	int i, count;
+
+	for (; n > 0; n -= count){
+		count = n < ECC_BATCH_SIZE ? n : ECC_BATCH_SIZE;
+		for (i = 0; i < count; i++){
+			ec_mult_base_jacobian(secret[i], resultx[i], resulty[i], Z[i]);
+			//the point at infinity stays (0, 0)
+			if (isZero(Z[i])){
+				setZero(resultx[i], 8);
+				setZero(resulty[i], 8);
+				Z[i][0] = 1;
+			}
 		}
+		ec_jacobian_to_affine_batch(resultx, resulty, Z, tmp, count);
+		secret += count;
+		resultx += count;
+		resulty += count;
 	}
-	copy(Qx, resultx,arrayLength);
-	copy(Qy, resulty,arrayLength);
 }
 
 /**
- * Calculate the ecdsa signature.
- *
- * For a description of this algorithm see
- * https://en.wikipedia.org/wiki/Elliptic_Curve_DSA#Signature_generation_algorithm
+ * Calculate the message independent part of an ecdsa signature.
  *
  * input:
- *  d: private key on the curve secp256r1 (32 bytes)
- *  e: hash to sign (32 bytes)
  *  k: random data, this must be changed for every signature (32 bytes)
  *
  * output:
  *  r: r value of the signature (36 bytes)
- *  s: s value of the signature (36 bytes)
+ *  kinv: k^{-1} mod n (32 bytes)
  *
  * return:
  *   0: everything is ok
  *  -1: can not create signature, try again with different k.
  */
-int ecc_ecdsa_sign(const uint32_t *d, const uint32_t *e, const uint32_t *k, uint32_t *r, uint32_t *s)
+int ecc_ecdsa_sign_precompute(const uint32_t *k, uint32_t *r, uint32_t *kinv)
 {
-	uint32_t tmp1[16];
-	uint32_t tmp2[9];
-	uint32_t tmp3[9];
+	uint32_t tmp1[8];
 
 	if (isZero(k))
 		return -1;
 
 	// 4. Calculate the curve point (x_1, y_1) = k * G.
-	ecc_ec_mult(ecc_g_point_x, ecc_g_point_y, k, r, tmp1);
+	ecc_ec_mult_base(k, r, tmp1);
 
 	// 5. Calculate r = x_1 \pmod{n}.
 	fieldModO(r, r, 8);
@@ -567,6 +1059,104 @@ int ecc_ecdsa_sign(const uint32_t *d, const uint32_t *e, const uint32_t *k, uint
 	if (isZero(r))
 		return -1;
 
+	// 6. k^{-1}
+	fieldInv(k, ecc_order_m, ecc_order_r, kinv);
+
+	return 0;
+}
+
+/**
+ * Same as ecc_ecdsa_sign_precompute() for n nonces at a time, which
+ * share the field inversions (Montgomery's trick): one modulo p for
+ * the conversion of the points k * G to affine coordinates and one
+ * modulo n for the k^{-1}.
+ *
+ * return:
+ *   0: everything is ok
+ *  -1: at least one k can not be used, try again with different ones.
+ */
+int ecc_ecdsa_sign_precompute_batch(const uint32_t (*k)[8], uint32_t (*r)[9], uint32_t (*kinv)[8], int n)
+{
+	uint32_t X[ECC_BATCH_SIZE][8];
+	uint32_t Y[ECC_BATCH_SIZE][8];
+	uint32_t Z[ECC_BATCH_SIZE][8];
+	uint32_t zprod[ECC_BATCH_SIZE][8];
+	uint32_t prod[ECC_BATCH_SIZE][9];
+	uint32_t inv[9];
+	uint32_t tmp[16];
+	int i, count;
+
+	for (; n > 0; n -= count){
+		count = n < ECC_BATCH_SIZE ? n : ECC_BATCH_SIZE;
+
+		// 4. Calculate the curve points k * G.
+		for (i = 0; i < count; i++){
+			if (isZero(k[i]))
+				return -1;
+			ec_mult_base_jacobian(k[i], X[i], Y[i], Z[i]);
+			if (isZero(Z[i]))
+				return -1;
+		}
+		ec_jacobian_to_affine_batch(X, Y, Z, zprod, count);
+
+		// 5. Calculate r = x_1 \pmod{n}, prod[i] = k_0 * ... * k_i \pmod{n}.
+		for (i = 0; i < count; i++){
+			copy(X[i], r[i], arrayLength);
+			fieldModO(r[i], r[i], 8);
+			if (isZero(r[i]))
+				return -1;
+			if (i == 0){
+				copy(k[0], tmp, arrayLength);
+				fieldModO(tmp, prod[0], 8);
+			} else {
+				fieldMult(prod[i - 1], k[i], tmp, arrayLength);
+				fieldModO(tmp, prod[i], 16);
+			}
+		}
+		if (isZero(prod[count - 1]))
+			return -1;
+
+		// 6. k^{-1}
+		fieldInv(prod[count - 1], ecc_order_m, ecc_order_r, inv);
+		for (i = count - 1; i > 0; i--){
+			fieldMult(inv, prod[i - 1], tmp, arrayLength);
+			fieldModO(tmp, prod[i], 16);
+			copy(prod[i], kinv[i], arrayLength);
+			fieldMult(inv, k[i], tmp, arrayLength);
+			fieldModO(tmp, inv, 16);
+		}
+		copy(inv, kinv[0], arrayLength);
+
+		k += count;
+		r += count;
+		kinv += count;
+	}
+	return 0;
+}
+
+/**
+ * Complete an ecdsa signature from the values calculated by
+ * ecc_ecdsa_sign_precompute(). r and kinv must not be used again.
+ *
+ * input:
+ *  d: private key on the curve secp256r1 (32 bytes)
+ *  e: hash to sign (32 bytes)
+ *  r: r value of the signature (32 bytes)
+ *  kinv: k^{-1} mod n (32 bytes)
+ *
+ * output:
+ *  s: s value of the signature (36 bytes)
+ *
+ * return:
+ *   0: everything is ok
+ *  -1: can not create signature, try again with different k.
+ */
+int ecc_ecdsa_sign_finish(const uint32_t *d, const uint32_t *e, const uint32_t *r, const uint32_t *kinv, uint32_t *s)
+{
+	uint32_t tmp1[16];
+	uint32_t tmp2[9];
+	uint32_t tmp3[9];
+
 	// 6. Calculate s = k^{-1}(z + r d_A) \pmod{n}.
 	// 6. r * d
 	fieldMult(r, d, tmp1, arrayLength);
@@ -576,11 +1166,8 @@ int ecc_ecdsa_sign(const uint32_t *d, const uint32_t *e, const uint32_t *k, uint
 	tmp1[8] = add(e, tmp2, tmp1, 8);
 	fieldModO(tmp1, tmp3, 9);
 
-	// 6. k^{-1}
-	fieldInv(k, ecc_order_m, ecc_order_r, tmp2);
-
 	// 6. (k^{-1}) (z + (r d))
-	fieldMult(tmp2, tmp3, tmp1, arrayLength);
+	fieldMult(kinv, tmp3, tmp1, arrayLength);
 	fieldModO(tmp1, s, 16);
 
 	// 6. If s = 0, go back to step 3.
@@ -590,6 +1177,61 @@ int ecc_ecdsa_sign(const uint32_t *d, const uint32_t *e, const uint32_t *k, uint
 	return 0;
 }
 
+/**
+ * Calculate the ecdsa signature.
+ *
+ * For a description of this algorithm see
+ * https://en.wikipedia.org/wiki/Elliptic_Curve_DSA#Signature_generation_algorithm
+ *
+ * input:
+ *  d: private key on the curve secp256r1 (32 bytes)
+ *  e: hash to sign (32 bytes)
+ *  k: random data, this must be changed for every signature (32 bytes)
+ *
+ * output:
+ *  r: r value of the signature (36 bytes)
+ *  s: s value of the signature (36 bytes)
+ *
+ * return:
+ *   0: everything is ok
+ *  -1: can not create signature, try again with different k.
+ */
+int ecc_ecdsa_sign(const uint32_t *d, const uint32_t *e, const uint32_t *k, uint32_t *r, uint32_t *s)
+{
+	uint32_t kinv[8];
+
+	if (ecc_ecdsa_sign_precompute(k, r, kinv))
+		return -1;
+
+	return ecc_ecdsa_sign_finish(d, e, r, kinv, s);
+}
+
+/*
+ * Steps 3 and 4 of the signature verification: u1 = e / s and
+ * u2 = r / s mod n. Returns -1 if r or s is zero.
+ */
+static int ecdsaScalars(const uint32_t *e, const uint32_t *r, const uint32_t *s, uint32_t *u1, uint32_t *u2)
+{
+	uint32_t w[8];
+	uint32_t tmp[16];
+
+	if (isZero(r) || isZero(s))
+		return -1;
+
+	// 3. Calculate w = s^{-1} \pmod{n}
+	fieldInv(s, ecc_order_m, ecc_order_r, w);
+
+	// 4. Calculate u_1 = zw \pmod{n}
+	fieldMult(e, w, tmp, arrayLength);
+	fieldModO(tmp, u1, 16);
+
+	// 4. Calculate u_2 = rw \pmod{n}
+	fieldMult(r, w, tmp, arrayLength);
+	fieldModO(tmp, u2, 16);
+
+	return 0;
+}
+
 /**
  * Verifies a ecdsa signature.
  *
@@ -609,44 +1251,98 @@ int ecc_ecdsa_sign(const uint32_t *d, const uint32_t *e, const uint32_t *k, uint
  */
 int ecc_ecdsa_validate(const uint32_t *x, const uint32_t *y, const uint32_t *e, const uint32_t *r, const uint32_t *s)
 {
-	uint32_t w[8];
-	uint32_t tmp[16];
 	uint32_t u1[9];
 	uint32_t u2[9];
-	uint32_t tmp1_x[8];
-	uint32_t tmp1_y[8];
-	uint32_t tmp2_x[8];
-	uint32_t tmp2_y[8];
 	uint32_t tmp3_x[8];
 	uint32_t tmp3_y[8];
 
-	if (isZero(r) || isZero(s))
+	if (ecdsaScalars(e, r, s, u1, u2))
 		return -1;
 
-	// 3. Calculate w = s^{-1} \pmod{n}
-	fieldInv(s, ecc_order_m, ecc_order_r, w);
+	// 5. Calculate the curve point (x_1, y_1) = u_1 * G + u_2 * Q_A.
+	ec_mult_twin(ecc_g_point_x, ecc_g_point_y, u1, x, y, u2, tmp3_x, tmp3_y);
 
-	// 4. Calculate u_1 = zw \pmod{n}
-	fieldMult(e, w, tmp, arrayLength);
-	fieldModO(tmp, u1, 16);
+	return isSame(tmp3_x, r, arrayLength) ? 0 : -1;
+}
 
-	// 4. Calculate u_2 = rw \pmod{n}
-	fieldMult(r, w, tmp, arrayLength);
-	fieldModO(tmp, u2, 16);
+#if ECC_KEY_TABLE_TEETH
+/*
+ * Verification with a comb of the public key, see comb_build(). Together
+ * with a comb of the generator, u_1 * G + u_2 * Q takes KEY_TABLE_SPACING
+ * doublings and up to twice as many additions. The generator table is
+ * built by ecc_init().
+ */
+#define KEY_TABLE_SPACING ((256 + ECC_KEY_TABLE_TEETH - 1) / ECC_KEY_TABLE_TEETH)
 
-	// 5. Calculate the curve point (x_1, y_1) = u_1 * G + u_2 * Q_A.
-	// tmp1 = u_1 * G
-	ecc_ec_mult(ecc_g_point_x, ecc_g_point_y, u1, tmp1_x, tmp1_y);
+static ecc_key_table_t base_table;
+static int base_table_ready = 0;
 
-	// tmp2 = u_2 * Q_A
-	ecc_ec_mult(x, y, u2, tmp2_x, tmp2_y);
+void ecc_key_table_init(ecc_key_table_t *table, const uint32_t *x, const uint32_t *y)
+{
+	comb_build(x, y, table->x, table->y, ECC_KEY_TABLE_TEETH, KEY_TABLE_SPACING);
+}
 
-	// tmp3 = tmp1 + tmp2
-	ec_add(tmp1_x, tmp1_y, tmp2_x, tmp2_y, tmp3_x, tmp3_y);
-	// TODO: this u_1 * G + u_2 * Q_A  could be optimiced with Straus's algorithm.
+/**
+ * Same as ecc_ecdsa_validate(), with the public key given by a table
+ * from ecc_key_table_init().
+ */
+int ecc_ecdsa_validate_table(const ecc_key_table_t *table, const uint32_t *e, const uint32_t *r, const uint32_t *s)
+{
+	uint32_t u1[9];
+	uint32_t u2[9];
+	uint32_t X[8];
+	uint32_t Y[8];
+	uint32_t Z[8];
+	uint32_t tmp3_x[8];
+	uint32_t tmp3_y[8];
+	int i, idx;
+
+	if (ecdsaScalars(e, r, s, u1, u2))
+		return -1;
+
+	//without the generator table, the public key is the first entry
+	if (!base_table_ready){
+		ec_mult_twin(ecc_g_point_x, ecc_g_point_y, u1, table->x[0], table->y[0], u2, tmp3_x, tmp3_y);
+		return isSame(tmp3_x, r, arrayLength) ? 0 : -1;
+	}
+
+	setZero(X, 8);
+	setZero(Y, 8);
+	setZero(Z, 8);
+	for (i = KEY_TABLE_SPACING; i--;){
+		ec_double_jacobian(X, Y, Z);
+		idx = combIndex(u1, i, ECC_KEY_TABLE_TEETH, KEY_TABLE_SPACING);
+		if (idx)
+			ec_add_jacobian(X, Y, Z, base_table.x[idx - 1], base_table.y[idx - 1]);
+		idx = combIndex(u2, i, ECC_KEY_TABLE_TEETH, KEY_TABLE_SPACING);
+		if (idx)
+			ec_add_jacobian(X, Y, Z, table->x[idx - 1], table->y[idx - 1]);
+	}
+	ec_jacobian_to_affine(X, Y, Z, tmp3_x, tmp3_y);
 
 	return isSame(tmp3_x, r, arrayLength) ? 0 : -1;
 }
+#endif /* ECC_KEY_TABLE_TEETH */
+
+/*
+ * The generator tables are built here once instead of on first use, so
+ * that several threads can use them without a lock.
+ */
+void ecc_init(void)
+{
+#if ECC_COMB_TEETH
+	if (!comb_ready){
+		comb_build(ecc_g_point_x, ecc_g_point_y, comb_x, comb_y, ECC_COMB_TEETH, COMB_SPACING);
+		comb_ready = 1;
+	}
+#endif /* ECC_COMB_TEETH */
+#if ECC_KEY_TABLE_TEETH
+	if (!base_table_ready){
+		ecc_key_table_init(&base_table, ecc_g_point_x, ecc_g_point_y);
+		base_table_ready = 1;
+	}
+#endif /* ECC_KEY_TABLE_TEETH */
+}
 
 int ecc_is_valid_key(const uint32_t * priv_key)
 {
@@ -682,6 +1378,16 @@ void ecc_fieldModP(uint32_t *A, const uint32_t *B)
 {
 	fieldModP(A, B);
 }
+void ecc_fieldMultP(const uint32_t *x, const uint32_t *y, uint32_t *result)
+{
+	fieldMultP(x, y, result);
+}
+
+void ecc_fieldSquareP(const uint32_t *x, uint32_t *result)
+{
+	fieldSquareP(x, result);
+}
+
 void ecc_fieldModO(const uint32_t *A, uint32_t *result, uint8_t length)
 {
 	fieldModO(A, result, length);
@@ -719,6 +1425,11 @@ void ecc_ec_add(const uint32_t *px, const uint32_t *py, const uint32_t *qx, cons
 {
 	ec_add(px, py, qx, qy, Sx, Sy);
 }
+void ecc_ec_mult_twin(const uint32_t *px, const uint32_t *py, const uint32_t *k1, const uint32_t *qx, const uint32_t *qy, const uint32_t *k2, uint32_t *resultx, uint32_t *resulty)
+{
+	ec_mult_twin(px, py, k1, qx, qy, k2, resultx, resulty);
+}
+
 void ecc_ec_double(const uint32_t *px, const uint32_t *py, uint32_t *Dx, uint32_t *Dy)
 {
 	ec_double(px, py, Dx, Dy);
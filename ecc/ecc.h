@@ -40,28 +40,109 @@
 #define keyLengthInBytes 32
 #define arrayLength 8
 
+/* The field arithmetic uses 4x64 bit limbs on hosts with a 128 bit
+ * integer type. Define ECC_NO_64BIT_LIMBS to use the 32 bit code meant
+ * for microcontrollers instead. */
+#if !defined(ECC_NO_64BIT_LIMBS) && defined(__SIZEOF_INT128__)
+#define ECC_64BIT_LIMBS 1
+#endif
+
+/* Number of teeth of the fixed-base comb used by ecc_ec_mult_base(),
+ * 0 disables it. The table takes (2^ECC_COMB_TEETH - 1) * 64 bytes of
+ * RAM (960 bytes for 4 teeth, 16320 for 8) and is computed by
+ * ecc_init(). */
+#ifndef ECC_COMB_TEETH
+#define ECC_COMB_TEETH 0
+#endif
+#if ECC_COMB_TEETH < 0 || ECC_COMB_TEETH > 8
+#error "ECC_COMB_TEETH must be between 0 and 8"
+#endif
+
+/* Window width of the signed fixed window ecc_ec_mult(), which keeps a
+ * table of 2^(ECC_WINDOW_BITS - 1) points and about four times that
+ * many 32 byte values on the stack (2 KiB for 5 bits). 0 selects the
+ * binary double-and-add, the default on targets without 64 bit limbs. */
+#ifndef ECC_WINDOW_BITS
+#ifdef ECC_64BIT_LIMBS
+#define ECC_WINDOW_BITS 5
+#else
+#define ECC_WINDOW_BITS 0
+#endif
+#endif
+#if ECC_WINDOW_BITS < 0 || ECC_WINDOW_BITS > 7
+#error "ECC_WINDOW_BITS must be between 0 and 7"
+#endif
+
+/* Number of teeth of the public key combs built by ecc_key_table_init()
+ * for ecc_ecdsa_validate_table(). A table takes (2^ECC_KEY_TABLE_TEETH
+ * - 1) * 64 bytes (960 bytes for 4 teeth), one more is kept for the
+ * generator and computed by ecc_init().
+ * 0 disables the tables, the default on targets without 64 bit limbs. */
+#ifndef ECC_KEY_TABLE_TEETH
+#ifdef ECC_64BIT_LIMBS
+#define ECC_KEY_TABLE_TEETH 4
+#else
+#define ECC_KEY_TABLE_TEETH 0
+#endif
+#endif
+#if ECC_KEY_TABLE_TEETH < 0 || ECC_KEY_TABLE_TEETH > 8
+#error "ECC_KEY_TABLE_TEETH must be between 0 and 8"
+#endif
+
+/* Number of operations the batch functions process at a time, each
+ * takes about 200 bytes of stack. */
+#ifndef ECC_BATCH_SIZE
+#define ECC_BATCH_SIZE 8
+#endif
+#if ECC_BATCH_SIZE < 1
+#error "ECC_BATCH_SIZE must be at least 1"
+#endif
+
 extern const uint32_t ecc_g_point_x[8];
 extern const uint32_t ecc_g_point_y[8];
 
+//builds the generator tables, call once before the other functions
+void ecc_init(void);
+
 //ec Functions
 void ecc_ec_mult(const uint32_t *px, const uint32_t *py, const uint32_t *secret, uint32_t *resultx, uint32_t *resulty);
+//secret * generator, same as ecc_ec_mult(ecc_g_point_x, ecc_g_point_y, ...)
+void ecc_ec_mult_base(const uint32_t *secret, uint32_t *resultx, uint32_t *resulty);
+//n generator multiplications sharing one field inversion
+void ecc_ec_mult_base_batch(const uint32_t (*secret)[8], uint32_t (*resultx)[8], uint32_t (*resulty)[8], int n);
 
 static inline void ecc_ecdh(const uint32_t *px, const uint32_t *py, const uint32_t *secret, uint32_t *resultx, uint32_t *resulty) {
 	ecc_ec_mult(px, py, secret, resultx, resulty);
 }
 int ecc_ecdsa_validate(const uint32_t *x, const uint32_t *y, const uint32_t *e, const uint32_t *r, const uint32_t *s);
 int ecc_ecdsa_sign(const uint32_t *d, const uint32_t *e, const uint32_t *k, uint32_t *r, uint32_t *s);
+//ecc_ecdsa_sign() split into the message independent and dependent parts
+int ecc_ecdsa_sign_precompute(const uint32_t *k, uint32_t *r, uint32_t *kinv);
+int ecc_ecdsa_sign_precompute_batch(const uint32_t (*k)[8], uint32_t (*r)[9], uint32_t (*kinv)[8], int n);
+int ecc_ecdsa_sign_finish(const uint32_t *d, const uint32_t *e, const uint32_t *r, const uint32_t *kinv, uint32_t *s);
+
+#if ECC_KEY_TABLE_TEETH
+//precomputed multiples of a public key for repeated verifications
+typedef struct {
+	uint32_t x[(1 << ECC_KEY_TABLE_TEETH) - 1][8];
+	uint32_t y[(1 << ECC_KEY_TABLE_TEETH) - 1][8];
+} ecc_key_table_t;
+
+void ecc_key_table_init(ecc_key_table_t *table, const uint32_t *x, const uint32_t *y);
+int ecc_ecdsa_validate_table(const ecc_key_table_t *table, const uint32_t *e, const uint32_t *r, const uint32_t *s);
+#endif /* ECC_KEY_TABLE_TEETH */
 
 int ecc_is_valid_key(const uint32_t * priv_key);
 static inline void ecc_gen_pub_key(const uint32_t *priv_key, uint32_t *pub_x, uint32_t *pub_y)
 {
-	ecc_ec_mult(ecc_g_point_x, ecc_g_point_y, priv_key, pub_x, pub_y);
+	ecc_ec_mult_base(priv_key, pub_x, pub_y);
 }
 
 #ifdef TEST_INCLUDE
 //ec Functions
 void ecc_ec_add(const uint32_t *px, const uint32_t *py, const uint32_t *qx, const uint32_t *qy, uint32_t *Sx, uint32_t *Sy);
 void ecc_ec_double(const uint32_t *px, const uint32_t *py, uint32_t *Dx, uint32_t *Dy);
+void ecc_ec_mult_twin(const uint32_t *px, const uint32_t *py, const uint32_t *k1, const uint32_t *qx, const uint32_t *qy, const uint32_t *k2, uint32_t *resultx, uint32_t *resulty);
 
 //simple Functions for addition and substraction of big numbers
 uint32_t ecc_add( const uint32_t *x, const uint32_t *y, uint32_t *result, uint8_t length);
@@ -72,6 +153,8 @@ int ecc_fieldAdd(const uint32_t *x, const uint32_t *y, const uint32_t *reducer,
 int ecc_fieldSub(const uint32_t *x, const uint32_t *y, const uint32_t *modulus, uint32_t *result);
 int ecc_fieldMult(const uint32_t *x, const uint32_t *y, uint32_t *result, uint8_t length);
 void ecc_fieldModP(uint32_t *A, const uint32_t *B);
+void ecc_fieldMultP(const uint32_t *x, const uint32_t *y, uint32_t *result);
+void ecc_fieldSquareP(const uint32_t *x, uint32_t *result);
 void ecc_fieldModO(const uint32_t *A, uint32_t *result, uint8_t length);
 void ecc_fieldInv(const uint32_t *A, const uint32_t *modulus, const uint32_t *reducer, uint32_t *B);
 
@@ -103,6 +103,10 @@ uint32_t resultMultx[8] = {	0x4eeca03f, 0xacc89ba3, 0xcfc18bed, 0xe62becc3,
 uint32_t resultMulty[8] = {	0x6a7b41d5, 0x35beca95, 0xa6c0cf30, 0x06f8fcf8,
 							0x1f6e744e, 0x5b673ab5, 0x8bf626aa, 0x75ee68eb};
 
+//ffffffff 00000000 ffffffff ffffffff bce6faad a7179e84 f3b9cac2 fc632551
+static const uint32_t ecc_order[8] = {	0xFC632551, 0xF3B9CAC2, 0xA7179E84, 0xBCE6FAAD,
+										0xFFFFFFFF, 0xFFFFFFFF, 0x00000000, 0xFFFFFFFF};
+
 static const uint32_t ecdsaTestMessage[] = { 0x65637572, 0x20612073, 0x68206F66, 0x20686173, 0x69732061, 0x68697320, 0x6F2C2054, 0x48616C6C};
 
 static const uint32_t ecdsaTestSecret[] = {0x94A949FA, 0x401455A1, 0xAD7294CA, 0x896A33BB, 0x7A80E714, 0x4321435B, 0x51247A14, 0x41C1CB6B};
@@ -145,6 +149,247 @@ multTest(void){
 	assert(ecc_isSame(tempy, resultMulty, arrayLength));
 }
 
+/* double and add in affine coordinates, as reference for ecc_ec_mult() */
+static void
+affineMult(const uint32_t *px, const uint32_t *py, const uint32_t *k, uint32_t *resultx, uint32_t *resulty){
+	uint32_t tempx[8];
+	uint32_t tempy[8];
+	int started = 0;
+	int i;
+
+	for (i = 256; i--;){
+		if (started) {
+			ecc_ec_double(resultx, resulty, tempx, tempy);
+			ecc_copy(tempx, resultx, arrayLength);
+			ecc_copy(tempy, resulty, arrayLength);
+		}
+		if (k[i / 32] & ((uint32_t)1 << (i % 32))) {
+			if (started) {
+				ecc_ec_add(resultx, resulty, px, py, tempx, tempy);
+				ecc_copy(tempx, resultx, arrayLength);
+				ecc_copy(tempy, resulty, arrayLength);
+			} else {
+				ecc_copy(px, resultx, arrayLength);
+				ecc_copy(py, resulty, arrayLength);
+				started = 1;
+			}
+		}
+	}
+}
+
+static void
+multRandomTest(void){
+	uint32_t k[8];
+	uint32_t tempx[8];
+	uint32_t tempy[8];
+	uint32_t refx[8];
+	uint32_t refy[8];
+	int i;
+
+	for (i = 0; i < 16; i++) {
+		ecc_setRandom(k);
+		ecc_ec_mult(Sx, Sy, k, tempx, tempy);
+		affineMult(Sx, Sy, k, refx, refy);
+		assert(ecc_isSame(tempx, refx, arrayLength));
+		assert(ecc_isSame(tempy, refy, arrayLength));
+	}
+
+	//small scalars, including all digits of the window method
+	ecc_setZero(k, 8);
+	for (i = 1; i < 70; i++) {
+		k[0] = i;
+		ecc_ec_mult(Sx, Sy, k, tempx, tempy);
+		affineMult(Sx, Sy, k, refx, refy);
+		assert(ecc_isSame(tempx, refx, arrayLength));
+		assert(ecc_isSame(tempy, refy, arrayLength));
+	}
+
+	//0 * S is the point at infinity
+	k[0] = 0;
+	ecc_ec_mult(Sx, Sy, k, tempx, tempy);
+	ecc_setZero(refx, 8);
+	assert(ecc_isSame(tempx, refx, arrayLength));
+	assert(ecc_isSame(tempy, refx, arrayLength));
+
+	//1 * S = S
+	ecc_setZero(k, 8);
+	k[0] = 1;
+	ecc_ec_mult(Sx, Sy, k, tempx, tempy);
+	assert(ecc_isSame(tempx, Sx, arrayLength));
+	assert(ecc_isSame(tempy, Sy, arrayLength));
+
+	//2 * S
+	k[0] = 2;
+	ecc_ec_mult(Sx, Sy, k, tempx, tempy);
+	assert(ecc_isSame(tempx, resultDoublex, arrayLength));
+	assert(ecc_isSame(tempy, resultDoubley, arrayLength));
+
+	//(n - 1) * G = -G
+	ecc_copy(ecc_order, k, arrayLength);
+	k[0]--;
+	ecc_ec_mult(BasePointx, BasePointy, k, tempx, tempy);
+	assert(ecc_isSame(tempx, BasePointx, arrayLength));
+	ecc_fieldSub(ecc_prime_m, BasePointy, ecc_prime_m, refy);
+	assert(ecc_isSame(tempy, refy, arrayLength));
+
+	//n * G is the point at infinity
+	ecc_ec_mult(BasePointx, BasePointy, ecc_order, tempx, tempy);
+	ecc_setZero(refx, 8);
+	assert(ecc_isSame(tempx, refx, arrayLength));
+	assert(ecc_isSame(tempy, refx, arrayLength));
+}
+
+static void
+multBaseTest(void){
+	uint32_t k[8];
+	uint32_t tempx[8];
+	uint32_t tempy[8];
+	uint32_t refx[8];
+	uint32_t refy[8];
+	int i;
+
+	for (i = 0; i < 16; i++) {
+		ecc_setRandom(k);
+		if (i == 0)
+			ecc_setZero(k, 8);
+		if (i == 1)
+			ecc_copy(ecc_order, k, arrayLength);
+		if (i == 2)
+			k[0]--;
+		ecc_ec_mult_base(k, tempx, tempy);
+		ecc_ec_mult(BasePointx, BasePointy, k, refx, refy);
+		assert(ecc_isSame(tempx, refx, arrayLength));
+		assert(ecc_isSame(tempy, refy, arrayLength));
+	}
+}
+
+/* u1 * G + u2 * Q with two separate multiplications as before Shamir's trick */
+static void
+twinReference(const uint32_t *u1, const uint32_t *qx, const uint32_t *qy, const uint32_t *u2, uint32_t *resultx, uint32_t *resulty){
+	uint32_t tmp1_x[8];
+	uint32_t tmp1_y[8];
+	uint32_t tmp2_x[8];
+	uint32_t tmp2_y[8];
+
+	ecc_ec_mult(BasePointx, BasePointy, u1, tmp1_x, tmp1_y);
+	ecc_ec_mult(qx, qy, u2, tmp2_x, tmp2_y);
+	ecc_ec_add(tmp1_x, tmp1_y, tmp2_x, tmp2_y, resultx, resulty);
+}
+
+static void
+multTwinTest(void){
+	uint32_t u1[8];
+	uint32_t u2[8];
+	uint32_t qx[8];
+	uint32_t qy[8];
+	uint32_t tempx[8];
+	uint32_t tempy[8];
+	uint32_t refx[8];
+	uint32_t refy[8];
+	int i;
+
+	for (i = 0; i < 16; i++) {
+		ecc_setRandom(u1);
+		ecc_setRandom(u2);
+		ecc_setRandom(tempx);
+		ecc_ec_mult(BasePointx, BasePointy, tempx, qx, qy);
+		if (i == 0) { //Q = G
+			ecc_copy(BasePointx, qx, arrayLength);
+			ecc_copy(BasePointy, qy, arrayLength);
+		}
+		if (i == 1) { //Q = -G
+			ecc_copy(BasePointx, qx, arrayLength);
+			ecc_fieldSub(ecc_prime_m, BasePointy, ecc_prime_m, qy);
+		}
+		if (i == 2) //u1 = u2
+			ecc_copy(u1, u2, arrayLength);
+		ecc_ec_mult_twin(BasePointx, BasePointy, u1, qx, qy, u2, tempx, tempy);
+		twinReference(u1, qx, qy, u2, refx, refy);
+		assert(ecc_isSame(tempx, refx, arrayLength));
+		assert(ecc_isSame(tempy, refy, arrayLength));
+	}
+}
+
+static void
+ecdsaRandomTest(void){
+	uint32_t priv[8];
+	uint32_t pub_x[8];
+	uint32_t pub_y[8];
+	uint32_t msg[8];
+	uint32_t k[8];
+	uint32_t r[9];
+	uint32_t s[9];
+	uint32_t r2[9];
+	uint32_t s2[9];
+	uint32_t kinv[8];
+#if ECC_KEY_TABLE_TEETH
+	ecc_key_table_t table;
+#endif
+	int i;
+
+	for (i = 0; i < 16; i++) {
+		ecc_setRandom(priv);
+		ecc_setRandom(msg);
+		ecc_setRandom(k);
+		ecc_gen_pub_key(priv, pub_x, pub_y);
+		if (ecc_ecdsa_sign(priv, msg, k, r, s))
+			continue;
+		assert(!ecc_ecdsa_validate(pub_x, pub_y, msg, r, s));
+		//the split signature must give the same result
+		assert(!ecc_ecdsa_sign_precompute(k, r2, kinv));
+		assert(!ecc_ecdsa_sign_finish(priv, msg, r2, kinv, s2));
+		assert(!memcmp(r, r2, 32) && !memcmp(s, s2, 32));
+		msg[i % 8] ^= 1;
+		assert(ecc_ecdsa_validate(pub_x, pub_y, msg, r, s));
+		msg[i % 8] ^= 1;
+		s[0] ^= 2;
+		assert(ecc_ecdsa_validate(pub_x, pub_y, msg, r, s));
+#if ECC_KEY_TABLE_TEETH
+		ecc_key_table_init(&table, pub_x, pub_y);
+		assert(ecc_ecdsa_validate_table(&table, msg, r, s));
+		s[0] ^= 2;
+		assert(!ecc_ecdsa_validate_table(&table, msg, r, s));
+		msg[i % 8] ^= 1;
+		assert(ecc_ecdsa_validate_table(&table, msg, r, s));
+#endif
+	}
+}
+
+static void
+batchTest(void){
+	uint32_t k[11][8];
+	uint32_t x[11][8];
+	uint32_t y[11][8];
+	uint32_t r[11][9];
+	uint32_t kinv[11][8];
+	uint32_t tempx[9];
+	uint32_t tempy[9];
+	uint32_t null[8];
+	int i;
+
+	ecc_setZero(null, 8);
+	for (i = 0; i < 11; i++)
+		ecc_setRandom(k[i]);
+	//crosses the ECC_BATCH_SIZE chunks
+	ecc_ec_mult_base_batch((const uint32_t (*)[8])k, x, y, 11);
+	assert(!ecc_ecdsa_sign_precompute_batch((const uint32_t (*)[8])k, r, kinv, 11));
+	for (i = 0; i < 11; i++){
+		ecc_ec_mult_base(k[i], tempx, tempy);
+		assert(ecc_isSame(x[i], tempx, arrayLength));
+		assert(ecc_isSame(y[i], tempy, arrayLength));
+		assert(!ecc_ecdsa_sign_precompute(k[i], tempx, tempy));
+		assert(ecc_isSame(r[i], tempx, arrayLength));
+		assert(ecc_isSame(kinv[i], tempy, arrayLength));
+	}
+
+	ecc_setZero(k[3], 8);
+	ecc_ec_mult_base_batch((const uint32_t (*)[8])k, x, y, 5);
+	assert(ecc_isSame(x[3], null, arrayLength) && ecc_isSame(y[3], null, arrayLength));
+	ecc_ec_mult_base(k[4], tempx, tempy);
+	assert(ecc_isSame(x[4], tempx, arrayLength));
+	assert(ecc_ecdsa_sign_precompute_batch((const uint32_t (*)[8])k, r, kinv, 5));
+}
+
 static void
 eccdhTest(void){
 	uint32_t tempx[8];
@@ -199,6 +444,110 @@ ecdsaTest(void) {
 	assert(!ret);
 }
 
+#ifndef CONTIKI
+static double
+elapsed(clock_t start){
+	return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+/* operations per second of the field arithmetic and of the public key
+ * operations of one ECDHE-ECDSA handshake side: key generation, ECDH,
+ * signing and verification */
+static void
+benchmark(void){
+	uint32_t priv[8];
+	uint32_t pub_x[8];
+	uint32_t pub_y[8];
+	uint32_t tempx[9];
+	uint32_t tempy[9];
+	uint32_t k[8];
+	uint32_t batch_k[ECC_BATCH_SIZE][8];
+	uint32_t batch_x[ECC_BATCH_SIZE][8];
+	uint32_t batch_y[ECC_BATCH_SIZE][8];
+	uint32_t batch_r[ECC_BATCH_SIZE][9];
+#if ECC_KEY_TABLE_TEETH
+	ecc_key_table_t table;
+#endif
+	clock_t start;
+	int i, n;
+
+	ecc_setRandom(priv);
+	ecc_gen_pub_key(priv, pub_x, pub_y);
+	ecc_setRandom(k);
+	ecc_copy(pub_y, tempx, arrayLength);
+
+	start = clock();
+	for (n = 0; elapsed(start) < 1.0; n++)
+		for (i = 0; i < 1000; i++)
+			ecc_fieldMultP(pub_x, tempx, tempx);
+	printf("fieldMult:   %8.1f kops/s\n", n / elapsed(start));
+
+	start = clock();
+	for (n = 0; elapsed(start) < 1.0; n++)
+		for (i = 0; i < 1000; i++)
+			ecc_fieldSquareP(tempx, tempx);
+	printf("fieldSquare: %8.1f kops/s\n", n / elapsed(start));
+
+	start = clock();
+	for (n = 0; elapsed(start) < 1.0; n++)
+		ecc_fieldInv(pub_x, ecc_prime_m, ecc_prime_r, tempy);
+	printf("fieldInv:    %8.1f ops/s\n", n / elapsed(start));
+
+	start = clock();
+	for (n = 0; elapsed(start) < 1.0; n++)
+		ecc_gen_pub_key(priv, tempx, tempy);
+	printf("gen_pub_key: %8.1f ops/s\n", n / elapsed(start));
+
+	for (i = 0; i < ECC_BATCH_SIZE; i++)
+		ecc_setRandom(batch_k[i]);
+	start = clock();
+	for (n = 0; elapsed(start) < 1.0; n += ECC_BATCH_SIZE)
+		ecc_ec_mult_base_batch((const uint32_t (*)[8])batch_k, batch_x, batch_y, ECC_BATCH_SIZE);
+	printf("  batched:   %8.1f ops/s\n", n / elapsed(start));
+
+	start = clock();
+	for (n = 0; elapsed(start) < 1.0; n++)
+		ecc_ecdh(pub_x, pub_y, priv, tempx, tempy);
+	printf("ecdh:        %8.1f ops/s\n", n / elapsed(start));
+
+	start = clock();
+	for (n = 0; elapsed(start) < 1.0; n++)
+		ecc_ecdsa_sign(priv, ecdsaTestMessage, k, tempx, tempy);
+	printf("sign:        %8.1f ops/s\n", n / elapsed(start));
+
+	start = clock();
+	for (n = 0; elapsed(start) < 1.0; n++)
+		ecc_ecdsa_sign_precompute(k, batch_r[0], batch_y[0]);
+	printf("precompute:  %8.1f ops/s\n", n / elapsed(start));
+
+	start = clock();
+	for (n = 0; elapsed(start) < 1.0; n += ECC_BATCH_SIZE)
+		ecc_ecdsa_sign_precompute_batch((const uint32_t (*)[8])batch_k, batch_r, batch_x, ECC_BATCH_SIZE);
+	printf("  batched:   %8.1f ops/s\n", n / elapsed(start));
+
+	start = clock();
+	for (n = 0; elapsed(start) < 1.0; n++) {
+		i = ecc_ecdsa_validate(pub_x, pub_y, ecdsaTestMessage, tempx, tempy);
+		assert(!i);
+	}
+	printf("validate:    %8.1f signatures/s\n", n / elapsed(start));
+#if ECC_KEY_TABLE_TEETH
+
+	start = clock();
+	for (n = 0; elapsed(start) < 1.0; n++)
+		ecc_key_table_init(&table, pub_x, pub_y);
+	printf("key_table:   %8.1f ops/s\n", n / elapsed(start));
+
+	start = clock();
+	for (n = 0; elapsed(start) < 1.0; n++) {
+		i = ecc_ecdsa_validate_table(&table, ecdsaTestMessage, tempx, tempy);
+		assert(!i);
+	}
+	printf("validate_table: %5.1f signatures/s\n", n / elapsed(start));
+#endif
+}
+#endif /* CONTIKI */
+
 #ifdef CONTIKI
 PROCESS(ecc_test, "ECC test");
 AUTOSTART_PROCESSES(&ecc_test);
@@ -210,8 +559,16 @@ PROCESS_THREAD(ecc_test, ev, d)
 	addTest();
 	doubleTest();
 	multTest();
+	multRandomTest();
+	//before and after the generator tables are built
+	multBaseTest();
+	ecc_init();
+	multBaseTest();
+	multTwinTest();
 	eccdhTest();
 	ecdsaTest();
+	ecdsaRandomTest();
+	batchTest();
 	printf("%s\n", "All Tests successful.");
 
 	PROCESS_END();
@@ -219,16 +576,24 @@ PROCESS_THREAD(ecc_test, ev, d)
 #else /* CONTIKI */
 int main(int argc, char const *argv[])
 {
-	(void)argc;
-	(void)argv;
 
 	srand(time(NULL));
 	addTest();
 	doubleTest();
 	multTest();
+	multRandomTest();
+	//before and after the generator tables are built
+	multBaseTest();
+	ecc_init();
+	multBaseTest();
+	multTwinTest();
 	eccdhTest();
 	ecdsaTest();
+	ecdsaRandomTest();
+	batchTest();
 	printf("%s\n", "All Tests successful.");
+	if (argc > 1 && !strcmp(argv[1], "-b"))
+		benchmark();
 	return 0;
 }
 #endif /* CONTIKI */
@@ -38,6 +38,7 @@
 #include <assert.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include "ecc.h"
 #include "test_helper.h"
 
@@ -98,13 +99,13 @@ static const uint32_t orderMinusOne[8] = {0xFC632550, 0xF3B9CAC2, 0xA7179E84, 0x
 					0xFFFFFFFF, 0xFFFFFFFF, 0x00000000, 0xFFFFFFFF};
 static const uint32_t orderResultDoubleMod[8] = {0xFC63254F, 0xF3B9CAC2, 0xA7179E84, 0xBCE6FAAD, 0xFFFFFFFF, 0xFFFFFFFF, 0x00000000, 0xFFFFFFFF};
 
-uint32_t temp[8];
+uint32_t temp[9]; //fieldModO() needs 9 words
 uint32_t temp2[16];
 
 static void
 nullEverything(void){
 	memset(temp, 0, sizeof(temp));
-	memset(temp2, 0, sizeof(temp));
+	memset(temp2, 0, sizeof(temp2));
 }
 
 static void
@@ -116,7 +117,7 @@ fieldAddTest(void){
 	ecc_fieldAdd(one, one, ecc_prime_r, temp);
 	assert(ecc_isSame(temp, two, arrayLength));
 	nullEverything();
-	ecc_add(full, one, temp, 32);
+	ecc_add(full, one, temp, arrayLength);
 	assert(ecc_isSame(null, temp, arrayLength));
 	nullEverything();
 	ecc_fieldAdd(full, one, ecc_prime_r, temp);
@@ -169,9 +170,76 @@ fieldModPTest(void){
 	ecc_fieldModP(temp, temp2);
 	assert(ecc_isSame(temp, resultDoubleMod, arrayLength));
 	nullEverything();
-	/*fieldMult(full, full, temp2, arrayLength); //not working, maybe because of the number bigger than p^2?
-	fieldModP(temp, temp2);
-	assert(ecc_isSame(temp, resultFullMod, arrayLength));*/
+	ecc_fieldMult(full, full, temp2, arrayLength);
+	ecc_fieldModP(temp, temp2);
+	assert(ecc_isSame(temp, resultFullMod, arrayLength));
+}
+
+//schoolbook multiplication as reference for ecc_fieldMult()
+static void
+referenceMult(const uint32_t *x, const uint32_t *y, uint32_t *result){
+	uint64_t l;
+	int k, n, i;
+
+	memset(result, 0, 16 * sizeof(uint32_t));
+	for (k = 0; k < arrayLength; k++){
+		for (n = 0; n < arrayLength; n++){
+			l = (uint64_t)x[n] * y[k];
+			for (i = n + k; l; i++){
+				l += result[i];
+				result[i] = (uint32_t)l;
+				l >>= 32;
+			}
+		}
+	}
+}
+
+//rand() only gives 31 bits
+static void
+setRandomFull(uint32_t *x){
+	int n;
+
+	for (n = 0; n < arrayLength; n++)
+		x[n] = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+}
+
+static void
+fieldMultPRandomTest(void){
+	uint32_t a[8];
+	uint32_t b[8];
+	uint32_t ref[16];
+	uint32_t ab[8];
+	int i;
+
+	for (i = 0; i < 1000; i++){
+		setRandomFull(a);
+		setRandomFull(b);
+		ecc_fieldMult(a, b, temp2, arrayLength);
+		referenceMult(a, b, ref);
+		assert(ecc_isSame(temp2, ref, arrayLength * 2));
+
+		//reduced input from here on
+		a[7] &= 0x7fffffff;
+		b[7] &= 0x7fffffff;
+		ecc_fieldMult(a, b, temp2, arrayLength);
+		referenceMult(a, b, ref);
+		assert(ecc_isSame(temp2, ref, arrayLength * 2));
+
+		ecc_fieldMultP(a, b, ab);
+		ecc_fieldModP(temp, temp2);
+		assert(ecc_isSame(ab, temp, arrayLength));
+		ecc_fieldSquareP(a, temp);
+		ecc_fieldMultP(a, a, ab);
+		assert(ecc_isSame(ab, temp, arrayLength));
+
+		//a * b * b^-1 = a
+		if (ecc_isSame(b, null, arrayLength))
+			continue;
+		ecc_fieldMultP(a, b, ab);
+		ecc_fieldInv(b, ecc_prime_m, ecc_prime_r, temp);
+		ecc_fieldMultP(ab, temp, temp);
+		assert(ecc_isSame(a, temp, arrayLength));
+	}
 }
 
 static void
@@ -264,6 +332,8 @@ PROCESS_THREAD(ecc_field_test, ev, d)
 	nullEverything();
 	fieldModPTest();
 	nullEverything();
+	fieldMultPRandomTest();
+	nullEverything();
 	fieldModOTest();
 	nullEverything();
 	fieldInvTest();
@@ -291,6 +361,8 @@ int main(int argc, char const *argv[])
 	nullEverything();
 	fieldModPTest();
 	nullEverything();
+	fieldMultPRandomTest();
+	nullEverything();
 	fieldModOTest();
 	nullEverything();
 	fieldInvTest();
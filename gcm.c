@@ -0,0 +1,375 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2011-2023 Olaf Bergmann (TZI) and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *******************************************************************************/
+
+#include <string.h>
+
+#include "tinydtls.h"
+#include "global.h"
+#include "numeric.h"
+#include "gcm.h"
+
+#ifdef DTLS_GCM_PCLMUL
+#include <cpuid.h>
+#include <wmmintrin.h>
+#include <tmmintrin.h>
+
+#ifndef bit_PCLMUL
+#define bit_PCLMUL (1 << 1)
+#endif
+#endif /* DTLS_GCM_PCLMUL */
+
+/*
+ * Portable GHASH with a 4-bit table (Shoup's method). H and the GHASH
+ * state are handled as two 64-bit halves, hh holding the first eight
+ * bytes in big-endian byte order.
+ */
+
+static const uint64_t last4[16] = {
+  0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+  0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0
+};
+
+static inline uint64_t
+load64_be(const unsigned char *p) {
+  return ((uint64_t)dtls_uint32_to_int(p) << 32) | dtls_uint32_to_int(p + 4);
+}
+
+static void
+gcm_gen_table(dtls_gcm_ghash_t *ghash, const unsigned char h[DTLS_GCM_BLOCKSIZE]) {
+  uint64_t vh, vl, t;
+  int i, j;
+
+  vh = load64_be(h);
+  vl = load64_be(h + 8);
+
+  /* 8 = 1000 corresponds to 1 in GF(2^128) */
+  ghash->u.table.hh[8] = vh;
+  ghash->u.table.hl[8] = vl;
+  ghash->u.table.hh[0] = 0;
+  ghash->u.table.hl[0] = 0;
+
+  for (i = 4; i > 0; i >>= 1) {
+    t = (vl & 1) * 0xe1000000U;
+    vl = (vh << 63) | (vl >> 1);
+    vh = (vh >> 1) ^ (t << 32);
+    ghash->u.table.hh[i] = vh;
+    ghash->u.table.hl[i] = vl;
+  }
+
+  for (i = 2; i <= 8; i *= 2) {
+    vh = ghash->u.table.hh[i];
+    vl = ghash->u.table.hl[i];
+    for (j = 1; j < i; j++) {
+      ghash->u.table.hh[i + j] = vh ^ ghash->u.table.hh[j];
+      ghash->u.table.hl[i + j] = vl ^ ghash->u.table.hl[j];
+    }
+  }
+}
+
+/* X = X * H */
+static void
+gcm_mult(const dtls_gcm_ghash_t *ghash, unsigned char X[DTLS_GCM_BLOCKSIZE]) {
+  const uint64_t *hh = ghash->u.table.hh, *hl = ghash->u.table.hl;
+  uint64_t zh, zl;
+  unsigned char lo, hi, rem;
+  int i;
+
+  lo = X[15] & 0xf;
+  zh = hh[lo];
+  zl = hl[lo];
+
+  for (i = 15; i >= 0; i--) {
+    lo = X[i] & 0xf;
+    hi = (X[i] >> 4) & 0xf;
+
+    if (i != 15) {
+      rem = (unsigned char)zl & 0xf;
+      zl = (zh << 60) | (zl >> 4);
+      zh = (zh >> 4) ^ (last4[rem] << 48);
+      zh ^= hh[lo];
+      zl ^= hl[lo];
+    }
+
+    rem = (unsigned char)zl & 0xf;
+    zl = (zh << 60) | (zl >> 4);
+    zh = (zh >> 4) ^ (last4[rem] << 48);
+    zh ^= hh[hi];
+    zl ^= hl[hi];
+  }
+
+  dtls_int_to_uint32(X, zh >> 32);
+  dtls_int_to_uint32(X + 4, zh);
+  dtls_int_to_uint32(X + 8, zl >> 32);
+  dtls_int_to_uint32(X + 12, zl);
+}
+
+#ifdef DTLS_GCM_PCLMUL
+/*
+ * GHASH with PCLMULQDQ, following Gueron and Kounavis, "Intel
+ * Carry-Less Multiplication Instruction and its Usage for Computing
+ * the GCM Mode". All blocks are byte-reversed so that the carry-less
+ * product can be reduced with shifts. Four blocks are multiplied with
+ * H^4 .. H^1 and reduced once.
+ */
+
+static int
+gcm_pclmul_available(void) {
+  static int available = -1;
+  unsigned int eax, ebx, ecx, edx;
+
+  if (available < 0) {
+    available = __get_cpuid(1, &eax, &ebx, &ecx, &edx) &&
+      (ecx & bit_PCLMUL) != 0;
+  }
+  return available;
+}
+
+/* Adds the 256-bit carry-less product a * b to lo and hi. */
+__attribute__((target("pclmul,ssse3"))) static inline void
+gcm_clmul(__m128i a, __m128i b, __m128i *lo, __m128i *hi) {
+  __m128i m;
+
+  m = _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x10),
+		    _mm_clmulepi64_si128(a, b, 0x01));
+  *lo = _mm_xor_si128(*lo, _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x00),
+					 _mm_slli_si128(m, 8)));
+  *hi = _mm_xor_si128(*hi, _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x11),
+					 _mm_srli_si128(m, 8)));
+}
+
+/* Reduces the 256-bit product lo, hi modulo the GCM polynomial. */
+__attribute__((target("pclmul,ssse3"))) static inline __m128i
+gcm_reduce(__m128i lo, __m128i hi) {
+  __m128i t7, t8, t9, t2;
+
+  /* shift the product left by one bit */
+  t7 = _mm_srli_epi32(lo, 31);
+  t8 = _mm_srli_epi32(hi, 31);
+  lo = _mm_slli_epi32(lo, 1);
+  hi = _mm_slli_epi32(hi, 1);
+  t9 = _mm_srli_si128(t7, 12);
+  t8 = _mm_slli_si128(t8, 4);
+  t7 = _mm_slli_si128(t7, 4);
+  lo = _mm_or_si128(lo, t7);
+  hi = _mm_or_si128(hi, t8);
+  hi = _mm_or_si128(hi, t9);
+
+  /* first phase of the reduction */
+  t7 = _mm_slli_epi32(lo, 31);
+  t8 = _mm_slli_epi32(lo, 30);
+  t9 = _mm_slli_epi32(lo, 25);
+  t7 = _mm_xor_si128(t7, t8);
+  t7 = _mm_xor_si128(t7, t9);
+  t8 = _mm_srli_si128(t7, 4);
+  t7 = _mm_slli_si128(t7, 12);
+  lo = _mm_xor_si128(lo, t7);
+
+  /* second phase of the reduction */
+  t2 = _mm_srli_epi32(lo, 1);
+  t2 = _mm_xor_si128(t2, _mm_srli_epi32(lo, 2));
+  t2 = _mm_xor_si128(t2, _mm_srli_epi32(lo, 7));
+  t2 = _mm_xor_si128(t2, t8);
+  lo = _mm_xor_si128(lo, t2);
+  return _mm_xor_si128(hi, lo);
+}
+
+__attribute__((target("pclmul,ssse3"))) static __m128i
+gcm_gfmul(__m128i a, __m128i b) {
+  __m128i lo = _mm_setzero_si128(), hi = _mm_setzero_si128();
+
+  gcm_clmul(a, b, &lo, &hi);
+  return gcm_reduce(lo, hi);
+}
+
+__attribute__((target("pclmul,ssse3"))) static void
+gcm_init_pclmul(dtls_gcm_ghash_t *ghash, const unsigned char h[DTLS_GCM_BLOCKSIZE]) {
+  const __m128i bswap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7,
+				     8, 9, 10, 11, 12, 13, 14, 15);
+  __m128i h1, hn;
+  int i;
+
+  h1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)h), bswap);
+  hn = h1;
+  _mm_storeu_si128((__m128i *)ghash->u.h[0], h1);
+  for (i = 1; i < 4; i++) {
+    hn = gcm_gfmul(hn, h1);
+    _mm_storeu_si128((__m128i *)ghash->u.h[i], hn);
+  }
+}
+
+__attribute__((target("pclmul,ssse3"))) static void
+ghash_pclmul(const dtls_gcm_ghash_t *ghash, unsigned char X[DTLS_GCM_BLOCKSIZE],
+	     const unsigned char *data, size_t len) {
+  const __m128i bswap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7,
+				     8, 9, 10, 11, 12, 13, 14, 15);
+  const __m128i h1 = _mm_loadu_si128((const __m128i *)ghash->u.h[0]);
+  const __m128i h2 = _mm_loadu_si128((const __m128i *)ghash->u.h[1]);
+  const __m128i h3 = _mm_loadu_si128((const __m128i *)ghash->u.h[2]);
+  const __m128i h4 = _mm_loadu_si128((const __m128i *)ghash->u.h[3]);
+  unsigned char B[DTLS_GCM_BLOCKSIZE];
+  __m128i x, lo, hi;
+
+  x = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)X), bswap);
+
+  while (len >= 4 * DTLS_GCM_BLOCKSIZE) {
+    lo = _mm_setzero_si128();
+    hi = _mm_setzero_si128();
+    x = _mm_xor_si128(x, _mm_shuffle_epi8(
+			  _mm_loadu_si128((const __m128i *)data), bswap));
+    gcm_clmul(x, h4, &lo, &hi);
+    gcm_clmul(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)data + 1),
+			       bswap), h3, &lo, &hi);
+    gcm_clmul(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)data + 2),
+			       bswap), h2, &lo, &hi);
+    gcm_clmul(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)data + 3),
+			       bswap), h1, &lo, &hi);
+    x = gcm_reduce(lo, hi);
+    data += 4 * DTLS_GCM_BLOCKSIZE;
+    len -= 4 * DTLS_GCM_BLOCKSIZE;
+  }
+
+  while (len) {
+    if (len < DTLS_GCM_BLOCKSIZE) {
+      /* the last partial block is padded with zeroes */
+      memset(B, 0, sizeof(B));
+      memcpy(B, data, len);
+      data = B;
+      len = DTLS_GCM_BLOCKSIZE;
+    }
+    x = _mm_xor_si128(x, _mm_shuffle_epi8(
+			  _mm_loadu_si128((const __m128i *)data), bswap));
+    x = gcm_gfmul(x, h1);
+    data += DTLS_GCM_BLOCKSIZE;
+    len -= DTLS_GCM_BLOCKSIZE;
+  }
+
+  _mm_storeu_si128((__m128i *)X, _mm_shuffle_epi8(x, bswap));
+}
+#endif /* DTLS_GCM_PCLMUL */
+
+/**
+ * Continues the GHASH in \p X over \p len bytes of \p data. The
+ * last partial block is padded with zeroes.
+ */
+static void
+gcm_ghash(const dtls_gcm_ghash_t *ghash, unsigned char X[DTLS_GCM_BLOCKSIZE],
+      const unsigned char *data, size_t len) {
+  size_t n;
+
+#ifdef DTLS_GCM_PCLMUL
+  if (ghash->pclmul) {
+    ghash_pclmul(ghash, X, data, len);
+    return;
+  }
+#endif /* DTLS_GCM_PCLMUL */
+
+  while (len) {
+    n = min(DTLS_GCM_BLOCKSIZE, len);
+    memxor(X, data, n);
+    gcm_mult(ghash, X);
+    data += n;
+    len -= n;
+  }
+}
+
+void
+dtls_gcm_init(dtls_gcm_ghash_t *ghash, rijndael_ctx *ctx) {
+  unsigned char h[DTLS_GCM_BLOCKSIZE];
+
+  memset(h, 0, sizeof(h));
+  rijndael_encrypt(ctx, h, h);
+
+  ghash->pclmul = 0;
+#ifdef DTLS_GCM_PCLMUL
+  if (ctx->aesni && gcm_pclmul_available()) {
+    ghash->pclmul = 1;
+    gcm_init_pclmul(ghash, h);
+  }
+#endif /* DTLS_GCM_PCLMUL */
+  if (!ghash->pclmul)
+    gcm_gen_table(ghash, h);
+
+  memset(h, 0, sizeof(h));
+}
+
+/**
+ * Computes the authentication tag over \p aad and the ciphertext \p c
+ * and stores it in \p T.
+ */
+static void
+gcm_tag(rijndael_ctx *ctx, const dtls_gcm_ghash_t *ghash,
+	const unsigned char nonce[DTLS_GCM_NONCE_SIZE],
+	const unsigned char *c, size_t lc,
+	const unsigned char *aad, size_t la,
+	unsigned char T[DTLS_GCM_BLOCKSIZE]) {
+  unsigned char J[DTLS_GCM_BLOCKSIZE];
+  unsigned char L[DTLS_GCM_BLOCKSIZE];
+
+  memset(T, 0, DTLS_GCM_BLOCKSIZE);
+  gcm_ghash(ghash, T, aad, la);
+  gcm_ghash(ghash, T, c, lc);
+
+  /* len(A) || len(C) in bits */
+  dtls_int_to_uint64(L, (uint64_t)la * 8);
+  dtls_int_to_uint64(L + 8, (uint64_t)lc * 8);
+  gcm_ghash(ghash, T, L, sizeof(L));
+
+  /* J_0 = nonce || 0^31 || 1 */
+  memcpy(J, nonce, DTLS_GCM_NONCE_SIZE);
+  dtls_int_to_uint32(J + DTLS_GCM_NONCE_SIZE, 1);
+  rijndael_encrypt(ctx, J, J);
+  memxor(T, J, DTLS_GCM_BLOCKSIZE);
+}
+
+long int
+dtls_gcm_encrypt_message(rijndael_ctx *ctx, const dtls_gcm_ghash_t *ghash,
+			 const unsigned char nonce[DTLS_GCM_NONCE_SIZE],
+			 unsigned char *msg, size_t lm,
+			 const unsigned char *aad, size_t la) {
+  unsigned char ctr[DTLS_GCM_BLOCKSIZE];
+  unsigned char T[DTLS_GCM_BLOCKSIZE];
+
+  /* the payload is encrypted starting with counter 2 */
+  memcpy(ctr, nonce, DTLS_GCM_NONCE_SIZE);
+  dtls_int_to_uint32(ctr + DTLS_GCM_NONCE_SIZE, 2);
+  rijndael_ctr32(ctx, ctr, msg, lm);
+
+  gcm_tag(ctx, ghash, nonce, msg, lm, aad, la, T);
+  memcpy(msg + lm, T, DTLS_GCM_TAG_SIZE);
+
+  return lm + DTLS_GCM_TAG_SIZE;
+}
+
+long int
+dtls_gcm_decrypt_message(rijndael_ctx *ctx, const dtls_gcm_ghash_t *ghash,
+			 const unsigned char nonce[DTLS_GCM_NONCE_SIZE],
+			 unsigned char *msg, size_t lm,
+			 const unsigned char *aad, size_t la) {
+  unsigned char ctr[DTLS_GCM_BLOCKSIZE];
+  unsigned char T[DTLS_GCM_BLOCKSIZE];
+
+  if (lm < DTLS_GCM_TAG_SIZE)
+    return -1;
+
+  lm -= DTLS_GCM_TAG_SIZE;
+
+  gcm_tag(ctx, ghash, nonce, msg, lm, aad, la, T);
+  if (!equals(T, msg + lm, DTLS_GCM_TAG_SIZE))
+    return -1;
+
+  memcpy(ctr, nonce, DTLS_GCM_NONCE_SIZE);
+  dtls_int_to_uint32(ctr + DTLS_GCM_NONCE_SIZE, 2);
+  rijndael_ctr32(ctx, ctr, msg, lm);
+
+  return lm;
+}
@@ -0,0 +1,96 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2011-2023 Olaf Bergmann (TZI) and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *******************************************************************************/
+
+#ifndef _DTLS_GCM_H_
+#define _DTLS_GCM_H_
+
+#include <stdint.h>
+
+#include "aes/rijndael.h"
+
+/* implementation of Galois/Counter Mode, NIST SP 800-38D */
+
+#define DTLS_GCM_BLOCKSIZE  16	/**< size of GHASH blocks */
+#define DTLS_GCM_TAG_SIZE   16	/**< size of the authentication tag */
+#define DTLS_GCM_NONCE_SIZE 12	/**< size of nonce */
+
+/* GHASH with PCLMULQDQ is available wherever the AES-NI backend is. */
+#ifdef RIJNDAEL_AESNI
+#define DTLS_GCM_PCLMUL 1
+#endif
+
+/**
+ * The hash subkey H = E(K, 0^128) prepared for GHASH. Set it up once
+ * per key with dtls_gcm_init().
+ */
+typedef struct {
+  union {
+    /** 4-bit multiplication table of H for the portable GHASH */
+    struct {
+      uint64_t hl[16];
+      uint64_t hh[16];
+    } table;
+    /** H, H^2, H^3 and H^4 in the byte order used with PCLMULQDQ */
+    unsigned char h[4][DTLS_GCM_BLOCKSIZE];
+  } u;
+  int pclmul;			/**< use the PCLMULQDQ GHASH */
+} dtls_gcm_ghash_t;
+
+/**
+ * Computes the hash subkey for the AES key schedule \p ctx. The
+ * PCLMULQDQ GHASH is used if \p ctx uses the AES-NI backend and the
+ * CPU supports it.
+ *
+ * \param ghash The hash subkey to set up.
+ * \param ctx   The initialized rijndael_ctx object of the GCM key.
+ */
+void dtls_gcm_init(dtls_gcm_ghash_t *ghash, rijndael_ctx *ctx);
+
+/**
+ * Authenticates and encrypts a message using AES in GCM mode. The
+ * encryption operation modifies the contents of \p msg and appends
+ * the \c DTLS_GCM_TAG_SIZE bytes authentication tag. Therefore, the
+ * buffer must be at least \p lm + \c DTLS_GCM_TAG_SIZE bytes large.
+ *
+ * \param ctx   The initialized rijndael_ctx object to be used for AES
+ *              operations.
+ * \param ghash The hash subkey set up with dtls_gcm_init() for \p ctx.
+ * \param nonce The \c DTLS_GCM_NONCE_SIZE bytes nonce.
+ * \param msg   The message to encrypt.
+ * \param lm    The actual length of \p msg.
+ * \param aad   A pointer to the additional authentication data (can be
+ *              \c NULL if \p la is zero).
+ * \param la    The number of additional authentication octets.
+ * \return The length of the encrypted message including the tag.
+ */
+long int
+dtls_gcm_encrypt_message(rijndael_ctx *ctx, const dtls_gcm_ghash_t *ghash,
+			 const unsigned char nonce[DTLS_GCM_NONCE_SIZE],
+			 unsigned char *msg, size_t lm,
+			 const unsigned char *aad, size_t la);
+
+/**
+ * Verifies and decrypts a message encrypted with
+ * dtls_gcm_encrypt_message(). The message is only decrypted if the
+ * authentication tag is valid.
+ *
+ * \return The length of the cleartext, or \c -1 if the message could
+ *         not be verified.
+ */
+long int
+dtls_gcm_decrypt_message(rijndael_ctx *ctx, const dtls_gcm_ghash_t *ghash,
+			 const unsigned char nonce[DTLS_GCM_NONCE_SIZE],
+			 unsigned char *msg, size_t lm,
+			 const unsigned char *aad, size_t la);
+
+#endif /* _DTLS_GCM_H_ */
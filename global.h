@@ -57,6 +57,18 @@ typedef unsigned char uint48[6];
 #endif /* WITH_CONTIKI || RIOT_VERSION */
 #endif
 
+#ifndef DTLS_MAX_REASSEMBLY
+/** Maximum length of a fragmented handshake message that can be
+    reassembled. The reassembly buffer holds the message with its 12
+    byte header and a bitmap of the received bytes, which must fit into
+    a netq node on platforms with fixed size nodes. */
+#if (defined(WITH_CONTIKI) || defined(RIOT_VERSION))
+#define DTLS_MAX_REASSEMBLY ((DTLS_MAX_BUF - 13) * 8 / 9)
+#else /* WITH_CONTIKI || RIOT_VERSION */
+#define DTLS_MAX_REASSEMBLY 4096
+#endif /* WITH_CONTIKI || RIOT_VERSION */
+#endif
+
 #ifndef DTLS_DEFAULT_MAX_RETRANSMIT
 /** Number of message retransmissions. */
 #define DTLS_DEFAULT_MAX_RETRANSMIT 7
@@ -65,8 +77,12 @@ typedef unsigned char uint48[6];
 /** Known cipher suites.*/
 typedef enum { 
   TLS_NULL_WITH_NULL_NULL = 0x0000,   /**< NULL cipher  */
+  TLS_PSK_WITH_AES_128_GCM_SHA256 = 0x00A8, /**< see RFC 5487 */
   TLS_PSK_WITH_AES_128_CCM_8 = 0xC0A8, /**< see RFC 6655 */
-  TLS_ECDHE_ECDSA_WITH_AES_128_CCM_8 = 0xC0AE /**< see RFC 7251 */
+  TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256 = 0xC02B, /**< see RFC 5289 */
+  TLS_ECDHE_ECDSA_WITH_AES_128_CCM_8 = 0xC0AE, /**< see RFC 7251 */
+  TLS_ECDHE_ECDSA_WITH_CHACHA20_POLY1305_SHA256 = 0xCCA9, /**< see RFC 7905 */
+  TLS_PSK_WITH_CHACHA20_POLY1305_SHA256 = 0xCCAB /**< see RFC 7905 */
 } dtls_cipher_t;
 
 /** Known compression suites.*/
@@ -81,10 +97,12 @@ typedef enum {
 #define TLS_EXT_SERVER_CERTIFICATE_TYPE	20 /* see RFC 7250 */
 #define TLS_EXT_ENCRYPT_THEN_MAC	22 /* see RFC 7366 */
 #define TLS_EXT_EXTENDED_MASTER_SECRET	23 /* see RFC 7627 */
+#define TLS_EXT_SESSION_TICKET		35 /* see RFC 5077 */
 
 #define TLS_CERT_TYPE_RAW_PUBLIC_KEY	2 /* see RFC 7250 */
 
 #define TLS_EXT_ELLIPTIC_CURVES_SECP256R1	23 /* see RFC 4492 */
+#define TLS_EXT_ELLIPTIC_CURVES_X25519		29 /* see RFC 8422 */
 
 #define TLS_EXT_EC_POINT_FORMATS_UNCOMPRESSED	0 /* see RFC 4492 */
 
@@ -34,31 +34,62 @@ dtls_hmac_update(dtls_hmac_context_t *ctx,
   dtls_hash_update(&ctx->data, input, ilen);
 }
 
-void
-dtls_hmac_init(dtls_hmac_context_t *ctx, const unsigned char *key, size_t klen) {
+/* Absorbs the ipad into inner and the opad into outer */
+static void
+dtls_hmac_pads(dtls_hash_ctx *inner, dtls_hash_ctx *outer,
+	       const unsigned char *key, size_t klen) {
+  unsigned char pad[DTLS_HMAC_BLOCKSIZE];
   int i;
 
-  assert(ctx);
-
-  memset(ctx, 0, sizeof(dtls_hmac_context_t));
+  memset(pad, 0, sizeof(pad));
 
   if (klen > DTLS_HMAC_BLOCKSIZE) {
-    dtls_hash_init(&ctx->data);
-    dtls_hash_update(&ctx->data, key, klen);
-    dtls_hash_finalize(ctx->pad, &ctx->data);
+    dtls_hash_init(inner);
+    dtls_hash_update(inner, key, klen);
+    dtls_hash_finalize(pad, inner);
   } else
-    memcpy(ctx->pad, key, klen);
+    memcpy(pad, key, klen);
 
   /* create ipad: */
   for (i=0; i < DTLS_HMAC_BLOCKSIZE; ++i)
-    ctx->pad[i] ^= 0x36;
+    pad[i] ^= 0x36;
 
-  dtls_hash_init(&ctx->data);
-  dtls_hmac_update(ctx, ctx->pad, DTLS_HMAC_BLOCKSIZE);
+  dtls_hash_init(inner);
+  dtls_hash_update(inner, pad, DTLS_HMAC_BLOCKSIZE);
 
   /* create opad by xor-ing pad[i] with 0x36 ^ 0x5C: */
   for (i=0; i < DTLS_HMAC_BLOCKSIZE; ++i)
-    ctx->pad[i] ^= 0x6A;
+    pad[i] ^= 0x6A;
+
+  dtls_hash_init(outer);
+  dtls_hash_update(outer, pad, DTLS_HMAC_BLOCKSIZE);
+
+  memset(pad, 0, sizeof(pad));
+}
+
+void
+dtls_hmac_init(dtls_hmac_context_t *ctx, const unsigned char *key, size_t klen) {
+  assert(ctx);
+
+  memset(ctx, 0, sizeof(dtls_hmac_context_t));
+  dtls_hmac_pads(&ctx->data, &ctx->outer, key, klen);
+}
+
+void
+dtls_hmac_key_init(dtls_hmac_key_t *key, const unsigned char *secret, size_t klen) {
+  assert(key);
+
+  memset(key, 0, sizeof(dtls_hmac_key_t));
+  dtls_hmac_pads(&key->inner, &key->outer, secret, klen);
+}
+
+void
+dtls_hmac_clone(dtls_hmac_context_t *ctx, const dtls_hmac_key_t *key) {
+  assert(ctx);
+  assert(key);
+
+  memcpy(&ctx->data, &key->inner, sizeof(dtls_hash_ctx));
+  memcpy(&ctx->outer, &key->outer, sizeof(dtls_hash_ctx));
 }
 
 int
@@ -71,8 +102,8 @@ dtls_hmac_finalize(dtls_hmac_context_t *ctx, unsigned char *result) {
   
   len = dtls_hash_finalize(buf, &ctx->data);
 
-  dtls_hash_init(&ctx->data);
-  dtls_hash_update(&ctx->data, ctx->pad, DTLS_HMAC_BLOCKSIZE);
+  /* the outer hash starts from the state after the opad */
+  memcpy(&ctx->data, &ctx->outer, sizeof(dtls_hash_ctx));
   dtls_hash_update(&ctx->data, buf, len);
 
   len = dtls_hash_finalize(result, &ctx->data);
@@ -80,6 +111,51 @@ dtls_hmac_finalize(dtls_hmac_context_t *ctx, unsigned char *result) {
   return len;
 }
 
+void
+dtls_hmac_multi(const dtls_hmac_key_t *key,
+		const unsigned char *msg[], const size_t mlen[],
+		size_t n, unsigned char *result[]) {
+#ifdef DTLS_SHA256_MULTI_MAX
+  dtls_hash_ctx ctx[DTLS_SHA256_MULTI_MAX];
+  dtls_hash_ctx *ctxp[DTLS_SHA256_MULTI_MAX];
+  unsigned char buf[DTLS_SHA256_MULTI_MAX][DTLS_HMAC_DIGEST_SIZE];
+  unsigned char *bufp[DTLS_SHA256_MULTI_MAX];
+  const unsigned char *inner[DTLS_SHA256_MULTI_MAX];
+  size_t ilen[DTLS_SHA256_MULTI_MAX];
+  size_t i, k, chunk;
+
+  for (i = 0; i < n; i += chunk) {
+    chunk = n - i < DTLS_SHA256_MULTI_MAX ? n - i : DTLS_SHA256_MULTI_MAX;
+
+    for (k = 0; k < chunk; k++) {
+      ctx[k] = key->inner;
+      ctxp[k] = &ctx[k];
+      bufp[k] = buf[k];
+    }
+    dtls_sha256_final_multi(ctxp, msg + i, mlen + i, chunk, bufp);
+
+    for (k = 0; k < chunk; k++) {
+      ctx[k] = key->outer;
+      inner[k] = buf[k];
+      ilen[k] = DTLS_HMAC_DIGEST_SIZE;
+    }
+    dtls_sha256_final_multi(ctxp, inner, ilen, chunk, result + i);
+  }
+  memset(buf, 0, sizeof(buf));
+#else /* DTLS_SHA256_MULTI_MAX */
+  dtls_hmac_context_t hmac;
+  size_t i;
+
+  /* the hash implementation has no multi-buffer interface */
+  for (i = 0; i < n; i++) {
+    dtls_hmac_clone(&hmac, key);
+    dtls_hmac_update(&hmac, msg[i], mlen[i]);
+    dtls_hmac_finalize(&hmac, result[i]);
+  }
+  memset(&hmac, 0, sizeof(hmac));
+#endif /* DTLS_SHA256_MULTI_MAX */
+}
+
 #ifdef HMAC_TEST
 #include <stdio.h>
 
@@ -102,16 +102,27 @@ typedef enum {
   HASH_SHA256=4, HASH_SHA384=5, HASH_SHA512=6
 } dtls_hashfunc_t;
 
+/**
+ * A HMAC key prepared with dtls_hmac_key_init(). It holds the hash
+ * states after the ipad and the opad block have been absorbed, so
+ * that each MAC started with dtls_hmac_clone() saves hashing the two
+ * pad blocks again.
+ */
+typedef struct {
+  dtls_hash_ctx inner;		/**< hash state after the ipad block */
+  dtls_hash_ctx outer;		/**< hash state after the opad block */
+} dtls_hmac_key_t;
+
 /**
  * Context for HMAC generation. This object is initialized with
- * dtls_hmac_init() and must be passed to dtls_hmac_update() and
- * dtls_hmac_finalize(). Once, finalized, the component \c H is
- * invalid and must be initialized again with dtls_hmac_init() before
+ * dtls_hmac_init() or dtls_hmac_clone() and must be passed to
+ * dtls_hmac_update() and dtls_hmac_finalize(). Once, finalized, the
+ * component \c H is invalid and must be initialized again before
  * the structure can be used again. 
  */
 typedef struct {
-  unsigned char pad[DTLS_HMAC_BLOCKSIZE]; /**< ipad and opad storage */
-  dtls_hash_ctx data;		          /**< context for hash function */
+  dtls_hash_ctx outer;		/**< hash state after the opad block */
+  dtls_hash_ctx data;		/**< context for hash function */
 } dtls_hmac_context_t;
 
 /**
@@ -123,6 +134,26 @@ typedef struct {
  */
 void dtls_hmac_init(dtls_hmac_context_t *ctx, const unsigned char *key, size_t klen);
 
+/**
+ * Prepares \p key for use with dtls_hmac_clone(). The result depends
+ * on the secret only and can be kept as long as the secret is used.
+ *
+ * @param key    The HMAC key to initialize.
+ * @param secret The secret key.
+ * @param klen   The length of @p secret.
+ */
+void dtls_hmac_key_init(dtls_hmac_key_t *key, const unsigned char *secret, size_t klen);
+
+/**
+ * Initializes an existing HMAC context from a prepared key. The
+ * result is the same as calling dtls_hmac_init() with the secret
+ * \p key has been prepared from.
+ *
+ * @param ctx The HMAC context to initialize.
+ * @param key The key prepared with dtls_hmac_key_init().
+ */
+void dtls_hmac_clone(dtls_hmac_context_t *ctx, const dtls_hmac_key_t *key);
+
 /**
  * Updates the HMAC context with data from \p input. 
  * 
@@ -146,6 +177,23 @@ void dtls_hmac_update(dtls_hmac_context_t *ctx,
  */
 int dtls_hmac_finalize(dtls_hmac_context_t *ctx, unsigned char *result);
 
+/**
+ * Computes the HMAC of \p n messages that use the same \p key. The
+ * result is the same as calling dtls_hmac_clone(), dtls_hmac_update()
+ * and dtls_hmac_finalize() for each message, but the messages are
+ * processed in parallel if the hash implementation supports it. Each
+ * buffer in \p result must hold \c DTLS_HMAC_DIGEST_SIZE bytes.
+ *
+ * \param key    The key prepared with dtls_hmac_key_init().
+ * \param msg    The messages.
+ * \param mlen   The lengths of the messages in \p msg.
+ * \param n      The number of messages.
+ * \param result Output parameters where the MACs are written to.
+ */
+void dtls_hmac_multi(const dtls_hmac_key_t *key,
+		     const unsigned char *msg[], const size_t mlen[],
+		     size_t n, unsigned char *result[]);
+
 /**@}*/
 
 #endif /* _DTLS_HMAC_H_ */
@@ -28,6 +28,7 @@
 #include "tinydtls.h"
 #include "global.h"
 #include "session.h"
+#include "dtls_time.h"
 
 #include "state.h"
 #include "crypto.h"
@@ -41,6 +42,17 @@ typedef enum { DTLS_CLIENT=0, DTLS_SERVER } dtls_peer_type;
 /** 
  * Holds security parameters, local state and the transport address
  * for each peer. */
+/**
+ * Round-trip estimate of a peer as in RFC 6298, taken from the
+ * handshake flights exchanged with it.
+ */
+typedef struct {
+  clock_time_t srtt;		/**< smoothed round-trip time, scaled by 8 */
+  clock_time_t rttvar;		/**< round-trip time variation, scaled by 4 */
+  clock_time_t rto;		/**< retransmission timeout of the next flight */
+  unsigned long samples;	/**< round trips measured, 0 for none */
+} dtls_peer_rtt_t;
+
 typedef struct dtls_peer_t {
 #ifdef DTLS_PEERS_NOHASH
   struct dtls_peer_t *next;
@@ -56,6 +68,7 @@ typedef struct dtls_peer_t {
 
   dtls_security_parameters_t *security_params[2];
   dtls_handshake_parameters_t *handshake_params;
+  dtls_peer_rtt_t rtt;	     /**< round-trip estimate for the retransmission timeout */
 } dtls_peer_t;
 
 /**
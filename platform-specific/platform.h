@@ -36,6 +36,30 @@
 #define DTLS_PSK
 #endif
 
+/* support for the AES_128_GCM_SHA256 cipher suites */
+#ifndef DTLS_CONF_GCM
+#define DTLS_CONF_GCM 0
+#endif
+#if DTLS_CONF_GCM
+#define DTLS_GCM
+#endif
+
+/* support for the CHACHA20_POLY1305_SHA256 cipher suites */
+#ifndef DTLS_CONF_CHACHA20
+#define DTLS_CONF_CHACHA20 0
+#endif
+#if DTLS_CONF_CHACHA20
+#define DTLS_CHACHA20
+#endif
+
+/* support for the x25519 ECDHE group */
+#ifndef DTLS_CONF_X25519
+#define DTLS_CONF_X25519 0
+#endif
+#if DTLS_CONF_X25519
+#define DTLS_X25519
+#endif
+
 /* Disable all debug output and assertions */
 #ifndef DTLS_CONF_NDEBUG
 #if DTLS_CONF_NDEBUG
@@ -579,6 +579,76 @@ void dtls_sha256_transform(dtls_sha256_ctx* context, const sha2_byte* data) {
 
 #endif /* SHA2_UNROLL_TRANSFORM */
 
+#ifdef SHA2_X86
+/* implementation in use, resolved on first use */
+static dtls_sha256_impl_t sha256_impl = DTLS_SHA256_IMPL_AUTO;
+#endif
+
+int dtls_sha256_set_impl(dtls_sha256_impl_t impl) {
+	switch (impl) {
+	case DTLS_SHA256_IMPL_AUTO:
+	case DTLS_SHA256_IMPL_GENERIC:
+		break;
+#ifdef SHA2_X86
+	case DTLS_SHA256_IMPL_AVX2:
+		if (!dtls_sha256_avx2_available())
+			return -1;
+		break;
+	case DTLS_SHA256_IMPL_SHANI:
+		if (!dtls_sha256_shani_available())
+			return -1;
+		break;
+#else /* SHA2_X86 */
+	case DTLS_SHA256_IMPL_AVX2:
+	case DTLS_SHA256_IMPL_SHANI:
+#endif /* SHA2_X86 */
+	default:
+		return -1;
+	}
+#ifdef SHA2_X86
+	sha256_impl = impl;
+#endif
+	return 0;
+}
+
+dtls_sha256_impl_t dtls_sha256_get_impl(void) {
+#ifdef SHA2_X86
+	if (sha256_impl == DTLS_SHA256_IMPL_AUTO) {
+		if (dtls_sha256_shani_available())
+			sha256_impl = DTLS_SHA256_IMPL_SHANI;
+		else if (dtls_sha256_avx2_available())
+			sha256_impl = DTLS_SHA256_IMPL_AVX2;
+		else
+			sha256_impl = DTLS_SHA256_IMPL_GENERIC;
+	}
+	return sha256_impl;
+#else
+	return DTLS_SHA256_IMPL_GENERIC;
+#endif
+}
+
+/* Processes nblocks complete blocks with the selected implementation */
+static void dtls_sha256_blocks(dtls_sha256_ctx* context, const sha2_byte* data, size_t nblocks) {
+#ifdef SHA2_X86
+	switch (dtls_sha256_get_impl()) {
+	case DTLS_SHA256_IMPL_SHANI:
+		dtls_sha256_blocks_shani(context->state, data, nblocks);
+		return;
+	case DTLS_SHA256_IMPL_AVX2:
+		dtls_sha256_blocks_avx2(context->state, data, nblocks);
+		return;
+	case DTLS_SHA256_IMPL_AUTO:
+	case DTLS_SHA256_IMPL_GENERIC:
+	default:
+		break;
+	}
+#endif /* SHA2_X86 */
+	while (nblocks--) {
+		dtls_sha256_transform(context, data);
+		data += DTLS_SHA256_BLOCK_LENGTH;
+	}
+}
+
 void dtls_sha256_update(dtls_sha256_ctx* context, const sha2_byte *data, size_t len) {
 	unsigned int	freespace, usedspace;
 
@@ -601,7 +671,7 @@ void dtls_sha256_update(dtls_sha256_ctx* context, const sha2_byte *data, size_t
 			context->bitcount += freespace << 3;
 			len -= freespace;
 			data += freespace;
-			dtls_sha256_transform(context, context->buffer);
+			dtls_sha256_blocks(context, context->buffer, 1);
 		} else {
 			/* The buffer is not yet full */
 			MEMCPY_BCOPY(&context->buffer[usedspace], data, len);
@@ -611,12 +681,14 @@ void dtls_sha256_update(dtls_sha256_ctx* context, const sha2_byte *data, size_t
 			return;
 		}
 	}
-	while (len >= DTLS_SHA256_BLOCK_LENGTH) {
+	if (len >= DTLS_SHA256_BLOCK_LENGTH) {
 		/* Process as many complete blocks as we can */
-		dtls_sha256_transform(context, data);
-		context->bitcount += DTLS_SHA256_BLOCK_LENGTH << 3;
-		len -= DTLS_SHA256_BLOCK_LENGTH;
-		data += DTLS_SHA256_BLOCK_LENGTH;
+		size_t nblocks = len / DTLS_SHA256_BLOCK_LENGTH;
+
+		dtls_sha256_blocks(context, data, nblocks);
+		context->bitcount += (sha2_word64)nblocks * DTLS_SHA256_BLOCK_LENGTH << 3;
+		len -= nblocks * DTLS_SHA256_BLOCK_LENGTH;
+		data += nblocks * DTLS_SHA256_BLOCK_LENGTH;
 	}
 	if (len > 0) {
 		/* There's left-overs, so save 'em */
@@ -653,7 +725,7 @@ void dtls_sha256_final(uint8_t digest[DTLS_SHA256_DIGEST_LENGTH], dtls_sha256_ct
 					MEMSET_BZERO(&context->buffer[usedspace], DTLS_SHA256_BLOCK_LENGTH - usedspace);
 				}
 				/* Do second-to-last transform: */
-				dtls_sha256_transform(context, context->buffer);
+				dtls_sha256_blocks(context, context->buffer, 1);
 
 				/* And set-up for the last transform: */
 				MEMSET_BZERO(context->buffer, DTLS_SHA256_SHORT_BLOCK_LENGTH);
@@ -670,7 +742,7 @@ void dtls_sha256_final(uint8_t digest[DTLS_SHA256_DIGEST_LENGTH], dtls_sha256_ct
 		MEMCPY_BCOPY(context->buffer+DTLS_SHA256_SHORT_BLOCK_LENGTH,
 					 (void *)&context->bitcount, sizeof(context->bitcount));
 		/* Final transform: */
-		dtls_sha256_transform(context, context->buffer);
+		dtls_sha256_blocks(context, context->buffer, 1);
 
 		{
 			/* Convert TO host byte order */
@@ -687,6 +759,119 @@ void dtls_sha256_final(uint8_t digest[DTLS_SHA256_DIGEST_LENGTH], dtls_sha256_ct
 	usedspace = 0;
 }
 
+/*
+ * Number of messages hashed in parallel, 0 if there is no multi-buffer
+ * backend. A single SHA-NI stream is as fast as eight AVX2 lanes, so
+ * the lanes are only used with the other implementations.
+ */
+static unsigned int dtls_sha256_multi_lanes(void) {
+#ifdef SHA2_X86
+	switch (dtls_sha256_get_impl()) {
+	case DTLS_SHA256_IMPL_AVX2:
+		return 8;
+	case DTLS_SHA256_IMPL_GENERIC:
+		return dtls_sha256_sse2_available() ? 4 : 0;
+	case DTLS_SHA256_IMPL_SHANI:
+	case DTLS_SHA256_IMPL_AUTO:
+	default:
+		break;
+	}
+#endif /* SHA2_X86 */
+	return 0;
+}
+
+#ifdef SHA2_X86
+/* Hashes the final blocks of n <= lanes messages in parallel */
+static void dtls_sha256_final_lanes(dtls_sha256_ctx *ctx[], const sha2_byte *data[],
+				    const size_t len[], unsigned int n, sha2_byte *digest[],
+				    unsigned int lanes) {
+	sha2_word32	st[8][DTLS_SHA256_MULTI_MAX];
+	sha2_byte	tail[DTLS_SHA256_MULTI_MAX][2 * DTLS_SHA256_BLOCK_LENGTH];
+	const sha2_byte	*block[DTLS_SHA256_MULTI_MAX];
+	size_t		nfull[DTLS_SHA256_MULTI_MAX], nblocks[DTLS_SHA256_MULTI_MAX];
+	size_t		i, j, rest, step, steps = 0;
+	unsigned int	mask;
+
+	for (i = 0; i < lanes; i++) {
+		nfull[i] = nblocks[i] = 0;
+		if (i >= n) {
+			for (j = 0; j < 8; j++)
+				st[j][i] = 0;
+			continue;
+		}
+		assert(((ctx[i]->bitcount >> 3) % DTLS_SHA256_BLOCK_LENGTH) == 0);
+
+		/* full blocks are read from data, the rest is padded in tail */
+		nfull[i] = len[i] / DTLS_SHA256_BLOCK_LENGTH;
+		rest = len[i] % DTLS_SHA256_BLOCK_LENGTH;
+		nblocks[i] = rest < DTLS_SHA256_SHORT_BLOCK_LENGTH ? 1 : 2;
+		MEMSET_BZERO(tail[i], nblocks[i] * DTLS_SHA256_BLOCK_LENGTH);
+		if (rest)
+			MEMCPY_BCOPY(tail[i], data[i] + len[i] - rest, rest);
+		tail[i][rest] = 0x80;
+		put32be(tail[i] + nblocks[i] * DTLS_SHA256_BLOCK_LENGTH - 8,
+			(sha2_word32)((ctx[i]->bitcount + ((sha2_word64)len[i] << 3)) >> 32));
+		put32be(tail[i] + nblocks[i] * DTLS_SHA256_BLOCK_LENGTH - 4,
+			(sha2_word32)(ctx[i]->bitcount + ((sha2_word64)len[i] << 3)));
+		nblocks[i] += nfull[i];
+		if (nblocks[i] > steps)
+			steps = nblocks[i];
+
+		for (j = 0; j < 8; j++)
+			st[j][i] = ctx[i]->state[j];
+	}
+
+	for (step = 0; step < steps; step++) {
+		mask = 0;
+		for (i = 0; i < lanes; i++) {
+			if (step < nfull[i]) {
+				block[i] = data[i] + step * DTLS_SHA256_BLOCK_LENGTH;
+			} else if (step < nblocks[i]) {
+				block[i] = tail[i] + (step - nfull[i]) * DTLS_SHA256_BLOCK_LENGTH;
+			} else {
+				/* finished or unused lane, the result is discarded */
+				block[i] = tail[0];
+				continue;
+			}
+			mask |= 1U << i;
+		}
+		if (lanes == 8)
+			dtls_sha256_x8_avx2(st, block, mask);
+		else
+			dtls_sha256_x4_sse2(st, block, mask);
+	}
+
+	for (i = 0; i < n; i++) {
+		for (j = 0; j < 8; j++)
+			put32be(digest[i] + 4 * j, st[j][i]);
+		MEMSET_BZERO(ctx[i], sizeof(*ctx[i]));
+	}
+	MEMSET_BZERO(tail, sizeof(tail));
+}
+#endif /* SHA2_X86 */
+
+void dtls_sha256_final_multi(dtls_sha256_ctx *ctx[], const sha2_byte *data[],
+			     const size_t len[], size_t n, sha2_byte *digest[]) {
+	unsigned int	lanes = dtls_sha256_multi_lanes();
+	size_t		i;
+
+	/* a single message is not worth the transposition */
+	if (lanes == 0 || n < 2) {
+		for (i = 0; i < n; i++) {
+			dtls_sha256_update(ctx[i], data[i], len[i]);
+			dtls_sha256_final(digest[i], ctx[i]);
+		}
+		return;
+	}
+#ifdef SHA2_X86
+	for (i = 0; i < n; i += lanes) {
+		dtls_sha256_final_lanes(ctx + i, data + i, len + i,
+					n - i < lanes ? (unsigned int)(n - i) : lanes,
+					digest + i, lanes);
+	}
+#endif /* SHA2_X86 */
+}
+
 char *dtls_sha256_end(dtls_sha256_ctx* context, char buffer[DTLS_SHA256_DIGEST_STRING_LENGTH]) {
 	sha2_byte	digest[DTLS_SHA256_DIGEST_LENGTH], *d = digest;
 	int		i;
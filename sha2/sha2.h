@@ -67,6 +67,27 @@ extern "C" {
 #define DTLS_SHA512_DIGEST_STRING_LENGTH	(DTLS_SHA512_DIGEST_LENGTH * 2 + 1)
 
 
+/*
+ * SHA-NI and AVX2 are available as alternative SHA-256 backends on x86
+ * when building with gcc or clang. Define SHA2_NO_X86 to disable them.
+ */
+#if !defined(SHA2_NO_X86) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define SHA2_X86 1
+#endif
+
+/* SHA-256 implementations that can be selected with dtls_sha256_set_impl() */
+typedef enum {
+	DTLS_SHA256_IMPL_AUTO = 0,	/* fastest one supported by the CPU */
+	DTLS_SHA256_IMPL_GENERIC,	/* portable C implementation */
+	DTLS_SHA256_IMPL_AVX2,		/* AVX2 message schedule */
+	DTLS_SHA256_IMPL_SHANI		/* SHA extensions */
+} dtls_sha256_impl_t;
+
+/* maximum number of messages hashed in parallel by dtls_sha256_final_multi() */
+#define DTLS_SHA256_MULTI_MAX		8
+
+
 /*** SHA-256/384/512 Context Structures *******************************/
 /* NOTE: If your architecture does not define either u_intXX_t types or
  * uintXX_t (from inttypes.h), you may need to define things by hand
@@ -208,6 +229,37 @@ char* dtls_sha512_data();
 
 #endif /* NOPROTO */
 
+#ifdef WITH_SHA256
+/*
+ * Selects the SHA-256 implementation used by all contexts. Returns 0
+ * on success, or -1 if impl is not available on this CPU or build.
+ */
+int dtls_sha256_set_impl(dtls_sha256_impl_t impl);
+/* Returns the SHA-256 implementation in use. */
+dtls_sha256_impl_t dtls_sha256_get_impl(void);
+
+/*
+ * Same as calling dtls_sha256_update(ctx[i], data[i], len[i]) and
+ * dtls_sha256_final(digest[i], ctx[i]) for i < n, but up to
+ * DTLS_SHA256_MULTI_MAX messages are hashed at once using the SIMD
+ * lanes of the CPU. All contexts must have been fed complete blocks
+ * only, as it is the case after a HMAC key has been absorbed.
+ */
+void dtls_sha256_final_multi(dtls_sha256_ctx *ctx[], const uint8_t *data[],
+			     const size_t len[], size_t n, uint8_t *digest[]);
+
+/* x86 backends, see sha2_x86.c */
+#ifdef SHA2_X86
+int dtls_sha256_shani_available(void);
+int dtls_sha256_avx2_available(void);
+void dtls_sha256_blocks_shani(uint32_t state[8], const uint8_t *data, size_t nblocks);
+void dtls_sha256_blocks_avx2(uint32_t state[8], const uint8_t *data, size_t nblocks);
+int dtls_sha256_sse2_available(void);
+void dtls_sha256_x8_avx2(uint32_t st[8][DTLS_SHA256_MULTI_MAX], const uint8_t *block[8], unsigned int mask);
+void dtls_sha256_x4_sse2(uint32_t st[8][DTLS_SHA256_MULTI_MAX], const uint8_t *block[4], unsigned int mask);
+#endif /* SHA2_X86 */
+#endif /* WITH_SHA256 */
+
 #ifdef	__cplusplus
 }
 #endif /* __cplusplus */
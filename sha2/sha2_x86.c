@@ -0,0 +1,493 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2011-2023 Olaf Bergmann (TZI) and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *******************************************************************************/
+
+/*
+ * SHA-256 compression using the x86 SHA extensions (SHA-NI), an AVX2
+ * variant that computes the message schedule of two blocks at a time,
+ * and SSE2/AVX2 kernels that hash four or eight independent messages
+ * side by side for dtls_sha256_final_multi(). The functions are compiled for their target only, so the
+ * library can still be built for and run on CPUs without these
+ * instructions. dtls_sha256_set_impl() checks the CPU via cpuid before
+ * this code is used.
+ */
+
+#include "tinydtls.h"
+#include "sha2.h"
+
+#if defined(WITH_SHA256) && defined(SHA2_X86)
+
+#include <cpuid.h>
+#include <immintrin.h>
+
+#ifndef bit_SSE2
+#define bit_SSE2 (1 << 26)
+#endif
+#ifndef bit_SSSE3
+#define bit_SSSE3 (1 << 9)
+#endif
+#ifndef bit_SSE4_1
+#define bit_SSE4_1 (1 << 19)
+#endif
+#ifndef bit_OSXSAVE
+#define bit_OSXSAVE (1 << 27)
+#endif
+#ifndef bit_AVX
+#define bit_AVX (1 << 28)
+#endif
+#ifndef bit_AVX2
+#define bit_AVX2 (1 << 5)
+#endif
+#ifndef bit_BMI2
+#define bit_BMI2 (1 << 8)
+#endif
+#ifndef bit_SHA
+#define bit_SHA (1 << 29)
+#endif
+
+/* same as K256 in sha2.c */
+static const uint32_t K256[64] = {
+	0x428a2f98UL, 0x71374491UL, 0xb5c0fbcfUL, 0xe9b5dba5UL,
+	0x3956c25bUL, 0x59f111f1UL, 0x923f82a4UL, 0xab1c5ed5UL,
+	0xd807aa98UL, 0x12835b01UL, 0x243185beUL, 0x550c7dc3UL,
+	0x72be5d74UL, 0x80deb1feUL, 0x9bdc06a7UL, 0xc19bf174UL,
+	0xe49b69c1UL, 0xefbe4786UL, 0x0fc19dc6UL, 0x240ca1ccUL,
+	0x2de92c6fUL, 0x4a7484aaUL, 0x5cb0a9dcUL, 0x76f988daUL,
+	0x983e5152UL, 0xa831c66dUL, 0xb00327c8UL, 0xbf597fc7UL,
+	0xc6e00bf3UL, 0xd5a79147UL, 0x06ca6351UL, 0x14292967UL,
+	0x27b70a85UL, 0x2e1b2138UL, 0x4d2c6dfcUL, 0x53380d13UL,
+	0x650a7354UL, 0x766a0abbUL, 0x81c2c92eUL, 0x92722c85UL,
+	0xa2bfe8a1UL, 0xa81a664bUL, 0xc24b8b70UL, 0xc76c51a3UL,
+	0xd192e819UL, 0xd6990624UL, 0xf40e3585UL, 0x106aa070UL,
+	0x19a4c116UL, 0x1e376c08UL, 0x2748774cUL, 0x34b0bcb5UL,
+	0x391c0cb3UL, 0x4ed8aa4aUL, 0x5b9cca4fUL, 0x682e6ff3UL,
+	0x748f82eeUL, 0x78a5636fUL, 0x84c87814UL, 0x8cc70208UL,
+	0x90befffaUL, 0xa4506cebUL, 0xbef9a3f7UL, 0xc67178f2UL
+};
+
+/* Returns the feature bits of cpuid leaf 7 in ebx, and stores those of
+ * leaf 1 in ecx to ecx1. */
+static unsigned int sha256_cpuid7(unsigned int *ecx1) {
+	unsigned int eax, ebx, ecx, edx;
+
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+		return 0;
+	*ecx1 = ecx;
+	if (__get_cpuid_max(0, NULL) < 7)
+		return 0;
+	__cpuid_count(7, 0, eax, ebx, ecx, edx);
+	return ebx;
+}
+
+int dtls_sha256_shani_available(void) {
+	static int available = -1;
+	unsigned int ecx1 = 0, ebx7;
+
+	if (available < 0) {
+		ebx7 = sha256_cpuid7(&ecx1);
+		available = (ebx7 & bit_SHA) != 0 &&
+		    (ecx1 & bit_SSSE3) != 0 && (ecx1 & bit_SSE4_1) != 0;
+	}
+	return available;
+}
+
+int dtls_sha256_avx2_available(void) {
+	static int available = -1;
+	unsigned int ecx1 = 0, ebx7, xcr0, edx;
+
+	if (available < 0) {
+		available = 0;
+		ebx7 = sha256_cpuid7(&ecx1);
+		/* the OS must save the YMM registers as well */
+		if ((ecx1 & bit_OSXSAVE) != 0 && (ecx1 & bit_AVX) != 0) {
+			__asm__ ("xgetbv" : "=a"(xcr0), "=d"(edx) : "c"(0));
+			available = (xcr0 & 6) == 6 &&
+			    (ebx7 & bit_AVX2) != 0 && (ebx7 & bit_BMI2) != 0;
+		}
+	}
+	return available;
+}
+
+/*
+ * Four rounds with the SHA extensions. cur holds the message words of
+ * these rounds. As in Intel's reference code, the schedule of the
+ * following rounds is computed alongside: next gets sha256msg2 for
+ * rounds 12 to 59, prev gets sha256msg1 for rounds 4 to 51.
+ */
+#define SHANI_ROUNDS(i, cur, next, prev) do {				\
+	msg = _mm_add_epi32(cur,					\
+	    _mm_loadu_si128((const __m128i *)&K256[4 * (i)]));		\
+	state1 = _mm_sha256rnds2_epu32(state1, state0, msg);		\
+	if ((i) >= 3 && (i) <= 14) {					\
+		tmp = _mm_alignr_epi8(cur, prev, 4);			\
+		next = _mm_sha256msg2_epu32(_mm_add_epi32(next, tmp),	\
+		    cur);						\
+	}								\
+	msg = _mm_shuffle_epi32(msg, 0x0e);				\
+	state0 = _mm_sha256rnds2_epu32(state0, state1, msg);		\
+	if ((i) >= 1 && (i) <= 12)					\
+		prev = _mm_sha256msg1_epu32(prev, cur);			\
+} while (0)
+
+__attribute__((target("sha,sse4.1,ssse3")))
+void dtls_sha256_blocks_shani(uint32_t state[8], const uint8_t *data, size_t nblocks) {
+	const __m128i bswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+	    0x0405060700010203ULL);
+	__m128i state0, state1, abef, cdgh, msg, tmp;
+	__m128i m0, m1, m2, m3;
+
+	/* the rounds instruction expects the state as ABEF and CDGH */
+	tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[0]), 0xb1);
+	state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[4]), 0x1b);
+	state0 = _mm_alignr_epi8(tmp, state1, 8);
+	state1 = _mm_blend_epi16(state1, tmp, 0xf0);
+
+	while (nblocks--) {
+		abef = state0;
+		cdgh = state1;
+
+		m0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)data), bswap);
+		m1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)data + 1), bswap);
+		m2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)data + 2), bswap);
+		m3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)data + 3), bswap);
+
+		SHANI_ROUNDS(0, m0, m1, m3);
+		SHANI_ROUNDS(1, m1, m2, m0);
+		SHANI_ROUNDS(2, m2, m3, m1);
+		SHANI_ROUNDS(3, m3, m0, m2);
+		SHANI_ROUNDS(4, m0, m1, m3);
+		SHANI_ROUNDS(5, m1, m2, m0);
+		SHANI_ROUNDS(6, m2, m3, m1);
+		SHANI_ROUNDS(7, m3, m0, m2);
+		SHANI_ROUNDS(8, m0, m1, m3);
+		SHANI_ROUNDS(9, m1, m2, m0);
+		SHANI_ROUNDS(10, m2, m3, m1);
+		SHANI_ROUNDS(11, m3, m0, m2);
+		SHANI_ROUNDS(12, m0, m1, m3);
+		SHANI_ROUNDS(13, m1, m2, m0);
+		SHANI_ROUNDS(14, m2, m3, m1);
+		SHANI_ROUNDS(15, m3, m0, m2);
+
+		state0 = _mm_add_epi32(state0, abef);
+		state1 = _mm_add_epi32(state1, cdgh);
+		data += DTLS_SHA256_BLOCK_LENGTH;
+	}
+
+	tmp = _mm_shuffle_epi32(state0, 0x1b);
+	state1 = _mm_shuffle_epi32(state1, 0xb1);
+	_mm_storeu_si128((__m128i *)&state[0], _mm_blend_epi16(tmp, state1, 0xf0));
+	_mm_storeu_si128((__m128i *)&state[4], _mm_alignr_epi8(state1, tmp, 8));
+}
+
+#undef SHANI_ROUNDS
+
+/* 32-bit rotate and shift of all lanes */
+#define ROR256(x, n)	_mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - (n)))
+#define sigma0_avx2(x)	_mm256_xor_si256(_mm256_xor_si256(ROR256(x, 7), ROR256(x, 18)), _mm256_srli_epi32(x, 3))
+#define sigma1_avx2(x)	_mm256_xor_si256(_mm256_xor_si256(ROR256(x, 17), ROR256(x, 19)), _mm256_srli_epi32(x, 10))
+
+/*
+ * Computes W[t] + K[t] for all 64 rounds of two blocks. Each 128-bit
+ * lane holds four consecutive words of one block: block b0 in the low
+ * and block b1 in the high lane.
+ */
+__attribute__((target("avx2")))
+static void sha256_schedule_avx2(const uint8_t *b0, const uint8_t *b1,
+				 uint32_t wk0[64], uint32_t wk1[64]) {
+	const __m256i bswap = _mm256_set_epi64x(0x0c0d0e0f08090a0bULL,
+	    0x0405060700010203ULL, 0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+	const __m256i lo = _mm256_set_epi32(0, 0, -1, -1, 0, 0, -1, -1);
+	__m256i x[4], w, s, k;
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		x[i] = _mm256_inserti128_si256(_mm256_castsi128_si256(
+		    _mm_loadu_si128((const __m128i *)b0 + i)),
+		    _mm_loadu_si128((const __m128i *)b1 + i), 1);
+		x[i] = _mm256_shuffle_epi8(x[i], bswap);
+	}
+
+	for (i = 0; i < 16; i++) {
+		k = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)&K256[4 * i]));
+		w = _mm256_add_epi32(x[i & 3], k);
+		_mm_storeu_si128((__m128i *)&wk0[4 * i], _mm256_castsi256_si128(w));
+		_mm_storeu_si128((__m128i *)&wk1[4 * i], _mm256_extracti128_si256(w, 1));
+
+		if (i >= 12)
+			continue;
+
+		/* W[t..t+3] from x[i & 3] = W[t-16..t-13] up to
+		 * x[(i + 3) & 3] = W[t-4..t-1] */
+		w = _mm256_add_epi32(x[i & 3],
+		    sigma0_avx2(_mm256_alignr_epi8(x[(i + 1) & 3], x[i & 3], 4)));
+		w = _mm256_add_epi32(w,
+		    _mm256_alignr_epi8(x[(i + 3) & 3], x[(i + 2) & 3], 4));
+		/* sigma1 depends on W[t-2] and W[t-1] for the first two new
+		 * words, and on the new words themselves for the others */
+		s = sigma1_avx2(_mm256_shuffle_epi32(x[(i + 3) & 3], 0xee));
+		w = _mm256_add_epi32(w, _mm256_and_si256(s, lo));
+		s = sigma1_avx2(_mm256_shuffle_epi32(w, 0x44));
+		x[i & 3] = _mm256_add_epi32(w, _mm256_andnot_si256(lo, s));
+	}
+}
+
+#define S32(b,x)	(((x) >> (b)) | ((x) << (32 - (b))))
+#define Ch(x,y,z)	(((x) & (y)) ^ ((~(x)) & (z)))
+#define Maj(x,y,z)	(((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+#define Sigma0_256(x)	(S32(2,  (x)) ^ S32(13, (x)) ^ S32(22, (x)))
+#define Sigma1_256(x)	(S32(6,  (x)) ^ S32(11, (x)) ^ S32(25, (x)))
+
+/* one round with the precomputed W[t] + K[t], the registers rotate by
+ * renaming instead of moving */
+#define ROUND256_WK(a,b,c,d,e,f,g,h,j) do {				\
+	T1 = (h) + Sigma1_256(e) + Ch((e), (f), (g)) + wk[j];		\
+	(d) += T1;							\
+	(h) = T1 + Sigma0_256(a) + Maj((a), (b), (c));			\
+} while (0)
+
+/* the 64 rounds with the precomputed W[t] + K[t] */
+__attribute__((target("avx2,bmi2")))
+static void sha256_rounds_avx2(uint32_t state[8], const uint32_t wk[64]) {
+	uint32_t a, b, c, d, e, f, g, h, T1;
+	int j;
+
+	a = state[0];
+	b = state[1];
+	c = state[2];
+	d = state[3];
+	e = state[4];
+	f = state[5];
+	g = state[6];
+	h = state[7];
+
+	for (j = 0; j < 64; j += 8) {
+		ROUND256_WK(a,b,c,d,e,f,g,h,j);
+		ROUND256_WK(h,a,b,c,d,e,f,g,j+1);
+		ROUND256_WK(g,h,a,b,c,d,e,f,j+2);
+		ROUND256_WK(f,g,h,a,b,c,d,e,j+3);
+		ROUND256_WK(e,f,g,h,a,b,c,d,j+4);
+		ROUND256_WK(d,e,f,g,h,a,b,c,j+5);
+		ROUND256_WK(c,d,e,f,g,h,a,b,j+6);
+		ROUND256_WK(b,c,d,e,f,g,h,a,j+7);
+	}
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+	state[5] += f;
+	state[6] += g;
+	state[7] += h;
+}
+
+__attribute__((target("avx2,bmi2")))
+void dtls_sha256_blocks_avx2(uint32_t state[8], const uint8_t *data, size_t nblocks) {
+	uint32_t wk0[64], wk1[64];
+
+	for (; nblocks >= 2; nblocks -= 2) {
+		sha256_schedule_avx2(data, data + DTLS_SHA256_BLOCK_LENGTH, wk0, wk1);
+		sha256_rounds_avx2(state, wk0);
+		sha256_rounds_avx2(state, wk1);
+		data += 2 * DTLS_SHA256_BLOCK_LENGTH;
+	}
+	if (nblocks) {
+		/* the high lane computes the same block again */
+		sha256_schedule_avx2(data, data, wk0, wk1);
+		sha256_rounds_avx2(state, wk0);
+	}
+}
+
+/*
+ * Multi-buffer SHA-256: every 32-bit lane of a vector register belongs
+ * to another message, so that 8 (AVX2) or 4 (SSE2) independent blocks
+ * go through the rounds together. The state is kept transposed,
+ * st[j][i] is word j of message i, the SSE2 variant uses the first
+ * four columns only. Lanes that are not set in mask keep their state,
+ * their block pointer must still be readable.
+ */
+
+int dtls_sha256_sse2_available(void) {
+#ifdef __x86_64__
+	return 1;
+#else
+	static int available = -1;
+	unsigned int eax, ebx, ecx, edx;
+
+	if (available < 0) {
+		available = __get_cpuid(1, &eax, &ebx, &ecx, &edx) &&
+		    (edx & bit_SSE2) != 0;
+	}
+	return available;
+#endif
+}
+
+#define MB_ROUND(V, a,b,c,d,e,f,g,h,j) do {				\
+	T1 = V##_add(V##_add(V##_add((h), V##_Sigma1(e)),		\
+	    V##_Ch((e), (f), (g))), V##_add(V##_set1(K256[j]), W[(j) & 15])); \
+	(d) = V##_add((d), T1);						\
+	(h) = V##_add(T1, V##_add(V##_Sigma0(a), V##_Maj((a), (b), (c)))); \
+} while (0)
+
+#define MB_SCHEDULE(V, j)						\
+	W[(j) & 15] = V##_add(V##_add(W[(j) & 15], V##_sigma1(W[((j) + 14) & 15])), \
+	    V##_add(W[((j) + 9) & 15], V##_sigma0(W[((j) + 1) & 15])))
+
+#define MB_ROUNDS(V) do {						\
+	for (j = 0; j < 64; j += 8) {					\
+		if (j >= 16) {						\
+			for (k = 0; k < 8; k++)				\
+				MB_SCHEDULE(V, j + k);			\
+		}							\
+		MB_ROUND(V, a,b,c,d,e,f,g,h,j);				\
+		MB_ROUND(V, h,a,b,c,d,e,f,g,j+1);			\
+		MB_ROUND(V, g,h,a,b,c,d,e,f,j+2);			\
+		MB_ROUND(V, f,g,h,a,b,c,d,e,j+3);			\
+		MB_ROUND(V, e,f,g,h,a,b,c,d,j+4);			\
+		MB_ROUND(V, d,e,f,g,h,a,b,c,j+5);			\
+		MB_ROUND(V, c,d,e,f,g,h,a,b,j+6);			\
+		MB_ROUND(V, b,c,d,e,f,g,h,a,j+7);			\
+	}								\
+} while (0)
+
+#define x8_add(x, y)	_mm256_add_epi32(x, y)
+#define x8_set1(x)	_mm256_set1_epi32((int)(x))
+#define x8_ror(x, n)	_mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - (n)))
+#define x8_xor3(x, y, z) _mm256_xor_si256(_mm256_xor_si256(x, y), z)
+#define x8_Sigma0(x)	x8_xor3(x8_ror(x, 2), x8_ror(x, 13), x8_ror(x, 22))
+#define x8_Sigma1(x)	x8_xor3(x8_ror(x, 6), x8_ror(x, 11), x8_ror(x, 25))
+#define x8_sigma0(x)	x8_xor3(x8_ror(x, 7), x8_ror(x, 18), _mm256_srli_epi32(x, 3))
+#define x8_sigma1(x)	x8_xor3(x8_ror(x, 17), x8_ror(x, 19), _mm256_srli_epi32(x, 10))
+#define x8_Ch(x, y, z)	_mm256_xor_si256(_mm256_and_si256(x, y), _mm256_andnot_si256(x, z))
+#define x8_Maj(x, y, z)	_mm256_or_si256(_mm256_and_si256(x, y), _mm256_and_si256(z, _mm256_or_si256(x, y)))
+
+/* loads words 0..7 of eight blocks at offset off, word j of block i
+ * into lane i of w[j] */
+__attribute__((target("avx2")))
+static void sha256_load_x8(const uint8_t *block[8], int off, __m256i w[8]) {
+	const __m256i bswap = _mm256_set_epi64x(0x0c0d0e0f08090a0bULL,
+	    0x0405060700010203ULL, 0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+	__m256i r[8], t[8], u[8];
+	int i;
+
+	for (i = 0; i < 8; i++)
+		r[i] = _mm256_shuffle_epi8(_mm256_loadu_si256(
+		    (const __m256i *)(block[i] + off)), bswap);
+	for (i = 0; i < 8; i += 2) {
+		t[i] = _mm256_unpacklo_epi32(r[i], r[i + 1]);
+		t[i + 1] = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+	}
+	for (i = 0; i < 8; i += 4) {
+		u[i] = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+		u[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+		u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+		u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+	}
+	for (i = 0; i < 4; i++) {
+		w[i] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+		w[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+	}
+}
+
+__attribute__((target("avx2")))
+void dtls_sha256_x8_avx2(uint32_t st[8][DTLS_SHA256_MULTI_MAX], const uint8_t *block[8], unsigned int mask) {
+	__m256i W[16], s[8], a, b, c, d, e, f, g, h, T1, m;
+	int j, k;
+
+	sha256_load_x8(block, 0, W);
+	sha256_load_x8(block, 32, W + 8);
+
+	for (j = 0; j < 8; j++)
+		s[j] = _mm256_loadu_si256((const __m256i *)st[j]);
+	a = s[0]; b = s[1]; c = s[2]; d = s[3];
+	e = s[4]; f = s[5]; g = s[6]; h = s[7];
+
+	MB_ROUNDS(x8);
+
+	m = _mm256_set_epi32(-((mask >> 7) & 1), -((mask >> 6) & 1),
+	    -((mask >> 5) & 1), -((mask >> 4) & 1), -((mask >> 3) & 1),
+	    -((mask >> 2) & 1), -((mask >> 1) & 1), -(mask & 1));
+	s[0] = _mm256_blendv_epi8(s[0], _mm256_add_epi32(s[0], a), m);
+	s[1] = _mm256_blendv_epi8(s[1], _mm256_add_epi32(s[1], b), m);
+	s[2] = _mm256_blendv_epi8(s[2], _mm256_add_epi32(s[2], c), m);
+	s[3] = _mm256_blendv_epi8(s[3], _mm256_add_epi32(s[3], d), m);
+	s[4] = _mm256_blendv_epi8(s[4], _mm256_add_epi32(s[4], e), m);
+	s[5] = _mm256_blendv_epi8(s[5], _mm256_add_epi32(s[5], f), m);
+	s[6] = _mm256_blendv_epi8(s[6], _mm256_add_epi32(s[6], g), m);
+	s[7] = _mm256_blendv_epi8(s[7], _mm256_add_epi32(s[7], h), m);
+	for (j = 0; j < 8; j++)
+		_mm256_storeu_si256((__m256i *)st[j], s[j]);
+}
+
+#define x4_add(x, y)	_mm_add_epi32(x, y)
+#define x4_set1(x)	_mm_set1_epi32((int)(x))
+#define x4_ror(x, n)	_mm_or_si128(_mm_srli_epi32(x, n), _mm_slli_epi32(x, 32 - (n)))
+#define x4_xor3(x, y, z) _mm_xor_si128(_mm_xor_si128(x, y), z)
+#define x4_Sigma0(x)	x4_xor3(x4_ror(x, 2), x4_ror(x, 13), x4_ror(x, 22))
+#define x4_Sigma1(x)	x4_xor3(x4_ror(x, 6), x4_ror(x, 11), x4_ror(x, 25))
+#define x4_sigma0(x)	x4_xor3(x4_ror(x, 7), x4_ror(x, 18), _mm_srli_epi32(x, 3))
+#define x4_sigma1(x)	x4_xor3(x4_ror(x, 17), x4_ror(x, 19), _mm_srli_epi32(x, 10))
+#define x4_Ch(x, y, z)	_mm_xor_si128(_mm_and_si128(x, y), _mm_andnot_si128(x, z))
+#define x4_Maj(x, y, z)	_mm_or_si128(_mm_and_si128(x, y), _mm_and_si128(z, _mm_or_si128(x, y)))
+
+/* byte swap of each 32-bit lane with SSE2 only */
+__attribute__((target("sse2")))
+static __m128i sha256_bswap_x4(__m128i x) {
+	x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+	x = _mm_shufflelo_epi16(x, 0xb1);
+	return _mm_shufflehi_epi16(x, 0xb1);
+}
+
+__attribute__((target("sse2")))
+void dtls_sha256_x4_sse2(uint32_t st[8][DTLS_SHA256_MULTI_MAX], const uint8_t *block[4], unsigned int mask) {
+	__m128i W[16], s[8], r[4], t[4], a, b, c, d, e, f, g, h, T1, m;
+	int i, j, k;
+
+	for (j = 0; j < 16; j += 4) {
+		for (i = 0; i < 4; i++)
+			r[i] = sha256_bswap_x4(_mm_loadu_si128(
+			    (const __m128i *)(block[i] + 4 * j)));
+		t[0] = _mm_unpacklo_epi32(r[0], r[1]);
+		t[1] = _mm_unpackhi_epi32(r[0], r[1]);
+		t[2] = _mm_unpacklo_epi32(r[2], r[3]);
+		t[3] = _mm_unpackhi_epi32(r[2], r[3]);
+		W[j] = _mm_unpacklo_epi64(t[0], t[2]);
+		W[j + 1] = _mm_unpackhi_epi64(t[0], t[2]);
+		W[j + 2] = _mm_unpacklo_epi64(t[1], t[3]);
+		W[j + 3] = _mm_unpackhi_epi64(t[1], t[3]);
+	}
+
+	for (j = 0; j < 8; j++)
+		s[j] = _mm_loadu_si128((const __m128i *)st[j]);
+	a = s[0]; b = s[1]; c = s[2]; d = s[3];
+	e = s[4]; f = s[5]; g = s[6]; h = s[7];
+
+	MB_ROUNDS(x4);
+
+	m = _mm_set_epi32(-((mask >> 3) & 1), -((mask >> 2) & 1),
+	    -((mask >> 1) & 1), -(mask & 1));
+#define MB_BLEND(x, v) \
+	_mm_or_si128(_mm_andnot_si128(m, x), _mm_and_si128(m, _mm_add_epi32(x, v)))
+	s[0] = MB_BLEND(s[0], a);
+	s[1] = MB_BLEND(s[1], b);
+	s[2] = MB_BLEND(s[2], c);
+	s[3] = MB_BLEND(s[3], d);
+	s[4] = MB_BLEND(s[4], e);
+	s[5] = MB_BLEND(s[5], f);
+	s[6] = MB_BLEND(s[6], g);
+	s[7] = MB_BLEND(s[7], h);
+#undef MB_BLEND
+	for (j = 0; j < 8; j++)
+		_mm_storeu_si128((__m128i *)st[j], s[j]);
+}
+
+#endif /* WITH_SHA256 && SHA2_X86 */
@@ -60,17 +60,88 @@ void printspeed(char *caption, unsigned long bytes, double time) {
 	}
 }
 
+/* Returns the best time of rep runs of SHA-256 over bytes bytes of buf */
+double best_sha256(char *buf, int bytes, int rep) {
+	dtls_sha256_ctx	c256;
+	char		md[DTLS_SHA256_DIGEST_STRING_LENGTH];
+	struct timeval	start, end;
+	double		t, best = 100000;
+	int		i, j;
+
+	for (i = 0; i < rep; i++) {
+		dtls_sha256_init(&c256);
+		gettimeofday(&start, (struct timezone*)0);
+		for (j = 0; j < bytes / BUFSIZE; j++) {
+			dtls_sha256_update(&c256, (unsigned char*)buf, BUFSIZE);
+		}
+		if (bytes % BUFSIZE) {
+			dtls_sha256_update(&c256, (unsigned char*)buf, bytes % BUFSIZE);
+		}
+		dtls_sha256_end(&c256, md);
+		gettimeofday(&end, (struct timezone*)0);
+		t = ((end.tv_sec - start.tv_sec) * 1000000.0 + (end.tv_usec - start.tv_usec)) / 1000000.0;
+		if (t < best) {
+			best = t;
+		}
+	}
+	return best;
+}
+
+/* Same as best_sha256(), but DTLS_SHA256_MULTI_MAX messages of
+ * BUFSIZE bytes are hashed in parallel until bytes have been hashed */
+double best_sha256_multi(char *buf, int bytes, int rep) {
+	dtls_sha256_ctx	c256[DTLS_SHA256_MULTI_MAX], *ctx[DTLS_SHA256_MULTI_MAX];
+	uint8_t		md[DTLS_SHA256_MULTI_MAX][DTLS_SHA256_DIGEST_LENGTH];
+	uint8_t		*digest[DTLS_SHA256_MULTI_MAX];
+	const uint8_t	*data[DTLS_SHA256_MULTI_MAX];
+	size_t		len[DTLS_SHA256_MULTI_MAX];
+	struct timeval	start, end;
+	double		t, best = 100000;
+	int		i, j, k;
+
+	for (k = 0; k < DTLS_SHA256_MULTI_MAX; k++) {
+		ctx[k] = &c256[k];
+		data[k] = (uint8_t*)buf;
+		len[k] = BUFSIZE;
+		digest[k] = md[k];
+	}
+	for (i = 0; i < rep; i++) {
+		gettimeofday(&start, (struct timezone*)0);
+		for (j = 0; j < bytes / (DTLS_SHA256_MULTI_MAX * BUFSIZE); j++) {
+			for (k = 0; k < DTLS_SHA256_MULTI_MAX; k++) {
+				dtls_sha256_init(&c256[k]);
+			}
+			dtls_sha256_final_multi(ctx, data, len, DTLS_SHA256_MULTI_MAX, digest);
+		}
+		gettimeofday(&end, (struct timezone*)0);
+		t = ((end.tv_sec - start.tv_sec) * 1000000.0 + (end.tv_usec - start.tv_usec)) / 1000000.0;
+		if (t < best) {
+			best = t;
+		}
+	}
+	return best;
+}
 
 int main(int argc, char **argv) {
+	static const struct {
+		dtls_sha256_impl_t	impl;
+		char			*name;
+	} backends[] = {
+		{ DTLS_SHA256_IMPL_GENERIC, "generic" },
+		{ DTLS_SHA256_IMPL_AVX2, "AVX2" },
+		{ DTLS_SHA256_IMPL_SHANI, "SHA-NI" }
+	};
 	dtls_sha256_ctx	c256;
 	dtls_sha384_ctx	c384;
 	dtls_sha512_ctx	c512;
 	char		buf[BUFSIZE];
 	char		md[DTLS_SHA512_DIGEST_STRING_LENGTH];
-	int		bytes, blocks, rep, i, j;
+	int		bytes, blocks, rep, i, j, multi;
 	struct timeval	start, end;
 	double		t, ave256, ave384, ave512;
-	double		best256, best384, best512;
+	double		best256, best384, best512, generic;
+	char		caption[64];
+	unsigned int	k;
 
 	if (argc > 4) {
 		usage(argv[0]);
@@ -171,6 +242,38 @@ int main(int argc, char **argv) {
 	printspeed("SHA-512 average:", bytes, ave512);
 	printspeed("SHA-512 best:   ", bytes, best512);
 
+	printf("\nSHA-256 PER BACKEND (best of %d):\n", rep);
+	generic = 0;
+	for (k = 0; k < sizeof(backends) / sizeof(backends[0]); k++) {
+		if (dtls_sha256_set_impl(backends[k].impl) < 0) {
+			printf("SHA-256 %-8s not available\n", backends[k].name);
+			continue;
+		}
+		t = best_sha256(buf, bytes, rep);
+		if (backends[k].impl == DTLS_SHA256_IMPL_GENERIC) {
+			generic = t;
+		}
+		snprintf(caption, sizeof(caption), "SHA-256 %-8s (%.2fx):",
+			 backends[k].name, generic / t);
+		printspeed(caption, bytes, t);
+	}
+
+	/* on x86, generic hashes four and AVX2 eight messages side by side,
+	 * SHA-NI hashes them one after another */
+	printf("\nSHA-256 %d MESSAGES IN PARALLEL (best of %d):\n",
+	       DTLS_SHA256_MULTI_MAX, rep);
+	multi = bytes / (DTLS_SHA256_MULTI_MAX * BUFSIZE) * DTLS_SHA256_MULTI_MAX * BUFSIZE;
+	for (k = 0; k < sizeof(backends) / sizeof(backends[0]); k++) {
+		if (dtls_sha256_set_impl(backends[k].impl) < 0) {
+			continue;
+		}
+		t = best_sha256_multi(buf, bytes, rep);
+		snprintf(caption, sizeof(caption), "SHA-256 %-8s (%.2fx):",
+			 backends[k].name, generic / t * multi / bytes);
+		printspeed(caption, multi, t);
+	}
+	dtls_sha256_set_impl(DTLS_SHA256_IMPL_AUTO);
+
 	return 1;
 }
 
@@ -0,0 +1,406 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2011-2023 Olaf Bergmann (TZI) and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *******************************************************************************/
+
+/*
+ * Measures the record protection throughput of AES-128-CCM-8 as used
+ * by dtls_prepare_record() and decrypt_verify(): once with the key
+ * schedule expanded for every record (dtls_encrypt_params()) and once
+ * with the key schedule cached in the security parameters
+ * (dtls_encrypt_params_ctx()). Finally, dtls_encrypt_params() and
+ * dtls_decrypt_params() are run from an increasing number of threads
+ * to show how the record path scales.
+ *
+ * The cached key schedule is also measured with each available AES
+ * backend (portable T-tables and AES-NI), and one record sent to
+ * several peers is encrypted once per peer with
+ * dtls_encrypt_params_ctx() and once with dtls_encrypt_params_multi().
+ * If built with DTLS_GCM, AES-128-GCM is compared against CCM-8 for
+ * several record sizes. If built with DTLS_CHACHA20, the same is done
+ * for ChaCha20-Poly1305, with both the portable and the SIMD
+ * implementation.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "tinydtls.h"
+#include "crypto.h"
+
+#define A_DATA_LEN 13
+#define MAX_RECORD 1024
+#define PEERS 8
+
+static const unsigned char key[DTLS_KEY_LENGTH] = {
+  0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7,
+  0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf
+};
+
+static double
+now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+usage(const char *prog) {
+  fprintf(stderr, "Usage:\t%s [<record-size>] [<num-of-records>] [<max-threads>]\n", prog);
+  exit(-1);
+}
+
+static size_t size = 64;
+static unsigned long records = 200000;
+static int worker_failed;
+
+/* Encrypts and decrypts records in a loop. Returns non-NULL if a
+ * record could not be verified. */
+static void *
+worker(void *arg) {
+  unsigned char nonce[DTLS_CCM_BLOCKSIZE];
+  unsigned char A_DATA[A_DATA_LEN];
+  unsigned char buf[MAX_RECORD + DTLS_CCM_MAX];
+  const dtls_ccm_params_t params = { nonce, 8, 3 };
+  unsigned long n;
+  int len;
+  (void)arg;
+
+  memset(nonce, 0, sizeof(nonce));
+  memset(A_DATA, 0x17, sizeof(A_DATA));
+  memset(buf, 0xa5, sizeof(buf));
+
+  for (n = 0; n < records; n++) {
+    nonce[DTLS_CCM_BLOCKSIZE - 4] = (unsigned char)n;
+    len = dtls_encrypt_params(&params, buf, size, buf,
+			      key, sizeof(key), A_DATA, A_DATA_LEN);
+    len = dtls_decrypt_params(&params, buf, len, buf,
+			      key, sizeof(key), A_DATA, A_DATA_LEN);
+    if (len != (int)size)
+      return &worker_failed;
+  }
+  return NULL;
+}
+
+/* Protects records of length bytes with a key schedule set up for impl
+ * and returns the time taken, or a negative value if impl is not
+ * available. */
+static double
+run_cached(rijndael_impl_t impl, size_t length, unsigned char *buf, int *len) {
+  unsigned char nonce[DTLS_CCM_BLOCKSIZE];
+  unsigned char A_DATA[A_DATA_LEN];
+  const dtls_ccm_params_t params = { nonce, 8, 3 };
+  rijndael_ctx key_ctx;
+  unsigned long n;
+  double start;
+
+  if (rijndael_set_impl(impl) < 0)
+    return -1;
+
+  memset(nonce, 0, sizeof(nonce));
+  memset(A_DATA, 0x17, sizeof(A_DATA));
+  memset(buf, 0xa5, MAX_RECORD + DTLS_CCM_MAX);
+
+  start = now();
+  if (rijndael_set_key_enc_only(&key_ctx, key, 8 * sizeof(key)) < 0)
+    return -1;
+  for (n = 0; n < records; n++) {
+    nonce[DTLS_CCM_BLOCKSIZE - 4] = (unsigned char)n;
+    *len = dtls_encrypt_params_ctx(&params, &key_ctx, buf, length, buf,
+				   A_DATA, A_DATA_LEN);
+  }
+  return now() - start;
+}
+
+/* Encrypts the same record for PEERS peers with different keys, one
+ * record at a time or all side by side with multi != 0. */
+static double
+run_fanout(int multi, unsigned char buf[PEERS][MAX_RECORD + DTLS_CCM_MAX],
+	   int *len) {
+  unsigned char nonce[PEERS][DTLS_CCM_BLOCKSIZE];
+  unsigned char A_DATA[PEERS][A_DATA_LEN];
+  dtls_ccm_params_t params[PEERS];
+  rijndael_ctx key_ctx[PEERS];
+  rijndael_ctx *key_ptr[PEERS];
+  unsigned char *data[PEERS];
+  const unsigned char *aad[PEERS];
+  unsigned char peer_key[DTLS_KEY_LENGTH];
+  unsigned long n;
+  double start;
+  int i;
+
+  for (i = 0; i < PEERS; i++) {
+    memcpy(peer_key, key, sizeof(peer_key));
+    peer_key[0] ^= i;
+    if (rijndael_set_key_enc_only(&key_ctx[i], peer_key, 8 * sizeof(peer_key)) < 0)
+      return -1;
+    memset(nonce[i], i, sizeof(nonce[i]));
+    memset(A_DATA[i], 0x17, sizeof(A_DATA[i]));
+    params[i].nonce = nonce[i];
+    params[i].tag_length = 8;
+    params[i].l = 3;
+    key_ptr[i] = &key_ctx[i];
+    data[i] = buf[i];
+    aad[i] = A_DATA[i];
+  }
+
+  start = now();
+  for (n = 0; n < records; n += PEERS) {
+    for (i = 0; i < PEERS; i++) {
+      memset(buf[i], 0xa5, size);
+      nonce[i][DTLS_CCM_BLOCKSIZE - 4] = (unsigned char)n;
+    }
+    if (multi) {
+      *len = dtls_encrypt_params_multi(params, key_ptr, data, size,
+				       aad, A_DATA_LEN, PEERS);
+    } else {
+      for (i = 0; i < PEERS; i++)
+	*len = dtls_encrypt_params_ctx(&params[i], key_ptr[i], buf[i], size,
+				       buf[i], aad[i], A_DATA_LEN);
+    }
+  }
+  return now() - start;
+}
+
+#ifdef DTLS_GCM
+/* Encrypts records of length bytes with AES-128-GCM or AES-128-CCM-8
+ * using a cached key schedule and returns the time taken. */
+static double
+run_aead(int gcm, size_t length, unsigned char *buf) {
+  unsigned char nonce[DTLS_CCM_BLOCKSIZE];
+  unsigned char A_DATA[A_DATA_LEN];
+  const dtls_ccm_params_t params = { nonce, 8, 3 };
+  rijndael_ctx key_ctx;
+  dtls_gcm_ghash_t ghash;
+  unsigned long n;
+  double start;
+
+  memset(nonce, 0, sizeof(nonce));
+  memset(A_DATA, 0x17, sizeof(A_DATA));
+  memset(buf, 0xa5, MAX_RECORD + DTLS_GCM_TAG_SIZE);
+
+  if (rijndael_set_key_enc_only(&key_ctx, key, 8 * sizeof(key)) < 0)
+    return -1;
+  dtls_gcm_init(&ghash, &key_ctx);
+
+  start = now();
+  for (n = 0; n < records; n++) {
+    nonce[DTLS_GCM_NONCE_SIZE - 1] = (unsigned char)n;
+    if (gcm)
+      dtls_encrypt_gcm_ctx(&key_ctx, &ghash, nonce, buf, length, buf,
+                           A_DATA, A_DATA_LEN);
+    else
+      dtls_encrypt_params_ctx(&params, &key_ctx, buf, length, buf,
+                              A_DATA, A_DATA_LEN);
+  }
+  return now() - start;
+}
+#endif /* DTLS_GCM */
+
+#ifdef DTLS_CHACHA20
+/* Encrypts records of length bytes with ChaCha20-Poly1305 using impl
+ * and returns the time taken, or a negative value if impl is not
+ * available. */
+static double
+run_chacha20(dtls_chacha20_impl_t impl, size_t length, unsigned char *buf) {
+  unsigned char chacha_key[DTLS_CHACHA20_KEY_LENGTH];
+  unsigned char nonce[DTLS_CHACHA20_NONCE_SIZE];
+  unsigned char A_DATA[A_DATA_LEN];
+  unsigned long n;
+  double start;
+
+  if (dtls_chacha20_set_impl(impl) < 0)
+    return -1;
+
+  memset(chacha_key, 0xc0, sizeof(chacha_key));
+  memset(nonce, 0, sizeof(nonce));
+  memset(A_DATA, 0x17, sizeof(A_DATA));
+  memset(buf, 0xa5, MAX_RECORD + DTLS_POLY1305_TAG_SIZE);
+
+  start = now();
+  for (n = 0; n < records; n++) {
+    nonce[DTLS_CHACHA20_NONCE_SIZE - 1] = (unsigned char)n;
+    dtls_encrypt_chacha20_poly1305(chacha_key, nonce, buf, length, buf,
+                                   A_DATA, A_DATA_LEN);
+  }
+  return now() - start;
+}
+#endif /* DTLS_CHACHA20 */
+
+static void
+printspeed(const char *caption, double t) {
+  printf("%-24s %8.4f sec %12.0f records/sec %8.2f MBps\n", caption, t,
+	 records / t, (double)records * size / 1048576 / t);
+}
+
+int
+main(int argc, char **argv) {
+  unsigned char nonce[DTLS_CCM_BLOCKSIZE];
+  unsigned char A_DATA[A_DATA_LEN];
+  unsigned char buf1[MAX_RECORD + DTLS_CCM_MAX];
+  unsigned char buf2[MAX_RECORD + DTLS_CCM_MAX];
+  const dtls_ccm_params_t params = { nonce, 8, 3 };
+  rijndael_ctx key_ctx;
+  static unsigned char fan1[PEERS][MAX_RECORD + DTLS_CCM_MAX];
+  static unsigned char fan2[PEERS][MAX_RECORD + DTLS_CCM_MAX];
+  pthread_t threads[64];
+  unsigned long n, max_threads = 8, i, k;
+  double start, t_key, t_ctx, t, t_single = 0;
+  int len1 = 0, len2 = 0;
+  void *failed;
+
+  if (argc > 4)
+    usage(argv[0]);
+  if (argc > 1) {
+    size = strtoul(argv[1], NULL, 10);
+    if (size == 0 || size > MAX_RECORD)
+      usage(argv[0]);
+  }
+  if (argc > 2) {
+    records = strtoul(argv[2], NULL, 10);
+    if (records == 0)
+      usage(argv[0]);
+  }
+  if (argc > 3) {
+    max_threads = strtoul(argv[3], NULL, 10);
+    if (max_threads == 0 || max_threads > sizeof(threads)/sizeof(threads[0]))
+      usage(argv[0]);
+  }
+
+  memset(nonce, 0, sizeof(nonce));
+  memset(A_DATA, 0x17, sizeof(A_DATA));
+  memset(buf1, 0xa5, sizeof(buf1));
+  memset(buf2, 0xa5, sizeof(buf2));
+
+  printf("AES-128-CCM-8, %lu records of %zu bytes\n", records, size);
+
+  start = now();
+  for (n = 0; n < records; n++) {
+    nonce[DTLS_CCM_BLOCKSIZE - 4] = (unsigned char)n;
+    len1 = dtls_encrypt_params(&params, buf1, size, buf1,
+			       key, sizeof(key), A_DATA, A_DATA_LEN);
+  }
+  t_key = now() - start;
+
+  start = now();
+  if (rijndael_set_key_enc_only(&key_ctx, key, 8 * sizeof(key)) < 0) {
+    fprintf(stderr, "cannot set key\n");
+    return -1;
+  }
+  for (n = 0; n < records; n++) {
+    nonce[DTLS_CCM_BLOCKSIZE - 4] = (unsigned char)n;
+    len2 = dtls_encrypt_params_ctx(&params, &key_ctx, buf2, size, buf2,
+				   A_DATA, A_DATA_LEN);
+  }
+  t_ctx = now() - start;
+
+  if (len1 != len2 || memcmp(buf1, buf2, len1) != 0) {
+    fprintf(stderr, "results differ\n");
+    return -1;
+  }
+
+  printspeed("key setup per record:", t_key);
+  printspeed("cached key schedule:", t_ctx);
+  printf("saving per record: %.1f ns\n", (t_key - t_ctx) * 1e9 / records);
+
+  printf("\ncached key schedule per AES backend\n");
+  t = run_cached(RIJNDAEL_IMPL_TABLES, size, buf1, &len1);
+  printspeed("T-tables:", t);
+  t = run_cached(RIJNDAEL_IMPL_AESNI, size, buf2, &len2);
+  if (t < 0) {
+    printf("%-24s not available\n", "AES-NI:");
+  } else {
+    printspeed("AES-NI:", t);
+    if (len1 != len2 || memcmp(buf1, buf2, len1) != 0) {
+      fprintf(stderr, "AES-NI result differs\n");
+      return -1;
+    }
+  }
+  rijndael_set_impl(RIJNDAEL_IMPL_AUTO);
+
+  printf("\none record to %d peers with different keys\n", PEERS);
+  t = run_fanout(0, fan1, &len1);
+  printspeed("one record at a time:", t);
+  t = run_fanout(1, fan2, &len2);
+  printspeed("side by side:", t);
+  if (len1 != len2 || memcmp(fan1, fan2, sizeof(fan1)) != 0) {
+    fprintf(stderr, "multi-buffer result differs\n");
+    return -1;
+  }
+
+#ifdef DTLS_GCM
+  printf("\nAES-128-GCM vs. AES-128-CCM-8 (MBps), %lu records\n", records);
+  printf("%12s %10s %10s %8s\n", "record size", "CCM-8", "GCM", "speedup");
+  for (k = 16; k <= MAX_RECORD; k *= 4) {
+    double t_ccm = run_aead(0, k, buf1);
+    double t_gcm = run_aead(1, k, buf2);
+
+    printf("%12lu %10.2f %10.2f %8.2f\n", k,
+	   (double)records * k / 1048576 / t_ccm,
+	   (double)records * k / 1048576 / t_gcm, t_ccm / t_gcm);
+  }
+#endif /* DTLS_GCM */
+
+#ifdef DTLS_CHACHA20
+  /* CCM-8 with the T-tables and portable ChaCha20 are what a host
+   * without AES instructions gets. */
+  printf("\nChaCha20-Poly1305 vs. AES-128-CCM-8 (MBps), %lu records\n", records);
+  printf("%12s %10s %10s %10s %10s\n", "record size", "CCM-8/tab",
+	 "CCM-8", "ChaCha/C", "ChaCha");
+  for (k = 16; k <= MAX_RECORD; k *= 4) {
+    double t_tab = run_cached(RIJNDAEL_IMPL_TABLES, k, buf1, &len1);
+    double t_ccm = run_cached(RIJNDAEL_IMPL_AUTO, k, buf1, &len1);
+    double t_port = run_chacha20(DTLS_CHACHA20_IMPL_PORTABLE, k, buf2);
+    double t_chacha = run_chacha20(DTLS_CHACHA20_IMPL_AUTO, k, buf2);
+
+    printf("%12lu %10.2f %10.2f %10.2f %10.2f\n", k,
+	   (double)records * k / 1048576 / t_tab,
+	   (double)records * k / 1048576 / t_ccm,
+	   (double)records * k / 1048576 / t_port,
+	   (double)records * k / 1048576 / t_chacha);
+  }
+  rijndael_set_impl(RIJNDAEL_IMPL_AUTO);
+#endif /* DTLS_CHACHA20 */
+
+  printf("\nencrypt+decrypt, %lu records of %zu bytes per thread\n", records, size);
+  for (k = 1; k <= max_threads; k *= 2) {
+    start = now();
+    for (i = 0; i < k; i++) {
+      if (pthread_create(&threads[i], NULL, worker, NULL) != 0) {
+	fprintf(stderr, "cannot create thread\n");
+	return -1;
+      }
+    }
+    failed = NULL;
+    for (i = 0; i < k; i++) {
+      void *res;
+      pthread_join(threads[i], &res);
+      if (res)
+	failed = res;
+    }
+    t = now() - start;
+    if (failed) {
+      fprintf(stderr, "decryption failed\n");
+      return -1;
+    }
+    if (k == 1)
+      t_single = t;
+    printf("%2lu threads: %8.4f sec %12.0f records/sec  scaling %.2f\n",
+	   k, t, k * records / t, k * t_single / t);
+  }
+
+  return 0;
+}
@@ -0,0 +1,85 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2011-2023 Olaf Bergmann (TZI) and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "tinydtls.h"
+#include "numeric.h"
+#include "chacha20_poly1305.h"
+
+#include "chacha-testdata.c"
+
+/* Runs all test vectors with the currently selected implementation.
+ * Returns the number of failed vectors. */
+static int
+run_vectors(const char *caption) {
+  unsigned char buf[300 + DTLS_POLY1305_TAG_SIZE];
+  long int len;
+  size_t n;
+  int failed = 0;
+
+  for (n = 0; n < sizeof(data)/sizeof(struct test_vector); ++n) {
+    memcpy(buf, data[n].msg, data[n].lm);
+    len = dtls_chacha20_poly1305_encrypt_message(data[n].key, data[n].nonce,
+						 buf, data[n].lm,
+						 data[n].aad, data[n].la);
+
+    printf("%s Test Case #%lu ", caption, (unsigned long)n + 1);
+    if ((size_t)len != data[n].lm + DTLS_POLY1305_TAG_SIZE ||
+	memcmp(buf, data[n].result, len)) {
+      printf("FAILED\n");
+      failed++;
+      continue;
+    }
+
+    len = dtls_chacha20_poly1305_decrypt_message(data[n].key, data[n].nonce,
+						 buf, len,
+						 data[n].aad, data[n].la);
+    if (len < 0 || (size_t)len != data[n].lm ||
+	memcmp(buf, data[n].msg, len)) {
+      printf("FAILED (decrypt)\n");
+      failed++;
+      continue;
+    }
+
+    /* a modified tag must be rejected */
+    memcpy(buf, data[n].result, data[n].lm + DTLS_POLY1305_TAG_SIZE);
+    buf[data[n].lm] ^= 1;
+    len = dtls_chacha20_poly1305_decrypt_message(data[n].key, data[n].nonce,
+						 buf, data[n].lm + DTLS_POLY1305_TAG_SIZE,
+						 data[n].aad, data[n].la);
+    if (len >= 0) {
+      printf("FAILED (forged tag accepted)\n");
+      failed++;
+      continue;
+    }
+    printf("OK\n");
+  }
+  return failed;
+}
+
+int main(int argc, char **argv) {
+  int failed;
+  (void)argc;
+  (void)argv;
+
+  dtls_chacha20_set_impl(DTLS_CHACHA20_IMPL_PORTABLE);
+  failed = run_vectors("portable:");
+  if (dtls_chacha20_set_impl(DTLS_CHACHA20_IMPL_SSE2) == 0)
+    failed += run_vectors("SSE2:");
+  if (dtls_chacha20_set_impl(DTLS_CHACHA20_IMPL_AVX2) == 0)
+    failed += run_vectors("AVX2:");
+
+  return failed ? -1 : 0;
+}
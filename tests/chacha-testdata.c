@@ -0,0 +1,123 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2011-2023 Olaf Bergmann (TZI) and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *******************************************************************************/
+
+/**
+ * @file chacha-testdata.c
+ * @brief ChaCha20-Poly1305 test cases: the AEAD example from RFC 8439
+ *        and DTLS record sized messages that cover the partial block
+ *        and the multi-block kernels
+ */
+
+struct test_vector {
+  unsigned char key[DTLS_CHACHA20_KEY_SIZE];
+  unsigned char nonce[DTLS_CHACHA20_NONCE_SIZE];
+  size_t la;			/* number of bytes additional data */
+  unsigned char aad[13];
+  size_t lm;			/* message length */
+  unsigned char msg[300];
+  unsigned char result[300 + DTLS_POLY1305_TAG_SIZE]; /* ciphertext and tag */
+};
+
+struct test_vector data[] = {
+  /* #1: RFC 8439, Section 2.8.2 */
+  { { 0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x8b, 0x8c, 0x8d, 0x8e, 0x8f,
+      0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0x9b, 0x9c, 0x9d, 0x9e, 0x9f },	/* key */
+    { 0x07, 0x00, 0x00, 0x00, 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47 },	/* nonce */
+    12, { 0x50, 0x51, 0x52, 0x53, 0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7 },	/* additional data */
+    114, { 0x4c, 0x61, 0x64, 0x69, 0x65, 0x73, 0x20, 0x61, 0x6e, 0x64, 0x20, 0x47, 0x65, 0x6e, 0x74, 0x6c,
+      0x65, 0x6d, 0x65, 0x6e, 0x20, 0x6f, 0x66, 0x20, 0x74, 0x68, 0x65, 0x20, 0x63, 0x6c, 0x61, 0x73,
+      0x73, 0x20, 0x6f, 0x66, 0x20, 0x27, 0x39, 0x39, 0x3a, 0x20, 0x49, 0x66, 0x20, 0x49, 0x20, 0x63,
+      0x6f, 0x75, 0x6c, 0x64, 0x20, 0x6f, 0x66, 0x66, 0x65, 0x72, 0x20, 0x79, 0x6f, 0x75, 0x20, 0x6f,
+      0x6e, 0x6c, 0x79, 0x20, 0x6f, 0x6e, 0x65, 0x20, 0x74, 0x69, 0x70, 0x20, 0x66, 0x6f, 0x72, 0x20,
+      0x74, 0x68, 0x65, 0x20, 0x66, 0x75, 0x74, 0x75, 0x72, 0x65, 0x2c, 0x20, 0x73, 0x75, 0x6e, 0x73,
+      0x63, 0x72, 0x65, 0x65, 0x6e, 0x20, 0x77, 0x6f, 0x75, 0x6c, 0x64, 0x20, 0x62, 0x65, 0x20, 0x69,
+      0x74, 0x2e },	/* msg */
+    { 0xd3, 0x1a, 0x8d, 0x34, 0x64, 0x8e, 0x60, 0xdb, 0x7b, 0x86, 0xaf, 0xbc, 0x53, 0xef, 0x7e, 0xc2,
+      0xa4, 0xad, 0xed, 0x51, 0x29, 0x6e, 0x08, 0xfe, 0xa9, 0xe2, 0xb5, 0xa7, 0x36, 0xee, 0x62, 0xd6,
+      0x3d, 0xbe, 0xa4, 0x5e, 0x8c, 0xa9, 0x67, 0x12, 0x82, 0xfa, 0xfb, 0x69, 0xda, 0x92, 0x72, 0x8b,
+      0x1a, 0x71, 0xde, 0x0a, 0x9e, 0x06, 0x0b, 0x29, 0x05, 0xd6, 0xa5, 0xb6, 0x7e, 0xcd, 0x3b, 0x36,
+      0x92, 0xdd, 0xbd, 0x7f, 0x2d, 0x77, 0x8b, 0x8c, 0x98, 0x03, 0xae, 0xe3, 0x28, 0x09, 0x1b, 0x58,
+      0xfa, 0xb3, 0x24, 0xe4, 0xfa, 0xd6, 0x75, 0x94, 0x55, 0x85, 0x80, 0x8b, 0x48, 0x31, 0xd7, 0xbc,
+      0x3f, 0xf4, 0xde, 0xf0, 0x8e, 0x4b, 0x7a, 0x9d, 0xe5, 0x76, 0xd2, 0x65, 0x86, 0xce, 0xc6, 0x4b,
+      0x61, 0x16, 0x1a, 0xe1, 0x0b, 0x59, 0x4f, 0x09, 0xe2, 0x6a, 0x7e, 0x90, 0x2e, 0xcb, 0xd0, 0x60,
+      0x06, 0x91 }	/* result */
+  },
+  /* #2: empty record */
+  { { 0x01, 0x06, 0x0b, 0x10, 0x15, 0x1a, 0x1f, 0x24, 0x29, 0x2e, 0x33, 0x38, 0x3d, 0x42, 0x47, 0x4c,
+      0x51, 0x56, 0x5b, 0x60, 0x65, 0x6a, 0x6f, 0x74, 0x79, 0x7e, 0x83, 0x88, 0x8d, 0x92, 0x97, 0x9c },	/* key */
+    { 0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xab },	/* nonce */
+    13, { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c },	/* additional data */
+    0, { 0 },	/* msg */
+    { 0x81, 0x7b, 0xdf, 0x0a, 0xfc, 0xee, 0x03, 0xc1, 0x51, 0xb5, 0xe1, 0x3c, 0xa6, 0x61, 0xcb, 0xf9 }	/* result */
+  },
+  /* #3: partial block */
+  { { 0x01, 0x06, 0x0b, 0x10, 0x15, 0x1a, 0x1f, 0x24, 0x29, 0x2e, 0x33, 0x38, 0x3d, 0x42, 0x47, 0x4c,
+      0x51, 0x56, 0x5b, 0x60, 0x65, 0x6a, 0x6f, 0x74, 0x79, 0x7e, 0x83, 0x88, 0x8d, 0x92, 0x97, 0x9c },	/* key */
+    { 0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xab },	/* nonce */
+    13, { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c },	/* additional data */
+    63, { 0x03, 0x0a, 0x11, 0x18, 0x1f, 0x26, 0x2d, 0x34, 0x3b, 0x42, 0x49, 0x50, 0x57, 0x5e, 0x65, 0x6c,
+      0x73, 0x7a, 0x81, 0x88, 0x8f, 0x96, 0x9d, 0xa4, 0xab, 0xb2, 0xb9, 0xc0, 0xc7, 0xce, 0xd5, 0xdc,
+      0xe3, 0xea, 0xf1, 0xf8, 0xff, 0x06, 0x0d, 0x14, 0x1b, 0x22, 0x29, 0x30, 0x37, 0x3e, 0x45, 0x4c,
+      0x53, 0x5a, 0x61, 0x68, 0x6f, 0x76, 0x7d, 0x84, 0x8b, 0x92, 0x99, 0xa0, 0xa7, 0xae, 0xb5 },	/* msg */
+    { 0x40, 0x39, 0x3a, 0xc2, 0x5c, 0x02, 0x95, 0xdd, 0x19, 0xdf, 0x04, 0xf6, 0xd8, 0xec, 0xfe, 0xb5,
+      0x59, 0x54, 0x89, 0xe7, 0x7a, 0xbd, 0xac, 0x3f, 0x3d, 0xa6, 0x64, 0xe7, 0x37, 0xa2, 0x3b, 0x05,
+      0x2a, 0x42, 0xbe, 0xcf, 0x5b, 0x3c, 0x23, 0xf7, 0x85, 0x4e, 0xf7, 0x96, 0xea, 0xcf, 0x1b, 0x8f,
+      0x99, 0xfd, 0x59, 0xfb, 0x84, 0x0f, 0x19, 0xc4, 0x69, 0xd7, 0x5e, 0x10, 0x9a, 0x84, 0xd5, 0xfc,
+      0xf3, 0x32, 0xa8, 0xbd, 0x59, 0x36, 0x43, 0xc2, 0x2c, 0x7f, 0x3c, 0x9f, 0xf1, 0x15, 0x8f }	/* result */
+  },
+  /* #4: more than eight blocks */
+  { { 0x01, 0x06, 0x0b, 0x10, 0x15, 0x1a, 0x1f, 0x24, 0x29, 0x2e, 0x33, 0x38, 0x3d, 0x42, 0x47, 0x4c,
+      0x51, 0x56, 0x5b, 0x60, 0x65, 0x6a, 0x6f, 0x74, 0x79, 0x7e, 0x83, 0x88, 0x8d, 0x92, 0x97, 0x9c },	/* key */
+    { 0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xab },	/* nonce */
+    13, { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c },	/* additional data */
+    300, { 0x03, 0x0a, 0x11, 0x18, 0x1f, 0x26, 0x2d, 0x34, 0x3b, 0x42, 0x49, 0x50, 0x57, 0x5e, 0x65, 0x6c,
+      0x73, 0x7a, 0x81, 0x88, 0x8f, 0x96, 0x9d, 0xa4, 0xab, 0xb2, 0xb9, 0xc0, 0xc7, 0xce, 0xd5, 0xdc,
+      0xe3, 0xea, 0xf1, 0xf8, 0xff, 0x06, 0x0d, 0x14, 0x1b, 0x22, 0x29, 0x30, 0x37, 0x3e, 0x45, 0x4c,
+      0x53, 0x5a, 0x61, 0x68, 0x6f, 0x76, 0x7d, 0x84, 0x8b, 0x92, 0x99, 0xa0, 0xa7, 0xae, 0xb5, 0xbc,
+      0xc3, 0xca, 0xd1, 0xd8, 0xdf, 0xe6, 0xed, 0xf4, 0xfb, 0x02, 0x09, 0x10, 0x17, 0x1e, 0x25, 0x2c,
+      0x33, 0x3a, 0x41, 0x48, 0x4f, 0x56, 0x5d, 0x64, 0x6b, 0x72, 0x79, 0x80, 0x87, 0x8e, 0x95, 0x9c,
+      0xa3, 0xaa, 0xb1, 0xb8, 0xbf, 0xc6, 0xcd, 0xd4, 0xdb, 0xe2, 0xe9, 0xf0, 0xf7, 0xfe, 0x05, 0x0c,
+      0x13, 0x1a, 0x21, 0x28, 0x2f, 0x36, 0x3d, 0x44, 0x4b, 0x52, 0x59, 0x60, 0x67, 0x6e, 0x75, 0x7c,
+      0x83, 0x8a, 0x91, 0x98, 0x9f, 0xa6, 0xad, 0xb4, 0xbb, 0xc2, 0xc9, 0xd0, 0xd7, 0xde, 0xe5, 0xec,
+      0xf3, 0xfa, 0x01, 0x08, 0x0f, 0x16, 0x1d, 0x24, 0x2b, 0x32, 0x39, 0x40, 0x47, 0x4e, 0x55, 0x5c,
+      0x63, 0x6a, 0x71, 0x78, 0x7f, 0x86, 0x8d, 0x94, 0x9b, 0xa2, 0xa9, 0xb0, 0xb7, 0xbe, 0xc5, 0xcc,
+      0xd3, 0xda, 0xe1, 0xe8, 0xef, 0xf6, 0xfd, 0x04, 0x0b, 0x12, 0x19, 0x20, 0x27, 0x2e, 0x35, 0x3c,
+      0x43, 0x4a, 0x51, 0x58, 0x5f, 0x66, 0x6d, 0x74, 0x7b, 0x82, 0x89, 0x90, 0x97, 0x9e, 0xa5, 0xac,
+      0xb3, 0xba, 0xc1, 0xc8, 0xcf, 0xd6, 0xdd, 0xe4, 0xeb, 0xf2, 0xf9, 0x00, 0x07, 0x0e, 0x15, 0x1c,
+      0x23, 0x2a, 0x31, 0x38, 0x3f, 0x46, 0x4d, 0x54, 0x5b, 0x62, 0x69, 0x70, 0x77, 0x7e, 0x85, 0x8c,
+      0x93, 0x9a, 0xa1, 0xa8, 0xaf, 0xb6, 0xbd, 0xc4, 0xcb, 0xd2, 0xd9, 0xe0, 0xe7, 0xee, 0xf5, 0xfc,
+      0x03, 0x0a, 0x11, 0x18, 0x1f, 0x26, 0x2d, 0x34, 0x3b, 0x42, 0x49, 0x50, 0x57, 0x5e, 0x65, 0x6c,
+      0x73, 0x7a, 0x81, 0x88, 0x8f, 0x96, 0x9d, 0xa4, 0xab, 0xb2, 0xb9, 0xc0, 0xc7, 0xce, 0xd5, 0xdc,
+      0xe3, 0xea, 0xf1, 0xf8, 0xff, 0x06, 0x0d, 0x14, 0x1b, 0x22, 0x29, 0x30 },	/* msg */
+    { 0x40, 0x39, 0x3a, 0xc2, 0x5c, 0x02, 0x95, 0xdd, 0x19, 0xdf, 0x04, 0xf6, 0xd8, 0xec, 0xfe, 0xb5,
+      0x59, 0x54, 0x89, 0xe7, 0x7a, 0xbd, 0xac, 0x3f, 0x3d, 0xa6, 0x64, 0xe7, 0x37, 0xa2, 0x3b, 0x05,
+      0x2a, 0x42, 0xbe, 0xcf, 0x5b, 0x3c, 0x23, 0xf7, 0x85, 0x4e, 0xf7, 0x96, 0xea, 0xcf, 0x1b, 0x8f,
+      0x99, 0xfd, 0x59, 0xfb, 0x84, 0x0f, 0x19, 0xc4, 0x69, 0xd7, 0x5e, 0x10, 0x9a, 0x84, 0xd5, 0x00,
+      0xb6, 0x03, 0xac, 0x3c, 0xdb, 0x7d, 0xfa, 0xaf, 0x0f, 0x91, 0xdc, 0x15, 0x48, 0xdc, 0xd3, 0xea,
+      0xe9, 0x7f, 0x5a, 0xd1, 0x8f, 0x4c, 0x2c, 0x4f, 0x63, 0x65, 0xc3, 0x23, 0x19, 0x5d, 0xa5, 0x8d,
+      0x51, 0x47, 0x71, 0x8c, 0xdd, 0xe8, 0x12, 0xe4, 0x87, 0xb3, 0xc6, 0xc6, 0x76, 0xd7, 0x7d, 0x20,
+      0x82, 0x42, 0x6c, 0x10, 0x98, 0x4b, 0x0b, 0x62, 0x26, 0x9e, 0xd9, 0x80, 0xc1, 0x9c, 0x6c, 0x7d,
+      0x89, 0xca, 0x0f, 0x62, 0x65, 0x70, 0xeb, 0x2c, 0x2a, 0x06, 0x09, 0x95, 0xf9, 0xcd, 0x91, 0x78,
+      0xa0, 0xfe, 0x49, 0x43, 0xd5, 0xc3, 0x52, 0x34, 0x80, 0x4b, 0x2b, 0x2f, 0x4f, 0x7c, 0xcd, 0x25,
+      0x4d, 0x9e, 0x32, 0xfa, 0xed, 0x9f, 0x27, 0x52, 0x2f, 0xdb, 0x0f, 0x2d, 0x84, 0x13, 0xb9, 0x01,
+      0xd3, 0x38, 0x5b, 0x03, 0x15, 0x19, 0x32, 0x8b, 0x97, 0xd6, 0xd7, 0xe6, 0xa3, 0x12, 0x58, 0x5b,
+      0xf5, 0xfc, 0x21, 0xbb, 0x63, 0x6e, 0x0d, 0xa0, 0x3c, 0xc7, 0x31, 0xde, 0xe9, 0x42, 0x8b, 0xe1,
+      0x2e, 0xba, 0x9d, 0x52, 0x3b, 0xa4, 0x8d, 0x3f, 0x05, 0x36, 0xec, 0xbf, 0xd0, 0x92, 0xe9, 0x65,
+      0x9d, 0x3b, 0x6a, 0x6e, 0x4c, 0xde, 0x46, 0x31, 0x6a, 0xad, 0x62, 0x0e, 0x1a, 0xea, 0xc2, 0x27,
+      0x65, 0x5e, 0x88, 0xfc, 0xe6, 0x9f, 0xe8, 0x68, 0xb1, 0x80, 0xff, 0x6d, 0xe1, 0xaa, 0x24, 0x8f,
+      0x53, 0x47, 0xbe, 0xc2, 0x04, 0x14, 0x4d, 0xec, 0x4b, 0x97, 0x67, 0x32, 0xf4, 0xfc, 0x91, 0x32,
+      0xe4, 0xbb, 0x63, 0xf5, 0x32, 0xb2, 0x77, 0x53, 0x7a, 0x63, 0xbf, 0x6a, 0x13, 0xf9, 0xbe, 0x00,
+      0x1b, 0xb7, 0x14, 0x1d, 0x78, 0x7d, 0x4d, 0x7d, 0xeb, 0x98, 0xb2, 0x20, 0xc1, 0x12, 0x6a, 0x67,
+      0x46, 0x71, 0x68, 0x18, 0x56, 0xf8, 0xa3, 0xbb, 0xae, 0x70, 0xf4, 0xfe }	/* result */
+  },
+};
@@ -308,14 +308,15 @@ usage( const char *program, const char *version) {
   fprintf(stderr, "%s v%s -- DTLS client implementation\n"
 	  "(c) 2011-2014 Olaf Bergmann <bergmann@tzi.org>\n\n"
 #ifdef DTLS_PSK
-	  "usage: %s [-i file] [-k file] [-o file] [-p port] [-v num] addr [port]\n"
+	  "usage: %s [-i file] [-k file] [-m mtu] [-o file] [-p port] [-v num] addr [port]\n"
 #else /*  DTLS_PSK */
-	  "usage: %s [-o file] [-p port] [-v num] addr [port]\n"
+	  "usage: %s [-m mtu] [-o file] [-p port] [-v num] addr [port]\n"
 #endif /* DTLS_PSK */
 #ifdef DTLS_PSK
 	  "\t-i file\t\tread PSK identity from file\n"
 	  "\t-k file\t\tread pre-shared key from file\n"
 #endif /* DTLS_PSK */
+	  "\t-m mtu\t\tfragment handshake messages to fit mtu\n"
 	  "\t-o file\t\toutput received data to this file (use '-' for STDOUT)\n"
 	  "\t-p port\t\tlisten on specified port (default is %d)\n"
 	  "\t-v num\t\tverbosity level (default: 3)\n",
@@ -359,6 +360,7 @@ main(int argc, char **argv) {
   session_t dst;
   char buf[200];
   size_t len = 0;
+  size_t mtu = 0;
 
 
   dtls_init();
@@ -371,7 +373,7 @@ main(int argc, char **argv) {
   memcpy(psk_key, PSK_DEFAULT_KEY, psk_key_length);
 #endif /* DTLS_PSK */
 
-  while ((opt = getopt(argc, argv, "p:o:v:" PSK_OPTIONS)) != -1) {
+  while ((opt = getopt(argc, argv, "m:p:o:v:" PSK_OPTIONS)) != -1) {
     switch (opt) {
 #ifdef DTLS_PSK
     case 'i' :
@@ -391,6 +393,9 @@ main(int argc, char **argv) {
       }
       break;
 #endif /* DTLS_PSK */
+    case 'm' :
+      mtu = strtoul(optarg, NULL, 10);
+      break;
     case 'p' :
       strncpy(port_str, optarg, NI_MAXSERV-1);
       port_str[NI_MAXSERV - 1] = '\0';
@@ -483,6 +488,8 @@ main(int argc, char **argv) {
   }
 
   dtls_set_handler(dtls_context, &cb);
+  if (mtu)
+    dtls_set_mtu(dtls_context, mtu);
 
   dtls_connect(dtls_context, &dst);
 
@@ -538,6 +545,8 @@ main(int argc, char **argv) {
 	    exit(-1);
           }
 	  dtls_set_handler(dtls_context, &cb);
+	  if (mtu)
+	    dtls_set_mtu(dtls_context, mtu);
 	  dtls_connect(dtls_context, &dst);
 	}
 	len = 0;
@@ -248,8 +248,9 @@ usage(const char *program, const char *version) {
 
   fprintf(stderr, "%s v%s -- DTLS server implementation\n"
 	  "(c) 2011-2014 Olaf Bergmann <bergmann@tzi.org>\n\n"
-	  "usage: %s [-A address] [-p port] [-v num]\n"
+	  "usage: %s [-A address] [-m mtu] [-p port] [-v num]\n"
 	  "\t-A address\t\tlisten on specified address (default is ::)\n"
+	  "\t-m mtu\t\tfragment handshake messages to fit mtu\n"
 	  "\t-p port\t\tlisten on specified port (default is %d)\n"
 	  "\t-v num\t\tverbosity level (default: 3)\n",
 	   program, version, program, DEFAULT_PORT);
@@ -279,6 +280,7 @@ main(int argc, char **argv) {
   struct sockaddr_in6 listen_addr;
   struct sigaction sa;
   uint16_t port = htons(DEFAULT_PORT);
+  size_t mtu = 0;
 
   memset(&listen_addr, 0, sizeof(struct sockaddr_in6));
 
@@ -290,7 +292,7 @@ main(int argc, char **argv) {
   listen_addr.sin6_family = AF_INET6;
   listen_addr.sin6_addr = in6addr_any;
 
-  while ((opt = getopt(argc, argv, "A:p:v:")) != -1) {
+  while ((opt = getopt(argc, argv, "A:m:p:v:")) != -1) {
     switch (opt) {
     case 'A' :
       if (resolve_address(optarg, (struct sockaddr *)&listen_addr) < 0) {
@@ -298,6 +300,9 @@ main(int argc, char **argv) {
 	exit(-1);
       }
       break;
+    case 'm' :
+      mtu = strtoul(optarg, NULL, 10);
+      break;
     case 'p' :
       port = htons(atoi(optarg));
       break;
@@ -370,6 +375,8 @@ main(int argc, char **argv) {
   the_context = dtls_new_context(&fd);
 
   dtls_set_handler(the_context, &cb);
+  if (mtu)
+    dtls_set_mtu(the_context, mtu);
 
   while (1) {
     FD_ZERO(&rfds);
@@ -380,6 +387,11 @@ main(int argc, char **argv) {
     
     timeout.tv_sec = 5;
     timeout.tv_usec = 0;
+
+    /* poll only while the key pools can be refilled */
+    if (dtls_ecdhe_pool_needs_refill(the_context) ||
+        dtls_ecdsa_sign_pool_needs_refill(the_context))
+      timeout.tv_sec = 0;
     
     result = select( fd+1, &rfds, &wfds, 0, &timeout);
     
@@ -387,6 +399,8 @@ main(int argc, char **argv) {
       if (errno != EINTR)
 	perror("select");
     } else if (result == 0) {	/* timeout */
+      dtls_ecdhe_pool_refill(the_context, DTLS_ECC_BATCH_SIZE);
+      dtls_ecdsa_sign_pool_refill(the_context, DTLS_ECC_BATCH_SIZE);
     } else {			/* ok */
       if (FD_ISSET(fd, &wfds))
 	;
@@ -0,0 +1,89 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2011-2023 Olaf Bergmann (TZI) and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "tinydtls.h"
+#include "numeric.h"
+#include "gcm.h"
+
+#include "gcm-testdata.c"
+
+/* Runs all test vectors with the AES backend impl and the GHASH
+ * implementation that goes with it. Returns the number of failed
+ * vectors. */
+static int
+run_vectors(const char *caption) {
+  unsigned char buf[64 + DTLS_GCM_TAG_SIZE];
+  rijndael_ctx ctx;
+  dtls_gcm_ghash_t ghash;
+  long int len;
+  size_t n;
+  int failed = 0;
+
+  for (n = 0; n < sizeof(data)/sizeof(struct test_vector); ++n) {
+    if (rijndael_set_key_enc_only(&ctx, data[n].key, 8*sizeof(data[n].key)) < 0) {
+      fprintf(stderr, "cannot set key\n");
+      return -1;
+    }
+    dtls_gcm_init(&ghash, &ctx);
+
+    memcpy(buf, data[n].msg, data[n].lm);
+    len = dtls_gcm_encrypt_message(&ctx, &ghash, data[n].nonce,
+				   buf, data[n].lm, data[n].aad, data[n].la);
+
+    printf("%s Test Case #%lu ", caption, (unsigned long)n + 1);
+    if ((size_t)len != data[n].lm + DTLS_GCM_TAG_SIZE ||
+	memcmp(buf, data[n].result, len)) {
+      printf("FAILED\n");
+      failed++;
+      continue;
+    }
+
+    len = dtls_gcm_decrypt_message(&ctx, &ghash, data[n].nonce,
+				   buf, len, data[n].aad, data[n].la);
+    if (len < 0 || (size_t)len != data[n].lm ||
+	memcmp(buf, data[n].msg, len)) {
+      printf("FAILED (decrypt)\n");
+      failed++;
+      continue;
+    }
+
+    /* a modified tag must be rejected */
+    buf[data[n].lm] ^= 1;
+    len = dtls_gcm_decrypt_message(&ctx, &ghash, data[n].nonce,
+				   buf, data[n].lm + DTLS_GCM_TAG_SIZE,
+				   data[n].aad, data[n].la);
+    if (len >= 0) {
+      printf("FAILED (forged tag accepted)\n");
+      failed++;
+      continue;
+    }
+    printf("OK\n");
+  }
+  return failed;
+}
+
+int main(int argc, char **argv) {
+  int failed;
+  (void)argc;
+  (void)argv;
+
+  rijndael_set_impl(RIJNDAEL_IMPL_TABLES);
+  failed = run_vectors("T-tables/table GHASH:");
+  if (rijndael_set_impl(RIJNDAEL_IMPL_AESNI) == 0)
+    failed += run_vectors("AES-NI/PCLMULQDQ:");
+
+  return failed ? -1 : 0;
+}
@@ -0,0 +1,191 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2011-2023 Olaf Bergmann (TZI) and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *******************************************************************************/
+
+/*
+ * Measures full ECDHE_ECDSA handshakes with client authentication
+ * between a client and a server context in one process. The ECDHE
+ * key and signature pools of both contexts are refilled between two
+ * handshakes, with at most <max-per-refill> entries per refill call
+ * and context, 0 filling the pools completely. The refills share
+ * their field inversions in batches of up to DTLS_ECC_BATCH_SIZE.
+ *
+ * For each setting, the handshakes per second include the time spent
+ * in the refills. The latency is the time from dtls_connect() until
+ * the client is connected, the refill time is the longest a single
+ * refill of both contexts delayed the next handshake. Without
+ * refills, the pools are empty and each handshake computes its keys
+ * and nonces itself.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "tinydtls.h"
+#include "dtls.h"
+#include "dtls_debug.h"
+#include "loopback.h"
+
+#ifdef DTLS_ECC
+
+static double
+now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+usage(const char *prog) {
+  fprintf(stderr, "Usage:\t%s [<handshakes>] [<max-per-refill>]\n", prog);
+  exit(-1);
+}
+
+static int
+verify_ecdsa_key(struct dtls_context_t *ctx, const session_t *session,
+		 const unsigned char *other_pub_x,
+		 const unsigned char *other_pub_y,
+		 size_t key_size) {
+  (void)ctx;
+  (void)session;
+  (void)other_pub_x;
+  (void)other_pub_y;
+  (void)key_size;
+  return 0;
+}
+
+static dtls_handler_t handler = {
+  .write = loopback_write,
+  .event = loopback_event,
+  .get_ecdsa_key = loopback_get_ecdsa_key,
+  .verify_ecdsa_key = verify_ecdsa_key,
+};
+
+/* runs a full handshake and closes the connection again */
+static int
+handshake(void) {
+  session_t session;
+  int connected;
+
+  /* no resumption, every handshake is a full one */
+  dtls_session_cache_flush(loopback_client);
+  connected = loopback_connect(0);
+  if (connected) {
+    loopback_address(&session, LOOPBACK_SERVER_PORT);
+    dtls_close(loopback_client, &session);
+  }
+  loopback_pump();
+  return connected;
+}
+
+static void
+refill(dtls_context_t *ctx, size_t max) {
+  dtls_ecdhe_pool_refill(ctx, max);
+  dtls_ecdsa_sign_pool_refill(ctx, max);
+}
+
+/* runs the handshakes, refilling up to max entries before each, max < 0 disables the refills */
+static int
+run(const char *caption, unsigned long handshakes, long max) {
+  dtls_pool_stats_t ecdhe, sign;
+  double start, t, total, latency = 0, worst = 0, stall = 0;
+  unsigned long n;
+
+  loopback_client = dtls_new_context(NULL);
+  loopback_server = dtls_new_context(NULL);
+  if (!loopback_client || !loopback_server) {
+    fprintf(stderr, "cannot create contexts\n");
+    return -1;
+  }
+  dtls_set_handler(loopback_client, &handler);
+  dtls_set_handler(loopback_server, &handler);
+
+  total = now();
+  for (n = 0; n < handshakes; n++) {
+    if (max >= 0) {
+      start = now();
+      refill(loopback_server, max);
+      refill(loopback_client, max);
+      t = now() - start;
+      if (t > stall)
+	stall = t;
+    }
+
+    start = now();
+    if (!handshake()) {
+      fprintf(stderr, "handshake %lu failed\n", n);
+      return -1;
+    }
+    t = now() - start;
+    latency += t;
+    if (t > worst)
+      worst = t;
+  }
+  total = now() - total;
+
+  dtls_ecdhe_pool_get_stats(loopback_server, &ecdhe);
+  dtls_ecdsa_sign_pool_get_stats(loopback_server, &sign);
+  printf("%-16s %8.1f %10.2f %10.2f %10.2f %6lu/%-6lu %6lu/%lu\n",
+	 caption, handshakes / total, 1000 * latency / handshakes,
+	 1000 * worst, 1000 * stall, ecdhe.hits, ecdhe.hits + ecdhe.misses,
+	 sign.hits, sign.hits + sign.misses);
+
+  dtls_free_context(loopback_client);
+  dtls_free_context(loopback_server);
+  return 0;
+}
+
+int
+main(int argc, char **argv) {
+  unsigned long handshakes = 200;
+  long max = 1;
+  char caption[32];
+
+  if (argc > 3)
+    usage(argv[0]);
+  if (argc > 1) {
+    handshakes = strtoul(argv[1], NULL, 10);
+    if (handshakes == 0)
+      usage(argv[0]);
+  }
+  if (argc > 2)
+    max = strtol(argv[2], NULL, 10);
+  if (max < 0)
+    usage(argv[0]);
+
+  dtls_init();
+  dtls_set_log_level(DTLS_LOG_EMERG);
+
+  printf("%lu full ECDHE_ECDSA handshakes, batch size %d\n", handshakes,
+	 DTLS_ECC_BATCH_SIZE);
+  printf("%-16s %8s %10s %10s %10s %13s %13s\n", "refill",
+	 "hs/sec", "mean [ms]", "max [ms]", "stall [ms]", "ecdhe pool",
+	 "sign pool");
+
+  if (run("none", handshakes, -1) < 0)
+    return -1;
+  snprintf(caption, sizeof(caption), "max %ld", max);
+  if (run(max ? caption : "full", handshakes, max) < 0)
+    return -1;
+  if (max && run("full", handshakes, 0) < 0)
+    return -1;
+  return 0;
+}
+#else /* DTLS_ECC */
+int main(void) {
+  printf("handshake-bench skipped, no DTLS_ECC support\n");
+  return 0;
+}
+#endif /* DTLS_ECC */
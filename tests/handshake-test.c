@@ -0,0 +1,455 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2011-2023 Olaf Bergmann (TZI) and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *******************************************************************************/
+
+/*
+ * Runs handshakes between a client and a server context in one
+ * process over a path that disturbs the datagrams. Both contexts use
+ * the smallest MTU, so the larger handshake messages are sent in
+ * fragments. The records of each flight are held back and released
+ * one by one, with the fragments of a message reversed, duplicated,
+ * overlapping or preceded by a fragment with a different header.
+ * Dropped flights check the retransmission of flights and that the
+ * round trips of retransmitted flights are not measured. Each check is
+ * done with PSK and with ECDSA.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "tinydtls.h"
+#include "dtls.h"
+#include "dtls_debug.h"
+#include "numeric.h"
+#include "loopback.h"
+
+#if defined(DTLS_PSK) || defined(DTLS_ECC)
+
+#define MAX_HELD 64
+
+#define RECORD_LENGTH sizeof(dtls_record_header_t)
+#define FRAGMENT_LENGTH (sizeof(dtls_record_header_t) + sizeof(dtls_handshake_header_t))
+
+#define HANDSHAKE_HEADER(D) \
+  ((dtls_handshake_header_t *)((D)->data + RECORD_LENGTH))
+
+/* how the fragments of a message are released */
+typedef enum {
+  IN_ORDER, REVERSED, DUPLICATED, OVERLAPPING, MISMATCHED
+} disorder_t;
+
+static disorder_t disorder;
+
+/* the n-th next flight to a side is dropped, all of them if less than zero */
+static int drop_flight[2];
+
+/* retransmission timeout of both contexts, 0 keeps the default */
+static clock_time_t timeout;
+
+/* the records written by both sides that have not been released yet */
+static loopback_datagram_t held[MAX_HELD];
+static size_t num_held;
+
+static unsigned long fragments;	/* fragmented records written */
+static uint64_t next_seq[2];	/* next epoch 0 sequence number per side */
+
+/* the statistics of the client after the last handshake */
+static dtls_retransmit_stats_t client_stats;
+static dtls_rtt_stats_t client_rtt;
+
+static const unsigned char psk_id[] = "Client_identity";
+static const unsigned char psk_key[] = "secretPSK";
+
+/* returns 1 if d holds an epoch 0 record with a handshake fragment */
+static int
+is_fragment(const loopback_datagram_t *d) {
+  const dtls_record_header_t *header = (const dtls_record_header_t *)d->data;
+  const dtls_handshake_header_t *hs = HANDSHAKE_HEADER(d);
+
+  return d->length > FRAGMENT_LENGTH &&
+    header->content_type == DTLS_CT_HANDSHAKE &&
+    dtls_uint16_to_int(header->epoch) == 0 &&
+    dtls_uint24_to_int(hs->length) != dtls_uint24_to_int(hs->fragment_length);
+}
+
+/* returns 1 if the fragments a and b belong to the same message */
+static int
+same_message(const loopback_datagram_t *a, const loopback_datagram_t *b) {
+  /* msg_type, length and message_seq */
+  return memcmp(HANDSHAKE_HEADER(a), HANDSHAKE_HEADER(b), 6) == 0;
+}
+
+/* the loopback filter that splits each datagram into its records and holds them */
+static int
+hold(loopback_datagram_t *d) {
+  loopback_datagram_t *r;
+  size_t offset = 0, length;
+
+  while (offset + RECORD_LENGTH <= d->length && num_held < MAX_HELD) {
+    length = RECORD_LENGTH + dtls_uint16_to_int(d->data + offset + 11);
+    if (offset + length > d->length)
+      break;
+
+    r = &held[num_held++];
+    r->to = d->to;
+    r->index = d->index;
+    memcpy(r->data, d->data + offset, length);
+    r->length = length;
+    if (is_fragment(r))
+      fragments++;
+    offset += length;
+  }
+  return 0;
+}
+
+/* sends the record d to its side and delivers what follows */
+static void
+release(loopback_datagram_t *d) {
+  const dtls_record_header_t *header = (const dtls_record_header_t *)d->data;
+
+  /* Plaintext records get fresh sequence numbers in the order they are
+   * released, so duplicates are not dropped as replays. */
+  if (dtls_uint16_to_int(header->epoch) == 0)
+    dtls_int_to_uint48(d->data + 5, next_seq[d->to]++);
+  loopback_send(d);
+  loopback_pump();
+}
+
+/* sets d to a fragment with the second half of a and the first half of b */
+static void
+overlap(loopback_datagram_t *d, const loopback_datagram_t *a,
+	const loopback_datagram_t *b) {
+  size_t a_length = a->length - FRAGMENT_LENGTH;
+  size_t b_length = b->length - FRAGMENT_LENGTH;
+  size_t start = a_length / 2;
+  size_t length = a_length - start + b_length / 2;
+
+  *d = *a;
+  memmove(d->data + FRAGMENT_LENGTH, d->data + FRAGMENT_LENGTH + start,
+	  a_length - start);
+  memcpy(d->data + FRAGMENT_LENGTH + a_length - start,
+	 b->data + FRAGMENT_LENGTH, b_length / 2);
+  dtls_int_to_uint24(HANDSHAKE_HEADER(d)->fragment_offset,
+		     dtls_uint24_to_int(HANDSHAKE_HEADER(a)->fragment_offset) + start);
+  dtls_int_to_uint24(HANDSHAKE_HEADER(d)->fragment_length, length);
+  dtls_int_to_uint16(d->data + 11, sizeof(dtls_handshake_header_t) + length);
+  d->length = FRAGMENT_LENGTH + length;
+}
+
+/* releases the count fragments of one message as set by disorder */
+static void
+release_message(loopback_datagram_t *fragment, size_t count) {
+  loopback_datagram_t d;
+  size_t i;
+
+  switch (disorder) {
+  case REVERSED:
+    for (i = count; i--; )
+      release(&fragment[i]);
+    break;
+  case DUPLICATED:
+    for (i = 0; i < count; i++) {
+      release(&fragment[i]);
+      release(&fragment[i]);
+    }
+    /* once more after the message is complete */
+    release(&fragment[0]);
+    break;
+  case OVERLAPPING:
+    for (i = 0; i < count; i++) {
+      if (i + 1 < count) {
+	overlap(&d, &fragment[i], &fragment[i + 1]);
+	release(&d);
+      }
+      release(&fragment[i]);
+    }
+    break;
+  case MISMATCHED:
+    /* A fragment of a longer message is never completed, the
+     * reassembly buffer must be thrown away on the next fragment. */
+    d = fragment[0];
+    dtls_int_to_uint24(HANDSHAKE_HEADER(&d)->length,
+		       dtls_uint24_to_int(HANDSHAKE_HEADER(&d)->length) + 1);
+    release(&d);
+    /* fall through */
+  case IN_ORDER:
+  default:
+    for (i = 0; i < count; i++)
+      release(&fragment[i]);
+    break;
+  }
+}
+
+/* releases the held records flight by flight until no side sends anything */
+static void
+release_held(void) {
+  static loopback_datagram_t flight[MAX_HELD];
+  size_t count, i, j;
+  int drop[2], to;
+
+  while (num_held) {
+    count = num_held;
+    memcpy(flight, held, count * sizeof(loopback_datagram_t));
+    num_held = 0;
+
+    for (to = 0; to < 2; to++) {
+      for (i = 0; i < count && flight[i].to != to; i++)
+	;
+      drop[to] = i < count &&
+	(drop_flight[to] < 0 || (drop_flight[to] && --drop_flight[to] == 0));
+    }
+
+    for (i = 0; i < count; i = j) {
+      j = i + 1;
+      if (drop[flight[i].to])
+	continue;
+      if (!is_fragment(&flight[i])) {
+	release(&flight[i]);
+	continue;
+      }
+      while (j < count && is_fragment(&flight[j]) &&
+	     same_message(&flight[i], &flight[j]))
+	j++;
+      release_message(&flight[i], j - i);
+    }
+  }
+}
+
+/* sleeps until the tick count t has passed */
+static void
+sleep_until(clock_time_t t) {
+  struct timespec ts;
+  dtls_tick_t now;
+
+  dtls_ticks(&now);
+  if (t > now) {
+    ts.tv_sec = (t - now) / CLOCK_SECOND;
+    ts.tv_nsec = (long)((t - now) % CLOCK_SECOND) * (1000000000L / CLOCK_SECOND);
+    nanosleep(&ts, NULL);
+  }
+}
+
+/* releases the held records and retransmits the flights of both sides
+ * until the client is connected or no flight is left */
+static void
+deliver(void) {
+  clock_time_t client_next, server_next;
+
+  for (;;) {
+    release_held();
+    if (loopback_connected)
+      return;
+
+    dtls_check_retransmit(loopback_client, &client_next);
+    dtls_check_retransmit(loopback_server, &server_next);
+    if (num_held)
+      continue;
+    if (!client_next && !server_next)
+      return;
+    if (!client_next || (server_next && server_next < client_next))
+      sleep_until(server_next);
+    else
+      sleep_until(client_next);
+  }
+}
+
+#ifdef DTLS_PSK
+static int
+get_psk_info(struct dtls_context_t *ctx, const session_t *session,
+	     dtls_credentials_type_t type,
+	     const unsigned char *id, size_t id_len,
+	     unsigned char *result, size_t result_length) {
+  (void)ctx;
+  (void)session;
+
+  switch (type) {
+  case DTLS_PSK_IDENTITY:
+    if (result_length < sizeof(psk_id) - 1)
+      return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
+    memcpy(result, psk_id, sizeof(psk_id) - 1);
+    return sizeof(psk_id) - 1;
+  case DTLS_PSK_KEY:
+    if (id_len != sizeof(psk_id) - 1 || memcmp(id, psk_id, id_len))
+      return dtls_alert_fatal_create(DTLS_ALERT_DECRYPT_ERROR);
+    if (result_length < sizeof(psk_key) - 1)
+      return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
+    memcpy(result, psk_key, sizeof(psk_key) - 1);
+    return sizeof(psk_key) - 1;
+  case DTLS_PSK_HINT:
+  default:
+    return 0;
+  }
+}
+
+static dtls_handler_t psk_handler = {
+  .write = loopback_write,
+  .event = loopback_event,
+  .get_psk_info = get_psk_info,
+};
+#endif /* DTLS_PSK */
+
+#ifdef DTLS_ECC
+/* both sides use the same key */
+static int
+verify_ecdsa_key(struct dtls_context_t *ctx, const session_t *session,
+		 const unsigned char *other_pub_x,
+		 const unsigned char *other_pub_y,
+		 size_t key_size) {
+  (void)ctx;
+  (void)session;
+
+  if (key_size != DTLS_EC_KEY_SIZE ||
+      memcmp(other_pub_x, loopback_ecdsa_key.pub_key_x, key_size) ||
+      memcmp(other_pub_y, loopback_ecdsa_key.pub_key_y, key_size))
+    return dtls_alert_fatal_create(DTLS_ALERT_BAD_CERTIFICATE);
+  return 0;
+}
+
+static dtls_handler_t ecdsa_handler = {
+  .write = loopback_write,
+  .event = loopback_event,
+  .get_ecdsa_key = loopback_get_ecdsa_key,
+  .verify_ecdsa_key = verify_ecdsa_key,
+};
+#endif /* DTLS_ECC */
+
+/* runs a handshake with fresh contexts, returns 1 if the client is connected */
+static int
+handshake(dtls_handler_t *handler) {
+  session_t session;
+  int connected;
+
+  loopback_client = dtls_new_context(NULL);
+  loopback_server = dtls_new_context(NULL);
+  if (!loopback_client || !loopback_server)
+    return 0;
+  dtls_set_handler(loopback_client, handler);
+  dtls_set_handler(loopback_server, handler);
+  dtls_set_mtu(loopback_client, DTLS_MIN_MTU);
+  dtls_set_mtu(loopback_server, DTLS_MIN_MTU);
+  if (timeout) {
+    dtls_set_retransmit_timeout(loopback_client, timeout, timeout, 2 * timeout);
+    dtls_set_retransmit_timeout(loopback_server, timeout, timeout, 2 * timeout);
+  }
+
+  fragments = 0;
+  next_seq[LOOPBACK_TO_CLIENT] = next_seq[LOOPBACK_TO_SERVER] = 0;
+  loopback_connect(0);
+  deliver();
+  connected = loopback_connected;
+
+  dtls_get_retransmit_stats(loopback_client, &client_stats);
+  loopback_address(&session, LOOPBACK_SERVER_PORT);
+  dtls_get_peer_rtt(loopback_client, &session, &client_rtt);
+
+  dtls_free_context(loopback_client);
+  dtls_free_context(loopback_server);
+  num_held = 0;
+  loopback_clear();
+  disorder = IN_ORDER;
+  drop_flight[LOOPBACK_TO_CLIENT] = drop_flight[LOOPBACK_TO_SERVER] = 0;
+  timeout = 0;
+  return connected;
+}
+
+static int
+check(const char *mode, const char *caption, int ok) {
+  printf("%s %-38s %s\n", mode, caption, ok ? "OK" : "FAILED");
+  return !ok;
+}
+
+static int
+run(const char *mode, dtls_handler_t *handler) {
+  unsigned long samples;
+  int failed = 0, ok;
+
+  ok = handshake(handler);
+  failed += check(mode, "fragments in order",
+		  ok && fragments > 0 && !client_stats.retransmissions);
+
+  disorder = REVERSED;
+  ok = handshake(handler);
+  failed += check(mode, "fragments reversed",
+		  ok && !client_stats.retransmissions);
+
+  disorder = DUPLICATED;
+  ok = handshake(handler);
+  failed += check(mode, "fragments duplicated",
+		  ok && !client_stats.retransmissions);
+
+  disorder = OVERLAPPING;
+  ok = handshake(handler);
+  failed += check(mode, "fragments overlapping",
+		  ok && !client_stats.retransmissions);
+
+  disorder = MISMATCHED;
+  ok = handshake(handler);
+  failed += check(mode, "fragment with other header",
+		  ok && !client_stats.retransmissions);
+
+  /* each flight of the client is measured */
+  timeout = CLOCK_SECOND / 10;
+  ok = handshake(handler);
+  samples = client_rtt.samples;
+  failed += check(mode, "round trips measured",
+		  ok && samples > 1 && !client_stats.retransmissions &&
+		  client_stats.samples == samples);
+
+  /* The last flight of the client is lost and resent after its
+   * timeout. The round trip of that flight is ambiguous and must not
+   * be measured (Karn's algorithm). */
+  timeout = CLOCK_SECOND / 10;
+  drop_flight[LOOPBACK_TO_SERVER] = 3;
+  ok = handshake(handler);
+  failed += check(mode, "lost flight retransmitted",
+		  ok && client_stats.retransmissions == 1 &&
+		  !client_stats.failures);
+  failed += check(mode, "retransmitted flight not measured",
+		  ok && client_rtt.samples == samples - 1 &&
+		  client_stats.samples == samples - 1);
+
+  /* the server never answers */
+  timeout = CLOCK_SECOND / 10;
+  drop_flight[LOOPBACK_TO_CLIENT] = -1;
+  ok = handshake(handler);
+  failed += check(mode, "flight given up",
+		  !ok && client_stats.failures == 1 &&
+		  client_stats.retransmissions == DTLS_DEFAULT_MAX_RETRANSMIT);
+
+  return failed;
+}
+
+int main(void) {
+  int failed = 0;
+
+  dtls_init();
+  dtls_set_log_level(DTLS_LOG_EMERG);
+  loopback_filter = hold;
+
+#ifdef DTLS_PSK
+  failed += run("psk  ", &psk_handler);
+#endif /* DTLS_PSK */
+#ifdef DTLS_ECC
+  failed += run("ecdsa", &ecdsa_handler);
+#endif /* DTLS_ECC */
+
+  return failed ? -1 : 0;
+}
+#else /* DTLS_PSK || DTLS_ECC */
+int main(void) {
+  printf("handshake-test skipped, no cipher suites\n");
+  return 0;
+}
+#endif /* DTLS_PSK || DTLS_ECC */
@@ -0,0 +1,142 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2011-2023 Olaf Bergmann (TZI) and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *******************************************************************************/
+
+#include <string.h>
+
+#include "loopback.h"
+
+#define MAX_QUEUED 32
+
+dtls_context_t *loopback_client;
+dtls_context_t *loopback_server;
+int loopback_connected;
+int (*loopback_filter)(loopback_datagram_t *datagram);
+
+static loopback_datagram_t queue[MAX_QUEUED];
+static size_t queued;
+
+#ifdef DTLS_ECC
+static const unsigned char ecdsa_priv_key[] = {
+  0xD9, 0xE2, 0x70, 0x7A, 0x72, 0xDA, 0x6A, 0x05,
+  0x04, 0x99, 0x5C, 0x86, 0xED, 0xDB, 0xE3, 0xEF,
+  0xC7, 0xF1, 0xCD, 0x74, 0x83, 0x8F, 0x75, 0x70,
+  0xC8, 0x07, 0x2D, 0x0A, 0x76, 0x26, 0x1B, 0xD4};
+
+static const unsigned char ecdsa_pub_key_x[] = {
+  0xD0, 0x55, 0xEE, 0x14, 0x08, 0x4D, 0x6E, 0x06,
+  0x15, 0x59, 0x9D, 0xB5, 0x83, 0x91, 0x3E, 0x4A,
+  0x3E, 0x45, 0x26, 0xA2, 0x70, 0x4D, 0x61, 0xF2,
+  0x7A, 0x4C, 0xCF, 0xBA, 0x97, 0x58, 0xEF, 0x9A};
+
+static const unsigned char ecdsa_pub_key_y[] = {
+  0xB4, 0x18, 0xB6, 0x4A, 0xFE, 0x80, 0x30, 0xDA,
+  0x1D, 0xDC, 0xF4, 0xF4, 0x2E, 0x2F, 0x26, 0x31,
+  0xD0, 0x43, 0xB1, 0xFB, 0x03, 0xE2, 0x2F, 0x4D,
+  0x17, 0xDE, 0x43, 0xF9, 0xF9, 0xAD, 0xEE, 0x70};
+
+const dtls_ecdsa_key_t loopback_ecdsa_key = {
+  .curve = DTLS_ECDH_CURVE_SECP256R1,
+  .priv_key = ecdsa_priv_key,
+  .pub_key_x = ecdsa_pub_key_x,
+  .pub_key_y = ecdsa_pub_key_y
+};
+
+int
+loopback_get_ecdsa_key(struct dtls_context_t *ctx, const session_t *session,
+		       const dtls_ecdsa_key_t **result) {
+  (void)ctx;
+  (void)session;
+
+  *result = &loopback_ecdsa_key;
+  return 0;
+}
+#endif /* DTLS_ECC */
+
+void
+loopback_address(session_t *session, int port) {
+  dtls_session_init(session);
+  session->size = sizeof(session->addr.sin);
+  session->addr.sin.sin_family = AF_INET;
+  session->addr.sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  session->addr.sin.sin_port = htons(port);
+}
+
+void
+loopback_send(const loopback_datagram_t *datagram) {
+  if (queued < MAX_QUEUED)
+    queue[queued++] = *datagram;
+}
+
+int
+loopback_write(struct dtls_context_t *ctx, session_t *session,
+	       uint8 *data, size_t len) {
+  loopback_datagram_t d;
+  int port = ntohs(session->addr.sin.sin_port);
+
+  if (queued == MAX_QUEUED || len > sizeof(d.data))
+    return -1;
+
+  d.to = ctx == loopback_client ? LOOPBACK_TO_SERVER : LOOPBACK_TO_CLIENT;
+  d.index = port - (ctx == loopback_client ?
+		    LOOPBACK_SERVER_PORT : LOOPBACK_CLIENT_PORT);
+  memcpy(d.data, data, len);
+  d.length = len;
+  if (!loopback_filter || loopback_filter(&d))
+    loopback_send(&d);
+  return len;
+}
+
+int
+loopback_event(struct dtls_context_t *ctx, session_t *session,
+	       dtls_alert_level_t level, unsigned short code) {
+  (void)session;
+  (void)level;
+  if (ctx == loopback_client && code == DTLS_EVENT_CONNECTED)
+    loopback_connected = 1;
+  return 0;
+}
+
+void
+loopback_pump(void) {
+  loopback_datagram_t d;
+  session_t session;
+
+  while (queued) {
+    d = queue[0];
+    memmove(queue, queue + 1, --queued * sizeof(loopback_datagram_t));
+    if (d.to == LOOPBACK_TO_SERVER) {
+      loopback_address(&session, LOOPBACK_CLIENT_PORT + d.index);
+      dtls_handle_message(loopback_server, &session, d.data, d.length);
+    } else {
+      loopback_address(&session, LOOPBACK_SERVER_PORT + d.index);
+      dtls_handle_message(loopback_client, &session, d.data, d.length);
+    }
+  }
+}
+
+void
+loopback_clear(void) {
+  queued = 0;
+}
+
+int
+loopback_connect(int n) {
+  session_t session;
+
+  loopback_address(&session, LOOPBACK_SERVER_PORT + n);
+  loopback_connected = 0;
+  if (dtls_connect(loopback_client, &session) < 0)
+    return 0;
+  loopback_pump();
+  return loopback_connected;
+}
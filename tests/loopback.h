@@ -0,0 +1,92 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2011-2023 Olaf Bergmann (TZI) and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *******************************************************************************/
+
+/*
+ * An in-process network between a client and a server context for
+ * the tests. Datagrams written by one context are queued and handed
+ * to the other one by loopback_pump(). The client reaches server n at
+ * port LOOPBACK_SERVER_PORT + n, the server sees the client at port
+ * LOOPBACK_CLIENT_PORT + n then.
+ */
+
+#ifndef _DTLS_TESTS_LOOPBACK_H_
+#define _DTLS_TESTS_LOOPBACK_H_
+
+#include "tinydtls.h"
+#include "dtls.h"
+
+#define LOOPBACK_SERVER_PORT 20000
+#define LOOPBACK_CLIENT_PORT 30000
+
+enum { LOOPBACK_TO_CLIENT, LOOPBACK_TO_SERVER };
+
+/** A datagram on its way between the two contexts. */
+typedef struct {
+  int to;			/**< LOOPBACK_TO_CLIENT or LOOPBACK_TO_SERVER */
+  int index;			/**< the server n the datagram belongs to */
+  size_t length;		/**< length of data */
+  uint8 data[DTLS_MAX_BUF];	/**< the datagram */
+} loopback_datagram_t;
+
+extern dtls_context_t *loopback_client;
+extern dtls_context_t *loopback_server;
+
+/** Set by loopback_event() when the client has finished a handshake. */
+extern int loopback_connected;
+
+/**
+ * Called with each datagram that is written, before it is queued.
+ * The filter may change the datagram, or return 0 to drop it. It may
+ * keep a copy to pass to loopback_send() later.
+ */
+extern int (*loopback_filter)(loopback_datagram_t *datagram);
+
+/** Sets @p session to the loopback address with @p port. */
+void loopback_address(session_t *session, int port);
+
+/** The write callback for the handlers of both contexts. */
+int loopback_write(struct dtls_context_t *ctx, session_t *session,
+		   uint8 *data, size_t len);
+
+/** The event callback, sets loopback_connected. */
+int loopback_event(struct dtls_context_t *ctx, session_t *session,
+		   dtls_alert_level_t level, unsigned short code);
+
+/** Queues @p datagram without passing it to loopback_filter. */
+void loopback_send(const loopback_datagram_t *datagram);
+
+/** Delivers the queued datagrams until no side has anything to send. */
+void loopback_pump(void);
+
+/** Drops all queued datagrams. */
+void loopback_clear(void);
+
+/**
+ * Starts a handshake of the client with server @p n and delivers
+ * datagrams until it is done.
+ *
+ * @return 1 if the client is connected, 0 otherwise.
+ */
+int loopback_connect(int n);
+
+#ifdef DTLS_ECC
+/** The key pair of both sides. */
+extern const dtls_ecdsa_key_t loopback_ecdsa_key;
+
+/** A get_ecdsa_key callback returning loopback_ecdsa_key. */
+int loopback_get_ecdsa_key(struct dtls_context_t *ctx,
+			   const session_t *session,
+			   const dtls_ecdsa_key_t **result);
+#endif /* DTLS_ECC */
+
+#endif /* _DTLS_TESTS_LOOPBACK_H_ */
@@ -0,0 +1,504 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2011-2023 Olaf Bergmann (TZI) and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *******************************************************************************/
+
+/*
+ * Runs handshakes between a client and a server context in one
+ * process and checks session resumption: a resumed session, flushed
+ * caches, the removal of a session after a fatal alert, the eviction
+ * of the least recently used session and sessions whose peer is no
+ * longer accepted by the application. Each check is done with PSK
+ * and with ECDSA. With session tickets, tickets are also checked
+ * against tampering, expiry and keys shared between servers.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "tinydtls.h"
+#include "dtls.h"
+#include "dtls_debug.h"
+#include "crypto.h"
+#include "loopback.h"
+
+#if DTLS_SESSION_CACHE_SIZE && (defined(DTLS_PSK) || defined(DTLS_ECC))
+
+/* the n-th next datagram to a side is replaced by a fatal alert */
+static int alert_to[2];
+
+static int client_revoked;	/* the client no longer accepts the server */
+static int server_revoked;	/* the server no longer accepts the client */
+
+static const unsigned char psk_id[] = "Client_identity";
+static const unsigned char psk_key[] = "secretPSK";
+
+/* replaces the records in buf by a fatal alert of the same epoch 0 sequence number */
+static size_t
+fatal_alert(uint8 *buf) {
+  buf[0] = DTLS_CT_ALERT;
+  buf[3] = buf[4] = 0;
+  buf[11] = 0;
+  buf[12] = 2;
+  buf[13] = DTLS_ALERT_LEVEL_FATAL;
+  buf[14] = DTLS_ALERT_HANDSHAKE_FAILURE;
+  return 15;
+}
+
+/* the loopback filter that injects the alerts requested in alert_to */
+static int
+inject_alert(loopback_datagram_t *d) {
+  if (alert_to[d->to] && --alert_to[d->to] == 0)
+    d->length = fatal_alert(d->data);
+  return 1;
+}
+
+#ifdef DTLS_PSK
+static int
+get_psk_info(struct dtls_context_t *ctx, const session_t *session,
+	     dtls_credentials_type_t type,
+	     const unsigned char *id, size_t id_len,
+	     unsigned char *result, size_t result_length) {
+  (void)session;
+
+  switch (type) {
+  case DTLS_PSK_IDENTITY:
+    if (result_length < sizeof(psk_id) - 1)
+      return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
+    memcpy(result, psk_id, sizeof(psk_id) - 1);
+    return sizeof(psk_id) - 1;
+  case DTLS_PSK_KEY:
+    if (id_len != sizeof(psk_id) - 1 || memcmp(id, psk_id, id_len) ||
+	(ctx == loopback_client ? client_revoked : server_revoked))
+      return dtls_alert_fatal_create(DTLS_ALERT_DECRYPT_ERROR);
+    if (result_length < sizeof(psk_key) - 1)
+      return dtls_alert_fatal_create(DTLS_ALERT_INTERNAL_ERROR);
+    memcpy(result, psk_key, sizeof(psk_key) - 1);
+    return sizeof(psk_key) - 1;
+  case DTLS_PSK_HINT:
+  default:
+    return 0;
+  }
+}
+
+static dtls_handler_t psk_handler = {
+  .write = loopback_write,
+  .event = loopback_event,
+  .get_psk_info = get_psk_info,
+};
+#endif /* DTLS_PSK */
+
+#ifdef DTLS_ECC
+/* both sides use the same key */
+static int
+verify_ecdsa_key(struct dtls_context_t *ctx, const session_t *session,
+		 const unsigned char *other_pub_x,
+		 const unsigned char *other_pub_y,
+		 size_t key_size) {
+  (void)session;
+
+  if (key_size != DTLS_EC_KEY_SIZE ||
+      memcmp(other_pub_x, loopback_ecdsa_key.pub_key_x, key_size) ||
+      memcmp(other_pub_y, loopback_ecdsa_key.pub_key_y, key_size) ||
+      (ctx == loopback_client ? client_revoked : server_revoked))
+    return dtls_alert_fatal_create(DTLS_ALERT_CERTIFICATE_REVOKED);
+  return 0;
+}
+
+static dtls_handler_t ecdsa_handler = {
+  .write = loopback_write,
+  .event = loopback_event,
+  .get_ecdsa_key = loopback_get_ecdsa_key,
+  .verify_ecdsa_key = verify_ecdsa_key,
+};
+#endif /* DTLS_ECC */
+
+/* terminates the connection with server n on both sides */
+static void
+disconnect(int n) {
+  session_t session;
+  dtls_peer_t *peer;
+
+  loopback_address(&session, LOOPBACK_SERVER_PORT + n);
+  if (dtls_get_peer(loopback_client, &session))
+    dtls_close(loopback_client, &session);
+  loopback_pump();
+
+  /* a failed handshake may have left a peer behind */
+  if ((peer = dtls_get_peer(loopback_client, &session)))
+    dtls_reset_peer(loopback_client, peer);
+  loopback_address(&session, LOOPBACK_CLIENT_PORT + n);
+  if ((peer = dtls_get_peer(loopback_server, &session)))
+    dtls_reset_peer(loopback_server, peer);
+  loopback_clear();
+  alert_to[LOOPBACK_TO_CLIENT] = alert_to[LOOPBACK_TO_SERVER] = 0;
+}
+
+/* the number of sessions the server has resumed */
+static unsigned long
+server_resumed(void) {
+  dtls_session_cache_stats_t stats;
+  dtls_session_ticket_stats_t tickets;
+
+  dtls_session_cache_get_stats(loopback_server, &stats);
+  dtls_session_ticket_get_stats(loopback_server, &tickets);
+  return stats.hits + tickets.accepted;
+}
+
+static int
+check(const char *mode, const char *caption, int ok) {
+  printf("%s %-38s %s\n", mode, caption, ok ? "OK" : "FAILED");
+  return !ok;
+}
+
+static int
+run(const char *mode, dtls_handler_t *handler) {
+  dtls_session_cache_stats_t before, after;
+  unsigned long resumed;
+  int failed = 0, ok, n;
+
+  loopback_client = dtls_new_context(NULL);
+  loopback_server = dtls_new_context(NULL);
+  if (!loopback_client || !loopback_server) {
+    printf("%s cannot create contexts FAILED\n", mode);
+    return 1;
+  }
+  dtls_set_handler(loopback_client, handler);
+  dtls_set_handler(loopback_server, handler);
+
+  ok = loopback_connect(0);
+  dtls_session_cache_get_stats(loopback_client, &after);
+  failed += check(mode, "full handshake",
+		  ok && after.entries == 1 && after.hits == 0);
+  disconnect(0);
+
+  /* hit */
+  resumed = server_resumed();
+  dtls_session_cache_get_stats(loopback_client, &before);
+  ok = loopback_connect(0);
+  dtls_session_cache_get_stats(loopback_client, &after);
+  failed += check(mode, "resumption",
+		  ok && after.hits == before.hits + 1 &&
+		  server_resumed() == resumed + 1);
+  disconnect(0);
+
+  /* without the session, the client does not offer it */
+  dtls_session_cache_flush(loopback_client);
+  resumed = server_resumed();
+  dtls_session_cache_get_stats(loopback_client, &before);
+  ok = loopback_connect(0);
+  dtls_session_cache_get_stats(loopback_client, &after);
+  failed += check(mode, "flushed client cache",
+		  ok && after.hits == before.hits &&
+		  after.misses == before.misses && after.entries == 1 &&
+		  server_resumed() == resumed);
+  disconnect(0);
+
+  /* A server that has forgotten the session does a full handshake,
+   * unless the client has a ticket that still carries the session. */
+  dtls_session_cache_flush(loopback_server);
+  dtls_session_cache_get_stats(loopback_client, &before);
+  ok = loopback_connect(0);
+  dtls_session_cache_get_stats(loopback_client, &after);
+#if DTLS_SESSION_TICKETS
+  failed += check(mode, "flushed server cache",
+		  ok && after.hits == before.hits + 1);
+#else /* DTLS_SESSION_TICKETS */
+  failed += check(mode, "flushed server cache",
+		  ok && after.misses == before.misses + 1 && after.entries == 1);
+#endif /* DTLS_SESSION_TICKETS */
+  disconnect(0);
+
+  /* a fatal alert from the server removes the client's session */
+  alert_to[LOOPBACK_TO_CLIENT] = 1;
+  ok = loopback_connect(0);
+  dtls_session_cache_get_stats(loopback_client, &after);
+  failed += check(mode, "fatal alert to client",
+		  !ok && after.entries == 0);
+  disconnect(0);
+
+  dtls_session_cache_get_stats(loopback_client, &before);
+  ok = loopback_connect(0);
+  dtls_session_cache_get_stats(loopback_client, &after);
+  failed += check(mode, "full handshake after fatal alert",
+		  ok && after.hits == before.hits &&
+		  after.misses == before.misses && after.entries == 1);
+  disconnect(0);
+
+#if !DTLS_SESSION_TICKETS
+  /* A fatal alert from the client in place of its Finished removes
+   * the sessions with the client from the server's cache. The alert
+   * replaces the third datagram after the ClientHello and the
+   * ClientHello with cookie. */
+  dtls_session_cache_get_stats(loopback_server, &before);
+  alert_to[LOOPBACK_TO_SERVER] = 3;
+  loopback_connect(0);
+  dtls_session_cache_get_stats(loopback_server, &after);
+  failed += check(mode, "fatal alert to server",
+		  after.hits == before.hits + 1 &&
+		  after.entries < before.entries);
+  disconnect(0);
+
+  dtls_session_cache_get_stats(loopback_client, &before);
+  ok = loopback_connect(0);
+  dtls_session_cache_get_stats(loopback_client, &after);
+  failed += check(mode, "full handshake after fatal alert",
+		  ok && after.misses == before.misses + 1);
+  disconnect(0);
+#endif /* !DTLS_SESSION_TICKETS */
+
+  /* Fill the client's cache, use session 0 again and connect to one
+   * more server. Session 1 is the least recently used one then. */
+  for (n = 1; n < DTLS_SESSION_CACHE_SIZE; n++) {
+    loopback_connect(n);
+    disconnect(n);
+  }
+  dtls_session_cache_get_stats(loopback_client, &before);
+  loopback_connect(0);
+  disconnect(0);
+  ok = loopback_connect(DTLS_SESSION_CACHE_SIZE);
+  disconnect(DTLS_SESSION_CACHE_SIZE);
+  dtls_session_cache_get_stats(loopback_client, &after);
+  failed += check(mode, "eviction",
+		  ok && after.entries == DTLS_SESSION_CACHE_SIZE &&
+		  after.evictions == before.evictions + 1 &&
+		  after.hits == before.hits + 1);
+
+  dtls_session_cache_get_stats(loopback_client, &before);
+  ok = loopback_connect(1);
+  disconnect(1);
+  dtls_session_cache_get_stats(loopback_client, &after);
+  ok = ok && after.hits == before.hits && after.misses == before.misses;
+  if (DTLS_SESSION_CACHE_SIZE > 2) {
+    /* session 0 has been used after session 2, which is replaced now */
+    ok = ok && loopback_connect(0);
+    disconnect(0);
+    dtls_session_cache_get_stats(loopback_client, &after);
+    ok = ok && after.hits == before.hits + 1;
+  }
+  failed += check(mode, "least recently used session replaced", ok);
+
+  /* the peer's identity is checked again before a session is resumed */
+  client_revoked = 1;
+  dtls_session_cache_get_stats(loopback_client, &before);
+  ok = loopback_connect(0);
+  dtls_session_cache_get_stats(loopback_client, &after);
+  failed += check(mode, "server revoked by client",
+		  !ok && after.hits == before.hits &&
+		  after.entries < before.entries);
+  client_revoked = 0;
+  disconnect(0);
+
+  loopback_connect(0);
+  disconnect(0);
+  server_revoked = 1;
+  resumed = server_resumed();
+  ok = loopback_connect(0);
+  failed += check(mode, "client revoked by server",
+		  !ok && server_resumed() == resumed);
+  server_revoked = 0;
+  disconnect(0);
+
+  dtls_free_context(loopback_client);
+  dtls_free_context(loopback_server);
+  return failed;
+}
+
+#if DTLS_SESSION_TICKETS
+/* The layout of a ticket: key name, CCM nonce, then the encrypted
+ * cipher suite, extended master secret flag, issue time, master
+ * secret and identity, followed by the MAC. */
+#define TICKET_NONCE_OFFSET DTLS_TICKET_KEY_NAME_LENGTH
+#define TICKET_STATE_OFFSET (TICKET_NONCE_OFFSET + 12)
+#define TICKET_ISSUED_OFFSET 3
+#define TICKET_MAC_LENGTH 8
+#define TICKET_LIFETIME (DTLS_TICKET_KEY_LIFETIME / CLOCK_SECOND)
+
+static const uint8 key_name[3][DTLS_TICKET_KEY_NAME_LENGTH + 1] = {
+  "ticket key one  ", "ticket key two  ", "ticket key three" };
+static const uint8 key_secret[3][DTLS_TICKET_KEY_LENGTH + 1] = {
+  "0123456789abcdef", "fedcba9876543210", "0011223344556677" };
+
+/* the ticket that the client keeps for server n */
+static dtls_session_cache_entry_t *
+client_ticket(int n) {
+  session_t session;
+  size_t i;
+
+  loopback_address(&session, LOOPBACK_SERVER_PORT + n);
+  for (i = 0; i < DTLS_SESSION_CACHE_SIZE; i++) {
+    dtls_session_cache_entry_t *entry = &loopback_client->session_cache.entry[i];
+    if (entry->id_length && entry->ticket_length &&
+	dtls_session_equals(&entry->session, &session))
+      return entry;
+  }
+  return NULL;
+}
+
+/* Moves the issue time of the client's ticket for server n, which
+ * has been issued under key k, by delta seconds. */
+static int
+reissue(int n, int k, long delta) {
+  dtls_session_cache_entry_t *entry = client_ticket(n);
+  uint8 state[DTLS_SESSION_TICKET_MAX_LENGTH];
+  rijndael_ctx ctx;
+  dtls_ccm_params_t params = { NULL, TICKET_MAC_LENGTH, 3 };
+  size_t length;
+  uint32_t issued;
+
+  if (!entry || entry->ticket_length < TICKET_STATE_OFFSET + TICKET_MAC_LENGTH)
+    return 0;
+  length = entry->ticket_length - TICKET_STATE_OFFSET;
+  params.nonce = entry->ticket + TICKET_NONCE_OFFSET;
+  rijndael_set_key_enc_only(&ctx, key_secret[k], 8 * DTLS_TICKET_KEY_LENGTH);
+  if (dtls_decrypt_params_ctx(&params, &ctx,
+			      entry->ticket + TICKET_STATE_OFFSET, length,
+			      state, entry->ticket,
+			      DTLS_TICKET_KEY_NAME_LENGTH) < 0)
+    return 0;
+
+  issued = dtls_uint32_to_int(state + TICKET_ISSUED_OFFSET) + delta;
+  dtls_int_to_uint32(state + TICKET_ISSUED_OFFSET, issued);
+  return dtls_encrypt_params_ctx(&params, &ctx, state,
+				 length - TICKET_MAC_LENGTH,
+				 entry->ticket + TICKET_STATE_OFFSET,
+				 entry->ticket,
+				 DTLS_TICKET_KEY_NAME_LENGTH) >= 0;
+}
+
+/* resumes the session with server n, returns 1 if it was resumed with a ticket */
+static int
+resume(int n) {
+  dtls_session_ticket_stats_t before, after;
+  int ok;
+
+  dtls_session_ticket_get_stats(loopback_server, &before);
+  ok = loopback_connect(n);
+  disconnect(n);
+  dtls_session_ticket_get_stats(loopback_server, &after);
+  return ok && after.accepted == before.accepted + 1;
+}
+
+static int
+run_tickets(const char *mode, dtls_handler_t *handler) {
+  dtls_session_ticket_stats_t before, after;
+  dtls_context_t *first, *other;
+  dtls_session_cache_entry_t *entry;
+  int failed = 0, ok;
+
+  loopback_client = dtls_new_context(NULL);
+  loopback_server = dtls_new_context(NULL);
+  other = dtls_new_context(NULL);
+  if (!loopback_client || !loopback_server || !other) {
+    printf("%s cannot create contexts FAILED\n", mode);
+    return 1;
+  }
+  dtls_set_handler(loopback_client, handler);
+  dtls_set_handler(loopback_server, handler);
+  dtls_set_handler(other, handler);
+  dtls_session_ticket_set_key(loopback_server, key_name[0], key_secret[0]);
+  dtls_session_ticket_set_key(other, key_name[0], key_secret[0]);
+
+  ok = loopback_connect(0);
+  disconnect(0);
+  dtls_session_ticket_get_stats(loopback_server, &after);
+  failed += check(mode, "ticket issued",
+		  ok && after.issued == 1 && client_ticket(0));
+
+  /* the server keeps no state, its cache is not needed */
+  dtls_session_cache_flush(loopback_server);
+  failed += check(mode, "ticket resumption", resume(0));
+
+  /* a server with the same key resumes the session */
+  first = loopback_server;
+  loopback_server = other;
+  failed += check(mode, "ticket with shared key", resume(0));
+  loopback_server = first;
+
+  entry = client_ticket(0);
+  if (entry)
+    entry->ticket[entry->ticket_length - 1] ^= 1;
+  dtls_session_ticket_get_stats(loopback_server, &before);
+  ok = loopback_connect(0);
+  disconnect(0);
+  dtls_session_ticket_get_stats(loopback_server, &after);
+  failed += check(mode, "tampered ticket",
+		  entry && ok && after.rejected == before.rejected + 1 &&
+		  after.accepted == before.accepted);
+
+  /* a ticket is accepted until the advertised lifetime has passed */
+  failed += check(mode, "ticket before its lifetime",
+		  reissue(0, 0, -(TICKET_LIFETIME - 60)) && resume(0));
+
+  dtls_session_ticket_get_stats(loopback_server, &before);
+  ok = reissue(0, 0, -TICKET_LIFETIME) && loopback_connect(0);
+  disconnect(0);
+  dtls_session_ticket_get_stats(loopback_server, &after);
+  failed += check(mode, "expired ticket",
+		  ok && after.rejected == before.rejected + 1 &&
+		  after.accepted == before.accepted);
+
+  dtls_session_ticket_get_stats(loopback_server, &before);
+  ok = reissue(0, 0, 2 * TICKET_LIFETIME) && loopback_connect(0);
+  disconnect(0);
+  dtls_session_ticket_get_stats(loopback_server, &after);
+  failed += check(mode, "ticket from the future",
+		  ok && after.rejected == before.rejected + 1);
+
+  /* a ticket under the previous key is accepted, an older one is not */
+  dtls_session_ticket_set_key(loopback_server, key_name[1], key_secret[1]);
+  failed += check(mode, "ticket under previous key", resume(0));
+  dtls_session_ticket_set_key(loopback_server, key_name[2], key_secret[2]);
+  dtls_session_ticket_set_key(loopback_server, key_name[0], key_secret[0]);
+  dtls_session_ticket_get_stats(loopback_server, &before);
+  ok = loopback_connect(0);
+  disconnect(0);
+  dtls_session_ticket_get_stats(loopback_server, &after);
+  failed += check(mode, "ticket under replaced key",
+		  ok && after.rejected == before.rejected + 1);
+
+  dtls_free_context(loopback_client);
+  dtls_free_context(loopback_server);
+  dtls_free_context(other);
+  return failed;
+}
+#endif /* DTLS_SESSION_TICKETS */
+
+int main(void) {
+  int failed = 0;
+
+  dtls_init();
+  dtls_set_log_level(DTLS_LOG_EMERG);
+  loopback_filter = inject_alert;
+
+#ifdef DTLS_PSK
+  failed += run("psk  ", &psk_handler);
+#endif /* DTLS_PSK */
+#ifdef DTLS_ECC
+  failed += run("ecdsa", &ecdsa_handler);
+#endif /* DTLS_ECC */
+#if DTLS_SESSION_TICKETS
+#ifdef DTLS_PSK
+  failed += run_tickets("psk  ", &psk_handler);
+#endif /* DTLS_PSK */
+#ifdef DTLS_ECC
+  failed += run_tickets("ecdsa", &ecdsa_handler);
+#endif /* DTLS_ECC */
+#endif /* DTLS_SESSION_TICKETS */
+
+  return failed ? -1 : 0;
+}
+#else /* DTLS_SESSION_CACHE_SIZE && (DTLS_PSK || DTLS_ECC) */
+int main(void) {
+  printf("resumption-test skipped, no session cache\n");
+  return 0;
+}
+#endif /* DTLS_SESSION_CACHE_SIZE && (DTLS_PSK || DTLS_ECC) */
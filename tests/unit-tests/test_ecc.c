@@ -190,6 +190,22 @@ t_test_ecc_ecdsa0(void) {
   CU_ASSERT(ret == -1);
 }
 
+static void
+t_test_ecc_ecdsa_precompute(void) {
+  int ret;
+  uint32_t tempx[9];
+  uint32_t tempy[9];
+  uint32_t kinv[8];
+
+  ret = ecc_ecdsa_sign_precompute(ecdsaTestRand1, tempx, kinv);
+  CU_ASSERT(ret == 0);
+  CU_ASSERT(ecc_isSame(tempx, ecdsaTestresultR1, arrayLength));
+
+  ret = ecc_ecdsa_sign_finish(ecdsaTestSecret, ecdsaTestMessage, tempx, kinv, tempy);
+  CU_ASSERT(ret == 0);
+  CU_ASSERT(ecc_isSame(tempy, ecdsaTestresultS1, arrayLength));
+}
+
 CU_pSuite
 t_init_ecc_tests(void) {
   CU_pSuite suite;
@@ -237,6 +253,11 @@ t_init_ecc_tests(void) {
             CU_get_error_msg());
   }
 
+  if (!CU_ADD_TEST(suite,t_test_ecc_ecdsa_precompute)) {
+    fprintf(stderr, "W: cannot add test for ECC ECDSA precomputation (%s)\n",
+            CU_get_error_msg());
+  }
+
   return suite;
 }
 
@@ -0,0 +1,171 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2023 Olaf Bergmann (TZI) and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ */
+
+#include <assert.h>
+
+#include "dtls_config.h"
+#include "test_hmac.h"
+
+#include "tinydtls.h"
+#include "hmac.h"
+
+#include <stdio.h>
+
+/* Test case 6 from RFC 4231, the key is longer than one block */
+static const uint8_t key6[131] = {
+  0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa,
+  0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa,
+  0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa,
+  0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa,
+  0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa,
+  0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa,
+  0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa,
+  0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa,
+  0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa,
+  0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa,
+  0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa
+};
+
+static const char data6[] =
+  "Test Using Larger Than Block-Size Key - Hash Key First";
+
+static const uint8_t result6[DTLS_HMAC_DIGEST_SIZE] = {
+  0x60, 0xe4, 0x31, 0x59, 0x1e, 0xe0, 0xb6, 0x7f,
+  0x0d, 0x8a, 0x26, 0xaa, 0xcb, 0xf5, 0xb7, 0x7f,
+  0x8e, 0x0b, 0xc6, 0x21, 0x37, 0x28, 0xc5, 0x14,
+  0x05, 0x46, 0x04, 0x0f, 0x0e, 0xe3, 0x7f, 0x54
+};
+
+/* Test case 2 from RFC 4231 */
+static void
+t_test_hmac0(void) {
+  const uint8_t key[] = { 0x4a, 0x65, 0x66, 0x65 };
+  const char data[] = "what do ya want for nothing?";
+  /* expected result */
+  const uint8_t result[] = {
+    0x5b, 0xdc, 0xc1, 0x46, 0xbf, 0x60, 0x75, 0x4e,
+    0x6a, 0x04, 0x24, 0x26, 0x08, 0x95, 0x75, 0xc7,
+    0x5a, 0x00, 0x3f, 0x08, 0x9d, 0x27, 0x39, 0x83,
+    0x9d, 0xec, 0x58, 0xb9, 0x64, 0xec, 0x38, 0x43
+  };
+  uint8_t outbuf[DTLS_HMAC_MAX];
+  dtls_hmac_context_t hmac;
+  int len;
+
+  dtls_hmac_init(&hmac, key, sizeof(key));
+  dtls_hmac_update(&hmac, (const unsigned char *)data, sizeof(data) - 1);
+  len = dtls_hmac_finalize(&hmac, outbuf);
+
+  CU_ASSERT_EQUAL(len, sizeof(result));
+  CU_ASSERT(memcmp(outbuf, result, sizeof(result)) == 0);
+}
+
+static void
+t_test_hmac1(void) {
+  uint8_t outbuf[DTLS_HMAC_MAX];
+  dtls_hmac_context_t hmac;
+  int len;
+
+  dtls_hmac_init(&hmac, key6, sizeof(key6));
+  dtls_hmac_update(&hmac, (const unsigned char *)data6, sizeof(data6) - 1);
+  len = dtls_hmac_finalize(&hmac, outbuf);
+
+  CU_ASSERT_EQUAL(len, sizeof(result6));
+  CU_ASSERT(memcmp(outbuf, result6, sizeof(result6)) == 0);
+}
+
+/* a prepared key must give the same result for each MAC started
+ * from it */
+static void
+t_test_hmac2(void) {
+  uint8_t outbuf[DTLS_HMAC_MAX];
+  dtls_hmac_context_t hmac;
+  dtls_hmac_key_t key;
+  int i, len;
+
+  dtls_hmac_key_init(&key, key6, sizeof(key6));
+
+  for (i = 0; i < 2; i++) {
+    memset(outbuf, 0, sizeof(outbuf));
+    dtls_hmac_clone(&hmac, &key);
+    dtls_hmac_update(&hmac, (const unsigned char *)data6, 20);
+    dtls_hmac_update(&hmac, (const unsigned char *)data6 + 20,
+                     sizeof(data6) - 21);
+    len = dtls_hmac_finalize(&hmac, outbuf);
+
+    CU_ASSERT_EQUAL(len, sizeof(result6));
+    CU_ASSERT(memcmp(outbuf, result6, sizeof(result6)) == 0);
+  }
+}
+
+/* dtls_hmac_multi() must give the same results as single HMACs, for
+ * messages that end in the same or in different blocks */
+static void
+t_test_hmac3(void) {
+  static uint8_t data[1000];
+  const unsigned char *msg[19];
+  size_t mlen[19];
+  uint8_t outbuf[19][DTLS_HMAC_DIGEST_SIZE];
+  unsigned char *result[19];
+  uint8_t expected[DTLS_HMAC_MAX];
+  dtls_hmac_context_t hmac;
+  dtls_hmac_key_t key;
+  size_t i;
+
+  for (i = 0; i < sizeof(data); i++)
+    data[i] = (uint8_t)(i * 7 + 3);
+
+  for (i = 0; i < 19; i++) {
+    msg[i] = data + i;
+    mlen[i] = (i * 53) % 300;
+    result[i] = outbuf[i];
+  }
+  msg[5] = (const unsigned char *)data6;
+  mlen[5] = sizeof(data6) - 1;
+
+  dtls_hmac_key_init(&key, key6, sizeof(key6));
+  dtls_hmac_multi(&key, msg, mlen, 19, result);
+  CU_ASSERT(memcmp(outbuf[5], result6, sizeof(result6)) == 0);
+
+  for (i = 0; i < 19; i++) {
+    dtls_hmac_init(&hmac, key6, sizeof(key6));
+    dtls_hmac_update(&hmac, msg[i], mlen[i]);
+    dtls_hmac_finalize(&hmac, expected);
+    CU_ASSERT(memcmp(outbuf[i], expected, DTLS_HMAC_DIGEST_SIZE) == 0);
+  }
+}
+
+CU_pSuite
+t_init_hmac_tests(void) {
+  CU_pSuite suite;
+
+  suite = CU_add_suite("HMAC", NULL, NULL);
+  if (!suite) {                        /* signal error */
+    fprintf(stderr, "W: cannot add HMAC test suite (%s)\n",
+            CU_get_error_msg());
+
+    return NULL;
+  }
+
+#define HMAC_TEST(s,t)                                                  \
+  if (!CU_ADD_TEST(s,t)) {                                              \
+    fprintf(stderr, "W: cannot add test for HMAC (%s)\n",               \
+            CU_get_error_msg());                                        \
+  }
+
+  HMAC_TEST(suite, t_test_hmac0);
+  HMAC_TEST(suite, t_test_hmac1);
+  HMAC_TEST(suite, t_test_hmac2);
+  HMAC_TEST(suite, t_test_hmac3);
+
+  return suite;
+}
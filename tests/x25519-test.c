@@ -0,0 +1,276 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2011-2023 Olaf Bergmann (TZI) and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *******************************************************************************/
+
+/*
+ * Checks the X25519 function against the test vectors of RFC 7748 and
+ * the ECDHE helpers of crypto.c and the x25519 keys of the ECDHE key
+ * pool. With -b, the time for an ephemeral
+ * key pair plus the shared secret is compared with the P-256 ECDH.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tinydtls.h"
+#include "dtls.h"
+#include "crypto.h"
+#include "dtls_prng.h"
+
+#ifdef DTLS_ECC
+struct test_vector {
+  const char *scalar;
+  const char *point;
+  const char *result;
+};
+
+/* RFC 7748, section 5.2 */
+static const struct test_vector data[] = {
+  { "a546e36bf0527c9d3b16154b82465edd62144c0ac1fc5a18506a2244ba449ac4",
+    "e6db6867583030db3594c1a424b15f7c726624ec26b3353b10a903a6d0ab1c4c",
+    "c3da55379de9c6908e94ea4df28d084f32eccf03491c71f754b4075577a28552" },
+  { "4b66e9d4d1b4673c5ad22691957d6af5c11b6421e0ea01d42ca4169e7918ba0d",
+    "e5210f12786811d3f4b7959d0538ae2c31dbe7106fc03c3efc4cd549c715a493",
+    "95cbde9476e8907d7aade45cb4b873f88b595a68799fa152e6f8f7647aac7957" }
+};
+
+/* the results of iterating k = X25519(k, u), u = k 1 and 1000 times */
+static const char *iterated[] = {
+  "422c8e7a6227d7bca1350b3e2bb7279f7897b87bb6854b783c60e80311ae3079",
+  "684cf59ba83309552800ef566f2f4d3c1c3887c49360e3875f2eb94d99532c51"
+};
+
+/* RFC 7748, section 6.1 */
+static const char *alice_priv =
+  "77076d0a7318a57d3c16c17251b26645df4c2f87ebc0992ab177fba51db92c2a";
+static const char *alice_pub =
+  "8520f0098930a754748b7ddcb43ef75a0dbf3a0d26381af4eba4a98eaa9b4e6a";
+static const char *bob_priv =
+  "5dab087e624a8a4b79e17f8b83800ee66f3bb1292618b6fd1c2f8b27ff88e0eb";
+static const char *bob_pub =
+  "de9edb7d7b7dc1b4d35b61c2ece435373f8343c85b78674dadfc7e146f882b4f";
+static const char *shared =
+  "4a5d9d5ba4ce2de1728e3bf480350f25e07e21c947d19e3376f09b3c1e161742";
+
+static void
+from_hex(const char *hex, unsigned char *buf) {
+  size_t i;
+
+  for (i = 0; i < DTLS_X25519_KEY_SIZE; i++) {
+    unsigned int v;
+    sscanf(hex + 2 * i, "%2x", &v);
+    buf[i] = (unsigned char)v;
+  }
+}
+
+static int
+check(const char *caption, const unsigned char *buf, const char *hex) {
+  unsigned char expected[DTLS_X25519_KEY_SIZE];
+
+  from_hex(hex, expected);
+  printf("%s ", caption);
+  if (memcmp(buf, expected, DTLS_X25519_KEY_SIZE)) {
+    printf("FAILED\n");
+    return 1;
+  }
+  printf("OK\n");
+  return 0;
+}
+
+static int
+run_vectors(void) {
+  unsigned char k[DTLS_X25519_KEY_SIZE], u[DTLS_X25519_KEY_SIZE];
+  unsigned char out[DTLS_X25519_KEY_SIZE];
+  char caption[32];
+  size_t n;
+  int i, res, failed = 0;
+
+  for (n = 0; n < sizeof(data)/sizeof(struct test_vector); ++n) {
+    from_hex(data[n].scalar, k);
+    from_hex(data[n].point, u);
+    dtls_x25519(out, k, u);
+    snprintf(caption, sizeof(caption), "Test Case #%lu", (unsigned long)n + 1);
+    failed += check(caption, out, data[n].result);
+  }
+
+  memset(k, 0, sizeof(k));
+  k[0] = 9;
+  memcpy(u, k, sizeof(u));
+  for (i = 1; i <= 1000; i++) {
+    dtls_x25519(out, k, u);
+    memcpy(u, k, sizeof(u));
+    memcpy(k, out, sizeof(k));
+    if (i == 1)
+      failed += check("1 iteration", k, iterated[0]);
+  }
+  failed += check("1000 iterations", k, iterated[1]);
+
+  from_hex(alice_priv, k);
+  dtls_x25519_base(out, k);
+  failed += check("Alice's public key", out, alice_pub);
+  from_hex(bob_pub, u);
+  dtls_x25519_pre_master_secret(k, u, out, sizeof(out));
+  failed += check("Alice's shared secret", out, shared);
+
+  from_hex(bob_priv, k);
+  dtls_x25519_base(out, k);
+  failed += check("Bob's public key", out, bob_pub);
+  from_hex(alice_pub, u);
+  dtls_x25519_pre_master_secret(k, u, out, sizeof(out));
+  failed += check("Bob's shared secret", out, shared);
+
+  /* u = 0 and u = 1 have small order and give an all zero secret */
+  memset(u, 0, sizeof(u));
+  res = dtls_x25519_pre_master_secret(k, u, out, sizeof(out));
+  u[0] = 1;
+  if (res < 0)
+    res = dtls_x25519_pre_master_secret(k, u, out, sizeof(out));
+  printf("small order points ");
+  if (res >= 0) {
+    printf("FAILED\n");
+    failed++;
+  } else {
+    printf("OK\n");
+  }
+
+  return failed;
+}
+
+/* generated key pairs agree on the shared secret */
+static int
+run_exchange(void) {
+  unsigned char priv_a[DTLS_X25519_KEY_SIZE], pub_a[DTLS_X25519_KEY_SIZE];
+  unsigned char priv_b[DTLS_X25519_KEY_SIZE], pub_b[DTLS_X25519_KEY_SIZE];
+  unsigned char secret_a[DTLS_X25519_KEY_SIZE], secret_b[DTLS_X25519_KEY_SIZE];
+  int n;
+
+  printf("key exchange ");
+  for (n = 0; n < 16; n++) {
+    dtls_x25519_generate_key(priv_a, pub_a);
+    dtls_x25519_generate_key(priv_b, pub_b);
+    if (dtls_x25519_pre_master_secret(priv_a, pub_b, secret_a,
+				      sizeof(secret_a)) != DTLS_X25519_KEY_SIZE ||
+	dtls_x25519_pre_master_secret(priv_b, pub_a, secret_b,
+				      sizeof(secret_b)) != DTLS_X25519_KEY_SIZE ||
+	memcmp(secret_a, secret_b, sizeof(secret_a))) {
+      printf("FAILED\n");
+      return 1;
+    }
+  }
+  printf("OK\n");
+  return 0;
+}
+
+/* the key pool keeps valid x25519 key pairs next to the secp256r1 ones */
+static int
+run_pool(void) {
+#if DTLS_ECDHE_POOL_SIZE && defined(DTLS_X25519)
+  dtls_context_t *ctx;
+  dtls_pool_stats_t stats;
+  unsigned char pub[DTLS_X25519_KEY_SIZE];
+  size_t n;
+  int failed = 0;
+
+  printf("key pool ");
+  ctx = dtls_new_context(NULL);
+  if (!ctx) {
+    printf("FAILED\n");
+    return 1;
+  }
+  dtls_ecdhe_pool_refill(ctx, 0);
+  dtls_ecdhe_pool_get_stats(ctx, &stats);
+  if (stats.available != 2 * DTLS_ECDHE_POOL_SIZE ||
+      ctx->ecdhe_pool.x25519_count != DTLS_ECDHE_POOL_SIZE ||
+      dtls_ecdhe_pool_needs_refill(ctx))
+    failed = 1;
+  for (n = 0; n < ctx->ecdhe_pool.x25519_count; n++) {
+    dtls_x25519_base(pub, ctx->ecdhe_pool.x25519[n].priv_key);
+    if (memcmp(pub, ctx->ecdhe_pool.x25519[n].pub_key_x, sizeof(pub)))
+      failed = 1;
+  }
+  dtls_free_context(ctx);
+  printf(failed ? "FAILED\n" : "OK\n");
+  return failed;
+#else /* DTLS_ECDHE_POOL_SIZE && DTLS_X25519 */
+  return 0;
+#endif /* DTLS_ECDHE_POOL_SIZE && DTLS_X25519 */
+}
+
+static double
+now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* one side of an ECDHE key exchange: an ephemeral key pair and the
+ * shared secret with the peer's key */
+static void
+bench(unsigned long rounds) {
+  unsigned char priv[DTLS_EC_KEY_SIZE], pub_x[DTLS_EC_KEY_SIZE];
+  unsigned char pub_y[DTLS_EC_KEY_SIZE];
+  unsigned char peer_priv[DTLS_EC_KEY_SIZE], peer_x[DTLS_EC_KEY_SIZE];
+  unsigned char peer_y[DTLS_EC_KEY_SIZE];
+  unsigned char secret[DTLS_EC_KEY_SIZE];
+  unsigned long n;
+  double start, t_p256, t_x25519;
+
+  dtls_ecdsa_generate_key(peer_priv, peer_x, peer_y, DTLS_EC_KEY_SIZE);
+  start = now();
+  for (n = 0; n < rounds; n++) {
+    dtls_ecdsa_generate_key(priv, pub_x, pub_y, DTLS_EC_KEY_SIZE);
+    dtls_ecdh_pre_master_secret(priv, peer_x, peer_y, DTLS_EC_KEY_SIZE,
+				secret, sizeof(secret));
+  }
+  t_p256 = now() - start;
+
+  dtls_x25519_generate_key(peer_priv, peer_x);
+  start = now();
+  for (n = 0; n < rounds; n++) {
+    dtls_x25519_generate_key(priv, pub_x);
+    dtls_x25519_pre_master_secret(priv, peer_x, secret, sizeof(secret));
+  }
+  t_x25519 = now() - start;
+
+  printf("\nECDHE key pair + shared secret, %lu rounds\n", rounds);
+  printf("%-12s %8.4f sec %10.0f ops/sec\n", "secp256r1:", t_p256,
+	 rounds / t_p256);
+  printf("%-12s %8.4f sec %10.0f ops/sec\n", "x25519:", t_x25519,
+	 rounds / t_x25519);
+  printf("speedup %.2f\n", t_p256 / t_x25519);
+}
+
+int main(int argc, char **argv) {
+  int failed;
+
+  dtls_init();
+  dtls_prng_init(0);
+
+  failed = run_vectors();
+  failed += run_exchange();
+  failed += run_pool();
+
+  if (argc > 1 && strcmp(argv[1], "-b") == 0)
+    bench(argc > 2 ? strtoul(argv[2], NULL, 10) : 1000);
+
+  return failed ? -1 : 0;
+}
+#else /* DTLS_ECC */
+int main(void) {
+  printf("x25519-test skipped, no DTLS_ECC support\n");
+  return 0;
+}
+#endif /* DTLS_ECC */
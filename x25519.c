@@ -0,0 +1,497 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2011-2023 Olaf Bergmann (TZI) and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *******************************************************************************/
+
+/*
+ * X25519 with the Montgomery ladder of RFC 7748. The field elements
+ * are kept in five 51-bit limbs where the compiler provides a 128-bit
+ * type, and in eight 32-bit words otherwise. All operations run in
+ * constant time, secret dependent choices are made with masks.
+ */
+
+#include <stdint.h>
+
+#include "x25519.h"
+
+#if defined(__SIZEOF_INT128__) && !defined(DTLS_X25519_NO_INT128)
+
+__extension__ typedef unsigned __int128 uint128_t;
+
+#define MASK51 (((uint64_t)1 << 51) - 1)
+
+/* f = f0 + f1 * 2^51 + ... + f4 * 2^204, the limbs may exceed 51 bits */
+typedef uint64_t fe[5];
+
+static inline uint64_t
+load64_le(const unsigned char *p) {
+  return (uint64_t)p[0] | ((uint64_t)p[1] << 8) |
+    ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24) |
+    ((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40) |
+    ((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+}
+
+static inline void
+store64_le(unsigned char *p, uint64_t v) {
+  int i;
+
+  for (i = 0; i < 8; i++)
+    p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static void
+fe_0(fe h) {
+  h[0] = h[1] = h[2] = h[3] = h[4] = 0;
+}
+
+static void
+fe_1(fe h) {
+  h[0] = 1;
+  h[1] = h[2] = h[3] = h[4] = 0;
+}
+
+static void
+fe_frombytes(fe h, const unsigned char s[32]) {
+  h[0] = load64_le(s) & MASK51;
+  h[1] = (load64_le(s + 6) >> 3) & MASK51;
+  h[2] = (load64_le(s + 12) >> 6) & MASK51;
+  h[3] = (load64_le(s + 19) >> 1) & MASK51;
+  h[4] = (load64_le(s + 24) >> 12) & MASK51;
+}
+
+static void
+fe_tobytes(unsigned char s[32], const fe f) {
+  uint64_t h0 = f[0], h1 = f[1], h2 = f[2], h3 = f[3], h4 = f[4];
+  uint64_t q;
+
+  /* two rounds of carries bring all limbs below 2^51 */
+  h1 += h0 >> 51; h0 &= MASK51;
+  h2 += h1 >> 51; h1 &= MASK51;
+  h3 += h2 >> 51; h2 &= MASK51;
+  h4 += h3 >> 51; h3 &= MASK51;
+  h0 += 19 * (h4 >> 51); h4 &= MASK51;
+  h1 += h0 >> 51; h0 &= MASK51;
+  h2 += h1 >> 51; h1 &= MASK51;
+  h3 += h2 >> 51; h2 &= MASK51;
+  h4 += h3 >> 51; h3 &= MASK51;
+  h0 += 19 * (h4 >> 51); h4 &= MASK51;
+
+  /* q = 1 if h >= p, then h - p = h + 19 - 2^255 */
+  q = (h0 + 19) >> 51;
+  q = (h1 + q) >> 51;
+  q = (h2 + q) >> 51;
+  q = (h3 + q) >> 51;
+  q = (h4 + q) >> 51;
+
+  h0 += 19 * q;
+  h1 += h0 >> 51; h0 &= MASK51;
+  h2 += h1 >> 51; h1 &= MASK51;
+  h3 += h2 >> 51; h2 &= MASK51;
+  h4 += h3 >> 51; h3 &= MASK51;
+  h4 &= MASK51;
+
+  store64_le(s, h0 | (h1 << 51));
+  store64_le(s + 8, (h1 >> 13) | (h2 << 38));
+  store64_le(s + 16, (h2 >> 26) | (h3 << 25));
+  store64_le(s + 24, (h3 >> 39) | (h4 << 12));
+}
+
+static void
+fe_add(fe h, const fe f, const fe g) {
+  h[0] = f[0] + g[0];
+  h[1] = f[1] + g[1];
+  h[2] = f[2] + g[2];
+  h[3] = f[3] + g[3];
+  h[4] = f[4] + g[4];
+}
+
+/* h = f - g + 4p, g must be below 2^53 in every limb */
+static void
+fe_sub(fe h, const fe f, const fe g) {
+  h[0] = f[0] + 0x1fffffffffffb4ULL - g[0];
+  h[1] = f[1] + 0x1ffffffffffffcULL - g[1];
+  h[2] = f[2] + 0x1ffffffffffffcULL - g[2];
+  h[3] = f[3] + 0x1ffffffffffffcULL - g[3];
+  h[4] = f[4] + 0x1ffffffffffffcULL - g[4];
+}
+
+/* reduces the 128-bit column sums t to limbs of about 51 bits */
+static void
+fe_carry(fe h, uint128_t t0, uint128_t t1, uint128_t t2,
+	 uint128_t t3, uint128_t t4) {
+  t1 += (uint64_t)(t0 >> 51);
+  t2 += (uint64_t)(t1 >> 51);
+  t3 += (uint64_t)(t2 >> 51);
+  t4 += (uint64_t)(t3 >> 51);
+  t0 = ((uint64_t)t0 & MASK51) + (uint128_t)(t4 >> 51) * 19;
+  h[1] = ((uint64_t)t1 & MASK51) + (uint64_t)(t0 >> 51);
+  h[0] = (uint64_t)t0 & MASK51;
+  h[2] = (uint64_t)t2 & MASK51;
+  h[3] = (uint64_t)t3 & MASK51;
+  h[4] = (uint64_t)t4 & MASK51;
+}
+
+/* h = f * g, the limbs of f and g must be below 2^54 */
+static void
+fe_mul(fe h, const fe f, const fe g) {
+  uint64_t g1_19 = 19 * g[1], g2_19 = 19 * g[2];
+  uint64_t g3_19 = 19 * g[3], g4_19 = 19 * g[4];
+  uint128_t t0, t1, t2, t3, t4;
+
+  t0 = (uint128_t)f[0] * g[0] + (uint128_t)f[1] * g4_19 +
+    (uint128_t)f[2] * g3_19 + (uint128_t)f[3] * g2_19 +
+    (uint128_t)f[4] * g1_19;
+  t1 = (uint128_t)f[0] * g[1] + (uint128_t)f[1] * g[0] +
+    (uint128_t)f[2] * g4_19 + (uint128_t)f[3] * g3_19 +
+    (uint128_t)f[4] * g2_19;
+  t2 = (uint128_t)f[0] * g[2] + (uint128_t)f[1] * g[1] +
+    (uint128_t)f[2] * g[0] + (uint128_t)f[3] * g4_19 +
+    (uint128_t)f[4] * g3_19;
+  t3 = (uint128_t)f[0] * g[3] + (uint128_t)f[1] * g[2] +
+    (uint128_t)f[2] * g[1] + (uint128_t)f[3] * g[0] +
+    (uint128_t)f[4] * g4_19;
+  t4 = (uint128_t)f[0] * g[4] + (uint128_t)f[1] * g[3] +
+    (uint128_t)f[2] * g[2] + (uint128_t)f[3] * g[1] +
+    (uint128_t)f[4] * g[0];
+
+  fe_carry(h, t0, t1, t2, t3, t4);
+}
+
+static void
+fe_sq(fe h, const fe f) {
+  uint64_t f0_2 = 2 * f[0], f1_2 = 2 * f[1];
+  uint64_t f3_19 = 19 * f[3], f4_19 = 19 * f[4];
+  uint128_t t0, t1, t2, t3, t4;
+
+  t0 = (uint128_t)f[0] * f[0] + (uint128_t)f1_2 * f4_19 +
+    (uint128_t)(2 * f[2]) * f3_19;
+  t1 = (uint128_t)f0_2 * f[1] + (uint128_t)(2 * f[2]) * f4_19 +
+    (uint128_t)f[3] * f3_19;
+  t2 = (uint128_t)f0_2 * f[2] + (uint128_t)f[1] * f[1] +
+    (uint128_t)(2 * f[3]) * f4_19;
+  t3 = (uint128_t)f0_2 * f[3] + (uint128_t)f1_2 * f[2] +
+    (uint128_t)f[4] * f4_19;
+  t4 = (uint128_t)f0_2 * f[4] + (uint128_t)f1_2 * f[3] +
+    (uint128_t)f[2] * f[2];
+
+  fe_carry(h, t0, t1, t2, t3, t4);
+}
+
+/* h = f * 121665 */
+static void
+fe_mul121665(fe h, const fe f) {
+  fe_carry(h, (uint128_t)f[0] * 121665, (uint128_t)f[1] * 121665,
+	   (uint128_t)f[2] * 121665, (uint128_t)f[3] * 121665,
+	   (uint128_t)f[4] * 121665);
+}
+
+/* swaps f and g if b is 1, leaves them unchanged if b is 0 */
+static void
+fe_cswap(fe f, fe g, unsigned int b) {
+  uint64_t mask = (uint64_t)0 - b, x;
+  int i;
+
+  for (i = 0; i < 5; i++) {
+    x = mask & (f[i] ^ g[i]);
+    f[i] ^= x;
+    g[i] ^= x;
+  }
+}
+
+#else /* __SIZEOF_INT128__ */
+
+/* f = f0 + f1 * 2^32 + ... + f7 * 2^224, kept below 2^256 but not
+ * necessarily below p */
+typedef uint32_t fe[8];
+
+static void
+fe_0(fe h) {
+  int i;
+
+  for (i = 0; i < 8; i++)
+    h[i] = 0;
+}
+
+static void
+fe_1(fe h) {
+  fe_0(h);
+  h[0] = 1;
+}
+
+static void
+fe_frombytes(fe h, const unsigned char s[32]) {
+  int i;
+
+  for (i = 0; i < 8; i++)
+    h[i] = (uint32_t)s[4 * i] | ((uint32_t)s[4 * i + 1] << 8) |
+      ((uint32_t)s[4 * i + 2] << 16) | ((uint32_t)s[4 * i + 3] << 24);
+  h[7] &= 0x7fffffff;
+}
+
+/* adds 38 * c to h and folds the carry once more, as 2^256 = 38 mod p */
+static void
+fe_fold(fe h, uint32_t c) {
+  uint64_t t = (uint64_t)c * 38;
+  int i;
+
+  for (i = 0; i < 8; i++) {
+    t += h[i];
+    h[i] = (uint32_t)t;
+    t >>= 32;
+  }
+  /* after a carry h is small, adding 38 cannot carry again */
+  h[0] += (uint32_t)t * 38;
+}
+
+static void
+fe_tobytes(unsigned char s[32], const fe f) {
+  uint32_t h[8], g[8], mask;
+  uint64_t t;
+  int i;
+
+  /* fold bit 255, h < p + 19 afterwards */
+  t = (uint64_t)(f[7] >> 31) * 19;
+  for (i = 0; i < 8; i++) {
+    t += i == 7 ? (f[7] & 0x7fffffff) : f[i];
+    h[i] = (uint32_t)t;
+    t >>= 32;
+  }
+
+  /* g = h + 19, which has bit 255 set if h >= p */
+  t = 19;
+  for (i = 0; i < 8; i++) {
+    t += h[i];
+    g[i] = (uint32_t)t;
+    t >>= 32;
+  }
+  mask = (uint32_t)0 - (g[7] >> 31);
+  g[7] &= 0x7fffffff;
+
+  for (i = 0; i < 8; i++) {
+    h[i] = (h[i] & ~mask) | (g[i] & mask);
+    s[4 * i] = (unsigned char)h[i];
+    s[4 * i + 1] = (unsigned char)(h[i] >> 8);
+    s[4 * i + 2] = (unsigned char)(h[i] >> 16);
+    s[4 * i + 3] = (unsigned char)(h[i] >> 24);
+  }
+}
+
+static void
+fe_add(fe h, const fe f, const fe g) {
+  uint64_t t = 0;
+  int i;
+
+  for (i = 0; i < 8; i++) {
+    t += (uint64_t)f[i] + g[i];
+    h[i] = (uint32_t)t;
+    t >>= 32;
+  }
+  fe_fold(h, (uint32_t)t);
+}
+
+static void
+fe_sub(fe h, const fe f, const fe g) {
+  uint64_t t;
+  uint32_t borrow = 0;
+  int i;
+
+  for (i = 0; i < 8; i++) {
+    t = (uint64_t)f[i] - g[i] - borrow;
+    h[i] = (uint32_t)t;
+    borrow = (uint32_t)(t >> 63);
+  }
+
+  /* h wrapped around 2^256, subtract 38 to get f - g mod p */
+  t = (uint64_t)borrow * 38;
+  for (i = 0; i < 8; i++) {
+    t = (uint64_t)h[i] - t;
+    h[i] = (uint32_t)t;
+    t = t >> 63;
+  }
+  /* a second borrow leaves h above 2^256 - 38, no further borrow */
+  h[0] -= (uint32_t)t * 38;
+}
+
+/* reduces the 512-bit product t to h */
+static void
+fe_reduce(fe h, const uint32_t t[16]) {
+  uint64_t c = 0;
+  int i;
+
+  for (i = 0; i < 8; i++) {
+    c += (uint64_t)t[i + 8] * 38 + t[i];
+    h[i] = (uint32_t)c;
+    c >>= 32;
+  }
+  fe_fold(h, (uint32_t)c);
+}
+
+static void
+fe_mul(fe h, const fe f, const fe g) {
+  uint32_t t[16];
+  uint64_t c;
+  int i, j;
+
+  for (i = 0; i < 16; i++)
+    t[i] = 0;
+  for (i = 0; i < 8; i++) {
+    c = 0;
+    for (j = 0; j < 8; j++) {
+      c += (uint64_t)f[i] * g[j] + t[i + j];
+      t[i + j] = (uint32_t)c;
+      c >>= 32;
+    }
+    t[i + 8] = (uint32_t)c;
+  }
+  fe_reduce(h, t);
+}
+
+static void
+fe_sq(fe h, const fe f) {
+  fe_mul(h, f, f);
+}
+
+/* h = f * 121665 */
+static void
+fe_mul121665(fe h, const fe f) {
+  uint64_t c = 0;
+  int i;
+
+  for (i = 0; i < 8; i++) {
+    c += (uint64_t)f[i] * 121665;
+    h[i] = (uint32_t)c;
+    c >>= 32;
+  }
+  fe_fold(h, (uint32_t)c);
+}
+
+/* swaps f and g if b is 1, leaves them unchanged if b is 0 */
+static void
+fe_cswap(fe f, fe g, unsigned int b) {
+  uint32_t mask = (uint32_t)0 - b, x;
+  int i;
+
+  for (i = 0; i < 8; i++) {
+    x = mask & (f[i] ^ g[i]);
+    f[i] ^= x;
+    g[i] ^= x;
+  }
+}
+
+#endif /* __SIZEOF_INT128__ */
+
+/* h = f^(2^n) */
+static void
+fe_sqn(fe h, const fe f, int n) {
+  fe_sq(h, f);
+  while (--n > 0)
+    fe_sq(h, h);
+}
+
+/* h = z^(p - 2) = 1/z, with the addition chain from curve25519-donna */
+static void
+fe_invert(fe h, const fe z) {
+  fe z2, z9, z11, z2_5_0, z2_10_0, z2_20_0, z2_50_0, z2_100_0, t;
+
+  fe_sq(z2, z);
+  fe_sqn(t, z2, 2);
+  fe_mul(z9, t, z);
+  fe_mul(z11, z9, z2);
+  fe_sq(t, z11);
+  fe_mul(z2_5_0, t, z9);
+  fe_sqn(t, z2_5_0, 5);
+  fe_mul(z2_10_0, t, z2_5_0);
+  fe_sqn(t, z2_10_0, 10);
+  fe_mul(z2_20_0, t, z2_10_0);
+  fe_sqn(t, z2_20_0, 20);
+  fe_mul(t, t, z2_20_0);
+  fe_sqn(t, t, 10);
+  fe_mul(z2_50_0, t, z2_10_0);
+  fe_sqn(t, z2_50_0, 50);
+  fe_mul(z2_100_0, t, z2_50_0);
+  fe_sqn(t, z2_100_0, 100);
+  fe_mul(t, t, z2_100_0);
+  fe_sqn(t, t, 50);
+  fe_mul(t, t, z2_50_0);
+  fe_sqn(t, t, 5);
+  fe_mul(h, t, z11);
+}
+
+int
+dtls_x25519(unsigned char out[DTLS_X25519_KEY_SIZE],
+	    const unsigned char scalar[DTLS_X25519_KEY_SIZE],
+	    const unsigned char point[DTLS_X25519_KEY_SIZE]) {
+  unsigned char k[DTLS_X25519_KEY_SIZE];
+  fe x1, x2, z2, x3, z3, a, aa, b, bb, e, c, d;
+  unsigned int swap = 0, bit;
+  unsigned char nonzero = 0;
+  int i;
+
+  for (i = 0; i < DTLS_X25519_KEY_SIZE; i++)
+    k[i] = scalar[i];
+  k[0] &= 248;
+  k[31] &= 127;
+  k[31] |= 64;
+
+  fe_frombytes(x1, point);
+  fe_1(x2);
+  fe_0(z2);
+  for (i = 0; i < (int)(sizeof(fe) / sizeof(x1[0])); i++)
+    x3[i] = x1[i];
+  fe_1(z3);
+
+  for (i = 254; i >= 0; i--) {
+    bit = (k[i >> 3] >> (i & 7)) & 1;
+    swap ^= bit;
+    fe_cswap(x2, x3, swap);
+    fe_cswap(z2, z3, swap);
+    swap = bit;
+
+    fe_add(a, x2, z2);
+    fe_sq(aa, a);
+    fe_sub(b, x2, z2);
+    fe_sq(bb, b);
+    fe_sub(e, aa, bb);
+    fe_add(c, x3, z3);
+    fe_sub(d, x3, z3);
+    fe_mul(d, d, a);		/* DA */
+    fe_mul(c, c, b);		/* CB */
+    fe_add(x3, d, c);
+    fe_sq(x3, x3);
+    fe_sub(z3, d, c);
+    fe_sq(z3, z3);
+    fe_mul(z3, z3, x1);
+    fe_mul(x2, aa, bb);
+    fe_mul121665(z2, e);
+    fe_add(z2, z2, aa);
+    fe_mul(z2, z2, e);
+  }
+  fe_cswap(x2, x3, swap);
+  fe_cswap(z2, z3, swap);
+
+  fe_invert(z2, z2);
+  fe_mul(x2, x2, z2);
+  fe_tobytes(out, x2);
+
+  for (i = 0; i < DTLS_X25519_KEY_SIZE; i++) {
+    nonzero |= out[i];
+    k[i] = 0;
+  }
+  return nonzero ? 0 : -1;
+}
+
+void
+dtls_x25519_base(unsigned char out[DTLS_X25519_KEY_SIZE],
+		 const unsigned char scalar[DTLS_X25519_KEY_SIZE]) {
+  static const unsigned char base[DTLS_X25519_KEY_SIZE] = { 9 };
+
+  dtls_x25519(out, scalar, base);
+}
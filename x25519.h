@@ -0,0 +1,43 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2011-2023 Olaf Bergmann (TZI) and others.
+ * All rights reserved. This program and the accompanying materials
+ * are made available under the terms of the Eclipse Public License v1.0
+ * and Eclipse Distribution License v. 1.0 which accompanies this distribution.
+ *
+ * The Eclipse Public License is available at http://www.eclipse.org/legal/epl-v10.html
+ * and the Eclipse Distribution License is available at
+ * http://www.eclipse.org/org/documents/edl-v10.php.
+ *
+ *******************************************************************************/
+
+#ifndef _DTLS_X25519_H_
+#define _DTLS_X25519_H_
+
+/* implementation of the X25519 function, RFC 7748 */
+
+#define DTLS_X25519_KEY_SIZE 32 /**< size of scalars and u-coordinates */
+
+/**
+ * Multiplies the u-coordinate @p point by @p scalar. Both and the
+ * result are little-endian byte strings as in RFC 7748. The scalar is
+ * clamped and the most significant bit of @p point is ignored.
+ *
+ * @param out    The resulting u-coordinate.
+ * @param scalar The scalar.
+ * @param point  The u-coordinate to multiply.
+ * @return @c 0 on success, or @c -1 if the result is all zero, i.e.
+ *         @p point has small order.
+ */
+int dtls_x25519(unsigned char out[DTLS_X25519_KEY_SIZE],
+		const unsigned char scalar[DTLS_X25519_KEY_SIZE],
+		const unsigned char point[DTLS_X25519_KEY_SIZE]);
+
+/**
+ * Computes the public key for the private key @p scalar, i.e. the
+ * multiple of the base point u = 9.
+ */
+void dtls_x25519_base(unsigned char out[DTLS_X25519_KEY_SIZE],
+		      const unsigned char scalar[DTLS_X25519_KEY_SIZE]);
+
+#endif /* _DTLS_X25519_H_ */